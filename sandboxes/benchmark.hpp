@@ -0,0 +1,30 @@
+#ifndef slic3r_sandboxes_benchmark_hpp_
+#define slic3r_sandboxes_benchmark_hpp_
+
+#include <algorithm>
+#include <limits>
+
+#include "libnest2d/tools/benchmark.h"
+
+// Timing helper shared by the sandboxes comparing two implementations of the same algorithm.
+
+namespace Slic3r { namespace sandboxes {
+
+// Returns the best wall clock time of num_runs calls of fn() in seconds, filtering out the noise of the other processes.
+template<typename Fn>
+double measure(Fn fn, int num_runs = 3)
+{
+    Benchmark b;
+    double best = std::numeric_limits<double>::max();
+    for (int i = 0; i < num_runs; ++ i) {
+        b.start();
+        fn();
+        b.stop();
+        best = std::min(best, b.getElapsedSec());
+    }
+    return best;
+}
+
+} } // namespace Slic3r::sandboxes
+
+#endif // slic3r_sandboxes_benchmark_hpp_
@@ -0,0 +1,98 @@
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <optional>
+#include <string>
+
+#include <tbb/global_control.h>
+#include <tbb/parallel_for.h>
+
+#include "libslic3r/ClipperUtils.hpp"
+#include "libslic3r/ExPolygon.hpp"
+
+#include "../benchmark.hpp"
+
+// Times a per layer pipeline of Clipper booleans and offsets resembling prepare_infill() / discover_vertical_shells(),
+// run over all layers in parallel, with the Clipper temporaries allocated from the system allocator
+// and from the thread local arena (ClipperLib::ArenaScope per task).
+
+const std::string USAGE_STR = {
+    "Usage: clipper_arena [thread_count] [layer_count] [hole_count]"
+};
+
+using namespace Slic3r;
+using sandboxes::measure;
+
+// A 100mm x 100mm plate with a grid of round holes, the holes drift with the layer index,
+// so that the neighbouring layers differ.
+static ExPolygons make_layer(size_t layer_id, size_t hole_count)
+{
+    static constexpr double size = 100.;
+    ExPolygon plate;
+    plate.contour.points = { Point::new_scale(0., 0.), Point::new_scale(size, 0.), Point::new_scale(size, size), Point::new_scale(0., size) };
+    size_t columns = size_t(std::ceil(std::sqrt(double(hole_count))));
+    double pitch   = size / double(columns + 1);
+    double shift   = 0.05 * double(layer_id % 20);
+    for (size_t i = 0; i < hole_count; ++ i) {
+        Vec2d  center(pitch * double(i % columns + 1) + shift, pitch * double(i / columns + 1) - shift);
+        double radius = 0.3 * pitch;
+        Polygon hole;
+        for (int j = 0; j < 64; ++ j) {
+            double angle = - 2. * PI * double(j) / 64.;
+            hole.points.emplace_back(Point::new_scale(center.x() + radius * std::cos(angle), center.y() + radius * std::sin(angle)));
+        }
+        plate.holes.emplace_back(std::move(hole));
+    }
+    return { plate };
+}
+
+static size_t process_layer(const ExPolygons &below, const ExPolygons &layer, const ExPolygons &above)
+{
+    const float perimeters = float(scale_(1.2));
+    const float spacing    = float(scale_(0.45));
+    ExPolygons  infill     = offset_ex(layer, - perimeters);
+    Polygons    top        = diff(layer, above);
+    Polygons    bottom     = diff(layer, below);
+    Polygons    shell      = union_(offset(top, spacing), offset(bottom, spacing));
+    ExPolygons  solid      = intersection_ex(infill, shell);
+    ExPolygons  sparse     = diff_ex(infill, solid);
+    ExPolygons  merged     = union_ex(offset2_ex(solid, spacing, - spacing));
+    return solid.size() + sparse.size() + merged.size();
+}
+
+int main(const int argc, const char *argv[])
+{
+    size_t thread_count = argc > 1 ? size_t(std::stoul(argv[1])) : 16;
+    size_t layer_count  = argc > 2 ? size_t(std::stoul(argv[2])) : 400;
+    size_t hole_count   = argc > 3 ? size_t(std::stoul(argv[3])) : 100;
+    if (thread_count == 0 || layer_count < 3) {
+        std::cout << USAGE_STR << std::endl;
+        return EXIT_FAILURE;
+    }
+    tbb::global_control parallelism(tbb::global_control::max_allowed_parallelism, thread_count);
+
+    std::vector<ExPolygons> layers;
+    for (size_t i = 0; i < layer_count; ++ i)
+        layers.emplace_back(make_layer(i, hole_count));
+
+    auto run = [&layers](bool use_arena) {
+        std::vector<size_t> results(layers.size(), 0);
+        tbb::parallel_for(tbb::blocked_range<size_t>(1, layers.size() - 1), [&](const tbb::blocked_range<size_t> &range) {
+            std::optional<ClipperLib::ArenaScope> clipper_arena;
+            if (use_arena)
+                clipper_arena.emplace();
+            for (size_t i = range.begin(); i < range.end(); ++ i)
+                results[i] = process_layer(layers[i - 1], layers[i], layers[i + 1]);
+        });
+        return results;
+    };
+
+    std::vector<size_t> res_heap, res_arena;
+    double t_heap  = measure([&]() { res_heap  = run(false); });
+    double t_arena = measure([&]() { res_arena = run(true); });
+
+    std::cout << layer_count << " layers, " << hole_count << " holes per layer, " << thread_count << " threads" << std::endl
+              << "  system allocator: " << t_heap << " s" << std::endl
+              << "  arena:            " << t_arena << " s, speedup " << t_heap / t_arena << std::endl;
+    return res_heap == res_arena ? EXIT_SUCCESS : EXIT_FAILURE;
+}
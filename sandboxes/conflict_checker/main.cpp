@@ -0,0 +1,119 @@
+#include <algorithm>
+#include <iostream>
+#include <optional>
+#include <string>
+
+#include "libslic3r/GCode/ConflictChecker.hpp"
+
+#include "../benchmark.hpp"
+
+// Times the conflict check of a plate with many objects with dense infill, the original check (the per-layer
+// lines of all objects rasterized together into a std::map of grid cells) against the bounding box culled
+// broad phase with the flat cell list.
+
+const std::string USAGE_STR = {
+    "Usage: conflict_checker [object_count] [layer_count] [overlap]\n"
+    "  overlap: 1 to make the infill of two neighbouring objects cross each other on the top layer"
+};
+
+using namespace Slic3r;
+using sandboxes::measure;
+
+// Perimeter square and a zig-zag infill of a 20mm x 20mm object.
+static ExtrusionLayers make_object_layers(size_t layer_count, bool extend_infill_on_top)
+{
+    static constexpr double size    = 20.;
+    static constexpr double spacing = 0.45;
+    static constexpr float  height  = 0.2f;
+
+    ExtrusionLayers layers;
+    layers.type = ExtrusionLayersType::PERIMETERS;
+    for (size_t layer_id = 0; layer_id < layer_count; ++ layer_id) {
+        ExtrusionLayer layer;
+        layer.layer    = nullptr;
+        layer.bottom_z = height * float(layer_id);
+        layer.height   = height;
+
+        ExtrusionPaths paths;
+        ExtrusionPath perimeter(erExternalPerimeter, 0.05, 0.45f, height);
+        perimeter.polyline.points = { Point::new_scale(0., 0.), Point::new_scale(size, 0.), Point::new_scale(size, size), Point::new_scale(0., size), Point::new_scale(0., 0.) };
+        paths.emplace_back(std::move(perimeter));
+
+        bool   extend = extend_infill_on_top && layer_id + 1 == layer_count;
+        double x_max  = extend ? size * 1.5 : size - spacing;
+        ExtrusionPath infill(erInternalInfill, 0.05, 0.45f, height);
+        for (double y = spacing; y < size - spacing; y += 2. * spacing) {
+            infill.polyline.points.emplace_back(Point::new_scale(spacing, y));
+            infill.polyline.points.emplace_back(Point::new_scale(x_max, y));
+            infill.polyline.points.emplace_back(Point::new_scale(x_max, y + spacing));
+            infill.polyline.points.emplace_back(Point::new_scale(spacing, y + spacing));
+        }
+        paths.emplace_back(std::move(infill));
+        layer.own_toolpaths = FlatToolpaths(paths);
+        layers.push_back(std::move(layer));
+    }
+    return layers;
+}
+
+static void fill_queue(LinesBucketQueue &queue, const std::vector<ExtrusionLayers> &objects)
+{
+    // Objects on a grid with 2mm gaps, so the neighbouring bounding boxes touch only with overlapping infill.
+    size_t columns = size_t(std::ceil(std::sqrt(double(objects.size()))));
+    for (size_t i = 0; i < objects.size(); ++ i) {
+        ExtrusionLayers layers = objects[i];
+        queue.emplace_back_bucket(std::move(layers), &objects[i], Point::new_scale(22. * double(i % columns), 22. * double(i / columns)));
+    }
+}
+
+// All lines of a layer copied into per line structs and rasterized together into a std::map of grid cells,
+// as the conflict checker used to do.
+static std::optional<std::pair<ConflictComputeResult, float>> find_all_lines(LinesBucketQueue &queue)
+{
+    while (queue.valid()) {
+        LineWithIDs lines;
+        for (const LinesBucketRange &range : queue.getCurRanges())
+            for (int i = range.begin; i < range.end; ++ i)
+                range.bucket->_piles[i].get_toolpaths().for_each_path([&](const FlatToolpaths::Path &path, const Point *begin, const Point *end) {
+                    Polyline polyline(Points(begin, end));
+                    polyline.translate(range.bucket->_offset);
+                    for (const Line &line : polyline.lines())
+                        lines.emplace_back(line, range.bucket->_id, path.role);
+                });
+        float bottom_z = queue.getCurrBottomZ();
+        if (auto res = ConflictChecker::find_inter_of_lines(lines); res.has_value())
+            return std::make_pair(*res, bottom_z);
+    }
+    return {};
+}
+
+int main(const int argc, const char *argv[])
+{
+    size_t object_count = argc > 1 ? size_t(std::stoul(argv[1])) : 36;
+    size_t layer_count  = argc > 2 ? size_t(std::stoul(argv[2])) : 100;
+    bool   overlap      = argc > 3 && std::string(argv[3]) == "1";
+    if (object_count < 2) {
+        std::cout << USAGE_STR << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    std::vector<ExtrusionLayers> objects;
+    for (size_t i = 0; i < object_count; ++ i)
+        objects.emplace_back(make_object_layers(layer_count, overlap && i == 0));
+
+    std::optional<std::pair<ConflictComputeResult, float>> res_all, res_culled;
+    double t_all = measure([&]() {
+        LinesBucketQueue queue;
+        fill_queue(queue, objects);
+        res_all = find_all_lines(queue);
+    });
+    double t_culled = measure([&]() {
+        LinesBucketQueue queue;
+        fill_queue(queue, objects);
+        res_culled = ConflictChecker::find_inter_of_buckets(queue);
+    });
+
+    std::cout << object_count << " objects, " << layer_count << " layers" << std::endl
+              << "  std::map, all lines: " << t_all << " s, conflict " << (res_all ? std::to_string(res_all->second) : "none") << std::endl
+              << "  bounding box culled: " << t_culled << " s, conflict " << (res_culled ? std::to_string(res_culled->second) : "none") << std::endl;
+    return res_all.has_value() == res_culled.has_value() ? EXIT_SUCCESS : EXIT_FAILURE;
+}
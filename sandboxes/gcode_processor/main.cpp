@@ -0,0 +1,74 @@
+#include <iostream>
+#include <memory>
+#include <string>
+
+#include <boost/filesystem.hpp>
+
+#include "libslic3r/GCode/GCodeProcessor.hpp"
+#include "libslic3r/LocalesUtils.hpp"
+
+#include "../benchmark.hpp"
+
+// Compares the serial and the parallel parsing of GCodeProcessor::process_file() on exported G-code files,
+// both for speed and for the identity of the results.
+
+const std::string USAGE_STR = {
+    "Usage: gcode_processor file1.gcode [file2.gcode ...]"
+};
+
+using namespace Slic3r;
+using sandboxes::measure;
+
+static std::unique_ptr<GCodeProcessor> process(const std::string &path, bool parallel, double &elapsed)
+{
+    auto processor = std::make_unique<GCodeProcessor>();
+    processor->enable_parallel_parsing(parallel);
+    // A single run, the processors are compared after the measurement.
+    elapsed = measure([&processor, &path]() { processor->process_file(path); }, 1);
+    return processor;
+}
+
+static bool same_results(const GCodeProcessorResult &lhs, const GCodeProcessorResult &rhs)
+{
+    if (lhs.moves.size() != rhs.moves.size() || lhs.lines_ends != rhs.lines_ends)
+        return false;
+    for (size_t i = 0; i < lhs.moves.size(); ++ i) {
+        const GCodeProcessorResult::MoveVertex &l = lhs.moves[i];
+        const GCodeProcessorResult::MoveVertex &r = rhs.moves[i];
+        if (l.gcode_id != r.gcode_id || l.type != r.type || l.extrusion_role != r.extrusion_role || l.extruder_id != r.extruder_id ||
+            l.position != r.position || l.delta_extruder != r.delta_extruder || l.feedrate != r.feedrate || l.time != r.time)
+            return false;
+    }
+    for (size_t i = 0; i < size_t(PrintEstimatedStatistics::ETimeMode::Count); ++ i)
+        if (lhs.print_statistics.modes[i].time != rhs.print_statistics.modes[i].time)
+            return false;
+    return true;
+}
+
+int main(const int argc, const char *argv[])
+{
+    if (argc < 2) {
+        std::cout << USAGE_STR << std::endl;
+        return EXIT_SUCCESS;
+    }
+
+    CNumericLocalesSetter locales_setter;
+    int ret = EXIT_SUCCESS;
+    for (int i = 1; i < argc; ++ i) {
+        std::string path = argv[i];
+        double      size_mb = double(boost::filesystem::file_size(path)) / (1024. * 1024.);
+        double      t_serial = 0., t_parallel = 0.;
+        std::unique_ptr<GCodeProcessor> serial_processor   = process(path, false, t_serial);
+        std::unique_ptr<GCodeProcessor> parallel_processor = process(path, true, t_parallel);
+        const GCodeProcessorResult &serial   = serial_processor->get_result();
+        const GCodeProcessorResult &parallel = parallel_processor->get_result();
+        bool same = same_results(serial, parallel);
+        std::cout << path << " (" << size_mb << " MB, " << serial.moves.size() << " moves)" << std::endl
+                  << "  serial:   " << t_serial << " s, " << size_mb / t_serial << " MB/s" << std::endl
+                  << "  parallel: " << t_parallel << " s, " << size_mb / t_parallel << " MB/s" << std::endl
+                  << "  speedup:  " << t_serial / t_parallel << ", results " << (same ? "identical" : "DIFFER") << std::endl;
+        if (! same)
+            ret = EXIT_FAILURE;
+    }
+    return ret;
+}
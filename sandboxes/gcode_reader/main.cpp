@@ -0,0 +1,57 @@
+#include <algorithm>
+#include <iostream>
+#include <string>
+
+#include <boost/filesystem.hpp>
+
+#include "libslic3r/GCodeReader.hpp"
+#include "libslic3r/LocalesUtils.hpp"
+
+#include "../benchmark.hpp"
+
+// Reports the throughput of the GCodeReader tokenizer in MB/s on exported G-code files.
+
+const std::string USAGE_STR = {
+    "Usage: gcode_reader file1.gcode [file2.gcode ...]"
+};
+
+using namespace Slic3r;
+using sandboxes::measure;
+
+int main(const int argc, const char *argv[])
+{
+    if (argc < 2) {
+        std::cout << USAGE_STR << std::endl;
+        return EXIT_SUCCESS;
+    }
+
+    CNumericLocalesSetter locales_setter;
+    for (int i = 1; i < argc; ++ i) {
+        std::string path    = argv[i];
+        double      size_mb = double(boost::filesystem::file_size(path)) / (1024. * 1024.);
+        size_t      cnt_lines = 0;
+        std::vector<size_t> lines_ends;
+
+        double t_raw = measure([&path, &cnt_lines]() {
+            GCodeReader reader;
+            cnt_lines = 0;
+            reader.parse_file_raw(path, [&cnt_lines](GCodeReader&, const char*, const char*) { ++ cnt_lines; });
+        });
+        double t_parse = measure([&path, &lines_ends, &cnt_lines]() {
+            GCodeReader reader;
+            cnt_lines = 0;
+            reader.parse_file(path, [&cnt_lines](GCodeReader&, const GCodeReader::GCodeLine&) { ++ cnt_lines; }, lines_ends);
+        });
+        double t_parallel = measure([&path, &lines_ends, &cnt_lines]() {
+            GCodeReader reader;
+            cnt_lines = 0;
+            reader.parse_file_parallel(path, [&cnt_lines](GCodeReader&, const GCodeReader::GCodeLine&) { ++ cnt_lines; }, lines_ends);
+        });
+
+        std::cout << path << " (" << size_mb << " MB, " << cnt_lines << " lines)" << std::endl
+                  << "  parse_file_raw:      " << size_mb / t_raw << " MB/s" << std::endl
+                  << "  parse_file:          " << size_mb / t_parse << " MB/s" << std::endl
+                  << "  parse_file_parallel: " << size_mb / t_parallel << " MB/s" << std::endl;
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,108 @@
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+#include <boost/algorithm/string.hpp>
+#include <boost/filesystem.hpp>
+
+#include "libslic3r/Orient.hpp"
+#include "libslic3r/Format/OBJ.hpp"
+#include "libslic3r/Geometry.hpp"
+
+#include "../benchmark.hpp"
+
+// Compares the orientations chosen by the auto orientation and its run time when all the candidate orientations
+// are evaluated exactly (exact_candidates = 0) and when the candidates are ranked by the histogram of the facet
+// normals first. Each model is oriented from several initial rotations.
+
+const std::string USAGE_STR = {
+    "Usage: orient <model directory or .obj / .stl files> [exact_candidates]"
+};
+
+using namespace Slic3r;
+using sandboxes::measure;
+
+static bool load_mesh(const boost::filesystem::path &path, TriangleMesh &mesh)
+{
+    std::string ext = boost::algorithm::to_lower_copy(path.extension().string());
+    if (ext == ".obj") {
+        ObjInfo     obj_info;
+        std::string message;
+        return load_obj(path.string().c_str(), &mesh, obj_info, message);
+    }
+    return ext == ".stl" && mesh.ReadSTLFile(path.string().c_str());
+}
+
+static Vec3d orient_mesh(const TriangleMesh &mesh, int exact_candidates)
+{
+    orientation::OrientParams params;
+    params.exact_candidates = exact_candidates;
+    params.min_volume       = true;
+    params.progressind      = [](unsigned, std::string) {};
+    orientation::OrientMeshs meshes(1);
+    meshes.front().mesh = mesh;
+    // The orientation prints the cost of every candidate.
+    std::ostringstream silent;
+    std::streambuf    *cout_buf = std::cout.rdbuf(silent.rdbuf());
+    orientation::orient(meshes, {}, params);
+    std::cout.rdbuf(cout_buf);
+    return meshes.front().orientation;
+}
+
+int main(const int argc, const char *argv[])
+{
+    if (argc < 2) {
+        std::cout << USAGE_STR << std::endl;
+        return EXIT_FAILURE;
+    }
+    int exact_candidates = orientation::OrientParams().exact_candidates;
+    std::vector<boost::filesystem::path> paths;
+    for (int i = 1; i < argc; ++ i) {
+        boost::filesystem::path path(argv[i]);
+        if (boost::filesystem::is_directory(path)) {
+            for (const auto &entry : boost::filesystem::directory_iterator(path))
+                paths.emplace_back(entry.path());
+        } else if (boost::filesystem::exists(path))
+            paths.emplace_back(path);
+        else
+            exact_candidates = std::stoi(argv[i]);
+    }
+    std::sort(paths.begin(), paths.end());
+
+    // Initial rotations of the models, as rotations around x and y in degrees.
+    const std::vector<Vec2d> rotations = { { 0, 0 }, { 90, 0 }, { 180, 0 }, { 35, 60 }, { 120, 215 } };
+
+    double t_exact_total = 0, t_histogram_total = 0;
+    size_t num_cases = 0, num_same = 0;
+    for (const boost::filesystem::path &path : paths) {
+        TriangleMesh model;
+        if (! load_mesh(path, model))
+            continue;
+        for (const Vec2d &rotation : rotations) {
+            TriangleMesh mesh = model;
+            mesh.rotate_x(float(Geometry::deg2rad(rotation.x())));
+            mesh.rotate_y(float(Geometry::deg2rad(rotation.y())));
+            Vec3d  o_exact, o_histogram;
+            double t_exact     = measure([&]() { o_exact = orient_mesh(mesh, 0); });
+            double t_histogram = measure([&]() { o_histogram = orient_mesh(mesh, exact_candidates); });
+            double angle       = Geometry::rad2deg(std::acos(std::clamp(o_exact.normalized().dot(o_histogram.normalized()), -1., 1.)));
+            bool   same        = angle < 1.;
+            std::cout << path.filename().string() << " (" << mesh.facets_count() << " facets, rotated " << rotation.x() << ", " << rotation.y() << "): "
+                      << "exact " << t_exact << " s, histogram " << t_histogram << " s, speedup " << t_exact / t_histogram
+                      << ", orientation " << (same ? "same" : "differs by " + std::to_string(angle) + " deg") << std::endl;
+            t_exact_total     += t_exact;
+            t_histogram_total += t_histogram;
+            num_same          += same;
+            ++ num_cases;
+        }
+    }
+    if (num_cases == 0) {
+        std::cout << USAGE_STR << std::endl;
+        return EXIT_FAILURE;
+    }
+    std::cout << num_cases << " cases, " << exact_candidates << " exact candidates: exact " << t_exact_total << " s, histogram " << t_histogram_total
+              << " s, speedup " << t_exact_total / t_histogram_total << ", same orientation in " << num_same << " cases" << std::endl;
+    return EXIT_SUCCESS;
+}
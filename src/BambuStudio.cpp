@@ -26,6 +26,12 @@
 #if defined(__linux__) || defined(__LINUX__)
 #include <condition_variable>
 #include <mutex>
+#include <chrono>
+#include <fstream>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
 #include <boost/thread.hpp>
 //add json logic
 #include "nlohmann/json.hpp"
@@ -51,6 +57,7 @@ using namespace nlohmann;
 #include "libslic3r/GCode/PostProcessor.hpp"
 #include "libslic3r/Model.hpp"
 #include "libslic3r/ModelArrange.hpp"
+#include "libslic3r/PerfReport.hpp"
 #include "libslic3r/Platform.hpp"
 #include "libslic3r/Print.hpp"
 #include "libslic3r/SLAPrint.hpp"
@@ -164,6 +171,17 @@ typedef struct _sliced_info {
 }sliced_info_t;
 std::vector<PrintBase::SlicingStatus> g_slicing_warnings;
 
+//BBS: settings files loaded by --load_settings / --load_filaments by the jobs of a --serve process, keyed by the file path.
+// Reused while the content of the file and the substitution rule do not change, so that each preset is parsed only once.
+typedef struct _loaded_settings {
+    std::string                             content;
+    ForwardCompatibilitySubstitutionRule    substitution_rule;
+    DynamicPrintConfig                      config;
+    std::map<std::string, std::string>      key_values;
+    ConfigSubstitutions                     config_substitutions;
+}loaded_settings_t;
+std::map<std::string, loaded_settings_t> g_loaded_settings;
+
 #if defined(__linux__) || defined(__LINUX__)
 #define PIPE_BUFFER_SIZE 512
 
@@ -947,7 +965,18 @@ int CLI::run(int argc, char **argv)
 
     PrinterTechnology printer_technology = get_printer_technology(m_config);
 
-    bool							start_gui			= m_actions.empty();
+    std::string                     serve_socket        = m_serving_job ? std::string() : m_config.opt_string("serve", true);
+    bool							start_gui			= m_actions.empty() && serve_socket.empty() && ! m_serving_job;
+
+    //BBS: record the slicing steps and write the report when leaving run(), whatever the exit path
+    std::string perf_report_file = serve_socket.empty() ? m_config.opt_string("perf_report", true) : std::string();
+    if (!perf_report_file.empty())
+        PerfReport::enable(true);
+    ScopeGuard perf_report_guard(perf_report_file.empty() ? ScopeGuard::Closure() : ScopeGuard::Closure([perf_report_file]() {
+        if (!PerfReport::write(perf_report_file))
+            BOOST_LOG_TRIVIAL(error) << "write performance report to " << perf_report_file << " failed";
+        PerfReport::enable(false);
+    }));
 
     //BBS: remove GCodeViewer as seperate APP logic
     /*bool 							start_as_gcodeviewer =
@@ -1043,6 +1072,14 @@ int CLI::run(int argc, char **argv)
         }
     }
 
+    if (! serve_socket.empty())
+        return this->serve(serve_socket);
+    if (m_actions.empty()) {
+        // A job of the slicing server without any action.
+        boost::nowide::cerr << "no action in the job" << std::endl;
+        return CLI_INVALID_PARAMS;
+    }
+
     global_begin_time = (long long)Slic3r::Utils::get_current_time_utc();
     BOOST_LOG_TRIVIAL(warning) << boost::format("cli mode, Current BambuStudio Version %1%")%SLIC3R_VERSION;
 
@@ -1516,22 +1553,47 @@ int CLI::run(int argc, char **argv)
         }
     }
 
-    auto load_config_file = [config_substitution_rule](const std::string& file, DynamicPrintConfig& config, std::string& config_type,
+    auto load_config_file = [this, config_substitution_rule](const std::string& file, DynamicPrintConfig& config, std::string& config_type,
                                 std::string& config_name, std::string& filament_id, std::string& config_from) {
         if (! boost::filesystem::exists(file)) {
             boost::nowide::cerr << __FUNCTION__<< ": can not find setting file: " << file << std::endl;
             return CLI_FILE_NOTFOUND;
         }
+        auto copy_substitutions = [](const ConfigSubstitutions &substitutions) {
+            ConfigSubstitutions out;
+            out.reserve(substitutions.size());
+            for (const ConfigSubstitution &subst : substitutions)
+                out.push_back({ subst.opt_def, subst.old_value, ConfigOptionUniquePtr(subst.new_value->clone()) });
+            return out;
+        };
         ConfigSubstitutions config_substitutions;
         try {
-            BOOST_LOG_TRIVIAL(info) << __FUNCTION__<< ":load setting file "<< file << ", with rule "<< config_substitution_rule << std::endl;
             std::map<std::string, std::string> key_values;
-            std::string reason;
+            // Only the jobs of a --serve process share the loaded settings. The file is compared by its content, its modification
+            // time may not change between two quick edits.
+            std::string content;
+            if (m_serving_job) {
+                boost::nowide::ifstream ifs(file, std::ios::binary);
+                content.assign(std::istreambuf_iterator<char>(ifs), std::istreambuf_iterator<char>());
+            }
+            auto cached = m_serving_job ? g_loaded_settings.find(file) : g_loaded_settings.end();
+            if (cached != g_loaded_settings.end() && cached->second.content == content && cached->second.substitution_rule == config_substitution_rule) {
+                BOOST_LOG_TRIVIAL(info) << __FUNCTION__<< ":use cached setting file "<< file << std::endl;
+                config               = cached->second.config;
+                key_values           = cached->second.key_values;
+                config_substitutions = copy_substitutions(cached->second.config_substitutions);
+            }
+            else {
+                BOOST_LOG_TRIVIAL(info) << __FUNCTION__<< ":load setting file "<< file << ", with rule "<< config_substitution_rule << std::endl;
+                std::string reason;
 
-            config_substitutions = config.load_from_json(file, config_substitution_rule, key_values, reason);
-            if (!reason.empty()) {
-                BOOST_LOG_TRIVIAL(error) <<__FUNCTION__<<  ":Can not load config from file "<<file<<"\n";
-                return CLI_CONFIG_FILE_ERROR;
+                config_substitutions = config.load_from_json(file, config_substitution_rule, key_values, reason);
+                if (!reason.empty()) {
+                    BOOST_LOG_TRIVIAL(error) <<__FUNCTION__<<  ":Can not load config from file "<<file<<"\n";
+                    return CLI_CONFIG_FILE_ERROR;
+                }
+                if (m_serving_job)
+                    g_loaded_settings[file] = { std::move(content), config_substitution_rule, config, key_values, copy_substitutions(config_substitutions) };
             }
 
             config_name = key_values[BBL_JSON_KEY_NAME];
@@ -4198,6 +4260,19 @@ int CLI::run(int argc, char **argv)
     bool export_to_3mf = false, load_slicedata = false, export_slicedata = false, export_slicedata_error = false;
     bool no_check = false;
     std::string export_3mf_file, load_slice_data_dir, export_slice_data_dir;
+    std::string slice_cache_dir;
+    ConfigOptionString* slice_cache_option = m_config.option<ConfigOptionString>("slice_cache");
+    if (slice_cache_option)
+        slice_cache_dir = slice_cache_option->value;
+    ConfigOptionInt* slice_cache_size_option = m_config.option<ConfigOptionInt>("slice_cache_size");
+    uint64_t slice_cache_max_size = uint64_t(std::max(0, slice_cache_size_option ? slice_cache_size_option->value : 10240)) * 1024 * 1024;
+    //BBS: release the sliced data of each plate while its G-code is exported
+    ConfigOptionBool* low_memory_option = m_config.option<ConfigOptionBool>("low_memory");
+    bool low_memory = low_memory_option ? low_memory_option->value : false;
+    if (low_memory && std::find(m_actions.begin(), m_actions.end(), "export_slicedata") != m_actions.end()) {
+        BOOST_LOG_TRIVIAL(warning) << "low_memory is ignored together with export_slicedata." << std::endl;
+        low_memory = false;
+    }
     std::vector<ThumbnailData*> calibration_thumbnails;
     std::vector<int> plate_object_count(partplate_list.get_plate_count(), 0);
     int max_slicing_time_per_plate = 0, max_triangle_count_per_plate = 0, sliced_plate = -1;
@@ -4466,6 +4541,8 @@ int CLI::run(int argc, char **argv)
                         print->apply(model, new_print_config);
                         BOOST_LOG_TRIVIAL(info) << boost::format("set no_check to %1%:")%no_check;
                         print->set_no_check_flag(no_check);//BBS
+                        if (print_fff)
+                            print_fff->set_low_memory_mode(low_memory);
                         StringObjectException warning;
                         auto err = print->validate(&warning);
                         if (!err.string.empty()) {
@@ -4580,6 +4657,18 @@ int CLI::run(int argc, char **argv)
                                         BOOST_LOG_TRIVIAL(info) << "plate "<< index+1<< ": finished print::process.";
                                     }
                                 }
+                                else if (!slice_cache_dir.empty() && (printer_technology == ptFFF)) {
+                                    //BBS: objects unchanged since a previous run are loaded from the slice cache, the others are sliced
+                                    int loaded_count = print_fff->load_slice_cache(slice_cache_dir);
+                                    BOOST_LOG_TRIVIAL(info) << "plate "<< index+1<< ": loaded "<< loaded_count << " objects from slice cache " << slice_cache_dir;
+                                    if (loaded_count > 0)
+                                        print->process(nullptr, true);
+                                    else
+                                        print->process(&time_using_cache);
+                                    int ret = print_fff->store_slice_cache(slice_cache_dir, slice_cache_max_size);
+                                    if (ret)
+                                        BOOST_LOG_TRIVIAL(warning) << "plate "<< index+1<< ": store slice cache error, ret=" << ret;
+                                }
                                 else {
                                     print->process(&time_using_cache);
                                     BOOST_LOG_TRIVIAL(info) << "print::process: first time_using_cache is " << time_using_cache << " secs.";
@@ -5412,6 +5501,157 @@ int CLI::run(int argc, char **argv)
     return 0;
 }
 
+int CLI::serve(const std::string &socket_path)
+{
+#if defined(__linux__) || defined(__LINUX__)
+    sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (socket_path.size() >= sizeof(addr.sun_path)) {
+        boost::nowide::cerr << "socket path too long: " << socket_path << std::endl;
+        return CLI_INVALID_PARAMS;
+    }
+    strncpy(addr.sun_path, socket_path.c_str(), sizeof(addr.sun_path) - 1);
+
+    int server_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (server_fd < 0) {
+        boost::nowide::cerr << "could not create socket, reason: " << strerror(errno) << std::endl;
+        return CLI_ENVIRONMENT_ERROR;
+    }
+    // Remove the socket left over by a previous server.
+    ::unlink(socket_path.c_str());
+    if (bind(server_fd, (sockaddr*)&addr, sizeof(addr)) < 0 || listen(server_fd, 16) < 0) {
+        boost::nowide::cerr << "could not listen on " << socket_path << ", reason: " << strerror(errno) << std::endl;
+        close(server_fd);
+        return CLI_ENVIRONMENT_ERROR;
+    }
+    BOOST_LOG_TRIVIAL(warning) << boost::format("serving slicing jobs on %1%") % socket_path;
+
+    // Read the arguments of a job, one per line up to an empty line or the end of the stream.
+    // Returns false if the client did not send the complete job in time or the read failed.
+    auto read_job = [](int fd, std::vector<std::string> &args) {
+        // A client which connects and then stalls shall not block the server forever.
+        timeval timeout { 30, 0 };
+        setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+        std::string data;
+        char buffer[4096];
+        for (;;) {
+            ssize_t cnt = read(fd, buffer, sizeof(buffer));
+            if (cnt < 0 && errno == EINTR)
+                continue;
+            if (cnt < 0)
+                return false;
+            if (cnt == 0)
+                break;
+            data.append(buffer, cnt);
+            if (boost::algorithm::ends_with(data, "\n\n"))
+                break;
+        }
+        size_t start = 0;
+        while (start < data.size()) {
+            size_t end = data.find('\n', start);
+            if (end == std::string::npos)
+                end = data.size();
+            if (end == start)
+                break;
+            args.emplace_back(data.substr(start, end - start));
+            start = end + 1;
+        }
+        return true;
+    };
+
+    // Peak resident memory of a job: the peak of the process (VmHWM) is reset by /proc/self/clear_refs before the job,
+    // which needs Linux 4.0. Returns false if the peak could not be reset, getrusage() then only reports the peak of the process.
+    auto reset_peak_rss = []() {
+        std::ofstream clear_refs("/proc/self/clear_refs");
+        clear_refs << "5";
+        clear_refs.close();
+        return ! clear_refs.fail();
+    };
+    auto peak_rss_kb = []() {
+        std::ifstream status("/proc/self/status");
+        for (std::string line; std::getline(status, line);)
+            if (boost::starts_with(line, "VmHWM:"))
+                return atoll(line.c_str() + 6);
+        return -1LL;
+    };
+
+    size_t job_id = 0;
+    for (;;) {
+        int client_fd = accept(server_fd, nullptr, nullptr);
+        if (client_fd < 0) {
+            if (errno == EINTR)
+                continue;
+            BOOST_LOG_TRIVIAL(error) << boost::format("accept failed, reason: %1%") % strerror(errno);
+            break;
+        }
+        std::vector<std::string> args;
+        if (! read_job(client_fd, args)) {
+            BOOST_LOG_TRIVIAL(error) << boost::format("could not read a job, reason: %1%") % strerror(errno);
+            close(client_fd);
+            continue;
+        }
+        if (args.size() == 1 && args.front() == "shutdown") {
+            BOOST_LOG_TRIVIAL(warning) << "slicing server shutdown requested";
+            close(client_fd);
+            break;
+        }
+
+        ++ job_id;
+        BOOST_LOG_TRIVIAL(warning) << boost::format("start job %1% with %2% arguments") % job_id % args.size();
+        std::vector<char*> job_argv;
+        std::string        program_name = SLIC3R_APP_KEY;
+        job_argv.emplace_back(program_name.data());
+        for (std::string &arg : args)
+            job_argv.emplace_back(arg.data());
+        job_argv.emplace_back(nullptr);
+
+        rusage usage_begin, usage_end;
+        getrusage(RUSAGE_SELF, &usage_begin);
+        bool job_peak_rss = reset_peak_rss();
+        auto time_begin = std::chrono::steady_clock::now();
+        // The jobs are run one by one, CLI::run() is not reentrant: it reports through g_cli_callback_mgr and g_slicing_warnings.
+        g_slicing_warnings.clear();
+        int ret;
+        try {
+            CLI job;
+            job.m_serving_job = true;
+            ret = job.run(int(job_argv.size()) - 1, job_argv.data());
+        } catch (const std::exception &ex) {
+            BOOST_LOG_TRIVIAL(error) << boost::format("job %1% failed: %2%") % job_id % ex.what();
+            ret = CLI_SLICING_ERROR;
+        }
+        auto time_end = std::chrono::steady_clock::now();
+        getrusage(RUSAGE_SELF, &usage_end);
+        auto cpu_ms = [](const timeval &tv) { return (long long)tv.tv_sec * 1000 + tv.tv_usec / 1000; };
+
+        json j;
+        j["job"]          = job_id;
+        j["return_code"]  = ret;
+        j["error_string"] = cli_errors.count(ret) ? cli_errors[ret] : std::string();
+        j["time_ms"]      = (long long)std::chrono::duration_cast<std::chrono::milliseconds>(time_end - time_begin).count();
+        j["cpu_time_ms"]  = cpu_ms(usage_end.ru_utime) + cpu_ms(usage_end.ru_stime) - cpu_ms(usage_begin.ru_utime) - cpu_ms(usage_begin.ru_stime);
+        // Peak resident set size of the job in kB, only reported if it could be measured.
+        if (long long job_rss_kb = job_peak_rss ? peak_rss_kb() : -1; job_rss_kb >= 0)
+            j["max_rss_kb"] = job_rss_kb;
+        // Peak resident set size of the server process in kB, it only grows when a job needs more memory than all the previous ones.
+        j["process_peak_rss_kb"] = (long long)usage_end.ru_maxrss;
+        std::string reply = j.dump() + "\n";
+        if (write(client_fd, reply.data(), reply.size()) < 0)
+            BOOST_LOG_TRIVIAL(warning) << boost::format("could not send the result of job %1%, reason: %2%") % job_id % strerror(errno);
+        close(client_fd);
+        BOOST_LOG_TRIVIAL(warning) << boost::format("finished job %1%: %2%") % job_id % j.dump();
+    }
+
+    close(server_fd);
+    ::unlink(socket_path.c_str());
+    return 0;
+#else
+    boost::nowide::cerr << "serve is only supported on Linux" << std::endl;
+    return CLI_INVALID_PARAMS;
+#endif
+}
+
 bool CLI::setup(int argc, char **argv)
 {
     // Detect the operating system flavor after SLIC3R_LOGLEVEL is set.
@@ -60,6 +60,8 @@ public:
     int run(int argc, char **argv);
 
 private:
+    //BBS: set for the jobs executed by serve(), which must not start the GUI or another server.
+    bool                        m_serving_job { false };
     DynamicPrintAndCLIConfig    m_config;
     DynamicPrintConfig			m_print_config;
     DynamicPrintConfig          m_extra_config;
@@ -70,6 +72,9 @@ private:
 
     bool setup(int argc, char **argv);
 
+    // Run as a batch slicing server listening on a UNIX socket, see the "serve" option.
+    int serve(const std::string &socket_path);
+
     /// Prints usage of the CLI.
     void print_help(bool include_print_options = false, PrinterTechnology printer_technology = ptAny) const;
 
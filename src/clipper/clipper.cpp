@@ -48,6 +48,7 @@
 #include <ostream>
 #include <functional>
 #include <assert.h>
+#include <memory>
 #include <libslic3r/Int128.hpp>
 
 // Profiling support using the Shiny intrusive profiler
@@ -170,6 +171,16 @@ void PolyTree::RemoveOutermostPolygon()
         this->Clear();
 }
 
+PolyNode* PolyTree::AddNode(PolyNode &parent, Path &&contour)
+{
+    assert(AllNodes.size() < AllNodes.capacity());
+    AllNodes.emplace_back(PolyNode());
+    PolyNode *pn = &AllNodes.back();
+    pn->Contour = std::move(contour);
+    parent.AddChild(*pn);
+    return pn;
+}
+
 //------------------------------------------------------------------------------
 // Miscellaneous global functions
 //------------------------------------------------------------------------------
@@ -772,7 +783,7 @@ bool ClipperBase::AddPath(const Path &pg, PolyType PolyTyp, bool Closed)
     return false;
 
   // Allocate a new edge array.
-  std::vector<TEdge> edges(highI + 1);
+  ArenaVector<TEdge> edges(highI + 1);
   // Fill in the edge array.
   bool result = AddPathInternal(pg, highI, PolyTyp, Closed, edges.data());
   if (result)
@@ -1067,7 +1078,7 @@ void Clipper::Reset()
 {
   CLIPPERLIB_PROFILE_FUNC();
   ClipperBase::Reset();
-  m_Scanbeam = std::priority_queue<cInt>();
+  m_Scanbeam = decltype(m_Scanbeam)();
   m_Maxima.clear();
   m_ActiveEdges = 0;
   m_SortedEdges = 0;
@@ -1192,7 +1203,9 @@ OutPt* Clipper::AllocateOutPt()
     pt = m_OutPts.back() + (m_OutPtsChunkLast ++);
   } else {
     // The last chunk is full. Allocate a new one.
-    m_OutPts.push_back(new OutPt[m_OutPtsChunkSize]);
+    OutPt *chunk = ClipperArena::Allocator<OutPt>(m_OutPts.get_allocator()).allocate(m_OutPtsChunkSize);
+    std::uninitialized_default_construct_n(chunk, m_OutPtsChunkSize);
+    m_OutPts.push_back(chunk);
     m_OutPtsChunkLast = 1;
     pt = m_OutPts.back();
   }
@@ -1201,10 +1214,14 @@ OutPt* Clipper::AllocateOutPt()
 
 void Clipper::DisposeAllOutRecs()
 {
+  ClipperArena::Allocator<OutPt>  pts_allocator(m_OutPts.get_allocator());
   for (OutPt *pts : m_OutPts)
-    delete[] pts;
-  for (OutRec *rec : m_PolyOuts)
-    delete rec;
+    pts_allocator.deallocate(pts, m_OutPtsChunkSize);
+  ClipperArena::Allocator<OutRec> rec_allocator(m_PolyOuts.get_allocator());
+  for (OutRec *rec : m_PolyOuts) {
+    rec->~OutRec();
+    rec_allocator.deallocate(rec, 1);
+  }
   m_OutPts.clear();
   m_OutPtsFree = nullptr;
   m_OutPtsChunkLast = m_OutPtsChunkSize;
@@ -1988,7 +2005,7 @@ void Clipper::AppendPolygon(TEdge *e1, TEdge *e2) const
 
 OutRec* Clipper::CreateOutRec()
 {
-  OutRec* result = new OutRec;
+  OutRec* result = new (ClipperArena::Allocator<OutRec>(m_PolyOuts.get_allocator()).allocate(1)) OutRec;
   result->IsHole = false;
   result->IsOpen = false;
   result->FirstLeft = 0;
@@ -2224,8 +2241,8 @@ void Clipper::ProcessHorizontal(TEdge *horzEdge)
   if (!eLastHorz->NextInLML)
     eMaxPair = GetMaximaPair(eLastHorz);
 
-  std::vector<cInt>::const_iterator maxIt;
-  std::vector<cInt>::const_reverse_iterator maxRit;
+  ArenaVector<cInt>::const_iterator maxIt;
+  ArenaVector<cInt>::const_reverse_iterator maxRit;
   if (!m_Maxima.empty())
   {
       //get the first maxima in range (X) ...
@@ -3935,7 +3952,7 @@ void CleanPolygon(const Path& in_poly, Path& out_poly, double distance)
     return;
   }
 
-  std::vector<OutPt> outPts(size);
+  ArenaVector<OutPt> outPts(size);
   for (size_t i = 0; i < size; ++i)
   {
     outPts[i].Pt = in_poly[i];
@@ -59,6 +59,8 @@
 #include <functional>
 #include <queue>
 
+#include "clipper_arena.hpp"
+
 #ifdef CLIPPERLIB_NAMESPACE_PREFIX
   namespace CLIPPERLIB_NAMESPACE_PREFIX {
 #endif // CLIPPERLIB_NAMESPACE_PREFIX
@@ -108,6 +110,11 @@ using IntPoint = Eigen::Matrix<cInt,
 
 using DoublePoint = Eigen::Matrix<double, 2, 1, Eigen::DontAlign>;
 
+// Container of the temporaries of Clipper / ClipperOffset, allocated from the arena of ArenaScope if active.
+template<typename T>
+using ArenaVector = ClipperArena::Vector<T>;
+using ArenaScope  = ClipperArena::Scope;
+
 //------------------------------------------------------------------------------
 
 typedef std::vector<IntPoint> Path;
@@ -181,6 +188,10 @@ public:
     void Clear() {  AllNodes.clear(); Childs.clear(); }
     int Total() const;
     void RemoveOutermostPolygon();
+    // Building a tree outside of Clipper, for example from the output of another clipping library.
+    // All nodes have to be reserved up front, AddNode() must not reallocate the nodes already linked.
+    void ReserveNodes(size_t n) { AllNodes.reserve(n); }
+    PolyNode* AddNode(PolyNode &parent, Path &&contour);
 private:
     PolyTree(const PolyTree &src) = delete;
     PolyTree& operator=(const PolyTree &src) = delete;
@@ -309,7 +320,7 @@ public:
     if (num_paths == 1)
         return AddPath(*paths_provider.begin(), PolyTyp, Closed);
 
-    std::vector<int> num_edges(num_paths, 0);
+    ArenaVector<int> num_edges(num_paths, 0);
     int num_edges_total = 0;
     size_t i = 0;
     for (const Path &pg : paths_provider) {
@@ -330,7 +341,7 @@ public:
       return false;
 
     // Allocate a new edge array.
-    std::vector<TEdge> edges(num_edges_total);
+    ArenaVector<TEdge> edges(num_edges_total);
     // Fill in the edge array.
     bool result = false;
     TEdge *p_edge = edges.data();
@@ -366,7 +377,7 @@ protected:
   void AscendToMax(TEdge *&E, bool Appending, bool IsClosed);
 
   // Local minima (Y, left edge, right edge) sorted by ascending Y.
-  std::vector<LocalMinimum> m_MinimaList;
+  ArenaVector<LocalMinimum> m_MinimaList;
 
 #ifdef CLIPPERLIB_INT32
   static constexpr const bool m_UseFullRange = false;
@@ -377,7 +388,7 @@ protected:
 #endif // CLIPPERLIB_INT32
 
   // A vector of edges per each input path.
-  std::vector<std::vector<TEdge>> m_edges;
+  ArenaVector<ArenaVector<TEdge>> m_edges;
   // Don't remove intermediate vertices of a collinear sequence of points.
   bool             m_PreserveCollinear;
   // Is any of the paths inserted by AddPath() or AddPaths() open?
@@ -421,22 +432,22 @@ protected:
 private:
   
   // Output polygons.
-  std::vector<OutRec*>  m_PolyOuts;
+  ArenaVector<OutRec*>  m_PolyOuts;
   // Output points, allocated by a continuous sets of m_OutPtsChunkSize.
-  std::vector<OutPt*>   m_OutPts;
+  ArenaVector<OutPt*>   m_OutPts;
   // List of free output points, to be used before taking a point from m_OutPts or allocating a new chunk.
   OutPt                *m_OutPtsFree;
   size_t                m_OutPtsChunkSize;
   size_t                m_OutPtsChunkLast;
 
-  std::vector<Join>     m_Joins;
-  std::vector<Join>     m_GhostJoins;
-  std::vector<IntersectNode> m_IntersectList;
+  ArenaVector<Join>     m_Joins;
+  ArenaVector<Join>     m_GhostJoins;
+  ArenaVector<IntersectNode> m_IntersectList;
   ClipType              m_ClipType;
   // A priority queue (a binary heap) of Y coordinates.
-  std::priority_queue<cInt> m_Scanbeam;
+  std::priority_queue<cInt, ArenaVector<cInt>> m_Scanbeam;
   // Maxima are collected by ProcessEdgesAtTopOfScanbeam(), consumed by ProcessHorizontal().
-  std::vector<cInt>     m_Maxima;
+  ArenaVector<cInt>     m_Maxima;
   TEdge                *m_ActiveEdges;
   TEdge                *m_SortedEdges;
   PolyFillType          m_ClipFillType;
@@ -527,7 +538,7 @@ private:
   Paths m_destPolys;
   Path m_srcPoly;
   Path m_destPoly;
-  std::vector<DoublePoint> m_normals;
+  ArenaVector<DoublePoint> m_normals;
   double m_delta, m_sinA, m_sin, m_cos;
   double m_miterLim, m_StepsPerRad;
   // x: index of the lowest contour in m_polyNodes
@@ -0,0 +1,198 @@
+// Thread local arena for the temporaries of ClipperLib.
+//
+// Clipper and ClipperOffset allocate their edges, local minima, scan beams, joins, output records and output points
+// per call and release them when the object is destroyed. With many TBB workers running boolean operations
+// at once, these short lived allocations contend in the system allocator. An active Scope redirects them
+// into a bump allocator owned by the calling thread. Once all the allocations of the arena are released,
+// which is after every ClipperUtils call, the arena is rewound and its memory is reused by the next call
+// without touching the system allocator.
+//
+// This file is shared by all the ClipperLib variants (ClipperLib, Slic3r::ClipperLib, ClipperLib_Z),
+// thus it has its own include guard and a namespace not affected by CLIPPERLIB_NAMESPACE_PREFIX.
+
+#ifndef clipper_arena_hpp
+#define clipper_arena_hpp
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdlib>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <vector>
+
+namespace ClipperArena {
+
+class Arena
+{
+public:
+    Arena() = default;
+    Arena(const Arena &) = delete;
+    Arena& operator=(const Arena &) = delete;
+    ~Arena() { this->release(); }
+
+    void* allocate(size_t bytes)
+    {
+        bytes = aligned(bytes);
+        if (bytes > size_t(m_end - m_top))
+            this->grow(bytes);
+        void *out = m_top;
+        m_top += bytes;
+        ++ m_live;
+        return out;
+    }
+
+    void deallocate(void *p, size_t bytes)
+    {
+        if (-- m_live == 0)
+            this->rewind();
+        else if (static_cast<char*>(p) + aligned(bytes) == m_top)
+            // The last allocation, for example a vector which has just been shrunk.
+            m_top = static_cast<char*>(p);
+    }
+
+    // Number of allocations not released yet.
+    size_t  live() const { return m_live; }
+    // Memory reserved by the arena in bytes.
+    size_t  capacity() const { size_t out = 0; for (const Block &block : m_blocks) out += block.size; return out; }
+
+    // Free the reserved memory if nothing is allocated from the arena and more than max_retained bytes are reserved.
+    void    trim(size_t max_retained)
+    {
+        if (m_live == 0 && this->capacity() > max_retained)
+            this->release();
+    }
+
+private:
+    struct Block
+    {
+        char   *data;
+        size_t  size;
+    };
+
+    static constexpr size_t alignment          = alignof(std::max_align_t);
+    static constexpr size_t default_block_size = 256 * 1024;
+
+    static size_t aligned(size_t bytes) { return (bytes + alignment - 1) & ~(alignment - 1); }
+
+    void grow(size_t bytes)
+    {
+        size_t size = std::max(m_blocks.empty() ? default_block_size : 2 * m_blocks.back().size, bytes);
+        char  *data = static_cast<char*>(std::malloc(size));
+        if (data == nullptr)
+            throw std::bad_alloc();
+        m_blocks.push_back({ data, size });
+        m_top = data;
+        m_end = data + size;
+    }
+
+    // All allocations were released. Start from the beginning of the first block, merging the blocks
+    // into a single one, so that the next run of the same size does not need to grow the arena.
+    void rewind()
+    {
+        if (m_blocks.size() > 1) {
+            size_t size = this->capacity();
+            this->release();
+            this->grow(size);
+        } else if (! m_blocks.empty()) {
+            m_top = m_blocks.front().data;
+            m_end = m_top + m_blocks.front().size;
+        }
+    }
+
+    void release()
+    {
+        for (const Block &block : m_blocks)
+            std::free(block.data);
+        m_blocks.clear();
+        m_top = nullptr;
+        m_end = nullptr;
+    }
+
+    std::vector<Block>  m_blocks;
+    char               *m_top  { nullptr };
+    char               *m_end  { nullptr };
+    size_t              m_live { 0 };
+};
+
+// Arena of the calling thread if a Scope is active on this thread, nullptr otherwise.
+inline Arena*& current()
+{
+    static thread_local Arena *arena = nullptr;
+    return arena;
+}
+
+inline Arena& thread_arena()
+{
+    static thread_local Arena arena;
+    return arena;
+}
+
+// Makes ClipperLib objects constructed by this thread allocate their temporaries from the arena of this thread,
+// until the outermost Scope is destroyed. A ClipperLib object constructed inside a Scope has to be destroyed
+// on the same thread, objects constructed outside of any Scope use the system allocator.
+class Scope
+{
+public:
+    // Memory kept by the arena of a thread for the next Scope.
+    static constexpr size_t max_retained = 32 * 1024 * 1024;
+
+    Scope() : m_outermost(current() == nullptr) { if (m_outermost) current() = &thread_arena(); }
+    ~Scope()
+    {
+        if (m_outermost) {
+            current() = nullptr;
+            thread_arena().trim(max_retained);
+        }
+    }
+    Scope(const Scope &) = delete;
+    Scope& operator=(const Scope &) = delete;
+
+private:
+    bool m_outermost;
+};
+
+// Standard allocator binding to the arena active when it is constructed. The arena travels with the allocator,
+// so memory is always returned to the arena it was allocated from.
+template<typename T>
+class Allocator
+{
+public:
+    using value_type                             = T;
+    using propagate_on_container_copy_assignment = std::true_type;
+    using propagate_on_container_move_assignment = std::true_type;
+    using propagate_on_container_swap            = std::true_type;
+
+    Allocator() noexcept : m_arena(current()) {}
+    template<typename U>
+    Allocator(const Allocator<U> &rhs) noexcept : m_arena(rhs.arena()) {}
+
+    T*      allocate(size_t n)
+    {
+        return m_arena ? static_cast<T*>(m_arena->allocate(n * sizeof(T))) : std::allocator<T>().allocate(n);
+    }
+    void    deallocate(T *p, size_t n)
+    {
+        if (m_arena)
+            m_arena->deallocate(p, n * sizeof(T));
+        else
+            std::allocator<T>().deallocate(p, n);
+    }
+
+    Arena*  arena() const noexcept { return m_arena; }
+
+    template<typename U>
+    bool    operator==(const Allocator<U> &rhs) const noexcept { return m_arena == rhs.arena(); }
+    template<typename U>
+    bool    operator!=(const Allocator<U> &rhs) const noexcept { return m_arena != rhs.arena(); }
+
+private:
+    Arena  *m_arena;
+};
+
+template<typename T>
+using Vector = std::vector<T, Allocator<T>>;
+
+} // namespace ClipperArena
+
+#endif // clipper_arena_hpp
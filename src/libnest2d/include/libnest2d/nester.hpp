@@ -69,6 +69,8 @@ class _Item {
         Box bb; bool valid;
         BBCache(): valid(false) {}
     } bb_cache_;
+    mutable size_t shape_hash_ = 0;
+    mutable bool shape_hash_valid_ = false;
 
     int binid_{BIN_ID_UNSET}, priority_{0};
     bool fixed_{false};
@@ -337,6 +339,7 @@ public:
             rotation_ = rot; has_rotation_ = true; tr_cache_valid_ = false;
             rmt_valid_ = false; lmb_valid_ = false;
             bb_cache_.valid = false;
+            shape_hash_valid_ = false;
         }
     }
 
@@ -394,6 +397,34 @@ public:
         return {bb.minCorner() + tr, bb.maxCorner() + tr };
     }
 
+    /**
+     * @brief Hash of the shape with the rotation and inflation applied, but
+     * not the translation. It is the same for the copies of a part, thus
+     * it may be used to share the results calculated for one of the copies.
+     */
+    inline size_t shapeHash() const {
+        if(!shape_hash_valid_) {
+            auto combine = [](size_t &seed, size_t v) {
+                seed ^= v + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+            };
+            auto hash_contour = [&combine](size_t &seed, const TContour<RawShape> &c) {
+                for(auto it = sl::cbegin(c); it != sl::cend(c); ++it) {
+                    combine(seed, std::hash<TCoord<Vertex>>()(getX(*it)));
+                    combine(seed, std::hash<TCoord<Vertex>>()(getY(*it)));
+                }
+                combine(seed, 0);
+            };
+            size_t seed = 0;
+            hash_contour(seed, sl::contour(sh_));
+            for(auto &h : sl::holes(sh_)) hash_contour(seed, h);
+            combine(seed, std::hash<double>()(has_rotation_ ? double(rotation_) : 0.));
+            combine(seed, std::hash<TCoord<Vertex>>()(has_inflation_ ? inflation_ : 0));
+            shape_hash_ = seed;
+            shape_hash_valid_ = true;
+        }
+        return shape_hash_;
+    }
+
     inline Vertex referenceVertex() const {
         return rightmostTopVertex();
     }
@@ -451,6 +482,7 @@ private:
         area_cache_valid_ = false;
         inflate_cache_valid_ = false;
         bb_cache_.valid = false;
+        shape_hash_valid_ = false;
         convexity_ = Convexity::UNCHECKED;
     }
 
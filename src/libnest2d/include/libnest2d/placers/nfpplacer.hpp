@@ -8,6 +8,9 @@
 #include <iterator>
 #include <future>
 #include <atomic>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
 
 #ifndef NDEBUG
 #include <iostream>
@@ -26,6 +29,132 @@
 namespace libnest2d {
 namespace placers {
 
+/**
+ * BBS: Cache of the no-fit polygons of pairs of shapes, keyed by the shape
+ * hashes of the stationary and the orbiting item (see _Item::shapeHash()).
+ *
+ * The NFP of two convex shapes does not depend on the translation of the
+ * orbiting item and it moves together with the stationary item, thus it is
+ * stored relative to the leftmost bottom vertex of the stationary item. The
+ * copies of the same part then share their NFPs instead of calculating the
+ * same polygon again for every copy.
+ *
+ * The hashes may collide, so the transformed shapes of both items are stored
+ * with the NFP and compared on a hit.
+ */
+template<class RawShape>
+class NfpCache {
+    using Vertex = TPoint<RawShape>;
+public:
+    struct Key {
+        size_t stationary;
+        size_t orbiter;
+        bool operator==(const Key& k) const {
+            return stationary == k.stationary && orbiter == k.orbiter;
+        }
+    };
+
+    struct KeyHash {
+        size_t operator()(const Key& k) const {
+            return k.stationary ^ (k.orbiter + 0x9e3779b9 + (k.stationary << 6) + (k.stationary >> 2));
+        }
+    };
+
+    // Whether shape1 moved by -lmb1 equals shape2 moved by -lmb2.
+    static bool sameShape(const RawShape& shape1, const Vertex& lmb1,
+                          const RawShape& shape2, const Vertex& lmb2)
+    {
+        auto same_path = [&lmb1, &lmb2](const TContour<RawShape>& c1,
+                                        const TContour<RawShape>& c2) {
+            auto it1 = shapelike::cbegin(c1), it2 = shapelike::cbegin(c2);
+            if(shapelike::cend(c1) - it1 != shapelike::cend(c2) - it2)
+                return false;
+            for(; it1 != shapelike::cend(c1); ++it1, ++it2)
+                if(!(*it1 - lmb1 == *it2 - lmb2)) return false;
+            return true;
+        };
+        const auto& holes1 = shapelike::holes(shape1);
+        const auto& holes2 = shapelike::holes(shape2);
+        if(holes1.size() != holes2.size() ||
+           !same_path(shapelike::contour(shape1), shapelike::contour(shape2)))
+            return false;
+        for(size_t i = 0; i < holes1.size(); ++i)
+            if(!same_path(holes1[i], holes2[i])) return false;
+        return true;
+    }
+
+    // Get the NFP moved to the leftmost bottom vertex of the stationary item,
+    // only if it was calculated for the very same shapes.
+    bool find(const Key& key,
+              const RawShape& stationary, const Vertex& stationary_lmb,
+              const RawShape& orbiter, const Vertex& orbiter_lmb,
+              RawShape& out) const
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            auto it = map_.find(key);
+            if(it == map_.end() ||
+               !sameShape(it->second.stationary, {0, 0}, stationary, stationary_lmb) ||
+               !sameShape(it->second.orbiter, {0, 0}, orbiter, orbiter_lmb))
+                return false;
+            out = it->second.nfp;
+        }
+        shapelike::translate(out, stationary_lmb);
+        return true;
+    }
+
+    void insert(const Key& key,
+                RawShape stationary, const Vertex& stationary_lmb,
+                RawShape orbiter, const Vertex& orbiter_lmb,
+                RawShape nfp)
+    {
+        shapelike::translate(stationary, Vertex{0, 0} - stationary_lmb);
+        shapelike::translate(orbiter, Vertex{0, 0} - orbiter_lmb);
+        shapelike::translate(nfp, Vertex{0, 0} - stationary_lmb);
+        size_t cnt = shapelike::contourVertexCount(nfp) +
+                     shapelike::contourVertexCount(stationary) +
+                     shapelike::contourVertexCount(orbiter);
+        std::lock_guard<std::mutex> lock(mutex_);
+        if(points_ + cnt > max_points) {
+            map_.clear();
+            points_ = 0;
+        }
+        // A colliding entry of other shapes is replaced.
+        Entry& entry = map_[key];
+        points_ -= entry.points;
+        entry = Entry{std::move(stationary), std::move(orbiter), std::move(nfp), cnt};
+        points_ += cnt;
+    }
+
+    void clear()
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        map_.clear();
+        points_ = 0;
+    }
+
+    size_t size() const
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return map_.size();
+    }
+
+private:
+    // The cache is flushed once it holds more vertices than this.
+    static constexpr size_t max_points = 4 * 1024 * 1024;
+
+    struct Entry {
+        RawShape stationary;
+        RawShape orbiter;
+        RawShape nfp;
+        size_t points = 0;
+    };
+
+    mutable std::mutex mutex_;
+    std::unordered_map<Key, Entry, KeyHash> map_;
+    size_t points_ = 0;
+};
+
 template<class RawShape>
 struct NfpPConfig {
 
@@ -96,6 +225,13 @@ struct NfpPConfig {
      */
     bool parallel = true;
 
+    /**
+     * @brief BBS: Cache of the no-fit polygons. It is shared by the copies of
+     * the configuration, thus by all the bins of an arrangement. Set it to
+     * nullptr to calculate every NFP.
+     */
+    std::shared_ptr<NfpCache<RawShape>> nfp_cache;
+
     /**
      * @brief before_packing Callback that is called just before a search for
      * a new item's position is started. You can use this to create various
@@ -134,7 +270,8 @@ struct NfpPConfig {
     std::vector < _Item<RawShape> > m_nonprefered_regions;
 
     NfpPConfig(): rotations({0.0, Pi/2.0, Pi, 3*Pi/2}),
-        alignment(Alignment::CENTER), starting_point(Alignment::CENTER) {}
+        alignment(Alignment::CENTER), starting_point(Alignment::CENTER),
+        nfp_cache(std::make_shared<NfpCache<RawShape>>()) {}
 };
 
 /**
@@ -604,24 +741,66 @@ private:
         trsh.rightmostTopVertex();
         trsh.leftmostBottomVertex();
 
+        trsh.shapeHash();
+
         for(Item& itm : items_) {
             itm.transformedShape();
             itm.referenceVertex();
             itm.rightmostTopVertex();
             itm.leftmostBottomVertex();
+            itm.shapeHash();
         }
         // /////////////////////////////////////////////////////////////////////
 
-        __parallel::enumerate(items_.begin(), items_.end(),
-                              [&nfps, &trsh](const Item& sh, size_t n)
+        // BBS: take the NFPs of the copies of the same part from the cache,
+        // calculate each missing NFP once and move it to the other copies.
+        using CacheKey = typename NfpCache<RawShape>::Key;
+        using CacheKeyHash = typename NfpCache<RawShape>::KeyHash;
+        auto key = [&trsh](const Item& sh) {
+            return CacheKey{sh.shapeHash(), trsh.shapeHash()};
+        };
+        const std::shared_ptr<NfpCache<RawShape>> &cache = config_.nfp_cache;
+        std::vector<size_t> calculate;      // items with a missing NFP
+        std::vector<size_t> source(items_.size());
+        std::unordered_map<CacheKey, size_t, CacheKeyHash> missing;
+        for(size_t n = 0; n < items_.size(); ++n) {
+            const Item& sh = items_[n];
+            source[n] = n;
+            if(!cache) calculate.emplace_back(n);
+            else if(!cache->find(key(sh), sh.transformedShape(), sh.leftmostBottomVertex(),
+                                 trsh.transformedShape(), trsh.leftmostBottomVertex(), nfps[n])) {
+                auto it = missing.emplace(key(sh), n);
+                const Item& src = items_[it.first->second];
+                if(it.second) calculate.emplace_back(n);
+                else if(NfpCache<RawShape>::sameShape(sh.transformedShape(), sh.leftmostBottomVertex(),
+                                                      src.transformedShape(), src.leftmostBottomVertex()))
+                    source[n] = it.first->second;
+                else calculate.emplace_back(n); // colliding hash of another shape
+            }
+        }
+
+        __parallel::enumerate(calculate.begin(), calculate.end(),
+                              [this, &nfps, &trsh](size_t idx, size_t)
         {
+            const Item& sh = items_[idx];
             auto& fixedp = sh.transformedShape();
             auto& orbp = trsh.transformedShape();
             auto subnfp_r = noFitPolygon<NfpLevel::CONVEX_ONLY>(fixedp, orbp);
             correctNfpPosition(subnfp_r, sh, trsh);
-            nfps[n] = subnfp_r.first;
+            nfps[idx] = subnfp_r.first;
         });
 
+        for(size_t n = 0; n < items_.size(); ++n) {
+            const Item& sh = items_[n];
+            if(source[n] != n) {
+                const Item& src = items_[source[n]];
+                nfps[n] = nfps[source[n]];
+                shapelike::translate(nfps[n], sh.leftmostBottomVertex() - src.leftmostBottomVertex());
+            } else if(cache && missing.count(key(sh)))
+                cache->insert(key(sh), sh.transformedShape(), sh.leftmostBottomVertex(),
+                              trsh.transformedShape(), trsh.leftmostBottomVertex(), nfps[n]);
+        }
+
         RawShape innerNfp = nfpInnerRectBed(bed, trsh.transformedShape()).first;
         Shapes finalNFP = nfp::subtract({ innerNfp }, nfps);
         return finalNFP;
@@ -792,24 +971,54 @@ private:
         }
         if (can_pack == false) {
 
-            Pile merged_pile = merged_pile_;
+            std::launch policy = std::launch::deferred;
+            if(config_.parallel) policy |= std::launch::async;
+
+            if(config_.before_packing)
+                config_.before_packing(merged_pile_, items_, remlist);
+
+            // BBS: the rotations are evaluated in parallel, each one on its own
+            // copy of the item. Fill the caches of the packed items first, so
+            // that the parallel NFP calculations only read them.
+            for(Item& itm : items_) {
+                itm.transformedShape();
+                itm.referenceVertex();
+                itm.leftmostBottomVertex();
+                itm.shapeHash();
+            }
+
+            struct RotationResult {
+                double score = std::numeric_limits<double>::max();
+                double overfit = std::numeric_limits<double>::max();
+                Vertex translation = {0, 0};
+                Shapes nfps;
+            };
 
-            for(auto rot : config_.rotations) {
+            std::vector<RotationResult> rot_results(config_.rotations.size());
 
-                item.translation(initial_tr);
-                item.rotation(initial_rot + rot);
-                item.boundingBox(); // fill the bb cache
+            __parallel::enumerate(config_.rotations.begin(), config_.rotations.end(),
+                                  [this, &rot_results, &item, &_objfunc, &bin, &binbb,
+                                   initial_tr, initial_rot, policy]
+                                  (Radians rot, size_t rot_idx)
+            {
+                RotationResult& rot_result = rot_results[rot_idx];
+                Pile merged_pile = merged_pile_;
+
+                Item rot_item = item;
+                rot_item.translation(initial_tr);
+                rot_item.rotation(initial_rot + rot);
+                rot_item.boundingBox(); // fill the bb cache
 
                 // place the new item outside of the print bed to make sure
                 // it is disjunct from the current merged pile
-                placeOutsideOfBin(item);
-
-                nfps = calcnfp(item, binbb, Lvl<MaxNfpLevel::value>());
+                placeOutsideOfBin(rot_item);
 
+                rot_result.nfps = calcnfp(rot_item, binbb, Lvl<MaxNfpLevel::value>());
+                const Shapes& nfps = rot_result.nfps;
 
-                auto iv = item.referenceVertex();
+                auto iv = rot_item.referenceVertex();
 
-                auto startpos = item.translation();
+                auto startpos = rot_item.translation();
 
                 std::vector<Edges> ecache;
                 ecache.reserve(nfps.size());
@@ -837,13 +1046,13 @@ private:
                 auto alignment = config_.alignment;
 
                 auto boundaryCheck = [alignment, &merged_pile, &getNfpPoint,
-                        &item, &bin, &iv, &startpos] (const Optimum& o)
+                        &rot_item, &bin, &iv, &startpos] (const Optimum& o)
                 {
                     auto v = getNfpPoint(o);
                     auto d = (v - iv) + startpos;
-                    item.translation(d);
+                    rot_item.translation(d);
 
-                    merged_pile.emplace_back(item.transformedShape());
+                    merged_pile.emplace_back(rot_item.transformedShape());
                     auto chull = sl::convexHull(merged_pile);
                     merged_pile.pop_back();
 
@@ -857,11 +1066,6 @@ private:
 
                 Optimum optimum(0, 0);
                 double best_score = std::numeric_limits<double>::max();
-                std::launch policy = std::launch::deferred;
-                if(config_.parallel) policy |= std::launch::async;
-
-                if(config_.before_packing)
-                    config_.before_packing(merged_pile, items_, remlist);
 
                 using OptResult = opt::Result<double>;
                 using OptResults = std::vector<OptResult>;
@@ -880,12 +1084,12 @@ private:
                     __parallel::enumerate(
                                 cache.corners().begin(),
                                 cache.corners().end(),
-                                [&results, &item, &rofn, &nfpoint, ch, accuracy]
+                                [&results, &rot_item, &rofn, &nfpoint, ch, accuracy]
                                 (double pos, size_t n)
                     {
                         Optimizer solver(accuracy);
 
-                        Item itemcpy = item;
+                        Item itemcpy = rot_item;
                         auto contour_ofn = [&rofn, &nfpoint, ch, &itemcpy]
                                 (double relpos)
                         {
@@ -918,7 +1122,7 @@ private:
                             best_score = mr.score;
                             optimum = o;
                         } else {
-                            best_overfit = std::min(miss, best_overfit);
+                            rot_result.overfit = std::min(miss, rot_result.overfit);
                         }
                     }
 
@@ -926,16 +1130,15 @@ private:
                         results.clear();
                         results.resize(cache.corners(hidx).size());
 
-                        // TODO : use parallel for
                         __parallel::enumerate(cache.corners(hidx).begin(),
                                       cache.corners(hidx).end(),
-                                      [&results, &item, &nfpoint,
+                                      [&results, &rot_item, &nfpoint,
                                        &rofn, ch, hidx, accuracy]
                                       (double pos, size_t n)
                         {
                             Optimizer solver(accuracy);
 
-                            Item itmcpy = item;
+                            Item itmcpy = rot_item;
                             auto hole_ofn =
                                     [&rofn, &nfpoint, ch, hidx, &itmcpy]
                                     (double pos)
@@ -967,19 +1170,29 @@ private:
                                 best_score = hmr.score;
                                 optimum = o;
                             } else {
-                                best_overfit = std::min(miss, best_overfit);
+                                rot_result.overfit = std::min(miss, rot_result.overfit);
                             }
                         }
                     }
                 }
 
-                if( best_score < global_score) {
-                    auto d = (getNfpPoint(optimum) - iv) + startpos;
-                    final_tr = d;
-                    final_rot = initial_rot + rot;
+                rot_result.score = best_score;
+                if(best_score < std::numeric_limits<double>::max())
+                    rot_result.translation = (getNfpPoint(optimum) - iv) + startpos;
+            }, policy);
+
+            // Reduce in the order of the rotations, the first best rotation wins
+            // as with the serial evaluation.
+            for(size_t rot_idx = 0; rot_idx < rot_results.size(); ++rot_idx) {
+                RotationResult& rot_result = rot_results[rot_idx];
+                best_overfit = std::min(best_overfit, rot_result.overfit);
+                if(rot_result.score < global_score) {
+                    final_tr = rot_result.translation;
+                    final_rot = initial_rot + config_.rotations[rot_idx];
                     can_pack = true;
-                    global_score = best_score;
+                    global_score = rot_result.score;
                 }
+                nfps = std::move(rot_result.nfps);
             }
 
             item.translation(final_tr);
@@ -325,6 +325,10 @@ void AppConfig::set_defaults()
         set("backup_interval", "10");
     }
 
+    if (get("backup_compression_level").empty()) {
+        set("backup_compression_level", "1");
+    }
+
     if (get("curr_bed_type").empty()) {
         set("curr_bed_type", "1");
     }
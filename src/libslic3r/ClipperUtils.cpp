@@ -2,6 +2,10 @@
 #include "Geometry.hpp"
 #include "ShortestPath.hpp"
 
+#include <atomic>
+
+#include "clipper2/clipper.h"
+
 // #define CLIPPER_UTILS_DEBUG
 
 #ifdef CLIPPER_UTILS_DEBUG
@@ -170,6 +174,17 @@ void clip_clipper_polygon_with_subject_bbox(const Polygon &src, const BoundingBo
     out.erase(std::remove_if(out.begin(), out.end(), [](const Polygon &polygon) {return polygon.empty(); }), out.end());
     return out;
 }
+
+static std::atomic<Backend> s_backend {
+#ifdef SLIC3R_CLIPPER2_BACKEND
+    Backend::Clipper2
+#else
+    Backend::ClipperLib
+#endif
+};
+
+void    set_backend(Backend backend) { s_backend.store(backend, std::memory_order_relaxed); }
+Backend backend() { return s_backend.load(std::memory_order_relaxed); }
 }
 
 static ExPolygons PolyTreeToExPolygons(ClipperLib::PolyTree &&polytree)
@@ -267,6 +282,137 @@ bool has_duplicate_points(const ClipperLib::PolyTree &polytree)
 }
 #endif
 
+// BBS: Clipper2 backend of the booleans and offsets, see ClipperUtils::set_backend().
+// The inputs are converted to Clipper2 paths, the outputs back to ClipperLib paths or ClipperLib::PolyTree,
+// so that the code converting the results to Polygons / ExPolygons is shared by both backends.
+namespace Clipper2Backend {
+
+static_assert(int(Clipper2Lib::FillRule::Negative) == int(ClipperLib::pftNegative), "Fill types of ClipperLib and Clipper2 differ");
+static_assert(int(Clipper2Lib::ClipType::Xor) == int(ClipperLib::ctXor) + 1, "Clip types of ClipperLib and Clipper2 differ");
+static_assert(int(Clipper2Lib::JoinType::Miter) == int(ClipperLib::jtMiter), "Join types of ClipperLib and Clipper2 differ");
+static_assert(int(Clipper2Lib::EndType::Round) == int(ClipperLib::etOpenRound), "End types of ClipperLib and Clipper2 differ");
+
+static inline bool enabled() { return ClipperUtils::backend() == ClipperUtils::Backend::Clipper2; }
+
+static inline Clipper2Lib::FillRule fill_rule(ClipperLib::PolyFillType fillType) { return Clipper2Lib::FillRule(int(fillType)); }
+static inline Clipper2Lib::ClipType clip_type(ClipperLib::ClipType clipType)     { return Clipper2Lib::ClipType(int(clipType) + 1); }
+static inline Clipper2Lib::JoinType join_type(ClipperLib::JoinType joinType)     { return Clipper2Lib::JoinType(int(joinType)); }
+static inline Clipper2Lib::EndType  end_type(ClipperLib::EndType endType)        { return Clipper2Lib::EndType(int(endType)); }
+
+static Clipper2Lib::Path64 to_path64(const Points &path)
+{
+    Clipper2Lib::Path64 out;
+    out.reserve(path.size());
+    for (const Point &pt : path)
+        out.emplace_back(int64_t(pt.x()), int64_t(pt.y()));
+    return out;
+}
+
+template<typename PathsProvider>
+static Clipper2Lib::Paths64 to_paths64(PathsProvider &&paths)
+{
+    Clipper2Lib::Paths64 out;
+    out.reserve(paths.size());
+    for (const Points &path : paths)
+        out.emplace_back(to_path64(path));
+    return out;
+}
+
+static ClipperLib::Path to_path(const Clipper2Lib::Path64 &path)
+{
+    ClipperLib::Path out;
+    out.reserve(path.size());
+    for (const Clipper2Lib::Point64 &pt : path)
+        out.emplace_back(coord_t(pt.x), coord_t(pt.y));
+    return out;
+}
+
+static ClipperLib::Paths to_paths(const Clipper2Lib::Paths64 &paths)
+{
+    ClipperLib::Paths out;
+    out.reserve(paths.size());
+    for (const Clipper2Lib::Path64 &path : paths)
+        out.emplace_back(to_path(path));
+    return out;
+}
+
+static size_t count_nodes(const Clipper2Lib::PolyPath64 &node)
+{
+    size_t cnt = node.Count();
+    for (const Clipper2Lib::PolyPath64 *child : node)
+        cnt += count_nodes(*child);
+    return cnt;
+}
+
+static void add_nodes(const Clipper2Lib::PolyPath64 &src, ClipperLib::PolyNode &dst, ClipperLib::PolyTree &tree)
+{
+    for (const Clipper2Lib::PolyPath64 *child : src)
+        add_nodes(*child, *tree.AddNode(dst, to_path(child->Polygon())), tree);
+}
+
+// Both trees nest the holes below their contours and the islands inside holes below the holes,
+// with the contours oriented CCW and the holes CW.
+static void to_polytree(const Clipper2Lib::PolyTree64 &src, ClipperLib::PolyTree &out)
+{
+    out.Clear();
+    out.ReserveNodes(count_nodes(src));
+    add_nodes(src, out, out);
+}
+
+static void execute(Clipper2Lib::Clipper64 &clipper, ClipperLib::ClipType clipType, ClipperLib::PolyFillType fillType, ClipperLib::Paths &out)
+{
+    Clipper2Lib::Paths64 solution;
+    clipper.Execute(clip_type(clipType), fill_rule(fillType), solution);
+    out = to_paths(solution);
+}
+
+static void execute(Clipper2Lib::Clipper64 &clipper, ClipperLib::ClipType clipType, ClipperLib::PolyFillType fillType, ClipperLib::PolyTree &out)
+{
+    Clipper2Lib::PolyTree64 solution;
+    clipper.Execute(clip_type(clipType), fill_rule(fillType), solution);
+    to_polytree(solution, out);
+}
+
+template<class TResult, class TSubj, class TClip>
+static TResult clipper_do(const ClipperLib::ClipType clipType, TSubj &&subject, TClip &&clip, const ClipperLib::PolyFillType fillType)
+{
+    Clipper2Lib::Clipper64 clipper;
+    clipper.AddSubject(to_paths64(subject));
+    if (clip.size() > 0)
+        clipper.AddClip(to_paths64(clip));
+    TResult retval;
+    execute(clipper, clipType, fillType, retval);
+    return retval;
+}
+
+// Offset a single path with the semantics of ClipperLib::ClipperOffset::Execute(): a closed path is reoriented
+// to CCW before it is offsetted, thus the output is always CCW.
+static ClipperLib::Paths offset(const Points &path, double delta, ClipperLib::JoinType joinType, ClipperLib::EndType endType, double miterLimit)
+{
+    // Clipper2 offsets a CW path with the opposite delta as well, but it keeps the orientation of the input. Reverse the solution of a CW path.
+    bool cw = endType == ClipperLib::etClosedPolygon && ! ClipperLib::Orientation(path);
+    if (std::abs(delta) < 0.25) {
+        // Clipper2 returns the input unchanged for |delta| below its arc tolerance, neither reoriented nor reversed.
+        // ClipperLib reorients a closed path and cleans it by a union, an open path offsetted by less than a unit is empty.
+        if (endType != ClipperLib::etClosedPolygon)
+            return {};
+        Clipper2Lib::Path64 path64 = to_path64(path);
+        if (cw)
+            std::reverse(path64.begin(), path64.end());
+        Clipper2Lib::Clipper64 clipper;
+        clipper.AddSubject({ std::move(path64) });
+        ClipperLib::Paths out;
+        execute(clipper, ClipperLib::ctUnion, ClipperLib::pftPositive, out);
+        return out;
+    }
+    Clipper2Lib::ClipperOffset co(joinType == jtRound ? 2. : miterLimit, joinType == jtRound ? miterLimit : 0., false, cw);
+    co.AddPath(to_path64(path), join_type(joinType), end_type(endType));
+    // ClipperLib offsets open paths by delta to both sides, Clipper2 by half of delta.
+    return to_paths(co.Execute(endType == ClipperLib::etClosedPolygon ? delta : 2. * delta));
+}
+
+} // namespace Clipper2Backend
+
 // Offset CCW contours outside, CW contours (holes) inside.
 // Don't calculate union of the output paths.
 template<typename PathsProvider, ClipperLib::EndType endType = ClipperLib::etClosedPolygon>
@@ -281,14 +427,19 @@ static ClipperLib::Paths raw_offset(PathsProvider &&paths, float offset, Clipper
     else
         co.MiterLimit = miterLimit;
     co.ShortestEdgeLength = double(std::abs(offset * ClipperOffsetShortestEdgeFactor));
+    const bool clipper2 = Clipper2Backend::enabled();
     for (const ClipperLib::Path &path : paths) {
-        co.Clear();
         // Execute reorients the contours so that the outer most contour has a positive area. Thus the output
         // contours will be CCW oriented even though the input paths are CW oriented.
         // Offset is applied after contour reorientation, thus the signum of the offset value is reversed.
-        co.AddPath(path, joinType, endType);
         bool ccw = endType == ClipperLib::etClosedPolygon ? ClipperLib::Orientation(path) : true;
-        co.Execute(out_this, ccw ? offset : - offset);
+        if (clipper2)
+            out_this = Clipper2Backend::offset(path, ccw ? offset : - offset, joinType, endType, miterLimit);
+        else {
+            co.Clear();
+            co.AddPath(path, joinType, endType);
+            co.Execute(out_this, ccw ? offset : - offset);
+        }
         if (! ccw) {
             // Reverse the resulting contours.
             for (ClipperLib::Path &path : out_this)
@@ -313,6 +464,8 @@ TResult clipper_do(
     TClip &&                       clip,
     const ClipperLib::PolyFillType fillType)
 {
+    if (Clipper2Backend::enabled())
+        return Clipper2Backend::clipper_do<TResult>(clipType, std::forward<TSubj>(subject), std::forward<TClip>(clip), fillType);
     ClipperLib::Clipper clipper;
     clipper.AddPaths(std::forward<TSubj>(subject), ClipperLib::ptSubject, true);
     clipper.AddPaths(std::forward<TClip>(clip),    ClipperLib::ptClip,    true);
@@ -342,6 +495,8 @@ TResult clipper_union(
     // fillType pftNonZero and pftPositive "should" produce the same result for "normalized with implicit union" set of polygons
     const ClipperLib::PolyFillType fillType = ClipperLib::pftNonZero)
 {
+    if (Clipper2Backend::enabled())
+        return Clipper2Backend::clipper_do<TResult>(ClipperLib::ctUnion, std::forward<TSubj>(subject), ClipperUtils::EmptyPathsProvider(), fillType);
     ClipperLib::Clipper clipper;
     clipper.AddPaths(std::forward<TSubj>(subject), ClipperLib::ptSubject, true);
     TResult retval;
@@ -385,6 +540,9 @@ static TResult shrink_paths(PathsProvider &&paths, float offset, ClipperLib::Joi
     //assert(offset > 0);
     TResult out;
     if (auto raw = raw_offset(std::forward<PathsProvider>(paths), - offset, joinType, miterLimit); ! raw.empty()) {
+        if (Clipper2Backend::enabled())
+            // Same as the union with the bounding rectangle below: keep the regions with a positive winding number.
+            return Clipper2Backend::clipper_do<TResult>(ClipperLib::ctUnion, raw, ClipperUtils::EmptyPathsProvider(), ClipperLib::pftPositive);
         ClipperLib::Clipper clipper;
         clipper.AddPaths(raw, ClipperLib::ptSubject, true);
         ClipperLib::IntRect r = clipper.GetBounds();
@@ -425,7 +583,10 @@ static int offset_expolygon_inner(const Slic3r::ExPolygon &expoly, const float d
 {
     // 1) Offset the outer contour.
     ClipperLib::Paths contours;
-    {
+    const bool clipper2 = Clipper2Backend::enabled();
+    if (clipper2)
+        contours = Clipper2Backend::offset(expoly.contour.points, delta, joinType, ClipperLib::etClosedPolygon, miterLimit);
+    else {
         ClipperLib::ClipperOffset co;
         if (joinType == jtRound)
             co.ArcTolerance = miterLimit;
@@ -447,6 +608,10 @@ static int offset_expolygon_inner(const Slic3r::ExPolygon &expoly, const float d
         ClipperLib::Paths holes;
         {
             for (const Polygon &hole : expoly.holes) {
+                if (clipper2) {
+                    append(holes, Clipper2Backend::offset(hole.points, - delta, joinType, ClipperLib::etClosedPolygon, miterLimit));
+                    continue;
+                }
                 ClipperLib::ClipperOffset co;
                 if (joinType == jtRound)
                     co.ArcTolerance = miterLimit;
@@ -631,6 +796,9 @@ inline ClipperLib::PolyTree clipper_do_polytree(
     PathProvider2                  &&clip,
     const ClipperLib::PolyFillType   fillType)
 {
+    if (Clipper2Backend::enabled())
+        // Clipper2 builds the PolyTree without the overhead described above.
+        return clipper_do<ClipperLib::PolyTree>(clipType, std::forward<PathProvider1>(subject), std::forward<PathProvider2>(clip), fillType);
     // Perform the operation with the output to input_subject.
     // This pass does not generate a PolyTree, which is a very expensive operation with the current Clipper library
     // if there are overapping edges.
@@ -812,6 +980,14 @@ Slic3r::ExPolygons union_ex(const Slic3r::ExPolygons& poly1, const Slic3r::ExPol
     return union_ex(expolys);
     }
 
+// BBS
+Slic3r::Polygons xor_(const Slic3r::Polygons &subject, const Slic3r::Polygons &clip)
+    { return _clipper(ClipperLib::ctXor, ClipperUtils::PolygonsProvider(subject), ClipperUtils::PolygonsProvider(clip), ApplySafetyOffset::No); }
+Slic3r::ExPolygons xor_ex(const Slic3r::Polygons &subject, const Slic3r::Polygons &clip)
+    { return _clipper_ex(ClipperLib::ctXor, ClipperUtils::PolygonsProvider(subject), ClipperUtils::PolygonsProvider(clip), ApplySafetyOffset::No); }
+Slic3r::ExPolygons xor_ex(const Slic3r::ExPolygons &subject, const Slic3r::ExPolygons &clip)
+    { return _clipper_ex(ClipperLib::ctXor, ClipperUtils::ExPolygonsProvider(subject), ClipperUtils::ExPolygonsProvider(clip), ApplySafetyOffset::No); }
+
 template<typename PathsProvider1, typename PathsProvider2>
 Polylines _clipper_pl_open(ClipperLib::ClipType clipType, PathsProvider1 &&subject, PathsProvider2 &&clip)
 {
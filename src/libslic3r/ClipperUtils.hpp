@@ -330,6 +330,17 @@ namespace ClipperUtils {
     [[nodiscard]] Polygons clip_clipper_polygons_with_subject_bbox(const ExPolygon &src, const BoundingBox &bbox, const bool get_entire_polygons = false);
     [[nodiscard]] Polygons clip_clipper_polygons_with_subject_bbox(const ExPolygons &src, const BoundingBox &bbox, const bool get_entire_polygons = false);
 
+    // BBS: library performing the offsets and the booleans of the functions below (offset, offset_ex, offset2, union_, diff,
+    // intersection, xor_ and their _ex variants). The results are converted to Polygons / ExPolygons the same way for both backends.
+    // The default is Clipper2 if compiled with SLIC3R_CLIPPER2_BACKEND, ClipperLib otherwise. The backend is global,
+    // switch it only while no other thread is calling these functions.
+    enum class Backend {
+        ClipperLib,
+        Clipper2
+    };
+    void    set_backend(Backend backend);
+    Backend backend();
+
     }
 
 // Perform union of input polygons using the non-zero rule, convert to ExPolygons.
@@ -552,6 +563,11 @@ Slic3r::ExPolygons union_ex(const Slic3r::Surfaces &subject);
 
 Slic3r::ExPolygons union_ex(const Slic3r::ExPolygons& poly1, const Slic3r::ExPolygons& poly2, bool safety_offset_ = false);
 
+// BBS: symmetric difference, the areas covered by exactly one of subject and clip.
+Slic3r::Polygons   xor_(const Slic3r::Polygons &subject, const Slic3r::Polygons &clip);
+Slic3r::ExPolygons xor_ex(const Slic3r::Polygons &subject, const Slic3r::Polygons &clip);
+Slic3r::ExPolygons xor_ex(const Slic3r::ExPolygons &subject, const Slic3r::ExPolygons &clip);
+
 // Convert polygons / expolygons into ClipperLib::PolyTree using ClipperLib::pftEvenOdd, thus union will NOT be performed.
 // If the contours are not intersecting, their orientation shall not be modified by union_pt().
 ClipperLib::PolyTree union_pt(const Slic3r::Polygons &subject);
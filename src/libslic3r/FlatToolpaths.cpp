@@ -0,0 +1,276 @@
+#include "FlatToolpaths.hpp"
+#include "ExtrusionEntityCollection.hpp"
+
+#include <cassert>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <type_traits>
+
+namespace Slic3r {
+
+// The arrays live in a block of raw memory, nothing is destructed when it is released.
+static_assert(std::is_trivially_destructible_v<Point>);
+static_assert(std::is_trivially_destructible_v<FlatToolpaths::Path>);
+static_assert(std::is_trivially_destructible_v<FlatToolpaths::Entity>);
+
+FlatToolpaths::FlatToolpaths(const ExtrusionEntityCollection &collection)
+{
+    Counts counts;
+    for (const ExtrusionEntity *entity : collection.entities)
+        count(*entity, counts);
+    this->allocate(counts);
+    for (const ExtrusionEntity *entity : collection.entities)
+        this->append(*entity);
+}
+
+FlatToolpaths::FlatToolpaths(std::initializer_list<const ExtrusionEntity*> entities)
+{
+    Counts counts;
+    for (const ExtrusionEntity *entity : entities)
+        count(*entity, counts);
+    this->allocate(counts);
+    for (const ExtrusionEntity *entity : entities)
+        this->append(*entity);
+}
+
+FlatToolpaths::FlatToolpaths(const ExtrusionPaths &paths)
+{
+    Counts counts;
+    for (const ExtrusionPath &path : paths)
+        count(path, counts);
+    counts.entities = paths.size();
+    this->allocate(counts);
+    for (const ExtrusionPath &path : paths)
+        this->append_path(path, EntityType::Path);
+}
+
+FlatToolpaths::FlatToolpaths(const FlatToolpaths &rhs)
+{
+    this->allocate({ rhs.m_num_points, rhs.m_num_paths, rhs.m_num_entities });
+    std::uninitialized_copy(rhs.m_points, rhs.m_points + rhs.m_num_points, m_points);
+    std::uninitialized_copy(rhs.m_paths, rhs.m_paths + rhs.m_num_paths, m_paths);
+    std::uninitialized_copy(rhs.m_entities, rhs.m_entities + rhs.m_num_entities, m_entities);
+    m_num_points   = rhs.m_num_points;
+    m_num_paths    = rhs.m_num_paths;
+    m_num_entities = rhs.m_num_entities;
+}
+
+void FlatToolpaths::swap(FlatToolpaths &rhs) noexcept
+{
+    std::swap(m_data,         rhs.m_data);
+    std::swap(m_data_size,    rhs.m_data_size);
+    std::swap(m_points,       rhs.m_points);
+    std::swap(m_paths,        rhs.m_paths);
+    std::swap(m_entities,     rhs.m_entities);
+    std::swap(m_num_points,   rhs.m_num_points);
+    std::swap(m_num_paths,    rhs.m_num_paths);
+    std::swap(m_num_entities, rhs.m_num_entities);
+}
+
+void FlatToolpaths::count(const ExtrusionEntity &entity, Counts &counts)
+{
+    ++ counts.entities;
+    if (const ExtrusionEntityCollection *collection = dynamic_cast<const ExtrusionEntityCollection*>(&entity)) {
+        for (const ExtrusionEntity *child : collection->entities)
+            count(*child, counts);
+    } else if (const ExtrusionLoop *loop = dynamic_cast<const ExtrusionLoop*>(&entity)) {
+        for (const ExtrusionPath &path : loop->paths)
+            count(path, counts);
+    } else if (const ExtrusionMultiPath *multipath = dynamic_cast<const ExtrusionMultiPath*>(&entity)) {
+        for (const ExtrusionPath &path : multipath->paths)
+            count(path, counts);
+    } else if (const ExtrusionPath *path = dynamic_cast<const ExtrusionPath*>(&entity)) {
+        count(*path, counts);
+    } else
+        assert(false);
+}
+
+void FlatToolpaths::allocate(const Counts &counts)
+{
+    assert(! m_data);
+    auto align = [](size_t offset, size_t alignment) { return (offset + alignment - 1) / alignment * alignment; };
+    size_t paths_offset    = align(counts.points * sizeof(Point), alignof(Path));
+    size_t entities_offset = align(paths_offset + counts.paths * sizeof(Path), alignof(Entity));
+    m_data_size = entities_offset + counts.entities * sizeof(Entity);
+    if (m_data_size == 0)
+        return;
+    // new[] of unsigned char returns memory aligned for any fundamental type.
+    static_assert(alignof(Point) <= alignof(std::max_align_t) && alignof(Path) <= alignof(std::max_align_t));
+    m_data.reset(new unsigned char[m_data_size]);
+    m_points   = reinterpret_cast<Point*>(m_data.get());
+    m_paths    = reinterpret_cast<Path*>(m_data.get() + paths_offset);
+    m_entities = reinterpret_cast<Entity*>(m_data.get() + entities_offset);
+}
+
+void FlatToolpaths::append(const ExtrusionEntity &entity)
+{
+    if (const ExtrusionEntityCollection *collection = dynamic_cast<const ExtrusionEntityCollection*>(&entity)) {
+        size_t  idx  = m_num_entities ++;
+        Entity *flat = new (m_entities + idx) Entity();
+        flat->type        = EntityType::Collection;
+        flat->no_sort     = collection->no_sort;
+        // The reversibility of a no_sort collection is not observable, see ExtrusionEntityCollection::can_reverse().
+        flat->can_reverse = collection->no_sort || collection->can_reverse();
+        flat->first_path  = uint32_t(m_num_paths);
+        for (const ExtrusionEntity *child : collection->entities)
+            this->append(*child);
+        flat->num_paths       = uint32_t(m_num_paths - flat->first_path);
+        flat->num_descendants = uint32_t(m_num_entities - idx - 1);
+        // Same as ExtrusionEntityCollection::role().
+        for (size_t child = idx + 1; child < m_num_entities; child = this->next_sibling(child)) {
+            ExtrusionRole er = m_entities[child].role;
+            flat->role = (flat->role == erNone || flat->role == er) ? er : erMixed;
+        }
+    } else if (const ExtrusionLoop *loop = dynamic_cast<const ExtrusionLoop*>(&entity)) {
+        Entity *flat = new (m_entities + m_num_entities ++) Entity();
+        flat->type       = EntityType::Loop;
+        flat->loop_role  = loop->loop_role();
+        flat->role       = loop->role();
+        flat->first_path = uint32_t(m_num_paths);
+        flat->num_paths  = uint32_t(loop->paths.size());
+        for (const ExtrusionPath &path : loop->paths)
+            this->append_path_data(path);
+    } else if (const ExtrusionMultiPath *multipath = dynamic_cast<const ExtrusionMultiPath*>(&entity)) {
+        Entity *flat = new (m_entities + m_num_entities ++) Entity();
+        flat->type        = EntityType::MultiPath;
+        flat->can_reverse = multipath->can_reverse();
+        flat->role        = multipath->role();
+        flat->first_path  = uint32_t(m_num_paths);
+        flat->num_paths   = uint32_t(multipath->paths.size());
+        for (const ExtrusionPath &path : multipath->paths)
+            this->append_path_data(path);
+    } else if (const ExtrusionPathOriented *path = dynamic_cast<const ExtrusionPathOriented*>(&entity)) {
+        this->append_path(*path, EntityType::PathOriented);
+    } else if (const ExtrusionPath *path = dynamic_cast<const ExtrusionPath*>(&entity)) {
+        this->append_path(*path, EntityType::Path);
+    } else
+        assert(false);
+}
+
+void FlatToolpaths::append_path(const ExtrusionPath &path, EntityType type)
+{
+    Entity *flat = new (m_entities + m_num_entities ++) Entity();
+    flat->type        = type;
+    flat->can_reverse = path.can_reverse();
+    flat->role        = path.role();
+    flat->first_path  = uint32_t(m_num_paths);
+    flat->num_paths   = 1;
+    this->append_path_data(path);
+}
+
+void FlatToolpaths::append_path_data(const ExtrusionPath &path)
+{
+    Path *flat = new (m_paths + m_num_paths ++) Path();
+    flat->first_point     = uint32_t(m_num_points);
+    flat->num_points      = uint32_t(path.polyline.points.size());
+    flat->mm3_per_mm      = path.mm3_per_mm;
+    flat->width           = path.width;
+    flat->height          = path.height;
+    flat->overhang_degree = path.overhang_degree;
+    flat->curve_degree    = path.curve_degree;
+    flat->role            = path.role();
+    flat->no_extrusion    = path.is_force_no_extrusion();
+    flat->can_reverse     = path.can_reverse();
+    std::uninitialized_copy(path.polyline.points.begin(), path.polyline.points.end(), m_points + m_num_points);
+    m_num_points += path.polyline.points.size();
+}
+
+FlatToolpaths::Span<Point> FlatToolpaths::entity_points(size_t idx) const
+{
+    const Entity &flat = m_entities[idx];
+    if (flat.num_paths == 0)
+        return {};
+    return { this->path_begin(m_paths[flat.first_path]), this->path_end(m_paths[flat.first_path + flat.num_paths - 1]) };
+}
+
+ExtrusionPath FlatToolpaths::to_path(const Path &path) const
+{
+    ExtrusionPath out(path.overhang_degree, path.curve_degree, path.role, path.mm3_per_mm, path.width, path.height);
+    out.set_force_no_extrusion(path.no_extrusion);
+    if (! path.can_reverse)
+        out.set_reverse();
+    out.polyline.points.assign(this->path_begin(path), this->path_end(path));
+    return out;
+}
+
+size_t FlatToolpaths::to_entity(size_t idx, ExtrusionEntityCollection &out) const
+{
+    const Entity &flat = m_entities[idx];
+    switch (flat.type) {
+    case EntityType::Path:
+        out.entities.emplace_back(new ExtrusionPath(this->to_path(m_paths[flat.first_path])));
+        break;
+    case EntityType::PathOriented:
+    {
+        const Path            &path = m_paths[flat.first_path];
+        ExtrusionPathOriented *out_path = new ExtrusionPathOriented(path.role, path.mm3_per_mm, path.width, path.height);
+        out_path->overhang_degree = path.overhang_degree;
+        out_path->curve_degree    = path.curve_degree;
+        out_path->set_force_no_extrusion(path.no_extrusion);
+        out_path->polyline.points.assign(this->path_begin(path), this->path_end(path));
+        out.entities.emplace_back(out_path);
+        break;
+    }
+    case EntityType::MultiPath:
+    {
+        ExtrusionMultiPath *multipath = new ExtrusionMultiPath();
+        multipath->paths.reserve(flat.num_paths);
+        for (const Path &path : this->entity_paths(idx))
+            multipath->paths.emplace_back(this->to_path(path));
+        if (! flat.can_reverse)
+            multipath->set_reverse();
+        out.entities.emplace_back(multipath);
+        break;
+    }
+    case EntityType::Loop:
+    {
+        ExtrusionLoop *loop = new ExtrusionLoop(flat.loop_role);
+        loop->paths.reserve(flat.num_paths);
+        for (const Path &path : this->entity_paths(idx))
+            loop->paths.emplace_back(this->to_path(path));
+        out.entities.emplace_back(loop);
+        break;
+    }
+    case EntityType::Collection:
+    {
+        ExtrusionEntityCollection *collection = new ExtrusionEntityCollection();
+        collection->no_sort = flat.no_sort;
+        if (! flat.can_reverse)
+            collection->set_reverse();
+        size_t end = this->next_sibling(idx);
+        for (size_t child = idx + 1; child < end;)
+            child = this->to_entity(child, *collection);
+        out.entities.emplace_back(collection);
+        break;
+    }
+    }
+    return this->next_sibling(idx);
+}
+
+void FlatToolpaths::to_collection(ExtrusionEntityCollection &out) const
+{
+    for (size_t idx = 0; idx < m_num_entities;)
+        idx = this->to_entity(idx, out);
+}
+
+void FlatToolpaths::collect_polylines(Polylines &dst) const
+{
+    dst.reserve(dst.size() + m_num_paths);
+    for (const Path &path : this->paths())
+        dst.emplace_back(Points(this->path_begin(path), this->path_end(path)));
+}
+
+double FlatToolpaths::total_volume() const
+{
+    double volume = 0.;
+    this->for_each_path([&volume](const Path &path, const Point *begin, const Point *end) {
+        double length = 0.;
+        for (const Point *pt = begin + 1; pt < end; ++ pt)
+            length += (*pt - *(pt - 1)).cast<double>().norm();
+        volume += path.mm3_per_mm * unscale<double>(length);
+    });
+    return volume;
+}
+
+} // namespace Slic3r
@@ -0,0 +1,155 @@
+#ifndef slic3r_FlatToolpaths_hpp_
+#define slic3r_FlatToolpaths_hpp_
+
+#include "libslic3r.h"
+#include "ExtrusionEntity.hpp"
+
+#include <cstdint>
+#include <initializer_list>
+#include <memory>
+
+namespace Slic3r {
+
+class ExtrusionEntityCollection;
+
+// BBS: compact read only copy of a tree of ExtrusionEntities.
+// The points of all paths, one small descriptor per path and the loop / multi path / collection grouping
+// are stored as three arrays of a single memory block, sized by a counting pass over the source tree.
+// Building it costs one allocation instead of one per path and per polyline, and the points and the paths
+// of an entity, including all the descendants of a collection, are contiguous.
+// The ExtrusionEntity trees stay the primary storage, LayerRegion and SupportLayer keep a flat copy
+// of their final extrusions for the consumers reading them only (conflict checker, seam placer).
+class FlatToolpaths
+{
+public:
+    struct Path
+    {
+        // Range of points().
+        uint32_t      first_point { 0 };
+        uint32_t      num_points  { 0 };
+        double        mm3_per_mm  { -1. };
+        float         width       { -1.f };
+        float         height      { -1.f };
+        double        overhang_degree { 0. };
+        int           curve_degree { 0 };
+        ExtrusionRole role        { erNone };
+        bool          no_extrusion { false };
+        bool          can_reverse  { true };
+    };
+
+    enum class EntityType : uint8_t { Path, PathOriented, MultiPath, Loop, Collection };
+
+    struct Entity
+    {
+        EntityType        type        { EntityType::Path };
+        // Only valid for loops.
+        ExtrusionLoopRole loop_role   { elrDefault };
+        bool              can_reverse { true };
+        // Only valid for collections.
+        bool              no_sort     { false };
+        // ExtrusionEntity::role() of the source entity.
+        ExtrusionRole     role        { erNone };
+        // Range of paths(), for a collection the paths of all its descendants.
+        uint32_t          first_path  { 0 };
+        uint32_t          num_paths   { 0 };
+        // Number of the entities following a collection in entities() which are its descendants, zero for the other types.
+        uint32_t          num_descendants { 0 };
+    };
+
+    // View of a contiguous range of one of the arrays.
+    template<typename T> class Span
+    {
+    public:
+        Span() = default;
+        Span(const T *begin, const T *end) : m_begin(begin), m_end(end) {}
+
+        const T*    begin() const { return m_begin; }
+        const T*    end() const   { return m_end; }
+        size_t      size() const  { return size_t(m_end - m_begin); }
+        bool        empty() const { return m_begin == m_end; }
+        const T&    operator[](size_t idx) const { return m_begin[idx]; }
+        const T&    front() const { return *m_begin; }
+        const T&    back() const  { return *(m_end - 1); }
+
+    private:
+        const T    *m_begin { nullptr };
+        const T    *m_end   { nullptr };
+    };
+
+    FlatToolpaths() = default;
+    // Flatten the entities of the collection, the collection itself is not stored.
+    explicit FlatToolpaths(const ExtrusionEntityCollection &collection);
+    // Flatten the entities, collections are stored as collections.
+    explicit FlatToolpaths(std::initializer_list<const ExtrusionEntity*> entities);
+    explicit FlatToolpaths(const ExtrusionPaths &paths);
+    FlatToolpaths(const FlatToolpaths &rhs);
+    FlatToolpaths(FlatToolpaths &&rhs) noexcept { this->swap(rhs); }
+    FlatToolpaths& operator=(FlatToolpaths rhs) noexcept { this->swap(rhs); return *this; }
+
+    void                        swap(FlatToolpaths &rhs) noexcept;
+
+    // Rebuild the ExtrusionEntity tree, append its top level entities to out.
+    void                        to_collection(ExtrusionEntityCollection &out) const;
+
+    Span<Point>                 points() const   { return { m_points, m_points + m_num_points }; }
+    Span<Path>                  paths() const    { return { m_paths, m_paths + m_num_paths }; }
+    Span<Entity>                entities() const { return { m_entities, m_entities + m_num_entities }; }
+
+    const Point*                path_begin(const Path &path) const { return m_points + path.first_point; }
+    const Point*                path_end(const Path &path) const   { return m_points + path.first_point + path.num_points; }
+
+    // Paths of the entity at idx, all the paths of the descendants for a collection.
+    Span<Path>                  entity_paths(size_t idx) const
+        { const Entity &e = m_entities[idx]; return { m_paths + e.first_path, m_paths + e.first_path + e.num_paths }; }
+    // Points of the entity at idx in extrusion order, the same as ExtrusionEntity::collect_points().
+    Span<Point>                 entity_points(size_t idx) const;
+    // Index of the entity following the entity at idx and all its descendants.
+    size_t                      next_sibling(size_t idx) const { return idx + 1 + m_entities[idx].num_descendants; }
+
+    // Call fn(const Path &path, const Point *begin, const Point *end) for every path in extrusion order.
+    template<typename Fn> void  for_each_path(Fn &&fn) const
+    {
+        for (const Path &path : this->paths())
+            fn(path, this->path_begin(path), this->path_end(path));
+    }
+
+    void                        collect_polylines(Polylines &dst) const;
+    double                      total_volume() const;
+
+    bool                        empty() const { return m_num_paths == 0; }
+    void                        clear() { FlatToolpaths().swap(*this); }
+    size_t                      memsize() const { return sizeof(FlatToolpaths) + m_data_size; }
+
+private:
+    struct Counts
+    {
+        size_t points   { 0 };
+        size_t paths    { 0 };
+        size_t entities { 0 };
+    };
+    static void                 count(const ExtrusionEntity &entity, Counts &counts);
+    static void                 count(const ExtrusionPath &path, Counts &counts) { counts.points += path.polyline.points.size(); ++ counts.paths; }
+
+    // Allocate the single memory block for the arrays, the arrays are filled by the append functions.
+    void                        allocate(const Counts &counts);
+    void                        append(const ExtrusionEntity &entity);
+    void                        append_path(const ExtrusionPath &path, EntityType type);
+    // Append a path descriptor without an entity, for multi paths and loops.
+    void                        append_path_data(const ExtrusionPath &path);
+    // Rebuild the entity at idx, returns the index of its next sibling.
+    size_t                      to_entity(size_t idx, ExtrusionEntityCollection &out) const;
+    ExtrusionPath               to_path(const Path &path) const;
+
+    std::unique_ptr<unsigned char[]> m_data;
+    size_t                      m_data_size    { 0 };
+    Point                      *m_points       { nullptr };
+    Path                       *m_paths        { nullptr };
+    Entity                     *m_entities     { nullptr };
+    size_t                      m_num_points   { 0 };
+    size_t                      m_num_paths    { 0 };
+    size_t                      m_num_entities { 0 };
+};
+
+} // namespace Slic3r
+
+#endif // slic3r_FlatToolpaths_hpp_
@@ -1,12 +1,17 @@
 #include "../libslic3r.h"
 #include "../Model.hpp"
 #include "../TriangleMesh.hpp"
+#include "../Utils.hpp"
 
 #include "OBJ.hpp"
 #include "objparser.hpp"
 
+#include <functional>
+#include <iomanip>
+#include <sstream>
 #include <string>
 
+#include <boost/filesystem/operations.hpp>
 #include <boost/log/trivial.hpp>
 
 #ifdef _WIN32
@@ -21,6 +26,30 @@
 
 namespace Slic3r {
 
+//BBS: OBJ files of at least this size are parsed once and then reloaded from a binary cache in the temporary directory,
+// as long as their content does not change. The least recently used caches are removed above OBJ_CACHE_MAX_SIZE in total.
+static constexpr uintmax_t OBJ_CACHE_MIN_SIZE = 32 * 1024 * 1024;
+static constexpr uint64_t  OBJ_CACHE_MAX_SIZE = uint64_t(4) * 1024 * 1024 * 1024;
+
+// Path of the cache of a large OBJ file, empty if the file is not cached.
+static std::string obj_cache_path(const char *path)
+{
+    if (temporary_dir().empty())
+        return {};
+    boost::system::error_code ec;
+    boost::filesystem::path   obj_path = boost::filesystem::absolute(path, ec);
+    if (ec || boost::filesystem::file_size(obj_path, ec) < OBJ_CACHE_MIN_SIZE || ec)
+        return {};
+    boost::filesystem::path cache_dir = boost::filesystem::path(temporary_dir()) / "obj_cache";
+    boost::filesystem::create_directories(cache_dir, ec);
+    if (ec)
+        return {};
+    // One cache per OBJ file, replaced when the file is modified.
+    std::ostringstream name;
+    name << std::hex << std::setw(16) << std::setfill('0') << std::hash<std::string>()(obj_path.generic_string()) << ".bin";
+    return (cache_dir / name.str()).string();
+}
+
 bool load_obj(const char *path, TriangleMesh *meshptr, ObjInfo& obj_info, std::string &message)
 {
     if (meshptr == nullptr)
@@ -28,11 +57,16 @@ bool load_obj(const char *path, TriangleMesh *meshptr, ObjInfo& obj_info, std::s
     // Parse the OBJ file.
     ObjParser::ObjData data;
     ObjParser::MtlData mtl_data;
-    if (! ObjParser::objparse(path, data)) {
+    std::string cache_path = obj_cache_path(path);
+    if (! (cache_path.empty() ? ObjParser::objparse(path, data) : ObjParser::objparse_cached(path, cache_path.c_str(), data))) {
         BOOST_LOG_TRIVIAL(error) << "load_obj: failed to parse " << path;
         message = _L("load_obj: failed to parse");
         return false;
     }
+    if (! cache_path.empty()) {
+        touch_cache_file(cache_path);
+        limit_cache_directory(boost::filesystem::path(cache_path).parent_path().string(), ".bin", OBJ_CACHE_MAX_SIZE);
+    }
     bool exist_mtl = false;
     if (data.mtllibs.size() > 0) { // read mtl
         for (auto mtl_name : data.mtllibs) {
@@ -1,10 +1,22 @@
 #include "../libslic3r.h"
 #include "../Model.hpp"
 #include "../TriangleMesh.hpp"
+#include "../Utils.hpp"
 
 #include "STL.hpp"
 
+#include <atomic>
+#include <cstring>
+#include <sstream>
 #include <string>
+#include <string_view>
+
+#include <boost/iostreams/device/mapped_file.hpp>
+#include <boost/log/trivial.hpp>
+#include <boost/predef/other/endian.h>
+
+#include <fast_float/fast_float.h>
+#include <tbb/parallel_for.h>
 
 #ifdef _WIN32
 #define DIR_SEPARATOR '\\'
@@ -14,6 +26,263 @@
 
 namespace Slic3r {
 
+namespace {
+
+// The facets are read in this many batches, the progress callback is called before each of them as stl_read() of admesh does.
+constexpr size_t progress_steps = 5;
+// ASCII files are split into chunks of about this size, which are parsed in parallel.
+constexpr size_t ascii_chunk_size = 1024 * 1024;
+
+inline bool is_space(char c) { return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\f' || c == '\v'; }
+
+inline bool is_nan(const stl_vertex &v) { return std::isnan(v.x()) || std::isnan(v.y()) || std::isnan(v.z()); }
+
+// Parser of the facets of an ASCII STL file, accepting the syntax stl_read() of admesh accepts.
+// Anything else makes the parser fail, so that the file is read by admesh.
+class AsciiFacetParser
+{
+public:
+    AsciiFacetParser(const char *begin, const char *end) : m_p(begin), m_end(end) {}
+
+    // Appends 3 vertices per facet to soup and the stored normal to normals.
+    bool parse(std::vector<stl_vertex> &soup, std::vector<stl_normal> &normals)
+    {
+        for (;;) {
+            this->skip_space();
+            if (m_p == m_end)
+                return true;
+            // Broken STL file generators may put several solid / endsolid lines into the file.
+            if (this->starts_with("solid") || this->starts_with("endsolid")) {
+                this->skip_line();
+                continue;
+            }
+            if (! this->keyword("facet") || ! this->keyword("normal"))
+                return false;
+            // The normal is parsed as strings as a workaround for not a numbers in the normal definition.
+            stl_normal normal;
+            bool       normal_valid = true;
+            for (int i = 0; i < 3; ++ i) {
+                this->skip_space();
+                const char *token = m_p;
+                while (m_p != m_end && ! is_space(*m_p))
+                    ++ m_p;
+                normal_valid &= this->parse_float(token, m_p, normal(i)) != token;
+            }
+            if (! normal_valid)
+                // Normal was mangled, reset it.
+                normal = stl_normal::Zero();
+            if (! this->keyword("outer") || ! this->keyword("loop"))
+                return false;
+            for (int i = 0; i < 3; ++ i) {
+                stl_vertex vertex;
+                if (! this->keyword("vertex") || ! this->number(vertex.x()) || ! this->number(vertex.y()) || ! this->number(vertex.z()))
+                    return false;
+                soup.emplace_back(vertex);
+            }
+            // Some G-code generators tend to produce text after "endloop" and "endfacet". Just ignore it.
+            if (! this->keyword("endloop"))
+                return false;
+            this->skip_line();
+            if (! this->keyword("endfacet"))
+                return false;
+            this->skip_line();
+            normals.emplace_back(normal);
+        }
+    }
+
+    // Start of the first line starting with a facet at or after p, or end.
+    static const char* find_facet(const char *p, const char *begin, const char *end)
+    {
+        std::string_view text(begin, end - begin);
+        for (size_t pos = p - begin; (pos = text.find("facet", pos)) != std::string_view::npos; pos += 5) {
+            size_t line_start = pos;
+            while (line_start > 0 && (text[line_start - 1] == ' ' || text[line_start - 1] == '\t'))
+                -- line_start;
+            if (line_start == 0 || text[line_start - 1] == '\n' || text[line_start - 1] == '\r')
+                return begin + pos;
+        }
+        return end;
+    }
+
+private:
+    void skip_space() { while (m_p != m_end && is_space(*m_p)) ++ m_p; }
+    // Lines may also end with just carriage returns.
+    void skip_line()
+    {
+        while (m_p != m_end && *m_p != '\n' && *m_p != '\r')
+            ++ m_p;
+    }
+    bool starts_with(std::string_view prefix) const { return size_t(m_end - m_p) >= prefix.size() && memcmp(m_p, prefix.data(), prefix.size()) == 0; }
+    bool keyword(std::string_view kw)
+    {
+        this->skip_space();
+        if (! this->starts_with(kw) || (m_p + kw.size() != m_end && ! is_space(m_p[kw.size()])))
+            return false;
+        m_p += kw.size();
+        return true;
+    }
+    // Returns the end of the parsed number or begin, as scanf("%f") accepts a leading '+'.
+    static const char* parse_float(const char *begin, const char *end, float &out)
+    {
+        const char *p = begin != end && *begin == '+' ? begin + 1 : begin;
+        const char *parsed = fast_float::from_chars(p, end, out).ptr;
+        return parsed == p ? begin : parsed;
+    }
+    bool number(float &out)
+    {
+        this->skip_space();
+        const char *parsed = parse_float(m_p, m_end, out);
+        if (parsed == m_p)
+            return false;
+        m_p = parsed;
+        return true;
+    }
+
+    const char *m_p;
+    const char *m_end;
+};
+
+// Designer model id and country code stored in the solid name of ASCII files as "MW 1.0 <model_id> <country_code>".
+void parse_solid_name(const char *begin, const char *end, std::string &model_id, std::string &country_code)
+{
+    while (begin != end && is_space(*begin))
+        ++ begin;
+    if (size_t(end - begin) < 5 || memcmp(begin, "solid", 5) != 0)
+        return;
+    const char *eol = begin + 5;
+    while (eol != end && *eol != '\n' && *eol != '\r')
+        ++ eol;
+    std::string name(begin + 5, eol);
+    size_t      mw = name.find("MW");
+    if (mw == std::string::npos || mw + 3 > name.size())
+        return;
+    std::istringstream iss(name.substr(mw + 3));
+    std::string        version, id, code;
+    if (iss >> version >> id >> code && version == "1.0") {
+        model_id     = id;
+        country_code = code;
+    }
+}
+
+} // namespace
+
+bool its_read_stl(const char *path, indexed_triangle_set &its, std::vector<stl_normal> &normals, bool &canceled, ImportstlProgressFn stlFn, int custom_header_length)
+{
+    canceled = false;
+#if BOOST_ENDIAN_BIG_BYTE
+    // The binary facets would have to be byte swapped.
+    return false;
+#endif /* BOOST_ENDIAN_BIG_BYTE */
+    boost::iostreams::mapped_file_source mapped;
+    if (! map_file(path, mapped))
+        return false;
+    const char  *data        = mapped.data();
+    const size_t file_size   = mapped.size();
+    const size_t header_size = size_t(std::max(custom_header_length, LABEL_SIZE)) + NUM_FACET_SIZE;
+
+    // Detect the file type the same way as stl_open() of admesh.
+    if (file_size < header_size + 128)
+        return false;
+    bool binary = false;
+    for (size_t i = header_size; i < header_size + 128 && ! binary; ++ i)
+        binary = static_cast<unsigned char>(data[i]) > 127;
+
+    std::string model_id, country_code;
+    auto        progress = [&](size_t current, size_t total) {
+        if (stlFn)
+            stlFn(int(current), int(total), canceled, model_id, country_code);
+        return ! canceled;
+    };
+
+    std::vector<stl_vertex> soup;
+    std::atomic<bool>       failed { false };
+    if (binary) {
+        if ((file_size - header_size) % SIZEOF_STL_FACET != 0 || file_size < STL_MIN_FILE_SIZE) {
+            BOOST_LOG_TRIVIAL(error) << "its_read_stl: The file " << path << " has the wrong size.";
+            return false;
+        }
+        const size_t num_facets = (file_size - header_size) / SIZEOF_STL_FACET;
+        soup.resize(num_facets * 3);
+        normals.resize(num_facets);
+        const char *facets = data + header_size;
+        for (size_t step = 0; step < progress_steps; ++ step) {
+            size_t begin = num_facets * step / progress_steps;
+            size_t end   = num_facets * (step + 1) / progress_steps;
+            if (! progress(begin, num_facets))
+                return false;
+            tbb::parallel_for(tbb::blocked_range<size_t>(begin, end), [facets, &soup, &normals, &failed](const tbb::blocked_range<size_t> &range) {
+                for (size_t i = range.begin(); i < range.end(); ++ i) {
+                    // Normal and 3 vertices of little endian floats, not aligned.
+                    float values[12];
+                    memcpy(values, facets + i * SIZEOF_STL_FACET, sizeof(values));
+                    normals[i] = stl_normal(values[0], values[1], values[2]);
+                    for (size_t j = 0; j < 3; ++ j) {
+                        soup[i * 3 + j] = stl_vertex(values[3 * j + 3], values[3 * j + 4], values[3 * j + 5]);
+                        if (is_nan(soup[i * 3 + j]))
+                            failed = true;
+                    }
+                }
+            });
+        }
+    } else {
+        const char *begin = data;
+        const char *end   = data + file_size;
+        parse_solid_name(begin, end, model_id, country_code);
+        // Split the file at the starts of the facets.
+        std::vector<const char*> splits { begin };
+        for (size_t i = 1; i < file_size / ascii_chunk_size; ++ i) {
+            const char *split = AsciiFacetParser::find_facet(std::max(splits.back(), begin + i * ascii_chunk_size), begin, end);
+            if (split == end)
+                break;
+            if (split > splits.back())
+                splits.emplace_back(split);
+        }
+        splits.emplace_back(end);
+        const size_t num_chunks = splits.size() - 1;
+        std::vector<std::vector<stl_vertex>> chunk_soups(num_chunks);
+        std::vector<std::vector<stl_normal>> chunk_normals(num_chunks);
+        for (size_t step = 0; step < progress_steps; ++ step) {
+            size_t chunk_begin = num_chunks * step / progress_steps;
+            size_t chunk_end   = num_chunks * (step + 1) / progress_steps;
+            if (! progress(chunk_begin, num_chunks))
+                return false;
+            tbb::parallel_for(tbb::blocked_range<size_t>(chunk_begin, chunk_end, 1), [&](const tbb::blocked_range<size_t> &range) {
+                for (size_t i = range.begin(); i < range.end() && ! failed; ++ i) {
+                    chunk_soups[i].reserve(size_t(splits[i + 1] - splits[i]) / 80);
+                    if (! AsciiFacetParser(splits[i], splits[i + 1]).parse(chunk_soups[i], chunk_normals[i]))
+                        failed = true;
+                }
+            });
+            if (failed)
+                break;
+        }
+        if (! failed) {
+            size_t num_facets = 0;
+            for (const std::vector<stl_normal> &n : chunk_normals)
+                num_facets += n.size();
+            soup.reserve(num_facets * 3);
+            normals.reserve(num_facets);
+            for (size_t i = 0; i < num_chunks; ++ i) {
+                append(soup, std::move(chunk_soups[i]));
+                append(normals, std::move(chunk_normals[i]));
+            }
+            for (const stl_vertex &v : soup)
+                if (is_nan(v)) {
+                    failed = true;
+                    break;
+                }
+        }
+    }
+    if (failed || soup.size() >= size_t(std::numeric_limits<int>::max())) {
+        // NaN vertices, syntax the parser does not handle, too many facets.
+        BOOST_LOG_TRIVIAL(info) << "its_read_stl: " << path << " will be read by admesh";
+        normals.clear();
+        return false;
+    }
+    its = its_from_triangle_soup(soup);
+    return true;
+}
+
 bool load_stl(const char *path, Model *model, const char *object_name_in, ImportstlProgressFn stlFn, int custom_header_length)
 {
     TriangleMesh mesh;
@@ -12,6 +12,11 @@ class ModelObject;
 // Load an STL file into a provided model.
 extern bool load_stl(const char *path, Model *model, const char *object_name = nullptr, ImportstlProgressFn stlFn = nullptr, int custom_header_length = 80);
 
+// BBS: Read a binary or ASCII STL file into an indexed triangle set with the exactly matching vertices merged. The facets are
+// read from the memory mapped file in parallel, normals receive the normals stored with the facets. Returns false if the file
+// could not be read this way: If the import was not canceled through stlFn, the caller shall read the file with stl_open().
+extern bool its_read_stl(const char *path, indexed_triangle_set &its, std::vector<stl_normal> &normals, bool &canceled, ImportstlProgressFn stlFn = nullptr, int custom_header_length = 80);
+
 extern bool store_stl(const char *path, TriangleMesh *mesh, bool binary);
 extern bool store_stl(const char *path, ModelObject *model_object, bool binary);
 extern bool store_stl(const char *path, Model *model, bool binary);
@@ -13,8 +13,11 @@
 #include "../I18N.hpp"
 
 #include "bbs_3mf.hpp"
+#include "bbs_3mf_mesh.hpp"
 
+#include <atomic>
 #include <limits>
+#include <set>
 #include <stdexcept>
 #include <iomanip>
 
@@ -392,8 +395,12 @@ std::string bbs_get_attribute_value_string(const char** attributes, unsigned int
 float bbs_get_attribute_value_float(const char** attributes, unsigned int attributes_size, const char* attribute_key)
 {
     float value = 0.0f;
-    if (const char *text = bbs_get_attribute_value_charptr(attributes, attributes_size, attribute_key); text != nullptr)
+    if (const char *text = bbs_get_attribute_value_charptr(attributes, attributes_size, attribute_key); text != nullptr) {
+        // fast_float::from_chars() rejects a leading '+'.
+        if (*text == '+')
+            ++ text;
         fast_float::from_chars(text, text + strlen(text), value);
+    }
     return value;
 }
 
@@ -786,6 +793,7 @@ void PlateData::parse_filament_info(GCodeProcessorResult *result)
             std::string obj_curr_metadata_name;
             std::string obj_curr_characters;
             float object_unit_factor;
+            MeshXmlSections *object_mesh_sections{nullptr};
             int object_current_color_group{-1};
             std::map<int, std::string> object_group_id_to_color;
             bool is_bbl_3mf { false };
@@ -949,6 +957,8 @@ void PlateData::parse_filament_info(GCodeProcessorResult *result)
         Model* m_model;
         float m_unit_factor;
         CurrentObject* m_curr_object{nullptr};
+        // BBS: mesh sections of the model file being parsed, decoded by the fast path
+        MeshXmlSections* m_mesh_sections{nullptr};
         IdToCurrentObjectMap m_current_objects;
         IndexToPathMap       m_index_paths;
         IdToModelObjectMap m_objects;
@@ -1021,6 +1031,8 @@ void PlateData::parse_filament_info(GCodeProcessorResult *result)
         bool _extract_xml_from_archive(mz_zip_archive& archive, const mz_zip_archive_file_stat& stat, XML_StartElementHandler start_handler, XML_EndElementHandler end_handler);
         bool _extract_model_from_archive(mz_zip_archive& archive, const mz_zip_archive_file_stat& stat);
         void _extract_cut_information_from_archive(mz_zip_archive &archive, const mz_zip_archive_file_stat &stat, ConfigSubstitutionContext &config_substitutions);
+        //BBS: read the ids of the objects on a plate before loading the model
+        bool _extract_plate_object_ids_from_archive(mz_zip_archive &archive, int plate_id, std::set<int> &object_ids);
         void _extract_layer_heights_profile_config_from_archive(mz_zip_archive& archive, const mz_zip_archive_file_stat& stat);
         void _extract_layer_config_ranges_from_archive(mz_zip_archive& archive, const mz_zip_archive_file_stat& stat, ConfigSubstitutionContext& config_substitutions);
         void _extract_sla_support_points_from_archive(mz_zip_archive& archive, const mz_zip_archive_file_stat& stat);
@@ -1563,6 +1575,7 @@ void PlateData::parse_filament_info(GCodeProcessorResult *result)
 
         //check whether sub relation file is exist or not
         int sub_index = mz_zip_reader_locate_file(&archive, sub_rels.c_str(), nullptr, 0);
+        bool root_model_loaded = false;
         if (sub_index == -1) {
             //no submodule files found, use only one 3dmodel.model
         }
@@ -1570,6 +1583,34 @@ void PlateData::parse_filament_info(GCodeProcessorResult *result)
             _extract_xml_from_archive(archive, sub_rels, _handle_start_relationships_element, _handle_end_relationships_element);
             int index = 0;
 
+            // BBS: when loading a single plate, load the root model first to find the sub models referenced by the objects
+            // of the plate, then skip loading the meshes and the paint data of the objects on the other plates.
+            std::set<int> plate_object_ids;
+            bool load_plate_only = plate_id > 0 && !m_load_restore && _extract_plate_object_ids_from_archive(archive, plate_id, plate_object_ids);
+            if (load_plate_only) {
+                if (!_extract_from_archive(archive, m_start_part_path, [this] (mz_zip_archive& archive, const mz_zip_archive_file_stat& stat) {
+                            return _extract_model_from_archive(archive, stat);
+                    })) {
+                    add_error("Archive does not contain a valid model");
+                    return false;
+                }
+                root_model_loaded = true;
+                // the plate list of a 3mf from other vendors does not refer to the objects of its model
+                load_plate_only = m_is_bbl_3mf;
+            }
+            if (load_plate_only) {
+                auto normalize = [](const std::string& path) { return (!path.empty() && path.front() == '/') ? path.substr(1) : path; };
+                std::set<std::string> plate_sub_model_paths;
+                for (const IdToCurrentObjectMap::value_type& object : m_current_objects)
+                    if (plate_object_ids.count(object.first.second) > 0)
+                        for (const Component& component : object.second.components)
+                            plate_sub_model_paths.insert(normalize(component.object_id.first));
+                BOOST_LOG_TRIVIAL(info) << __FUNCTION__ << ":" << __LINE__ << boost::format(", load %1% of %2% sub model files for plate %3%\n")
+                    % plate_sub_model_paths.size() % m_sub_model_paths.size() % plate_id;
+                m_sub_model_paths.erase(std::remove_if(m_sub_model_paths.begin(), m_sub_model_paths.end(),
+                    [&plate_sub_model_paths, &normalize](const std::string& path) { return plate_sub_model_paths.count(normalize(path)) == 0; }), m_sub_model_paths.end());
+            }
+
 #if 0
             for (auto path : m_sub_model_paths) {
                 if (proFn) {
@@ -1636,7 +1677,7 @@ void PlateData::parse_filament_info(GCodeProcessorResult *result)
         }
 
         //extract model files
-        if (!_extract_from_archive(archive, m_start_part_path, [this] (mz_zip_archive& archive, const mz_zip_archive_file_stat& stat) {
+        if (!root_model_loaded && !_extract_from_archive(archive, m_start_part_path, [this] (mz_zip_archive& archive, const mz_zip_archive_file_stat& stat) {
                     return _extract_model_from_archive(archive, stat);
             })) {
             add_error("Archive does not contain a valid model");
@@ -2267,6 +2308,41 @@ void PlateData::parse_filament_info(GCodeProcessorResult *result)
         return true;
     }
 
+    // BBS: a large model file is extracted to memory and its mesh sections are decoded in parallel by decode_mesh_xml_sections(),
+    // while the rest of the file is parsed by Expat, whose handlers of the </vertices> and </triangles> end elements take the decoded
+    // sections from mesh_sections. If the fast path does not handle the file, the whole file is parsed by Expat.
+    // Returns false if the file could not be extracted, throws on errors while parsing as the streaming callback does.
+    template<typename ParseError, typename ParseErrorMessage>
+    static bool parse_model_xml_in_memory(mz_zip_archive &archive, const mz_zip_archive_file_stat &stat, XML_Parser parser, MeshXmlSections *&mesh_sections,
+                                          ParseError parse_error, ParseErrorMessage parse_error_message)
+    {
+        std::string buffer((size_t)stat.m_uncomp_size, 0);
+        if (mz_zip_reader_extract_to_mem(&archive, stat.m_file_index, (void*)buffer.data(), buffer.size(), 0) == 0)
+            return false;
+
+        MeshXmlSections    sections;
+        const std::string *text = &buffer;
+        if (decode_mesh_xml_sections(buffer.data(), buffer.data() + buffer.size(), sections)) {
+            // release the text of the mesh sections before Expat builds the model
+            std::string().swap(buffer);
+            text          = &sections.skeleton;
+            mesh_sections = &sections;
+        }
+        ScopeGuard reset_mesh_sections([&mesh_sections]() { mesh_sections = nullptr; });
+        if (!XML_Parse(parser, text->data(), (int)text->size(), 1) || parse_error()) {
+            char error_buf[1024];
+            ::snprintf(error_buf, 1024, "Error (%s) while parsing '%s' at line %d", parse_error_message(), stat.m_filename, (int)XML_GetCurrentLineNumber(parser));
+            throw Slic3r::FileIOError(error_buf);
+        }
+        return true;
+    }
+
+    // BBS: is the model file large enough for parse_model_xml_in_memory() and small enough for a single XML_Parse() call?
+    static bool parse_model_xml_in_memory_enabled(const mz_zip_archive_file_stat &stat)
+    {
+        return stat.m_uncomp_size >= MeshXmlSections::min_file_size && stat.m_uncomp_size < (mz_uint64)std::numeric_limits<int>::max();
+    }
+
     bool _BBS_3MF_Importer::_extract_model_from_archive(mz_zip_archive& archive, const mz_zip_archive_file_stat& stat)
     {
         if (stat.m_uncomp_size == 0) {
@@ -2301,17 +2377,22 @@ void PlateData::parse_filament_info(GCodeProcessorResult *result)
 
         try
         {
-            mz_file_write_func callback = [](void* pOpaque, mz_uint64 file_ofs, const void* pBuf, size_t n)->size_t {
-                CallbackData* data = (CallbackData*)pOpaque;
-                if (!XML_Parse(data->parser, (const char*)pBuf, (int)n, (file_ofs + n == data->stat.m_uncomp_size) ? 1 : 0) || data->importer.parse_error()) {
-                    char error_buf[1024];
-                    ::snprintf(error_buf, 1024, "Error (%s) while parsing '%s' at line %d", data->importer.parse_error_message(), data->stat.m_filename, (int)XML_GetCurrentLineNumber(data->parser));
-                    throw Slic3r::FileIOError(error_buf);
-                }
-                return n;
-            };
-            void* opaque = &data;
-            res = mz_zip_reader_extract_to_callback(&archive, stat.m_file_index, callback, opaque, 0);
+            if (parse_model_xml_in_memory_enabled(stat))
+                res = parse_model_xml_in_memory(archive, stat, m_xml_parser, m_mesh_sections,
+                    [this]() { return parse_error(); }, [this]() { return parse_error_message(); });
+            else {
+                mz_file_write_func callback = [](void* pOpaque, mz_uint64 file_ofs, const void* pBuf, size_t n)->size_t {
+                    CallbackData* data = (CallbackData*)pOpaque;
+                    if (!XML_Parse(data->parser, (const char*)pBuf, (int)n, (file_ofs + n == data->stat.m_uncomp_size) ? 1 : 0) || data->importer.parse_error()) {
+                        char error_buf[1024];
+                        ::snprintf(error_buf, 1024, "Error (%s) while parsing '%s' at line %d", data->importer.parse_error_message(), data->stat.m_filename, (int)XML_GetCurrentLineNumber(data->parser));
+                        throw Slic3r::FileIOError(error_buf);
+                    }
+                    return n;
+                };
+                void* opaque = &data;
+                res = mz_zip_reader_extract_to_callback(&archive, stat.m_file_index, callback, opaque, 0);
+            }
         }
         catch (const version_error& e)
         {
@@ -2332,6 +2413,51 @@ void PlateData::parse_filament_info(GCodeProcessorResult *result)
         return true;
     }
 
+    bool _BBS_3MF_Importer::_extract_plate_object_ids_from_archive(mz_zip_archive &archive, int plate_id, std::set<int> &object_ids)
+    {
+        mz_zip_archive_file_stat stat;
+        int index = mz_zip_reader_locate_file(&archive, BBS_MODEL_CONFIG_FILE.c_str(), nullptr, 0);
+        if (index < 0 || !mz_zip_reader_file_stat(&archive, index, &stat) || stat.m_uncomp_size == 0)
+            return false;
+
+        std::string buffer((size_t) stat.m_uncomp_size, 0);
+        if (mz_zip_reader_extract_to_mem(&archive, stat.m_file_index, (void *) buffer.data(), buffer.size(), 0) == 0)
+            return false;
+
+        pt::ptree config_tree;
+        try {
+            std::istringstream iss(buffer);
+            pt::read_xml(iss, config_tree);
+        } catch (const std::exception &e) {
+            BOOST_LOG_TRIVIAL(warning) << __FUNCTION__ << ":" << __LINE__ << boost::format(", failed to read the plates of %1%: %2%\n") % BBS_MODEL_CONFIG_FILE % e.what();
+            return false;
+        }
+
+        auto is_metadata = [](const pt::ptree::value_type &item, const char *key) {
+            return item.first == METADATA_TAG && item.second.get<std::string>("<xmlattr>." + std::string(KEY_ATTR), "") == key;
+        };
+        auto config = config_tree.get_child_optional(CONFIG_TAG);
+        if (!config)
+            return false;
+        for (const auto &plate : *config) {
+            if (plate.first != PLATE_TAG)
+                continue;
+            int plate_index = -1;
+            for (const auto &item : plate.second)
+                if (is_metadata(item, PLATERID_ATTR))
+                    plate_index = item.second.get<int>("<xmlattr>." + std::string(VALUE_ATTR), -1);
+            if (plate_index != plate_id)
+                continue;
+            for (const auto &instance : plate.second)
+                if (instance.first == INSTANCE_TAG)
+                    for (const auto &item : instance.second)
+                        if (is_metadata(item, OBJECT_ID_ATTR))
+                            object_ids.insert(item.second.get<int>("<xmlattr>." + std::string(VALUE_ATTR), -1));
+            return true;
+        }
+        return false;
+    }
+
     void _BBS_3MF_Importer::_extract_cut_information_from_archive(mz_zip_archive &archive, const mz_zip_archive_file_stat &stat, ConfigSubstitutionContext &config_substitutions)
     {
         if (stat.m_uncomp_size > 0) {
@@ -3369,7 +3495,18 @@ void PlateData::parse_filament_info(GCodeProcessorResult *result)
 
     bool _BBS_3MF_Importer::_handle_end_vertices()
     {
-        // do nothing
+        // BBS: take the vertices decoded by the fast path
+        if (m_mesh_sections != nullptr) {
+            std::vector<Vec3f> vertices;
+            if (!m_mesh_sections->take_vertices(vertices))
+                return false;
+            if (m_curr_object) {
+                if (m_unit_factor != 1.0f)
+                    for (Vec3f& vertex : vertices)
+                        vertex *= m_unit_factor;
+                m_curr_object->geometry.vertices = std::move(vertices);
+            }
+        }
         return true;
     }
 
@@ -3401,7 +3538,19 @@ void PlateData::parse_filament_info(GCodeProcessorResult *result)
 
     bool _BBS_3MF_Importer::_handle_end_triangles()
     {
-        // do nothing
+        // BBS: take the triangles decoded by the fast path
+        if (m_mesh_sections != nullptr) {
+            MeshXmlSections::Triangles triangles;
+            if (!m_mesh_sections->take_triangles(triangles))
+                return false;
+            if (m_curr_object) {
+                m_curr_object->geometry.triangles        = std::move(triangles.indices);
+                m_curr_object->geometry.custom_supports  = std::move(triangles.custom_supports);
+                m_curr_object->geometry.custom_seam      = std::move(triangles.custom_seam);
+                m_curr_object->geometry.mmu_segmentation = std::move(triangles.mmu_segmentation);
+                m_curr_object->geometry.face_properties  = std::move(triangles.face_properties);
+            }
+        }
         return true;
     }
 
@@ -4891,7 +5040,18 @@ void PlateData::parse_filament_info(GCodeProcessorResult *result)
 
     bool _BBS_3MF_Importer::ObjectImporter::_handle_object_end_vertices()
     {
-        // do nothing
+        // BBS: take the vertices decoded by the fast path
+        if (object_mesh_sections != nullptr) {
+            std::vector<Vec3f> vertices;
+            if (!object_mesh_sections->take_vertices(vertices))
+                return false;
+            if (current_object) {
+                if (object_unit_factor != 1.0f)
+                    for (Vec3f& vertex : vertices)
+                        vertex *= object_unit_factor;
+                current_object->geometry.vertices = std::move(vertices);
+            }
+        }
         return true;
     }
 
@@ -4923,7 +5083,19 @@ void PlateData::parse_filament_info(GCodeProcessorResult *result)
 
     bool _BBS_3MF_Importer::ObjectImporter::_handle_object_end_triangles()
     {
-        // do nothing
+        // BBS: take the triangles decoded by the fast path
+        if (object_mesh_sections != nullptr) {
+            MeshXmlSections::Triangles triangles;
+            if (!object_mesh_sections->take_triangles(triangles))
+                return false;
+            if (current_object) {
+                current_object->geometry.triangles        = std::move(triangles.indices);
+                current_object->geometry.custom_supports  = std::move(triangles.custom_supports);
+                current_object->geometry.custom_seam      = std::move(triangles.custom_seam);
+                current_object->geometry.mmu_segmentation = std::move(triangles.mmu_segmentation);
+                current_object->geometry.face_properties  = std::move(triangles.face_properties);
+            }
+        }
         return true;
     }
 
@@ -5156,17 +5328,22 @@ void PlateData::parse_filament_info(GCodeProcessorResult *result)
 
         try
         {
-            mz_file_write_func callback = [](void* pOpaque, mz_uint64 file_ofs, const void* pBuf, size_t n)->size_t {
-                CallbackData* data = (CallbackData*)pOpaque;
-                if (!XML_Parse(data->parser, (const char*)pBuf, (int)n, (file_ofs + n == data->stat.m_uncomp_size) ? 1 : 0) || data->importer.object_parse_error()) {
-                    char error_buf[1024];
-                    ::snprintf(error_buf, 1024, "Error (%s) while parsing '%s' at line %d", data->importer.object_parse_error_message(), data->stat.m_filename, (int)XML_GetCurrentLineNumber(data->parser));
-                    throw Slic3r::FileIOError(error_buf);
-                }
-                return n;
-            };
-            void* opaque = &data;
-            res = mz_zip_reader_extract_to_callback(&archive, stat.m_file_index, callback, opaque, 0);
+            if (parse_model_xml_in_memory_enabled(stat))
+                res = parse_model_xml_in_memory(archive, stat, object_xml_parser, object_mesh_sections,
+                    [this]() { return object_parse_error(); }, [this]() { return object_parse_error_message(); });
+            else {
+                mz_file_write_func callback = [](void* pOpaque, mz_uint64 file_ofs, const void* pBuf, size_t n)->size_t {
+                    CallbackData* data = (CallbackData*)pOpaque;
+                    if (!XML_Parse(data->parser, (const char*)pBuf, (int)n, (file_ofs + n == data->stat.m_uncomp_size) ? 1 : 0) || data->importer.object_parse_error()) {
+                        char error_buf[1024];
+                        ::snprintf(error_buf, 1024, "Error (%s) while parsing '%s' at line %d", data->importer.object_parse_error_message(), data->stat.m_filename, (int)XML_GetCurrentLineNumber(data->parser));
+                        throw Slic3r::FileIOError(error_buf);
+                    }
+                    return n;
+                };
+                void* opaque = &data;
+                res = mz_zip_reader_extract_to_callback(&archive, stat.m_file_index, callback, opaque, 0);
+            }
         }
         catch (const version_error& e)
         {
@@ -5250,6 +5427,7 @@ void PlateData::parse_filament_info(GCodeProcessorResult *result)
         bool m_skip_auxiliary { false };    // skip normal axuiliary files
         bool m_use_loaded_id { false };        // whether to use loaded id for identify_id
         bool m_share_mesh { false };        // whether to share mesh between objects
+        int m_compression_level { MZ_DEFAULT_LEVEL }; // deflate level of the archive entries, 1 (fastest) to 10 (best)
         std::string m_thumbnail_middle = PRINTER_THUMBNAIL_MIDDLE_FILE;
         std::string m_thumbnail_small  = PRINTER_THUMBNAIL_SMALL_FILE;
         std::map<void const *, std::pair<ObjectData*, ModelVolume const *>> m_shared_meshes;
@@ -5262,6 +5440,8 @@ void PlateData::parse_filament_info(GCodeProcessorResult *result)
 
         bool save_model_to_file(StoreParams& store_params);
         // add backup logic
+        // the staged entries (model files, G-code) cannot be stored without compression, thus level 0 is not accepted
+        void set_compression_level(int level) { m_compression_level = std::clamp(level, int(MZ_BEST_SPEED), int(MZ_UBER_COMPRESSION)); }
         bool save_object_mesh(const std::string& temp_path, ModelObject const & object, int obj_id);
 
     private:
@@ -5283,7 +5463,15 @@ void PlateData::parse_filament_info(GCodeProcessorResult *result)
 
         bool _add_content_types_file_to_archive(mz_zip_archive& archive);
 
-        bool _add_thumbnail_file_to_archive(mz_zip_archive& archive, const ThumbnailData& thumbnail_data, const char* local_path, int index, bool generate_small_thumbnail = false);
+        //BBS: a thumbnail to be stored as a PNG file
+        struct ThumbnailFile
+        {
+            const ThumbnailData* data;
+            std::string          name;
+            // downsample to PLATE_THUMBNAIL_SMALL_WIDTH x PLATE_THUMBNAIL_SMALL_HEIGHT first
+            bool                 small { false };
+        };
+        bool _add_thumbnail_files_to_archive(mz_zip_archive& archive, const std::vector<ThumbnailFile>& thumbnails);
         bool _add_calibration_file_to_archive(mz_zip_archive& archive, const ThumbnailData& thumbnail_data, int index);
         bool _add_bbox_file_to_archive(mz_zip_archive& archive, const PlateBBoxData& id_bboxes, int index);
         bool _add_relationships_file_to_archive(mz_zip_archive &                archive,
@@ -5527,13 +5715,13 @@ void PlateData::parse_filament_info(GCodeProcessorResult *result)
                     return false;
             }
 
+            std::vector<ThumbnailFile> thumbnail_files;
             for (unsigned int index = 0; index < thumbnail_data.size(); index++)
             {
                 if (thumbnail_data[index]->is_valid())
                 {
-                    if (!_add_thumbnail_file_to_archive(archive, *thumbnail_data[index], "Metadata/plate", index, true)) {
-                        return false;
-                    }
+                    thumbnail_files.push_back({ thumbnail_data[index], (boost::format("Metadata/plate_%1%.png") % (index + 1)).str() });
+                    thumbnail_files.push_back({ thumbnail_data[index], (boost::format("Metadata/plate_%1%_small.png") % (index + 1)).str(), true });
 
                     BOOST_LOG_TRIVIAL(info) << __FUNCTION__ << ":" <<__LINE__ << boost::format(",add thumbnail %1%'s data into 3mf")%(index+1);
                     thumbnail_status[index] = true;
@@ -5546,22 +5734,22 @@ void PlateData::parse_filament_info(GCodeProcessorResult *result)
                 if (top_thumbnail_data[index]->is_valid())
                 {
                     BOOST_LOG_TRIVIAL(info) << __FUNCTION__ << ":" <<__LINE__ << boost::format(",add top thumbnail %1%'s data into 3mf")%(index+1);
-                    if (!_add_thumbnail_file_to_archive(archive, *top_thumbnail_data[index], "Metadata/top", index)) {
-                        return false;
-                    }
+                    thumbnail_files.push_back({ top_thumbnail_data[index], (boost::format("Metadata/top_%1%.png") % (index + 1)).str() });
                     top_thumbnail_status[index] = true;
                 }
 
                 if (pick_thumbnail_data[index]->is_valid())
                 {
                     BOOST_LOG_TRIVIAL(info) << __FUNCTION__ << ":" <<__LINE__ << boost::format(",add pick thumbnail %1%'s data into 3mf")%(index+1);
-                    if (!_add_thumbnail_file_to_archive(archive, *pick_thumbnail_data[index], "Metadata/pick", index)) {
-                        return false;
-                    }
+                    thumbnail_files.push_back({ pick_thumbnail_data[index], (boost::format("Metadata/pick_%1%.png") % (index + 1)).str() });
                     pick_thumbnail_status[index] = true;
                 }
             }
 
+            if (!_add_thumbnail_files_to_archive(archive, thumbnail_files)) {
+                return false;
+            }
+
             for (int i = 0; i < plate_data_list.size(); i++) {
                 PlateData *plate_data = plate_data_list[i];
 
@@ -5769,7 +5957,7 @@ void PlateData::parse_filament_info(GCodeProcessorResult *result)
                     plate_data->gcode_file_md5 = std::string(md5_str);
                     std::string target_file    = (boost::format("Metadata/plate_%1%.gcode.md5") % (plate_data->plate_index + 1)).str();
                     if (!mz_zip_writer_add_mem(&archive, target_file.c_str(), (const void *) plate_data->gcode_file_md5.c_str(), plate_data->gcode_file_md5.length(),
-                                               MZ_DEFAULT_COMPRESSION)) {
+                                               m_compression_level)) {
                         BOOST_LOG_TRIVIAL(error) << __FUNCTION__ << ":" << __LINE__
                                                  << boost::format(", store  gcode md5 to 3mf's %1%,  length %2%, failed\n") %target_file %plate_data->gcode_file_md5.length();
                         return false;
@@ -5863,17 +6051,39 @@ void PlateData::parse_filament_info(GCodeProcessorResult *result)
         return true;
     }
 
+    //BBS: entries compressed on the worker threads into their own heap archive are copied into the archive with their compressed data,
+    // the mutex serializes the writing of the local headers and of the central directory records.
+    static bool add_heap_archive_to_archive(mz_zip_archive& archive, mz_zip_archive& heap_archive, boost::mutex& mutex)
+    {
+        void*  buf  = nullptr;
+        size_t size = 0;
+        bool   res  = mz_zip_writer_finalize_heap_archive(&heap_archive, &buf, &size);
+        mz_zip_writer_end(&heap_archive);
+        mz_zip_zero_struct(&heap_archive);
+        if (res && mz_zip_reader_init_mem(&heap_archive, buf, size, 0)) {
+            {
+                boost::unique_lock l(mutex);
+                for (mz_uint i = 0; res && i < mz_zip_reader_get_num_files(&heap_archive); ++i)
+                    res = mz_zip_writer_add_from_zip_reader(&archive, &heap_archive, i);
+            }
+            mz_zip_reader_end(&heap_archive);
+        } else
+            res = false;
+        mz_free(buf);
+        return res;
+    }
+
     bool _BBS_3MF_Exporter::_add_file_to_archive(mz_zip_archive& archive, const std::string& path_in_zip, const std::string& src_file_path)
     {
         static std::string const nocomp_exts[] = {".png", ".jpg", ".mp4", ".jpeg", ".zip", ".3mf"};
         auto end = nocomp_exts + sizeof(nocomp_exts) / sizeof(nocomp_exts[0]);
         bool nocomp = std::find_if(nocomp_exts, end, [&path_in_zip](auto & ext) { return boost::algorithm::ends_with(path_in_zip, ext); }) != end;
 #if WRITE_ZIP_LANGUAGE_ENCODING
-        bool result = mz_zip_writer_add_file(&archive, path_in_zip.c_str(), encode_path(src_file_path.c_str()).c_str(), NULL, 0, nocomp ? MZ_NO_COMPRESSION : MZ_DEFAULT_LEVEL);
+        bool result = mz_zip_writer_add_file(&archive, path_in_zip.c_str(), encode_path(src_file_path.c_str()).c_str(), NULL, 0, nocomp ? MZ_NO_COMPRESSION : m_compression_level);
 #else
         std::string native_path = encode_path(path_in_zip.c_str());
         std::string extra = ZipUnicodePathExtraField::encode(path_in_zip, native_path);
-        bool result = mz_zip_writer_add_file_ex(&archive, native_path.c_str(), encode_path(src_file_path.c_str()).c_str(), NULL, 0, nocomp ? MZ_ZIP_FLAG_ASCII_FILENAME : MZ_DEFAULT_COMPRESSION,
+        bool result = mz_zip_writer_add_file_ex(&archive, native_path.c_str(), encode_path(src_file_path.c_str()).c_str(), NULL, 0, nocomp ? MZ_ZIP_FLAG_ASCII_FILENAME : m_compression_level,
                 extra.c_str(), extra.length(), extra.c_str(), extra.length());
 #endif
         if (!result) {
@@ -5898,7 +6108,7 @@ void PlateData::parse_filament_info(GCodeProcessorResult *result)
 
         std::string out = stream.str();
 
-        if (!mz_zip_writer_add_mem(&archive, CONTENT_TYPES_FILE.c_str(), (const void*)out.data(), out.length(), MZ_DEFAULT_COMPRESSION)) {
+        if (!mz_zip_writer_add_mem(&archive, CONTENT_TYPES_FILE.c_str(), (const void*)out.data(), out.length(), m_compression_level)) {
             add_error("Unable to add content types file to archive");
             BOOST_LOG_TRIVIAL(error) << __FUNCTION__ << ":" << __LINE__ << boost::format(", Unable to add content types file to archive\n");
             return false;
@@ -5907,69 +6117,67 @@ void PlateData::parse_filament_info(GCodeProcessorResult *result)
         return true;
     }
 
-    bool _BBS_3MF_Exporter::_add_thumbnail_file_to_archive(mz_zip_archive& archive, const ThumbnailData& thumbnail_data, const char* local_path, int index, bool generate_small_thumbnail)
-    {
-        bool res = false;
-
-        size_t png_size = 0;
-        void* png_data = tdefl_write_image_to_png_file_in_memory_ex((const void*)thumbnail_data.pixels.data(), thumbnail_data.width, thumbnail_data.height, 4, &png_size, MZ_DEFAULT_COMPRESSION, 1);
-        if (png_data != nullptr) {
-            std::string thumbnail_name = (boost::format("%1%_%2%.png")%local_path % (index + 1)).str();
-            res = mz_zip_writer_add_mem(&archive, thumbnail_name.c_str(), (const void*)png_data, png_size, MZ_NO_COMPRESSION);
-            mz_free(png_data);
-        }
-
-        if (!res) {
-            add_error("Unable to add thumbnail file to archive");
-            BOOST_LOG_TRIVIAL(error) << __FUNCTION__ << ":" << __LINE__ << boost::format(", Unable to add thumbnail file to archive\n");
-        }
-
-        if (generate_small_thumbnail && thumbnail_data.is_valid()) {
-            //generate small size of thumbnail
-            std::vector<unsigned char> small_pixels;
-            small_pixels.resize(PLATE_THUMBNAIL_SMALL_WIDTH * PLATE_THUMBNAIL_SMALL_HEIGHT * 4);
-            /* step width and step height */
-            int sw = thumbnail_data.width / PLATE_THUMBNAIL_SMALL_WIDTH;
-            int sh = thumbnail_data.height / PLATE_THUMBNAIL_SMALL_HEIGHT;
-            int clampped_width = sw * PLATE_THUMBNAIL_SMALL_WIDTH;
-            int clampped_height = sh * PLATE_THUMBNAIL_SMALL_HEIGHT;
-
-            for (int i = 0; i < clampped_height; i += sh) {
-                for (int j = 0; j < clampped_width; j += sw) {
-                    int r = 0, g = 0, b = 0, a = 0;
-                    for (int m = 0; m < sh; m++) {
-                        for (int n = 0; n < sw; n++) {
-                            r += (int)thumbnail_data.pixels[4 * ((i + m) * thumbnail_data.width + j + n) + 0];
-                            g += (int)thumbnail_data.pixels[4 * ((i + m) * thumbnail_data.width + j + n) + 1];
-                            b += (int)thumbnail_data.pixels[4 * ((i + m) * thumbnail_data.width + j + n) + 2];
-                            a += (int)thumbnail_data.pixels[4 * ((i + m) * thumbnail_data.width + j + n) + 3];
-                        }
+    //BBS: downsample the plate thumbnail to PLATE_THUMBNAIL_SMALL_WIDTH x PLATE_THUMBNAIL_SMALL_HEIGHT
+    static std::vector<unsigned char> small_thumbnail_pixels(const ThumbnailData& thumbnail_data)
+    {
+        //generate small size of thumbnail
+        std::vector<unsigned char> small_pixels;
+        small_pixels.resize(PLATE_THUMBNAIL_SMALL_WIDTH * PLATE_THUMBNAIL_SMALL_HEIGHT * 4);
+        /* step width and step height */
+        int sw = thumbnail_data.width / PLATE_THUMBNAIL_SMALL_WIDTH;
+        int sh = thumbnail_data.height / PLATE_THUMBNAIL_SMALL_HEIGHT;
+        int clampped_width = sw * PLATE_THUMBNAIL_SMALL_WIDTH;
+        int clampped_height = sh * PLATE_THUMBNAIL_SMALL_HEIGHT;
+
+        for (int i = 0; i < clampped_height; i += sh) {
+            for (int j = 0; j < clampped_width; j += sw) {
+                int r = 0, g = 0, b = 0, a = 0;
+                for (int m = 0; m < sh; m++) {
+                    for (int n = 0; n < sw; n++) {
+                        r += (int)thumbnail_data.pixels[4 * ((i + m) * thumbnail_data.width + j + n) + 0];
+                        g += (int)thumbnail_data.pixels[4 * ((i + m) * thumbnail_data.width + j + n) + 1];
+                        b += (int)thumbnail_data.pixels[4 * ((i + m) * thumbnail_data.width + j + n) + 2];
+                        a += (int)thumbnail_data.pixels[4 * ((i + m) * thumbnail_data.width + j + n) + 3];
                     }
-                    r = std::clamp(0, r / sw / sh, 255);
-                    g = std::clamp(0, g / sw / sh, 255);
-                    b = std::clamp(0, b / sw / sh, 255);
-                    a = std::clamp(0, a / sw / sh, 255);
-                    small_pixels[4 * (i / sw * PLATE_THUMBNAIL_SMALL_WIDTH + j / sh) + 0] = (unsigned char)r;
-                    small_pixels[4 * (i / sw * PLATE_THUMBNAIL_SMALL_WIDTH + j / sh) + 1] = (unsigned char)g;
-                    small_pixels[4 * (i / sw * PLATE_THUMBNAIL_SMALL_WIDTH + j / sh) + 2] = (unsigned char)b;
-                    small_pixels[4 * (i / sw * PLATE_THUMBNAIL_SMALL_WIDTH + j / sh) + 3] = (unsigned char)a;
-                    //memcpy((void*)&small_pixels[4*(i / sw * PLATE_THUMBNAIL_SMALL_WIDTH + j / sh)], thumbnail_data.pixels.data() + 4*(i * thumbnail_data.width + j), 4);
                 }
+                r = std::clamp(0, r / sw / sh, 255);
+                g = std::clamp(0, g / sw / sh, 255);
+                b = std::clamp(0, b / sw / sh, 255);
+                a = std::clamp(0, a / sw / sh, 255);
+                small_pixels[4 * (i / sw * PLATE_THUMBNAIL_SMALL_WIDTH + j / sh) + 0] = (unsigned char)r;
+                small_pixels[4 * (i / sw * PLATE_THUMBNAIL_SMALL_WIDTH + j / sh) + 1] = (unsigned char)g;
+                small_pixels[4 * (i / sw * PLATE_THUMBNAIL_SMALL_WIDTH + j / sh) + 2] = (unsigned char)b;
+                small_pixels[4 * (i / sw * PLATE_THUMBNAIL_SMALL_WIDTH + j / sh) + 3] = (unsigned char)a;
+                //memcpy((void*)&small_pixels[4*(i / sw * PLATE_THUMBNAIL_SMALL_WIDTH + j / sh)], thumbnail_data.pixels.data() + 4*(i * thumbnail_data.width + j), 4);
             }
-            size_t small_png_size = 0;
-            void* small_png_data = tdefl_write_image_to_png_file_in_memory_ex((const void*)small_pixels.data(), PLATE_THUMBNAIL_SMALL_WIDTH, PLATE_THUMBNAIL_SMALL_HEIGHT, 4, &small_png_size, MZ_DEFAULT_COMPRESSION, 1);
-            if (png_data != nullptr) {
-                std::string thumbnail_name = (boost::format("%1%_%2%_small.png") % local_path % (index + 1)).str();
-                res = mz_zip_writer_add_mem(&archive, thumbnail_name.c_str(), (const void*)small_png_data, small_png_size, MZ_NO_COMPRESSION);
-                mz_free(small_png_data);
+        }
+        return small_pixels;
+    }
+
+    bool _BBS_3MF_Exporter::_add_thumbnail_files_to_archive(mz_zip_archive& archive, const std::vector<ThumbnailFile>& thumbnails)
+    {
+        //BBS: encode the PNGs in parallel, then store them one after another in the order of the list
+        std::vector<std::pair<void*, size_t>> pngs(thumbnails.size(), { nullptr, 0 });
+        tbb::parallel_for(tbb::blocked_range<size_t>(0, thumbnails.size(), 1), [&thumbnails, &pngs](const tbb::blocked_range<size_t>& range) {
+            for (size_t i = range.begin(); i < range.end(); ++i) {
+                const ThumbnailData& thumbnail_data = *thumbnails[i].data;
+                if (thumbnails[i].small) {
+                    std::vector<unsigned char> small_pixels = small_thumbnail_pixels(thumbnail_data);
+                    pngs[i].first = tdefl_write_image_to_png_file_in_memory_ex((const void*)small_pixels.data(), PLATE_THUMBNAIL_SMALL_WIDTH, PLATE_THUMBNAIL_SMALL_HEIGHT, 4, &pngs[i].second, MZ_DEFAULT_COMPRESSION, 1);
+                } else
+                    pngs[i].first = tdefl_write_image_to_png_file_in_memory_ex((const void*)thumbnail_data.pixels.data(), thumbnail_data.width, thumbnail_data.height, 4, &pngs[i].second, MZ_DEFAULT_COMPRESSION, 1);
             }
+        });
 
-            if (!res) {
-                add_error("Unable to add small thumbnail file to archive");
-                BOOST_LOG_TRIVIAL(error) << __FUNCTION__ << ":" << __LINE__ << boost::format(", Unable to add small thumbnail file to archive\n");
+        bool res = true;
+        for (size_t i = 0; i < thumbnails.size(); ++i) {
+            if (res && (pngs[i].first == nullptr || !mz_zip_writer_add_mem(&archive, thumbnails[i].name.c_str(), (const void*)pngs[i].first, pngs[i].second, MZ_NO_COMPRESSION))) {
+                add_error("Unable to add thumbnail file to archive");
+                BOOST_LOG_TRIVIAL(error) << __FUNCTION__ << ":" << __LINE__ << boost::format(", Unable to add thumbnail file %1% to archive\n") % thumbnails[i].name;
+                res = false;
             }
+            mz_free(pngs[i].first);
         }
-
         return res;
     }
 
@@ -6001,7 +6209,7 @@ void PlateData::parse_filament_info(GCodeProcessorResult *result)
         std::string out = j.dump();
 
         std::string json_file_name = (boost::format(PATTERN_CONFIG_FILE_FORMAT) % (index + 1)).str();
-        if (!mz_zip_writer_add_mem(&archive, json_file_name.c_str(), (const void*)out.data(), out.length(), MZ_DEFAULT_COMPRESSION)) {
+        if (!mz_zip_writer_add_mem(&archive, json_file_name.c_str(), (const void*)out.data(), out.length(), m_compression_level)) {
             add_error("Unable to add json file to archive");
             BOOST_LOG_TRIVIAL(error) << __FUNCTION__ << ":" << __LINE__ << boost::format(", Unable to add json file to archive\n");
             return false;
@@ -6074,7 +6282,7 @@ void PlateData::parse_filament_info(GCodeProcessorResult *result)
 
         std::string out = stream.str();
 
-        if (!mz_zip_writer_add_mem(&archive, from.empty() ? RELATIONSHIPS_FILE.c_str() : from.c_str(), (const void*)out.data(), out.length(), MZ_DEFAULT_COMPRESSION)) {
+        if (!mz_zip_writer_add_mem(&archive, from.empty() ? RELATIONSHIPS_FILE.c_str() : from.c_str(), (const void*)out.data(), out.length(), m_compression_level)) {
             add_error("Unable to add relationships file to archive");
             BOOST_LOG_TRIVIAL(error) << __FUNCTION__ << ":" << __LINE__ << boost::format(", Unable to add relationships file to archive\n");
             return false;
@@ -6123,9 +6331,9 @@ void PlateData::parse_filament_info(GCodeProcessorResult *result)
                 // GH issue #6193.
                 (uint64_t(1) << 32) - 1,
 #if WRITE_ZIP_LANGUAGE_ENCODING
-            nullptr, nullptr, 0, MZ_DEFAULT_LEVEL, nullptr, 0, nullptr, 0)) {
+            nullptr, nullptr, 0, m_compression_level, nullptr, 0, nullptr, 0)) {
 #else
-            nullptr, nullptr, 0, MZ_DEFAULT_COMPRESSION, extra.c_str(), extra.length(), extra.c_str(), extra.length())) {
+            nullptr, nullptr, 0, m_compression_level, extra.c_str(), extra.length(), extra.c_str(), extra.length())) {
 #endif
             add_error("Unable to add model file to archive");
             BOOST_LOG_TRIVIAL(error) << __FUNCTION__ << ":" << __LINE__ << boost::format(", Unable to add model file to archive\n");
@@ -6372,7 +6580,8 @@ void PlateData::parse_filament_info(GCodeProcessorResult *result)
 
         if (!m_from_backup_save) {
             boost::mutex mutex;
-            tbb::parallel_for(tbb::blocked_range<size_t>(0, objects_data.size(), 1), [this, &mutex, &model, objects = model.objects, &objects_data, &object_paths, main = &archive, project](const tbb::blocked_range<size_t>& range) {
+            std::atomic<bool> result { true };
+            tbb::parallel_for(tbb::blocked_range<size_t>(0, objects_data.size(), 1), [this, &mutex, &result, &model, objects = model.objects, &objects_data, &object_paths, main = &archive, project](const tbb::blocked_range<size_t>& range) {
                 for (size_t i = range.begin(); i < range.end(); ++i) {
                     auto iter = objects_data.find(objects[i]);
                     ObjectToObjectDataMap objects_data2;
@@ -6384,18 +6593,15 @@ void PlateData::parse_filament_info(GCodeProcessorResult *result)
                     CNumericLocalesSetter locales_setter;
                     _add_model_file_to_archive(object_paths[i], archive, model, objects_data2, nullptr, project);
                     iter->second = objects_data2.begin()->second;
-                    void *ppBuf; size_t pSize;
-                    mz_zip_writer_finalize_heap_archive(&archive, &ppBuf, &pSize);
-                    mz_zip_writer_end(&archive);
-                    mz_zip_zero_struct(&archive);
-                    mz_zip_reader_init_mem(&archive, ppBuf, pSize, 0);
-                    {
-                        boost::unique_lock l(mutex);
-                        mz_zip_writer_add_from_zip_reader(main, &archive, 0);
-                    }
-                    mz_zip_reader_end(&archive);
+                    if (!add_heap_archive_to_archive(*main, archive, mutex))
+                        result = false;
                 }
             });
+            if (!result) {
+                add_error("Unable to add object model files to archive");
+                BOOST_LOG_TRIVIAL(error) << __FUNCTION__ << ":" << __LINE__ << boost::format(", Unable to add object model files to archive\n");
+                return false;
+            }
         }
 
         return true;
@@ -6776,7 +6982,7 @@ void PlateData::parse_filament_info(GCodeProcessorResult *result)
         }
 
         if (!out.empty()) {
-            if (!mz_zip_writer_add_mem(&archive, BBS_LAYER_HEIGHTS_PROFILE_FILE.c_str(), (const void*)out.data(), out.length(), MZ_DEFAULT_COMPRESSION)) {
+            if (!mz_zip_writer_add_mem(&archive, BBS_LAYER_HEIGHTS_PROFILE_FILE.c_str(), (const void*)out.data(), out.length(), m_compression_level)) {
                 add_error("Unable to add layer heights profile file to archive");
                 BOOST_LOG_TRIVIAL(error) << __FUNCTION__ << ":" << __LINE__ << boost::format("Unable to add layer heights profile file to archive\n");
                 return false;
@@ -6835,7 +7041,7 @@ void PlateData::parse_filament_info(GCodeProcessorResult *result)
         }
 
         if (!out.empty()) {
-            if (!mz_zip_writer_add_mem(&archive, LAYER_CONFIG_RANGES_FILE.c_str(), (const void*)out.data(), out.length(), MZ_DEFAULT_COMPRESSION)) {
+            if (!mz_zip_writer_add_mem(&archive, LAYER_CONFIG_RANGES_FILE.c_str(), (const void*)out.data(), out.length(), m_compression_level)) {
                 add_error("Unable to add layer heights profile file to archive");
                 BOOST_LOG_TRIVIAL(error) << __FUNCTION__ << ":" << __LINE__ << boost::format("Unable to add layer heights profile file to archive\n");
                 return false;
@@ -6873,7 +7079,7 @@ void PlateData::parse_filament_info(GCodeProcessorResult *result)
             // Adds version header at the beginning:
             //out = std::string("support_points_format_version=") + std::to_string(support_points_format_version) + std::string("\n") + out;
 
-            if (!mz_zip_writer_add_mem(&archive, SLA_SUPPORT_POINTS_FILE.c_str(), (const void*)out.data(), out.length(), MZ_DEFAULT_COMPRESSION)) {
+            if (!mz_zip_writer_add_mem(&archive, SLA_SUPPORT_POINTS_FILE.c_str(), (const void*)out.data(), out.length(), m_compression_level)) {
                 add_error("Unable to add sla support points file to archive");
                 BOOST_LOG_TRIVIAL(error) << __FUNCTION__ << ":" << __LINE__ << boost::format("Unable to add sla support points file to archive\n");
                 return false;
@@ -6925,7 +7131,7 @@ void PlateData::parse_filament_info(GCodeProcessorResult *result)
             // Adds version header at the beginning:
             //out = std::string("drain_holes_format_version=") + std::to_string(drain_holes_format_version) + std::string("\n") + out;
 
-            if (!mz_zip_writer_add_mem(&archive, SLA_DRAIN_HOLES_FILE.c_str(), static_cast<const void*>(out.data()), out.length(), mz_uint(MZ_DEFAULT_COMPRESSION))) {
+            if (!mz_zip_writer_add_mem(&archive, SLA_DRAIN_HOLES_FILE.c_str(), static_cast<const void*>(out.data()), out.length(), mz_uint(m_compression_level))) {
                 add_error("Unable to add sla support points file to archive");
                 BOOST_LOG_TRIVIAL(error) << __FUNCTION__ << ":" << __LINE__ << boost::format("Unable to add sla support points file to archive\n");
                 return false;
@@ -6946,7 +7152,7 @@ void PlateData::parse_filament_info(GCodeProcessorResult *result)
                 out += "; " + key + " = " + config.opt_serialize(key) + "\n";
 
         if (!out.empty()) {
-            if (!mz_zip_writer_add_mem(&archive, BBS_PRINT_CONFIG_FILE.c_str(), (const void*)out.data(), out.length(), MZ_DEFAULT_COMPRESSION)) {
+            if (!mz_zip_writer_add_mem(&archive, BBS_PRINT_CONFIG_FILE.c_str(), (const void*)out.data(), out.length(), m_compression_level)) {
                 add_error("Unable to add print config file to archive");
                 BOOST_LOG_TRIVIAL(error) << __FUNCTION__ << ":" << __LINE__ << boost::format("Unable to add print config file to archive\n");
                 return false;
@@ -7326,7 +7532,7 @@ void PlateData::parse_filament_info(GCodeProcessorResult *result)
         stream << "</" << CONFIG_TAG << ">\n";
 
         std::string out = stream.str();
-        if (!mz_zip_writer_add_mem(&archive, BBS_MODEL_CONFIG_FILE.c_str(), (const void*)out.data(), out.length(), MZ_DEFAULT_COMPRESSION)) {
+        if (!mz_zip_writer_add_mem(&archive, BBS_MODEL_CONFIG_FILE.c_str(), (const void*)out.data(), out.length(), m_compression_level)) {
             BOOST_LOG_TRIVIAL(error) << __FUNCTION__ << ":" << __LINE__ << boost::format("Unable to add model config file to archive\n");
             add_error("Unable to add model config file to archive");
             return false;
@@ -7389,7 +7595,7 @@ void PlateData::parse_filament_info(GCodeProcessorResult *result)
         }
 
         if (!out.empty()) {
-            if (!mz_zip_writer_add_mem(&archive, CUT_INFORMATION_FILE.c_str(), (const void *) out.data(), out.length(), MZ_DEFAULT_COMPRESSION)) {
+            if (!mz_zip_writer_add_mem(&archive, CUT_INFORMATION_FILE.c_str(), (const void *) out.data(), out.length(), m_compression_level)) {
                 add_error("Unable to add cut information file to archive");
                 return false;
             }
@@ -7490,7 +7696,7 @@ void PlateData::parse_filament_info(GCodeProcessorResult *result)
 
         std::string out = stream.str();
 
-        if (!mz_zip_writer_add_mem(&archive, SLICE_INFO_CONFIG_FILE.c_str(), (const void*)out.data(), out.length(), MZ_DEFAULT_COMPRESSION)) {
+        if (!mz_zip_writer_add_mem(&archive, SLICE_INFO_CONFIG_FILE.c_str(), (const void*)out.data(), out.length(), m_compression_level)) {
             add_error("Unable to add model config file to archive");
             BOOST_LOG_TRIVIAL(error) << __FUNCTION__ << ":" << __LINE__ << boost::format(", store  slice-info to 3mf,  length %1%, failed\n") % out.length();
             return false;
@@ -7519,7 +7725,8 @@ bool _BBS_3MF_Exporter::_add_gcode_file_to_archive(mz_zip_archive& archive, cons
     }
 
     boost::mutex mutex;
-    tbb::parallel_for(tbb::blocked_range<size_t>(0, plate_data_list2.size(), 1), [this, &plate_data_list2, &root_archive = archive, &mutex, &result](const tbb::blocked_range<size_t>& range) {
+    std::atomic<bool> copy_result { true };
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, plate_data_list2.size(), 1), [this, &plate_data_list2, &root_archive = archive, &mutex, &result, &copy_result](const tbb::blocked_range<size_t>& range) {
         for (int i = range.begin(); i < range.end(); ++i) {
             PlateData* plate_data = plate_data_list2[i];
             auto src_gcode_file = plate_data->gcode_file;
@@ -7532,7 +7739,7 @@ bool _BBS_3MF_Exporter::_add_gcode_file_to_archive(mz_zip_archive& archive, cons
             mz_zip_writer_init_heap(&archive, 0, 1024 * 1024);
             {
                 mz_zip_writer_add_staged_open(&archive, &context, gcode_in_3mf.c_str(), m_zip64 ? (uint64_t(1) << 30) * 16 : (uint64_t(1) << 32) - 1, nullptr, nullptr, 0,
-                    MZ_DEFAULT_COMPRESSION, nullptr, 0, nullptr, 0);
+                    m_compression_level, nullptr, 0, nullptr, 0);
                 boost::filesystem::path src_gcode_path(src_gcode_file);
                 if (!boost::filesystem::exists(src_gcode_path)) {
                     BOOST_LOG_TRIVIAL(error) << "Gcode is missing, filename = " << src_gcode_file;
@@ -7546,19 +7753,16 @@ bool _BBS_3MF_Exporter::_add_gcode_file_to_archive(mz_zip_archive& archive, cons
                 }
                 mz_zip_writer_add_staged_finish(&context);
             }
-            void *ppBuf; size_t pSize;
-            mz_zip_writer_finalize_heap_archive(&archive, &ppBuf, &pSize);
-            mz_zip_writer_end(&archive);
-            mz_zip_zero_struct(&archive);
-            mz_zip_reader_init_mem(&archive, ppBuf, pSize, 0);
-            {
-                boost::unique_lock l(mutex);
-                mz_zip_writer_add_from_zip_reader(&root_archive, &archive, 0);
-            }
-            mz_zip_reader_end(&archive);
+            if (!add_heap_archive_to_archive(root_archive, archive, mutex))
+                copy_result = false;
             BOOST_LOG_TRIVIAL(info) << __FUNCTION__ << ":" <<__LINE__ << boost::format(", store  %1% to 3mf %2%\n") % src_gcode_file % gcode_in_3mf;
         }
     });
+    if (!copy_result) {
+        add_error("Unable to add gcode files to archive");
+        BOOST_LOG_TRIVIAL(error) << __FUNCTION__ << ":" << __LINE__ << boost::format(", Unable to add gcode files to archive\n");
+        return false;
+    }
     return result;
 }
 
@@ -7609,7 +7813,7 @@ bool _BBS_3MF_Exporter::_add_custom_gcode_per_print_z_file_to_archive(mz_zip_arc
     }
 
     if (!out.empty()) {
-        if (!mz_zip_writer_add_mem(&archive, CUSTOM_GCODE_PER_PRINT_Z_FILE.c_str(), (const void*)out.data(), out.length(), MZ_DEFAULT_COMPRESSION)) {
+        if (!mz_zip_writer_add_mem(&archive, CUSTOM_GCODE_PER_PRINT_Z_FILE.c_str(), (const void*)out.data(), out.length(), m_compression_level)) {
             add_error("Unable to add custom Gcodes per print_z file to archive");
             BOOST_LOG_TRIVIAL(error) << __FUNCTION__ << ":" << __LINE__ << boost::format(", Unable to add custom Gcodes per print_z file to archive\n");
             return false;
@@ -7789,6 +7993,14 @@ public:
         BOOST_LOG_TRIVIAL(info) << __FUNCTION__ << " exit, and new interval is: " << m_interval;
     }
 
+    // BBS: the backups are written often and read rarely, thus favour speed over size
+    void set_compression_level(int level) {
+        BOOST_LOG_TRIVIAL(info) << __FUNCTION__ << " backup compression level: " << level;
+        m_compression_level = level;
+    }
+
+    int compression_level() const { return m_compression_level; }
+
     void put_other_changes()
     {
         BOOST_LOG_TRIVIAL(info) << "put_other_changes";
@@ -7945,6 +8157,7 @@ private:
                 {
                     CNumericLocalesSetter locales_setter;
                     _BBS_3MF_Exporter     e;
+                    e.set_compression_level(m_compression_level);
                     e.save_object_mesh(t.path, *t.object, (int) t.id);
                     // response to delete cloned object
                 }
@@ -8043,6 +8256,7 @@ private:
     // param 1: should backup current project
     std::function<void(int)> m_post_callback;
     long m_interval = 1 * 60;
+    std::atomic<int> m_compression_level { MZ_BEST_SPEED };
     boost::system_time m_next_backup;
     Model m_temp_model; // visit only in main thread
     bool m_other_changes = false; // visit only in main thread
@@ -8096,6 +8310,8 @@ bool store_bbs_3mf(StoreParams& store_params)
         return false;
 
     _BBS_3MF_Exporter exporter;
+    if (store_params.strategy & SaveStrategy::Backup)
+        exporter.set_compression_level(_BBS_Backup_Manager::get().compression_level());
     bool res = exporter.save_model_to_file(store_params);
     if (!res)
         exporter.log_errors();
@@ -8148,6 +8364,11 @@ void set_backup_interval(long interval)
     _BBS_Backup_Manager::get().set_interval(interval);
 }
 
+void set_backup_compression_level(int level)
+{
+    _BBS_Backup_Manager::get().set_compression_level(level);
+}
+
 void set_backup_callback(std::function<void(int)> callback)
 {
     _BBS_Backup_Manager::get().set_post_callback(callback);
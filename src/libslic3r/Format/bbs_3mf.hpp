@@ -272,6 +272,9 @@ extern void remove_backup(Model& model, bool removeAll);
 
 extern void set_backup_interval(long interval);
 
+// deflate level of the backup files, 1 (fastest) to 10 (best compression), 1 by default
+extern void set_backup_compression_level(int level);
+
 extern void set_backup_callback(std::function<void(int)> callback);
 
 extern void run_backup_ui_tasks();
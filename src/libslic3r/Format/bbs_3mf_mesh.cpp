@@ -0,0 +1,321 @@
+#include "bbs_3mf_mesh.hpp"
+
+#include <atomic>
+#include <charconv>
+#include <cstring>
+#include <string_view>
+
+#include <fast_float/fast_float.h>
+#include <tbb/parallel_for.h>
+
+namespace Slic3r {
+
+namespace {
+
+// Sections larger than twice this size are split into chunks of about this size, which are decoded in parallel.
+constexpr size_t chunk_size = 1024 * 1024;
+
+// Expected lengths of the elements, to reserve the output.
+constexpr size_t vertex_text_size   = 40;
+constexpr size_t triangle_text_size = 30;
+
+inline bool is_space(char c) { return c == ' ' || c == '\t' || c == '\n' || c == '\r'; }
+
+inline const char* skip_space(const char *p, const char *end)
+{
+    while (p != end && is_space(*p))
+        ++ p;
+    return p;
+}
+
+// Does the name of an element starting at p match name?
+inline bool match_name(const char *p, const char *end, std::string_view name)
+{
+    return size_t(end - p) > name.size() && memcmp(p, name.data(), name.size()) == 0 &&
+        (is_space(p[name.size()]) || p[name.size()] == '>' || p[name.size()] == '/');
+}
+
+// Parses the attributes of a start tag up to and including its closing "/>" or ">", calling fn(name, value, value_end)
+// for each attribute. Returns the position after the tag or nullptr if the tag is not supported or it is malformed.
+template<typename AttributeFn>
+const char* parse_attributes(const char *p, const char *end, bool &empty_element, AttributeFn fn)
+{
+    for (;;) {
+        p = skip_space(p, end);
+        if (p == end)
+            return nullptr;
+        if (*p == '/') {
+            if (++ p == end || *p != '>')
+                return nullptr;
+            empty_element = true;
+            return p + 1;
+        }
+        if (*p == '>') {
+            empty_element = false;
+            return p + 1;
+        }
+        const char *name = p;
+        while (p != end && ! is_space(*p) && *p != '=' && *p != '>' && *p != '/')
+            ++ p;
+        std::string_view name_view(name, p - name);
+        p = skip_space(p, end);
+        if (name_view.empty() || p == end || *p != '=')
+            return nullptr;
+        p = skip_space(p + 1, end);
+        if (p == end || (*p != '"' && *p != '\''))
+            return nullptr;
+        char        quote = *p ++;
+        const char *value = p;
+        for (; p != end && *p != quote; ++ p)
+            // Expat would have to expand the references, '<' is not allowed in a value.
+            if (*p == '&' || *p == '<')
+                return nullptr;
+        if (p == end)
+            return nullptr;
+        fn(name_view, value, p);
+        ++ p;
+        if (p != end && ! is_space(*p) && *p != '/' && *p != '>')
+            return nullptr;
+    }
+}
+
+// Skips the end tag of an element, which is not empty, thus it may only contain white space.
+inline const char* skip_end_tag(const char *p, const char *end, std::string_view name)
+{
+    p = skip_space(p, end);
+    if (size_t(end - p) < name.size() + 2 || p[0] != '<' || p[1] != '/' || memcmp(p + 2, name.data(), name.size()) != 0)
+        return nullptr;
+    p = skip_space(p + 2 + name.size(), end);
+    return p != end && *p == '>' ? p + 1 : nullptr;
+}
+
+inline int parse_int(const char *p, const char *end)
+{
+    int value = 0;
+    if (p != end && *p == '+')
+        ++ p;
+    std::from_chars(p, end, value);
+    return value;
+}
+
+// fast_float::from_chars() rejects a leading '+', which other 3mf producers write.
+inline void parse_float(const char *p, const char *end, float &value)
+{
+    if (p != end && *p == '+')
+        ++ p;
+    fast_float::from_chars(p, end, value);
+}
+
+// Decodes the <vertex> elements of [p, end), appending them to out.
+bool decode_vertices(const char *p, const char *end, std::vector<Vec3f> &out)
+{
+    out.reserve(out.size() + size_t(end - p) / vertex_text_size);
+    for (;;) {
+        p = skip_space(p, end);
+        if (p == end)
+            return true;
+        if (*p != '<' || ! match_name(p + 1, end, "vertex"))
+            return false;
+        // missing values are set equal to ZERO
+        Vec3f vertex = Vec3f::Zero();
+        bool  empty_element;
+        p = parse_attributes(p + 7, end, empty_element, [&vertex](std::string_view name, const char *value, const char *value_end) {
+            if (name.size() == 1 && name[0] >= 'x' && name[0] <= 'z')
+                parse_float(value, value_end, vertex[name[0] - 'x']);
+        });
+        if (p == nullptr || (! empty_element && (p = skip_end_tag(p, end, "vertex")) == nullptr))
+            return false;
+        out.emplace_back(vertex);
+    }
+}
+
+// Decodes the <triangle> elements of [p, end), appending them to out.
+bool decode_triangles(const char *p, const char *end, MeshXmlSections::Triangles &out)
+{
+    size_t reserve = out.indices.size() + size_t(end - p) / triangle_text_size;
+    out.indices.reserve(reserve);
+    out.custom_supports.reserve(reserve);
+    out.custom_seam.reserve(reserve);
+    out.mmu_segmentation.reserve(reserve);
+    out.face_properties.reserve(reserve);
+    for (;;) {
+        p = skip_space(p, end);
+        if (p == end)
+            return true;
+        if (*p != '<' || ! match_name(p + 1, end, "triangle"))
+            return false;
+        // The p1, p2, p3 and pid attributes are ignored, missing values are set equal to ZERO.
+        Vec3i       indices = Vec3i::Zero();
+        std::string custom_supports, custom_seam, mmu_segmentation, face_property;
+        bool        empty_element;
+        p = parse_attributes(p + 9, end, empty_element, [&](std::string_view name, const char *value, const char *value_end) {
+            if (name.size() == 2 && name[0] == 'v' && name[1] >= '1' && name[1] <= '3')
+                indices[name[1] - '1'] = parse_int(value, value_end);
+            else if (name == "paint_supports")
+                custom_supports.assign(value, value_end);
+            else if (name == "paint_seam")
+                custom_seam.assign(value, value_end);
+            else if (name == "paint_color")
+                mmu_segmentation.assign(value, value_end);
+            else if (name == "face_property")
+                face_property.assign(value, value_end);
+        });
+        if (p == nullptr || (! empty_element && (p = skip_end_tag(p, end, "triangle")) == nullptr))
+            return false;
+        out.indices.emplace_back(indices);
+        out.custom_supports.emplace_back(std::move(custom_supports));
+        out.custom_seam.emplace_back(std::move(custom_seam));
+        out.mmu_segmentation.emplace_back(std::move(mmu_segmentation));
+        out.face_properties.emplace_back(std::move(face_property));
+    }
+}
+
+template<typename T>
+void append_chunk(std::vector<T> &dst, std::vector<T> &&src)
+{
+    if (dst.empty())
+        dst = std::move(src);
+    else
+        dst.insert(dst.end(), std::make_move_iterator(src.begin()), std::make_move_iterator(src.end()));
+}
+
+struct Section
+{
+    bool        triangles;
+    // index into MeshXmlSections::vertices or MeshXmlSections::triangles
+    size_t      idx;
+    const char *begin;
+    const char *end;
+};
+
+struct Chunk
+{
+    size_t                     section;
+    const char                *begin;
+    const char                *end;
+    std::vector<Vec3f>         vertices;
+    MeshXmlSections::Triangles triangles;
+};
+
+// Splits the section into chunks at the starts of its elements. '<' may only start a tag inside a section.
+void split_section(const Section &section, size_t section_idx, std::vector<Chunk> &chunks)
+{
+    size_t      num_chunks = std::max<size_t>(1, size_t(section.end - section.begin) / chunk_size);
+    const char *begin      = section.begin;
+    for (size_t i = 1; i < num_chunks; ++ i) {
+        const char *split = section.begin + (section.end - section.begin) * i / num_chunks;
+        while (split != section.end && (split = static_cast<const char*>(memchr(split, '<', section.end - split))) != nullptr && split + 1 != section.end && split[1] == '/')
+            ++ split;
+        if (split == nullptr || split == section.end)
+            break;
+        if (split > begin) {
+            chunks.push_back({ section_idx, begin, split, {}, {} });
+            begin = split;
+        }
+    }
+    chunks.push_back({ section_idx, begin, section.end, {}, {} });
+}
+
+} // namespace
+
+bool MeshXmlSections::take_vertices(std::vector<Vec3f> &out)
+{
+    if (m_next_vertices == vertices.size())
+        return false;
+    out = std::move(vertices[m_next_vertices ++]);
+    return true;
+}
+
+bool MeshXmlSections::take_triangles(Triangles &out)
+{
+    if (m_next_triangles == triangles.size())
+        return false;
+    out = std::move(triangles[m_next_triangles ++]);
+    return true;
+}
+
+bool decode_mesh_xml_sections(const char *begin, const char *end, MeshXmlSections &out)
+{
+    out = MeshXmlSections();
+
+    // Cut the sections out of the document.
+    std::vector<Section> sections;
+    std::string_view     document(begin, end - begin);
+    size_t               sections_size = 0;
+    bool                 seen_element  = false;
+    const char          *copied        = begin;
+    for (const char *p = begin; p != end && (p = static_cast<const char*>(memchr(p, '<', end - p))) != nullptr;) {
+        const char *name = p + 1;
+        if (name == end || *name == '!' || (*name == '?' && seen_element))
+            // Comment, CDATA, DTD, a processing instruction, which may contain '<'.
+            return false;
+        seen_element |= *name != '?';
+        bool triangles = match_name(name, end, "triangles");
+        if (! triangles && ! match_name(name, end, "vertices")) {
+            p = name;
+            continue;
+        }
+        std::string_view tag = triangles ? "triangles" : "vertices";
+        bool             empty_element;
+        const char      *body = parse_attributes(name + tag.size(), end, empty_element, [](std::string_view, const char*, const char*) {});
+        if (body == nullptr)
+            return false;
+        Section section { triangles, triangles ? out.triangles.size() : out.vertices.size(), body, body };
+        if (! empty_element) {
+            size_t closing = document.find(triangles ? "</triangles" : "</vertices", body - begin);
+            if (closing == std::string_view::npos)
+                return false;
+            section.end = begin + closing;
+        }
+        if (triangles)
+            out.triangles.emplace_back();
+        else
+            out.vertices.emplace_back();
+        if (section.end != section.begin) {
+            out.skeleton.append(copied, section.begin);
+            copied = section.end;
+            sections_size += section.end - section.begin;
+            sections.emplace_back(section);
+        }
+        p = section.end;
+    }
+    out.skeleton.reserve(out.skeleton.size() + (end - copied));
+    out.skeleton.append(copied, end);
+    if (sections.empty())
+        return true;
+
+    std::vector<Chunk> chunks;
+    chunks.reserve(sections.size() + sections_size / chunk_size);
+    for (size_t i = 0; i < sections.size(); ++ i)
+        split_section(sections[i], i, chunks);
+
+    std::atomic<bool> failed { false };
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, chunks.size(), 1), [&chunks, &sections, &failed](const tbb::blocked_range<size_t> &range) {
+        for (size_t i = range.begin(); i < range.end() && ! failed; ++ i) {
+            Chunk &chunk = chunks[i];
+            bool   ok    = sections[chunk.section].triangles ?
+                decode_triangles(chunk.begin, chunk.end, chunk.triangles) :
+                decode_vertices(chunk.begin, chunk.end, chunk.vertices);
+            if (! ok)
+                failed = true;
+        }
+    });
+    if (failed)
+        return false;
+
+    for (Chunk &chunk : chunks) {
+        const Section &section = sections[chunk.section];
+        if (section.triangles) {
+            MeshXmlSections::Triangles &dst = out.triangles[section.idx];
+            append_chunk(dst.indices,          std::move(chunk.triangles.indices));
+            append_chunk(dst.custom_supports,  std::move(chunk.triangles.custom_supports));
+            append_chunk(dst.custom_seam,      std::move(chunk.triangles.custom_seam));
+            append_chunk(dst.mmu_segmentation, std::move(chunk.triangles.mmu_segmentation));
+            append_chunk(dst.face_properties,  std::move(chunk.triangles.face_properties));
+        } else
+            append_chunk(out.vertices[section.idx], std::move(chunk.vertices));
+    }
+    return true;
+}
+
+} // namespace Slic3r
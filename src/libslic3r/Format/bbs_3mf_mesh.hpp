@@ -0,0 +1,52 @@
+#ifndef slic3r_Format_bbs_3mf_mesh_hpp_
+#define slic3r_Format_bbs_3mf_mesh_hpp_
+
+#include "libslic3r/Point.hpp"
+
+#include <string>
+#include <vector>
+
+namespace Slic3r {
+
+// BBS: fast path for the <vertices> and <triangles> sections of the 3MF model files, which hold almost all of their text.
+// The sections are cut out of the document and decoded by a scanner specialized to the <vertex> and <triangle> elements,
+// the large sections in parallel chunks. The rest of the document, the skeleton, is parsed by Expat as before, which
+// reports each section as an empty element. The handlers of the end elements then take the decoded contents.
+struct MeshXmlSections
+{
+    struct Triangles
+    {
+        std::vector<Vec3i>       indices;
+        std::vector<std::string> custom_supports;
+        std::vector<std::string> custom_seam;
+        std::vector<std::string> mmu_segmentation;
+        std::vector<std::string> face_properties;
+    };
+
+    // Smaller model files are streamed to Expat without being extracted to memory first.
+    static constexpr size_t min_file_size = 1024 * 1024;
+
+    // The document with the contents of the mesh sections removed.
+    std::string                     skeleton;
+    // Contents of the sections in the order of the document, including the empty sections.
+    std::vector<std::vector<Vec3f>> vertices;
+    std::vector<Triangles>          triangles;
+
+    // To be called by the handlers of the </vertices> and </triangles> end elements of the skeleton, in the order of the document.
+    bool take_vertices(std::vector<Vec3f> &out);
+    bool take_triangles(Triangles &out);
+
+private:
+    size_t m_next_vertices  { 0 };
+    size_t m_next_triangles { 0 };
+};
+
+// Cuts the mesh sections out of the document [begin, end) and decodes them.
+// Returns false if the document uses XML constructs the scanner does not handle (comments, CDATA, DTD,
+// processing instructions after the first element, entity references or other elements inside the mesh sections)
+// or if a mesh section is malformed. The caller shall then parse the whole document with Expat, which also reports the errors.
+bool decode_mesh_xml_sections(const char *begin, const char *end, MeshXmlSections &out);
+
+} // namespace Slic3r
+
+#endif /* slic3r_Format_bbs_3mf_mesh_hpp_ */
@@ -1,20 +1,70 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include <atomic>
+#include <charconv>
+#include <climits>
+#include <cstdint>
+#include <type_traits>
+
+#include <boost/filesystem/operations.hpp>
+#include <boost/iostreams/device/mapped_file.hpp>
 #include <boost/log/trivial.hpp>
 #include <boost/nowide/cstdio.hpp>
 
+#include <fast_float/fast_float.h>
+#include <tbb/parallel_for.h>
+
 #include "objparser.hpp"
 
 #include "libslic3r/LocalesUtils.hpp"
+#include "libslic3r/Utils.hpp"
 
 namespace ObjParser {
+
+// BBS: replacements of strtod() and strtol() for the OBJ records, which do not depend on the locale.
+// As strtod() and strtol(), they skip a leading '+' and set endptr to line if there is no number to parse.
+static inline double parse_double(const char *line, const char *line_end, char **endptr)
+{
+	const char *begin = *line == '+' && line[1] != '-' && line[1] != '+' ? line + 1 : line;
+	// Parse to double and round to float by the caller, as with strtod().
+	double value = 0;
+	auto [ptr, ec] = fast_float::from_chars(begin, line_end, value);
+	*endptr = const_cast<char*>(ec == std::errc::invalid_argument ? line : ptr);
+	return ec == std::errc::invalid_argument ? 0 : value;
+}
+
+static inline long parse_int(const char *line, const char *line_end, char **endptr)
+{
+	const char *begin = *line == '+' && line[1] != '-' && line[1] != '+' ? line + 1 : line;
+	long value = 0;
+	auto [ptr, ec] = std::from_chars(begin, line_end, value);
+	*endptr = const_cast<char*>(ec == std::errc::invalid_argument ? line : ptr);
+	if (ec == std::errc::result_out_of_range)
+		value = *begin == '-' ? LONG_MIN : LONG_MAX;
+	return value;
+}
+
+// Face vertex index relative to the end of the coordinates, texture coordinates or normals parsed so far,
+// recorded by the parallel parser to be rebased when the chunks are concatenated.
+struct ObjRelativeIdx
+{
+	// Index into ObjData::vertices.
+	size_t	vertex;
+	// 0 - coordIdx, 1 - textureCoordIdx, 2 - normalIdx
+	int		field;
+	// Negative index as written in the file.
+	int		idx;
+	// Number of floats of the referenced array of the chunk at the time the face was parsed.
+	size_t	num_floats;
+};
+
 #define EATWS()  while (*line == ' ' || *line == '\t') ++line
-static bool obj_parseline(const char *line, ObjData &data)
+static bool obj_parseline(const char *line, ObjData &data, std::vector<ObjRelativeIdx> *relative = nullptr)
 {
 	if (*line == 0)
 		return true;
-    assert(Slic3r::is_decimal_separator_point());
+	const char *line_end = line + strlen(line);
 	// Ignore whitespaces at the beginning of the line.
 	//FIXME is this a good idea?
 	EATWS();
@@ -38,14 +88,14 @@ static bool obj_parseline(const char *line, ObjData &data)
 				return false;
 			EATWS();
 			char *endptr = 0;
-			double u = strtod(line, &endptr);
+			double u = parse_double(line, line_end, &endptr);
 			if (endptr == 0 || (*endptr != ' ' && *endptr != '\t'))
 				return false;
 			line = endptr;
 			EATWS();
 			double v = 0;
 			if (*line != 0) {
-				v = strtod(line, &endptr);
+				v = parse_double(line, line_end, &endptr);
 				if (endptr == 0 || (*endptr != ' ' && *endptr != '\t' && *endptr != 0))
 					return false;
 				line = endptr;
@@ -75,17 +125,17 @@ static bool obj_parseline(const char *line, ObjData &data)
 				return false;
 			EATWS();
 			char *endptr = 0;
-			double x = strtod(line, &endptr);
+			double x = parse_double(line, line_end, &endptr);
 			if (endptr == 0 || (*endptr != ' ' && *endptr != '\t'))
 				return false;
 			line = endptr;
 			EATWS();
-			double y = strtod(line, &endptr);
+			double y = parse_double(line, line_end, &endptr);
 			if (endptr == 0 || (*endptr != ' ' && *endptr != '\t'))
 				return false;
 			line = endptr;
 			EATWS();
-			double z = strtod(line, &endptr);
+			double z = parse_double(line, line_end, &endptr);
 			if (endptr == 0 || (*endptr != ' ' && *endptr != '\t' && *endptr != 0))
 				return false;
 			line = endptr;
@@ -105,19 +155,19 @@ static bool obj_parseline(const char *line, ObjData &data)
 				return false;
 			EATWS();
 			char *endptr = 0;
-			double u = strtod(line, &endptr);
+			double u = parse_double(line, line_end, &endptr);
 			if (endptr == 0 || (*endptr != ' ' && *endptr != '\t' && *endptr != 0))
 				return false;
 			line = endptr;
 			EATWS();
-			double v = strtod(line, &endptr);
+			double v = parse_double(line, line_end, &endptr);
 			if (endptr == 0 || (*endptr != ' ' && *endptr != '\t' && *endptr != 0))
 				return false;
 			line = endptr;
 			EATWS();
 			double w = 0;
 			if (*line != 0) {
-				w = strtod(line, &endptr);
+				w = parse_double(line, line_end, &endptr);
 				if (endptr == 0 || (*endptr != ' ' && *endptr != '\t' && *endptr != 0))
 					return false;
 				line = endptr;
@@ -137,17 +187,17 @@ static bool obj_parseline(const char *line, ObjData &data)
 				return false;
 			EATWS();
 			char *endptr = 0;
-			double x = strtod(line, &endptr);
+			double x = parse_double(line, line_end, &endptr);
 			if (endptr == 0 || (*endptr != ' ' && *endptr != '\t'))
 				return false;
 			line = endptr;
 			EATWS();
-			double y = strtod(line, &endptr);
+			double y = parse_double(line, line_end, &endptr);
 			if (endptr == 0 || (*endptr != ' ' && *endptr != '\t'))
 				return false;
 			line = endptr;
 			EATWS();
-			double z = strtod(line, &endptr);
+			double z = parse_double(line, line_end, &endptr);
 			if (endptr == 0 || (*endptr != ' ' && *endptr != '\t' && *endptr != 0))
 				return false;
 			line = endptr;
@@ -157,24 +207,24 @@ static bool obj_parseline(const char *line, ObjData &data)
                 if (!data.has_vertex_color) {
                     data.has_vertex_color = true;
                 }
-                color_x = strtod(line, &endptr);
+                color_x = parse_double(line, line_end, &endptr);
                 if (endptr == 0 || (*endptr != ' ' && *endptr != '\t' && *endptr != 0))
                     return false;
                 line = endptr;
                 EATWS();
-                color_y = strtod(line, &endptr);
+                color_y = parse_double(line, line_end, &endptr);
                 if (endptr == 0 || (*endptr != ' ' && *endptr != '\t' && *endptr != 0))
                      return false;
                 line = endptr;
                 EATWS();
-                color_z = strtod(line, &endptr);
+                color_z = parse_double(line, line_end, &endptr);
                 if (endptr == 0 || (*endptr != ' ' && *endptr != '\t' && *endptr != 0))
                     return false;
                 line = endptr;
                 EATWS();
                 color_w = 1.0;//default define alpha = 1.0
                 if (*line != 0) {
-                    color_w = strtod(line, &endptr);
+                    color_w = parse_double(line, line_end, &endptr);
                     if (endptr == 0 || (*endptr != ' ' && *endptr != '\t' && *endptr != 0)) return false;
                     line = endptr;
                     EATWS();
@@ -212,7 +262,7 @@ static bool obj_parseline(const char *line, ObjData &data)
 			vertex.coordIdx			= 0;
 			vertex.normalIdx		= 0;
 			vertex.textureCoordIdx	= 0;
-			vertex.coordIdx = strtol(line, &endptr, 10);
+			vertex.coordIdx = parse_int(line, line_end, &endptr);
 			// Coordinate has to be defined
 			if (endptr == 0 || (*endptr != ' ' && *endptr != '\t' && *endptr != '/' && *endptr != 0))
 				return false;
@@ -222,7 +272,7 @@ static bool obj_parseline(const char *line, ObjData &data)
 				// Texture coordinate index may be missing after a 1st slash, but then the normal index has to be present.
 				if (*line != '/') {
 					// Parse the texture coordinate index.
-					vertex.textureCoordIdx = strtol(line, &endptr, 10);
+					vertex.textureCoordIdx = parse_int(line, line_end, &endptr);
 					if (endptr == 0 || (*endptr != ' ' && *endptr != '\t' && *endptr != '/' && *endptr != 0))
 						return false;
 					line = endptr;
@@ -230,24 +280,26 @@ static bool obj_parseline(const char *line, ObjData &data)
 				if (*line == '/') {
 					// Parse normal index.
 					++ line;
-					vertex.normalIdx = strtol(line, &endptr, 10);
+					vertex.normalIdx = parse_int(line, line_end, &endptr);
 					if (endptr == 0 || (*endptr != ' ' && *endptr != '\t' && *endptr != 0))
 						return false;
 					line = endptr;
 				}
 			}
-			if (vertex.coordIdx < 0)
-                vertex.coordIdx += (int) data.coordinates.size() / OBJ_VERTEX_LENGTH;
-            else
-				-- vertex.coordIdx;
-			if (vertex.normalIdx < 0)
-                vertex.normalIdx += (int)data.normals.size() / 3;
-            else
-				-- vertex.normalIdx;
-			if (vertex.textureCoordIdx < 0)
-                vertex.textureCoordIdx += (int)data.textureCoordinates.size() / 3;
-            else
-				-- vertex.textureCoordIdx;
+			// The parallel parser resolves the relative indices once the chunks are concatenated.
+			// Until then they are set to zero, not to be mistaken for the delimiter of faces.
+			auto resolve = [&data, relative](int &idx, int field, size_t num_floats, int elem_size) {
+				if (idx >= 0)
+					-- idx;
+				else if (relative) {
+					relative->push_back({ data.vertices.size(), field, idx, num_floats });
+					idx = 0;
+				} else
+					idx += (int) num_floats / elem_size;
+			};
+			resolve(vertex.coordIdx, 0, data.coordinates.size(), OBJ_VERTEX_LENGTH);
+			resolve(vertex.normalIdx, 2, data.normals.size(), 3);
+			resolve(vertex.textureCoordIdx, 1, data.textureCoordinates.size(), 3);
 			data.vertices.push_back(vertex);
 			EATWS();
 		}
@@ -353,7 +405,7 @@ static bool obj_parseline(const char *line, ObjData &data)
 			return false;
 		EATWS();
 		char *endptr = 0;
-		long g = strtol(line, &endptr, 10);
+		long g = parse_int(line, line_end, &endptr);
 		if (endptr == 0 || (*endptr != ' ' && *endptr != '\t' && *endptr != 0))
 			return false;
 		line = endptr;
@@ -565,16 +617,200 @@ static bool        mtl_parseline(const char *line, MtlData &data)
     return true;
 }
 
+namespace {
+
+// Files larger than twice this size are split into chunks of about this size at line boundaries, which are parsed in parallel.
+constexpr size_t obj_chunk_size = 1024 * 1024;
+// Lines longer than this are rejected as by the buffered parser.
+constexpr size_t obj_max_line_length = 65536;
+
+inline bool is_eol(char c) { return c == '\r' || c == '\n'; }
+
+// Parses the lines of [begin, end), the last one may not be terminated.
+bool obj_parselines(const char *begin, const char *end, ObjData &data, std::vector<ObjRelativeIdx> *relative)
+{
+	std::string line;
+	for (const char *p = begin; p != end;) {
+		const char *line_end = p;
+		while (line_end != end && ! is_eol(*line_end))
+			++ line_end;
+		if (size_t(line_end - p) > obj_max_line_length) {
+			BOOST_LOG_TRIVIAL(error) << "ObjParser: Excessive line length";
+			return false;
+		}
+		while (p != line_end && (*p == ' ' || *p == '\t'))
+			++ p;
+		// obj_parseline() expects a zero terminated line.
+		line.assign(p, line_end);
+		obj_parseline(line.c_str(), data, relative);
+		p = line_end == end ? end : line_end + 1;
+	}
+	return true;
+}
+
+struct ObjChunk
+{
+	const char                  *begin;
+	const char                  *end;
+	ObjData                      data;
+	std::vector<ObjRelativeIdx>  relative;
+};
+
+// Sizes of the arrays of ObjData, which are concatenated by objparse_chunks().
+struct ObjChunkOffsets
+{
+	size_t coordinates;
+	size_t textureCoordinates;
+	size_t normals;
+	size_t parameters;
+	size_t vertices;
+};
+
+template<typename T>
+void append_named(std::vector<T> &dst, std::vector<T> &&src, int vertex_offset)
+{
+	for (T &item : src) {
+		item.vertexIdxFirst += vertex_offset;
+		dst.push_back(std::move(item));
+	}
+}
+
+// Parses the lines of the file in chunks in parallel and appends them to data.
+// Each chunk is parsed as if it started a file, but with a placeholder usemtl collecting the faces preceding the first usemtl
+// of the chunk, which belong to the last usemtl of the previous chunks. The indices referencing the data parsed so far,
+// that is the vertex indices of the usemtls, objects and groups and the relative face vertex indices, are rebased
+// when the chunks are concatenated in the order of the file.
+bool objparse_chunks(const char *begin, const char *end, ObjData &data)
+{
+	std::vector<ObjChunk> chunks;
+	size_t                num_chunks = std::max<size_t>(1, size_t(end - begin) / obj_chunk_size);
+	chunks.reserve(num_chunks);
+	const char *chunk_begin = begin;
+	for (size_t i = 1; i < num_chunks; ++ i) {
+		const char *split = begin + (end - begin) * i / num_chunks;
+		while (split != end && ! is_eol(*split))
+			++ split;
+		if (split == end)
+			break;
+		if (++ split > chunk_begin) {
+			chunks.push_back({ chunk_begin, split, {}, {} });
+			chunk_begin = split;
+		}
+	}
+	if (chunks.empty())
+		// Small file, parse it directly.
+		return obj_parselines(begin, end, data, nullptr);
+	chunks.push_back({ chunk_begin, end, {}, {} });
+
+	std::atomic<bool> failed { false };
+	tbb::parallel_for(tbb::blocked_range<size_t>(0, chunks.size(), 1), [&chunks, &failed](const tbb::blocked_range<size_t> &range) {
+		for (size_t i = range.begin(); i < range.end() && ! failed; ++ i) {
+			ObjChunk &chunk = chunks[i];
+			ObjUseMtl leading;
+			leading.vertexIdxFirst = 0;
+			leading.face_start     = 0;
+			chunk.data.usemtls.push_back(leading);
+			if (! obj_parselines(chunk.begin, chunk.end, chunk.data, &chunk.relative))
+				failed = true;
+		}
+	});
+	if (failed)
+		return false;
+
+	std::vector<ObjChunkOffsets> offsets(chunks.size() + 1);
+	offsets.front() = { data.coordinates.size(), data.textureCoordinates.size(), data.normals.size(), data.parameters.size(), data.vertices.size() };
+	for (size_t i = 0; i < chunks.size(); ++ i) {
+		const ObjData &src = chunks[i].data;
+		offsets[i + 1] = { offsets[i].coordinates + src.coordinates.size(), offsets[i].textureCoordinates + src.textureCoordinates.size(),
+						   offsets[i].normals + src.normals.size(), offsets[i].parameters + src.parameters.size(), offsets[i].vertices + src.vertices.size() };
+	}
+	data.coordinates.resize(offsets.back().coordinates);
+	data.textureCoordinates.resize(offsets.back().textureCoordinates);
+	data.normals.resize(offsets.back().normals);
+	data.parameters.resize(offsets.back().parameters);
+	data.vertices.resize(offsets.back().vertices);
+	tbb::parallel_for(tbb::blocked_range<size_t>(0, chunks.size(), 1), [&chunks, &offsets, &data](const tbb::blocked_range<size_t> &range) {
+		for (size_t i = range.begin(); i < range.end(); ++ i) {
+			ObjData               &src    = chunks[i].data;
+			const ObjChunkOffsets &offset = offsets[i];
+			std::copy(src.coordinates.begin(), src.coordinates.end(), data.coordinates.begin() + offset.coordinates);
+			std::copy(src.textureCoordinates.begin(), src.textureCoordinates.end(), data.textureCoordinates.begin() + offset.textureCoordinates);
+			std::copy(src.normals.begin(), src.normals.end(), data.normals.begin() + offset.normals);
+			std::copy(src.parameters.begin(), src.parameters.end(), data.parameters.begin() + offset.parameters);
+			std::copy(src.vertices.begin(), src.vertices.end(), data.vertices.begin() + offset.vertices);
+			// Resolve the relative indices as obj_parseline() would have with all the preceding chunks parsed.
+			for (const ObjRelativeIdx &rel : chunks[i].relative) {
+				ObjVertex &vertex = data.vertices[offset.vertices + rel.vertex];
+				if (rel.field == 0)
+					vertex.coordIdx = rel.idx + (int) (offset.coordinates + rel.num_floats) / OBJ_VERTEX_LENGTH;
+				else if (rel.field == 1)
+					vertex.textureCoordIdx = rel.idx + (int) (offset.textureCoordinates + rel.num_floats) / 3;
+				else
+					vertex.normalIdx = rel.idx + (int) (offset.normals + rel.num_floats) / 3;
+			}
+			src.coordinates        = {};
+			src.textureCoordinates = {};
+			src.normals            = {};
+			src.parameters         = {};
+			src.vertices           = {};
+		}
+	});
+
+	for (size_t i = 0; i < chunks.size(); ++ i) {
+		ObjData &src           = chunks[i].data;
+		int      vertex_offset = (int) offsets[i].vertices;
+		data.has_vertex_color |= src.has_vertex_color;
+		data.mtllibs.insert(data.mtllibs.end(), std::make_move_iterator(src.mtllibs.begin()), std::make_move_iterator(src.mtllibs.end()));
+		append_named(data.objects, std::move(src.objects), vertex_offset);
+		append_named(data.groups, std::move(src.groups), vertex_offset);
+		append_named(data.smoothingGroups, std::move(src.smoothingGroups), vertex_offset);
+		// The faces collected by the placeholder continue the last usemtl, if any.
+		const ObjUseMtl &leading     = src.usemtls.front();
+		int              face_offset = 0;
+		if (data.usemtls.empty())
+			face_offset = - (leading.face_end + 1);
+		else {
+			ObjUseMtl &last = data.usemtls.back();
+			face_offset = last.face_end + 1;
+			if (leading.vertexIdxEnd != -1)
+				last.vertexIdxEnd = leading.vertexIdxEnd + vertex_offset;
+			last.face_end += leading.face_end + 1;
+		}
+		for (auto it = src.usemtls.begin() + 1; it != src.usemtls.end(); ++ it) {
+			ObjUseMtl usemtl = std::move(*it);
+			usemtl.vertexIdxFirst += vertex_offset;
+			if (usemtl.vertexIdxEnd != -1)
+				usemtl.vertexIdxEnd += vertex_offset;
+			usemtl.face_start += face_offset;
+			usemtl.face_end   += face_offset;
+			data.usemtls.push_back(std::move(usemtl));
+		}
+	}
+	return true;
+}
+
+} // namespace
+
 bool objparse(const char *path, ObjData &data)
 {
-    Slic3r::CNumericLocalesSetter locales_setter;
+	// BBS: parse the memory mapped file in parallel chunks.
+	boost::iostreams::mapped_file_source mapped;
+	if (Slic3r::map_file(path, mapped)) {
+		try {
+			return objparse_chunks(mapped.data(), mapped.data() + mapped.size(), data);
+		}
+		catch (std::bad_alloc&) {
+			BOOST_LOG_TRIVIAL(error) << "ObjParser: Out of memory";
+			return true;
+		}
+	}
 
 	FILE *pFile = boost::nowide::fopen(path, "rt");
 	if (pFile == 0)
 		return false;
 
 	try {
-		char buf[65536 * 2];
+		char buf[65536 * 2 + 1];
 		size_t len = 0;
 		size_t lenPrev = 0;
 		while ((len = ::fread(buf + lenPrev, 1, 65536, pFile)) != 0) {
@@ -599,6 +835,12 @@ bool objparse(const char *path, ObjData &data)
 			}
 			memmove(buf, buf + lastLine, lenPrev);
 		}
+		// The last line may not be terminated.
+		buf[lenPrev] = 0;
+		char *c = buf;
+		while (*c == ' ' || *c == '\t')
+			++ c;
+		obj_parseline(c, data);
     }
     catch (std::bad_alloc&) {
     	BOOST_LOG_TRIVIAL(error) << "ObjParser: Out of memory";
@@ -648,10 +890,8 @@ bool mtlparse(const char *path, MtlData &data)
 
 bool objparse(std::istream &stream, ObjData &data)
 {
-    Slic3r::CNumericLocalesSetter locales_setter;
-
     try {
-        char buf[65536 * 2];
+        char buf[65536 * 2 + 1];
         size_t len = 0;
         size_t lenPrev = 0;
         while ((len = size_t(stream.read(buf + lenPrev, 65536).gcount())) != 0) {
@@ -667,8 +907,18 @@ bool objparse(std::istream &stream, ObjData &data)
                     lastLine = i + 1;
                 }
             lenPrev = len - lastLine;
+            if (lenPrev > 65536) {
+                BOOST_LOG_TRIVIAL(error) << "ObjParser: Excessive line length";
+                return false;
+            }
             memmove(buf, buf + lastLine, lenPrev);
         }
+        // The last line may not be terminated.
+        buf[lenPrev] = 0;
+        char *c = buf;
+        while (*c == ' ' || *c == '\t')
+            ++ c;
+        obj_parseline(c, data);
     }
     catch (std::bad_alloc&) {
     	BOOST_LOG_TRIVIAL(error) << "ObjParser: Out of memory";
@@ -678,150 +928,303 @@ bool objparse(std::istream &stream, ObjData &data)
     return true;
 }
 
+// BBS: private binary format of ObjData, version 3. It is loaded from a memory mapped file, the arrays of floats
+// and face vertices with a single copy each, thus it serves as a fast reload cache of large OBJ files.
+// Layout: ObjBinHeader followed by the arrays in the order of ObjData, each of them prefixed by its uint64_t length.
+static constexpr uint32_t OBJBIN_MAGIC   = 0x4a424f42; // "BOBJ"
+static constexpr uint32_t OBJBIN_VERSION = 3;
+
+struct ObjBinHeader
+{
+	uint32_t	magic;
+	uint32_t	version;
+	// Size and hash of the content of the OBJ file the data was parsed from, zero if not known.
+	uint64_t	source_size;
+	uint64_t	source_hash;
+	uint32_t	has_vertex_color;
+	uint32_t	reserved;
+};
+
+// 64bit hash of a block of memory, reading it by 8 bytes. Not a cryptographic hash, it detects modified files.
+static uint64_t hash_block(const char *data, size_t len, uint64_t hash)
+{
+	static constexpr uint64_t prime = 0x100000001b3ull;
+	for (; len >= sizeof(uint64_t); data += sizeof(uint64_t), len -= sizeof(uint64_t)) {
+		uint64_t word;
+		memcpy(&word, data, sizeof(word));
+		hash = (hash ^ word) * prime;
+		hash ^= hash >> 29;
+	}
+	for (; len > 0; ++ data, -- len)
+		hash = (hash ^ uint64_t(uint8_t(*data))) * prime;
+	return hash;
+}
+
+// Hash of the content of a file, the blocks of a large file are hashed in parallel.
+static uint64_t hash_content(const char *data, size_t len)
+{
+	static constexpr uint64_t seed       = 0xcbf29ce484222325ull;
+	static constexpr size_t   block_size = 4 * 1024 * 1024;
+	std::vector<uint64_t> block_hashes((len + block_size - 1) / block_size, 0);
+	tbb::parallel_for(tbb::blocked_range<size_t>(0, block_hashes.size()), [data, len, &block_hashes](const tbb::blocked_range<size_t> &range) {
+		for (size_t i = range.begin(); i < range.end(); ++ i)
+			block_hashes[i] = hash_block(data + i * block_size, std::min(block_size, len - i * block_size), seed + i);
+	});
+	return hash_block(reinterpret_cast<const char*>(block_hashes.data()), block_hashes.size() * sizeof(uint64_t), seed ^ uint64_t(len));
+}
+
+static ObjBinHeader objbin_header(const char *source_path)
+{
+	ObjBinHeader header { OBJBIN_MAGIC, OBJBIN_VERSION, 0, 0, 0, 0 };
+	if (source_path != nullptr) {
+		boost::iostreams::mapped_file_source mapped;
+		if (Slic3r::map_file(source_path, mapped) && mapped.size() > 0) {
+			header.source_size = uint64_t(mapped.size());
+			header.source_hash = hash_content(mapped.data(), mapped.size());
+		}
+	}
+	return header;
+}
+
+static bool savebytes(FILE *pFile, const void *data, size_t len)
+{
+	return len == 0 || ::fwrite(data, 1, len, pFile) == len;
+}
+
+static bool savesize(FILE *pFile, size_t len)
+{
+	uint64_t cnt = len;
+	return savebytes(pFile, &cnt, sizeof(cnt));
+}
+
+static bool savestring(FILE *pFile, const std::string &s)
+{
+	return savesize(pFile, s.size()) && savebytes(pFile, s.data(), s.size());
+}
+
 template<typename T> 
 bool savevector(FILE *pFile, const std::vector<T> &v)
 {
-	size_t cnt = v.size();
-	::fwrite(&cnt, 1, sizeof(cnt), pFile);
+	static_assert(std::is_trivially_copyable<T>::value, "savevector() stores the memory of the elements");
 	//FIXME sizeof(T) works for data types leaving no gaps in the allocated vector because of alignment of the T type.
-	if (! v.empty())
-		::fwrite(&v.front(), 1, sizeof(T) * cnt, pFile);
-	return true;
+	return savesize(pFile, v.size()) && savebytes(pFile, v.data(), sizeof(T) * v.size());
 }
 
 bool savevector(FILE *pFile, const std::vector<std::string> &v)
 {
-	size_t cnt = v.size();
-	::fwrite(&cnt, 1, sizeof(cnt), pFile);
-	for (size_t i = 0; i < cnt; ++ i) {
-		size_t len = v[i].size();
-		::fwrite(&len, 1, sizeof(cnt), pFile);
-		::fwrite(v[i].c_str(), 1, len, pFile);
-	}
-	return true;
+	bool ok = savesize(pFile, v.size());
+	for (size_t i = 0; ok && i < v.size(); ++ i)
+		ok = savestring(pFile, v[i]);
+	return ok;
 }
 
 template<typename T>
 bool savevectornameidx(FILE *pFile, const std::vector<T> &v)
 {
-	size_t cnt = v.size();
-	::fwrite(&cnt, 1, sizeof(cnt), pFile);
-	for (size_t i = 0; i < cnt; ++ i) {
-		::fwrite(&v[i].vertexIdxFirst, 1, sizeof(int), pFile);
-		size_t len = v[i].name.size();
-		::fwrite(&len, 1, sizeof(cnt), pFile);
-		::fwrite(v[i].name.c_str(), 1, len, pFile);
+	bool ok = savesize(pFile, v.size());
+	for (size_t i = 0; ok && i < v.size(); ++ i)
+		ok = savebytes(pFile, &v[i].vertexIdxFirst, sizeof(int)) && savestring(pFile, v[i].name);
+	return ok;
+}
+
+bool savevector(FILE *pFile, const std::vector<ObjUseMtl> &v)
+{
+	bool ok = savesize(pFile, v.size());
+	for (size_t i = 0; ok && i < v.size(); ++ i) {
+		int idx[4] = { v[i].vertexIdxFirst, v[i].vertexIdxEnd, v[i].face_start, v[i].face_end };
+		ok = savebytes(pFile, idx, sizeof(idx)) && savestring(pFile, v[i].name);
 	}
-	return true;
+	return ok;
 }
 
+// Sequential reader of the memory mapped binary file, all reads are bounds checked.
+class ObjBinReader
+{
+public:
+	ObjBinReader(const char *begin, const char *end) : m_ptr(begin), m_end(end) {}
+
+	bool read(void *data, size_t len)
+	{
+		if (size_t(m_end - m_ptr) < len)
+			return false;
+		if (len > 0)
+			memcpy(data, m_ptr, len);
+		m_ptr += len;
+		return true;
+	}
+
+	// Reads the length of an array of elements of elem_size, which have to fit into the rest of the file.
+	bool read_size(size_t elem_size, size_t &len)
+	{
+		uint64_t cnt = 0;
+		if (! this->read(&cnt, sizeof(cnt)) || cnt > uint64_t(m_end - m_ptr) / std::max<size_t>(elem_size, 1))
+			return false;
+		len = size_t(cnt);
+		return true;
+	}
+
+	bool read_string(std::string &s)
+	{
+		size_t len = 0;
+		if (! this->read_size(1, len))
+			return false;
+		s.assign(m_ptr, len);
+		m_ptr += len;
+		return true;
+	}
+
+private:
+	const char *m_ptr;
+	const char *m_end;
+};
+
 template<typename T> 
-bool loadvector(FILE *pFile, std::vector<T> &v)
+bool loadvector(ObjBinReader &reader, std::vector<T> &v)
 {
 	v.clear();
 	size_t cnt = 0;
-	if (::fread(&cnt, sizeof(cnt), 1, pFile) != 1)
+	if (! reader.read_size(sizeof(T), cnt))
 		return false;
-	//FIXME sizeof(T) works for data types leaving no gaps in the allocated vector because of alignment of the T type.
-	if (cnt != 0) {
-		v.assign(cnt, T());
-		if (::fread(&v.front(), sizeof(T), cnt, pFile) != cnt)
-			return false;
-	}
-	return true;
+	v.resize(cnt);
+	return reader.read(v.data(), sizeof(T) * cnt);
 }
 
-bool loadvector(FILE *pFile, std::vector<std::string> &v)
+bool loadvector(ObjBinReader &reader, std::vector<std::string> &v)
 {
 	v.clear();
 	size_t cnt = 0;
-	if (::fread(&cnt, sizeof(cnt), 1, pFile) != 1)
+	if (! reader.read_size(sizeof(uint64_t), cnt))
 		return false;
-	v.reserve(cnt);
-	for (size_t i = 0; i < cnt; ++ i) {
-		size_t len = 0;
-		if (::fread(&len, sizeof(len), 1, pFile) != 1)
-			return false;
-		std::string s(" ", len);
-		if (::fread(s.data(), 1, len, pFile) != len)
+	v.assign(cnt, std::string());
+	for (size_t i = 0; i < cnt; ++ i)
+		if (! reader.read_string(v[i]))
 			return false;
-		v.push_back(std::move(s));
-	}
 	return true;
 }
 
 template<typename T>
-bool loadvectornameidx(FILE *pFile, std::vector<T> &v)
+bool loadvectornameidx(ObjBinReader &reader, std::vector<T> &v)
 {
 	v.clear();
 	size_t cnt = 0;
-	if (::fread(&cnt, sizeof(cnt), 1, pFile) != 1)
+	if (! reader.read_size(sizeof(int) + sizeof(uint64_t), cnt))
 		return false;
 	v.assign(cnt, T());
-	for (size_t i = 0; i < cnt; ++ i) {
-		if (::fread(&v[i].vertexIdxFirst, sizeof(int), 1, pFile) != 1)
+	for (size_t i = 0; i < cnt; ++ i)
+		if (! reader.read(&v[i].vertexIdxFirst, sizeof(int)) || ! reader.read_string(v[i].name))
 			return false;
-		size_t len = 0;
-		if (::fread(&len, sizeof(len), 1, pFile) != 1)
-			return false;
-		v[i].name.assign(" ", len);
-		if (::fread(v[i].name.data(), 1, len, pFile) != len)
+	return true;
+}
+
+bool loadvector(ObjBinReader &reader, std::vector<ObjUseMtl> &v)
+{
+	v.clear();
+	size_t cnt = 0;
+	if (! reader.read_size(4 * sizeof(int) + sizeof(uint64_t), cnt))
+		return false;
+	v.assign(cnt, ObjUseMtl());
+	for (size_t i = 0; i < cnt; ++ i) {
+		int idx[4];
+		if (! reader.read(idx, sizeof(idx)) || ! reader.read_string(v[i].name))
 			return false;
+		v[i].vertexIdxFirst = idx[0];
+		v[i].vertexIdxEnd   = idx[1];
+		v[i].face_start     = idx[2];
+		v[i].face_end       = idx[3];
 	}
 	return true;
 }
 
-bool objbinsave(const char *path, const ObjData &data)
+// The data are written to a temporary file, which replaces the file at path once complete, thus a concurrent
+// objbinload() or a crash never leave a truncated file at path.
+static bool objbin_save(const char *path, const ObjData &data, ObjBinHeader header)
 {
-	FILE *pFile = boost::nowide::fopen(path, "wb");
+	boost::system::error_code ec;
+	std::string temp_path = std::string(path) + "." + boost::filesystem::unique_path().string() + ".tmp";
+	FILE *pFile = boost::nowide::fopen(temp_path.c_str(), "wb");
 	if (pFile == 0)
 		return false;
 
-	size_t version = 1;
-	::fwrite(&version, 1, sizeof(version), pFile);
+	header.has_vertex_color = data.has_vertex_color;
 
 	bool result =
+		savebytes(pFile, &header, sizeof(header))	&&
 		savevector(pFile, data.coordinates)			&&
 		savevector(pFile, data.textureCoordinates)	&&
 		savevector(pFile, data.normals)				&&
 		savevector(pFile, data.parameters)			&&
 		savevector(pFile, data.mtllibs)				&&
-		savevectornameidx(pFile, data.usemtls)		&&
+		savevector(pFile, data.usemtls)				&&
 		savevectornameidx(pFile, data.objects)		&&
 		savevectornameidx(pFile, data.groups)		&&
 		savevector(pFile, data.smoothingGroups)		&&
 		savevector(pFile, data.vertices);
 
-	::fclose(pFile);
-	return result;
+	result = ::fclose(pFile) == 0 && result;
+	if (result)
+		boost::filesystem::rename(temp_path, path, ec);
+	if (! result || ec) {
+		boost::nowide::remove(temp_path.c_str());
+		return false;
+	}
+	return true;
 }
 
-bool objbinload(const char *path, ObjData &data)
+bool objbinsave(const char *path, const ObjData &data, const char *source_path)
 {
-	FILE *pFile = boost::nowide::fopen(path, "rb");
-	if (pFile == 0)
+	return objbin_save(path, data, objbin_header(source_path));
+}
+
+// If source is given, the data are only loaded if they were stored for the same size and hash of the OBJ file.
+static bool objbin_load(const char *path, ObjData &data, const ObjBinHeader *source)
+{
+	boost::iostreams::mapped_file_source mapped;
+	if (! Slic3r::map_file(path, mapped))
 		return false;
 
-	data.version = 0;
-	if (::fread(&data.version, sizeof(data.version), 1, pFile) != 1)
+	ObjBinReader reader(mapped.data(), mapped.data() + mapped.size());
+	ObjBinHeader header;
+	if (! reader.read(&header, sizeof(header)) || header.magic != OBJBIN_MAGIC || header.version != OBJBIN_VERSION)
 		return false;
-	if (data.version != 1)
+	// Reject the data of a different or modified OBJ file.
+	if (source != nullptr && (source->source_size == 0 || source->source_size != header.source_size || source->source_hash != header.source_hash))
 		return false;
 
-	bool result =
-		loadvector(pFile, data.coordinates)			&&
-		loadvector(pFile, data.textureCoordinates)	&&
-		loadvector(pFile, data.normals)				&&
-		loadvector(pFile, data.parameters)			&&
-		loadvector(pFile, data.mtllibs)				&&
-		loadvectornameidx(pFile, data.usemtls)		&&
-		loadvectornameidx(pFile, data.objects)		&&
-		loadvectornameidx(pFile, data.groups)		&&
-		loadvector(pFile, data.smoothingGroups)		&&
-		loadvector(pFile, data.vertices);
+	data.version          = int(header.version);
+	data.has_vertex_color = header.has_vertex_color != 0;
+	return
+		loadvector(reader, data.coordinates)		&&
+		loadvector(reader, data.textureCoordinates)	&&
+		loadvector(reader, data.normals)			&&
+		loadvector(reader, data.parameters)			&&
+		loadvector(reader, data.mtllibs)			&&
+		loadvector(reader, data.usemtls)			&&
+		loadvectornameidx(reader, data.objects)		&&
+		loadvectornameidx(reader, data.groups)		&&
+		loadvector(reader, data.smoothingGroups)	&&
+		loadvector(reader, data.vertices);
+}
 
-	::fclose(pFile);
-	return result;
+bool objbinload(const char *path, ObjData &data, const char *source_path)
+{
+	if (source_path == nullptr)
+		return objbin_load(path, data, nullptr);
+	ObjBinHeader source = objbin_header(source_path);
+	return objbin_load(path, data, &source);
+}
+
+bool objparse_cached(const char *path, const char *cache_path, ObjData &data)
+{
+	// The OBJ file is hashed once, for both the check of the cache and the new cache.
+	ObjBinHeader source = objbin_header(path);
+	if (objbin_load(cache_path, data, &source))
+		return true;
+	data = ObjData();
+	if (! objparse(path, data))
+		return false;
+	if (source.source_size > 0 && ! objbin_save(cache_path, data, source))
+		BOOST_LOG_TRIVIAL(warning) << "ObjParser: failed to save the cache " << cache_path;
+	return true;
 }
 
 template<typename T>
@@ -4,6 +4,7 @@
 #include <string>
 #include <vector>
 #include <array>
+#include <memory>
 #include <unordered_map>
 #include <istream>
 
@@ -123,13 +124,21 @@ struct MtlData
     int version;
     std::unordered_map<std::string, std::shared_ptr<ObjNewMtl>> new_mtl_unmap;
 };
+// BBS: large files are memory mapped and parsed in parallel chunks.
 extern bool objparse(const char *path, ObjData &data);
 extern bool mtlparse(const char *path, MtlData &data);
 extern bool objparse(std::istream &stream, ObjData &data);
 
-extern bool objbinsave(const char *path, const ObjData &data);
+// Store / load ObjData in a private binary format, which is memory mapped for loading.
+// If source_path is given, the size and a hash of the content of the OBJ file are stored with the data,
+// and objbinload() fails if the file at source_path does not match them.
+extern bool objbinsave(const char *path, const ObjData &data, const char *source_path = nullptr);
 
-extern bool objbinload(const char *path, ObjData &data);
+extern bool objbinload(const char *path, ObjData &data, const char *source_path = nullptr);
+
+// Load ObjData of the OBJ file at path from the binary file at cache_path if it was stored for the current file,
+// otherwise parse the OBJ file and store the binary file for the next time.
+extern bool objparse_cached(const char *path, const char *cache_path, ObjData &data);
 
 extern bool objequal(const ObjData &data1, const ObjData &data2);
 
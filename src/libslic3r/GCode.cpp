@@ -8,6 +8,7 @@
 #include "GCode/PrintExtents.hpp"
 #include "GCode/WipeTower.hpp"
 #include "ShortestPath.hpp"
+#include "PerfReport.hpp"
 #include "Print.hpp"
 #include "Utils.hpp"
 #include "ClipperUtils.hpp"
@@ -342,7 +343,7 @@ static std::vector<Vec2d> get_path_of_change_filament(const Print& print)
                     //FIXME one shall not generate the unnecessary G1 Fxxx commands, here wipe_speed is a constant inside this cycle.
                     // Is it here for the cooling markers? Or should it be outside of the cycle?
                     //gcode += gcodegen.writer().set_speed(wipe_speed * 60, "", gcodegen.enable_cooling_markers() ? ";_WIPE" : "");
-                    gcode += gcodegen.writer().extrude_to_xy(
+                    gcodegen.writer().extrude_to_xy(gcode,
                         gcodegen.point_to_gcode(line.b),
                         -dE,
                         "wipe and retract"
@@ -1204,6 +1205,7 @@ void GCode::do_export(Print* print, const char* path, GCodeProcessorResult* resu
 
     try {
         m_placeholder_parser_failed_templates.clear();
+        PerfReport::Scope perf_scope("gcode", "generate");
         this->_do_export(*print, file, thumbnail_cb);
         file.flush();
         if (file.is_error()) {
@@ -1264,7 +1266,10 @@ void GCode::do_export(Print* print, const char* path, GCodeProcessorResult* resu
         }
     }
 
-    m_processor.finalize(true);
+    {
+        PerfReport::Scope perf_scope("gcode", "processor_finalize");
+        m_processor.finalize(true);
+    }
 //    DoExport::update_print_estimated_times_stats(m_processor, print->m_print_statistics);
     DoExport::update_print_estimated_stats(m_processor, m_writer.extruders(), print->m_print_statistics);
     if (result != nullptr) {
@@ -2141,6 +2146,14 @@ void GCode::_do_export(Print& print, GCodeOutputStream &file, ThumbnailsGenerato
         if (print.config().print_sequence == PrintSequence::ByObject && !has_wipe_tower) {
             size_t             finished_objects = 0;
             const PrintObject *prev_object      = (*print_object_instance_sequential_active)->print_object;
+            if (print.low_memory_mode())
+                // Each instance exports all the layers of its object.
+                for (auto it = print_object_instance_sequential_active; it != print_object_instances_ordering.end(); ++ it) {
+                    for (const Layer *layer : (*it)->print_object->layers())
+                        ++ m_pending_layer_exports[layer];
+                    for (const SupportLayer *layer : (*it)->print_object->support_layers())
+                        ++ m_pending_layer_exports[layer];
+                }
             for (; print_object_instance_sequential_active != print_object_instances_ordering.end(); ++print_object_instance_sequential_active) {
                 const PrintObject &object = *(*print_object_instance_sequential_active)->print_object;
                 if (&object != prev_object || tool_ordering.first_extruder() != final_extruder_id) {
@@ -2216,6 +2229,9 @@ void GCode::_do_export(Print& print, GCodeOutputStream &file, ThumbnailsGenerato
             // Sort layers by Z.
             // All extrusion moves with the same top layer height are extruded uninterrupted.
             std::vector<std::pair<coordf_t, std::vector<LayerToPrint>>> layers_to_print = collect_layers_to_print(print);
+            if (print.low_memory_mode())
+                for (const std::pair<coordf_t, std::vector<LayerToPrint>> &layer : layers_to_print)
+                    this->add_pending_layer_exports(layer.second);
             // Prusa Multi-Material wipe tower.
             if (has_wipe_tower && !layers_to_print.empty()) {
                 m_wipe_tower.reset(new WipeTowerIntegration(print.config(), print.get_plate_index(), print.get_plate_origin(), *print.wipe_tower_data().priming.get(),
@@ -2395,22 +2411,38 @@ void GCode::process_layers(
 {
     // The pipeline is variable: The vase mode filter is optional.
     size_t layer_to_print_idx = 0;
-    const auto generator = tbb::make_filter<void, GCode::LayerResult>(slic3r_tbb_filtermode::serial_in_order,
-        [this, &print, &tool_ordering, &print_object_instances_ordering, &layers_to_print, &layer_to_print_idx](tbb::flow_control& fc) -> GCode::LayerResult {
-            if (layer_to_print_idx == layers_to_print.size()) {
+    // Busy time of the pipeline stages, recorded when --perf-report is enabled.
+    PerfReport::Stage perf_grouping("gcode", "group_extrusions"), perf_generator("gcode", "process_layer"),
+                      perf_spiral_vase("gcode", "spiral_vase"), perf_cooling("gcode", "cooling_buffer"), perf_output("gcode", "output");
+    const auto enumerator = tbb::make_filter<void, size_t>(slic3r_tbb_filtermode::serial_in_order,
+        [&layers_to_print, &layer_to_print_idx](tbb::flow_control& fc) -> size_t {
+            if (layer_to_print_idx == layers_to_print.size())
                 fc.stop();
-                return {};
-            } else {
-                const std::pair<coordf_t, std::vector<LayerToPrint>>& layer = layers_to_print[layer_to_print_idx++];
-                const LayerTools& layer_tools = tool_ordering.tools_for_layer(layer.first);
-                print.set_status(80, Slic3r::format(_(L("Generating G-code: layer %1%")), std::to_string(layer_to_print_idx)));
-                if (m_wipe_tower && layer_tools.has_wipe_tower)
-                    m_wipe_tower->next_layer();
-                //BBS
-                check_placeholder_parser_failed();
-                print.throw_if_canceled();
-                return this->process_layer(print, layer.second, layer_tools, &layer == &layers_to_print.back(), &print_object_instances_ordering, size_t(-1));
-            }
+            return layer_to_print_idx ++;
+        });
+    // The layer local part of the G-code generation, running in parallel with process_layer() of the preceding layers.
+    const auto grouping = tbb::make_filter<size_t, GCode::LayerExtrusions>(slic3r_tbb_filtermode::parallel,
+        [&print, &tool_ordering, &layers_to_print, &perf_grouping](size_t idx) -> GCode::LayerExtrusions {
+            PerfReport::Stage::Task perf_task(perf_grouping);
+            GCode::LayerExtrusions out { idx, {} };
+            if (! print.canceled())
+                out.by_extruder = group_extrusions_by_extruder(print, layers_to_print[idx].second, tool_ordering.tools_for_layer(layers_to_print[idx].first));
+            return out;
+        });
+    const auto generator = tbb::make_filter<GCode::LayerExtrusions, GCode::LayerResult>(slic3r_tbb_filtermode::serial_in_order,
+        [this, &print, &tool_ordering, &print_object_instances_ordering, &layers_to_print, &perf_generator](GCode::LayerExtrusions in) -> GCode::LayerResult {
+            PerfReport::Stage::Task perf_task(perf_generator);
+            const std::pair<coordf_t, std::vector<LayerToPrint>>& layer = layers_to_print[in.layer_to_print_idx];
+            const LayerTools& layer_tools = tool_ordering.tools_for_layer(layer.first);
+            print.set_status(80, Slic3r::format(_(L("Generating G-code: layer %1%")), std::to_string(in.layer_to_print_idx + 1)));
+            if (m_wipe_tower && layer_tools.has_wipe_tower)
+                m_wipe_tower->next_layer();
+            //BBS
+            check_placeholder_parser_failed();
+            print.throw_if_canceled();
+            GCode::LayerResult result = this->process_layer(print, layer.second, layer_tools, &layer == &layers_to_print.back(), &print_object_instances_ordering, in.by_extruder, size_t(-1));
+            this->release_exported_layers(layer.second);
+            return result;
         });
     if (m_spiral_vase) {
         float nozzle_diameter  = EXTRUDER_CONFIG(nozzle_diameter);
@@ -2418,24 +2450,36 @@ void GCode::process_layers(
         this->m_spiral_vase->set_max_xy_smoothing(max_xy_smoothing);
     }
     const auto spiral_mode = tbb::make_filter<GCode::LayerResult, GCode::LayerResult>(
-        slic3r_tbb_filtermode::serial_in_order, [&spiral_mode = *this->m_spiral_vase.get(), & layers_to_print](GCode::LayerResult in) -> GCode::LayerResult {
+        slic3r_tbb_filtermode::serial_in_order, [&spiral_mode = *this->m_spiral_vase.get(), & layers_to_print, &buffers = m_gcode_buffers, &perf_spiral_vase](GCode::LayerResult in) -> GCode::LayerResult {
+            PerfReport::Stage::Task perf_task(perf_spiral_vase);
             spiral_mode.enable(in.spiral_vase_enable);
             bool last_layer = in.layer_id == layers_to_print.size() - 1;
-            return { spiral_mode.process_layer(std::move(in.gcode), last_layer), in.layer_id, in.spiral_vase_enable, in.cooling_buffer_flush};
+            std::string gcode = spiral_mode.process_layer(in.gcode, last_layer);
+            buffers.release(std::move(in.gcode));
+            return { std::move(gcode), in.layer_id, in.spiral_vase_enable, in.cooling_buffer_flush};
         });
     const auto cooling = tbb::make_filter<GCode::LayerResult, std::string>(slic3r_tbb_filtermode::serial_in_order,
-        [&cooling_buffer = *this->m_cooling_buffer.get()](GCode::LayerResult in) -> std::string {
-            return cooling_buffer.process_layer(std::move(in.gcode), in.layer_id, in.cooling_buffer_flush);
+        [&cooling_buffer = *this->m_cooling_buffer.get(), &buffers = m_gcode_buffers, &perf_cooling](GCode::LayerResult in) -> std::string {
+            PerfReport::Stage::Task perf_task(perf_cooling);
+            std::string out = buffers.acquire();
+            cooling_buffer.process_layer(std::move(in.gcode), in.layer_id, in.cooling_buffer_flush, out);
+            buffers.release(std::move(in.gcode));
+            return out;
         });
     const auto output = tbb::make_filter<std::string, void>(slic3r_tbb_filtermode::serial_in_order,
-        [&output_stream](std::string s) { output_stream.write(s); }
+        [&output_stream, &buffers = m_gcode_buffers, &perf_output](std::string s) {
+            PerfReport::Stage::Task perf_task(perf_output);
+            output_stream.write(s);
+            buffers.release(std::move(s));
+        }
     );
 
     // The pipeline elements are joined using const references, thus no copying is performed.
     if (m_spiral_vase)
-        tbb::parallel_pipeline(12, generator & spiral_mode & cooling & output);
+        tbb::parallel_pipeline(12, enumerator & grouping & generator & spiral_mode & cooling & output);
     else
-        tbb::parallel_pipeline(12, generator & cooling & output);
+        tbb::parallel_pipeline(12, enumerator & grouping & generator & cooling & output);
+    m_gcode_buffers.clear();
 }
 
 // Process all layers of a single object instance (sequential mode) with a parallel pipeline:
@@ -2452,19 +2496,36 @@ void GCode::process_layers(
 {
     // The pipeline is variable: The vase mode filter is optional.
     size_t layer_to_print_idx = 0;
-    const auto generator = tbb::make_filter<void, GCode::LayerResult>(slic3r_tbb_filtermode::serial_in_order,
-        [this, &print, &tool_ordering, &layers_to_print, &layer_to_print_idx, single_object_idx, prime_extruder](tbb::flow_control& fc) -> GCode::LayerResult {
-            if (layer_to_print_idx == layers_to_print.size()) {
+    // Busy time of the pipeline stages, recorded when --perf-report is enabled.
+    PerfReport::Stage perf_grouping("gcode", "group_extrusions"), perf_generator("gcode", "process_layer"),
+                      perf_spiral_vase("gcode", "spiral_vase"), perf_cooling("gcode", "cooling_buffer"), perf_output("gcode", "output");
+    const auto enumerator = tbb::make_filter<void, size_t>(slic3r_tbb_filtermode::serial_in_order,
+        [&layers_to_print, &layer_to_print_idx](tbb::flow_control& fc) -> size_t {
+            if (layer_to_print_idx == layers_to_print.size())
                 fc.stop();
-                return {};
-            } else {
-                LayerToPrint &layer = layers_to_print[layer_to_print_idx ++];
-                print.set_status(80, Slic3r::format(_(L("Generating G-code: layer %1%")), std::to_string(layer_to_print_idx)));
-                //BBS
-                check_placeholder_parser_failed();
-                print.throw_if_canceled();
-                return this->process_layer(print, { std::move(layer) }, tool_ordering.tools_for_layer(layer.print_z()), &layer == &layers_to_print.back(), nullptr, single_object_idx, prime_extruder);
-            }
+            return layer_to_print_idx ++;
+        });
+    // The layer local part of the G-code generation, running in parallel with process_layer() of the preceding layers.
+    const auto grouping = tbb::make_filter<size_t, GCode::LayerExtrusions>(slic3r_tbb_filtermode::parallel,
+        [&print, &tool_ordering, &layers_to_print, &perf_grouping](size_t idx) -> GCode::LayerExtrusions {
+            PerfReport::Stage::Task perf_task(perf_grouping);
+            GCode::LayerExtrusions out { idx, {} };
+            const LayerToPrint &layer_to_print = layers_to_print[idx];
+            if (! print.canceled())
+                out.by_extruder = group_extrusions_by_extruder(print, { layer_to_print }, tool_ordering.tools_for_layer(layer_to_print.print_z()));
+            return out;
+        });
+    const auto generator = tbb::make_filter<GCode::LayerExtrusions, GCode::LayerResult>(slic3r_tbb_filtermode::serial_in_order,
+        [this, &print, &tool_ordering, &layers_to_print, single_object_idx, prime_extruder, &perf_generator](GCode::LayerExtrusions in) -> GCode::LayerResult {
+            PerfReport::Stage::Task perf_task(perf_generator);
+            LayerToPrint &layer = layers_to_print[in.layer_to_print_idx];
+            print.set_status(80, Slic3r::format(_(L("Generating G-code: layer %1%")), std::to_string(in.layer_to_print_idx + 1)));
+            //BBS
+            check_placeholder_parser_failed();
+            print.throw_if_canceled();
+            GCode::LayerResult result = this->process_layer(print, { layer }, tool_ordering.tools_for_layer(layer.print_z()), &layer == &layers_to_print.back(), nullptr, in.by_extruder, single_object_idx, prime_extruder);
+            this->release_exported_layers({ layer });
+            return result;
         });
     if (m_spiral_vase) {
         float nozzle_diameter  = EXTRUDER_CONFIG(nozzle_diameter);
@@ -2472,24 +2533,65 @@ void GCode::process_layers(
         this->m_spiral_vase->set_max_xy_smoothing(max_xy_smoothing);
     }
     const auto spiral_mode = tbb::make_filter<GCode::LayerResult, GCode::LayerResult>(
-        slic3r_tbb_filtermode::serial_in_order, [&spiral_mode = *this->m_spiral_vase.get(), &layers_to_print](GCode::LayerResult in) -> GCode::LayerResult {
+        slic3r_tbb_filtermode::serial_in_order, [&spiral_mode = *this->m_spiral_vase.get(), &layers_to_print, &buffers = m_gcode_buffers, &perf_spiral_vase](GCode::LayerResult in) -> GCode::LayerResult {
+            PerfReport::Stage::Task perf_task(perf_spiral_vase);
             spiral_mode.enable(in.spiral_vase_enable);
             bool last_layer = in.layer_id == layers_to_print.size() - 1;
-            return { spiral_mode.process_layer(std::move(in.gcode), last_layer), in.layer_id, in.spiral_vase_enable, in.cooling_buffer_flush };
+            std::string gcode = spiral_mode.process_layer(in.gcode, last_layer);
+            buffers.release(std::move(in.gcode));
+            return { std::move(gcode), in.layer_id, in.spiral_vase_enable, in.cooling_buffer_flush };
         });
     const auto cooling = tbb::make_filter<GCode::LayerResult, std::string>(slic3r_tbb_filtermode::serial_in_order,
-        [&cooling_buffer = *this->m_cooling_buffer.get()](GCode::LayerResult in)->std::string {
-            return cooling_buffer.process_layer(std::move(in.gcode), in.layer_id, in.cooling_buffer_flush);
+        [&cooling_buffer = *this->m_cooling_buffer.get(), &buffers = m_gcode_buffers, &perf_cooling](GCode::LayerResult in)->std::string {
+            PerfReport::Stage::Task perf_task(perf_cooling);
+            std::string out = buffers.acquire();
+            cooling_buffer.process_layer(std::move(in.gcode), in.layer_id, in.cooling_buffer_flush, out);
+            buffers.release(std::move(in.gcode));
+            return out;
         });
     const auto output = tbb::make_filter<std::string, void>(slic3r_tbb_filtermode::serial_in_order,
-        [&output_stream](std::string s) { output_stream.write(s); }
+        [&output_stream, &buffers = m_gcode_buffers, &perf_output](std::string s) {
+            PerfReport::Stage::Task perf_task(perf_output);
+            output_stream.write(s);
+            buffers.release(std::move(s));
+        }
     );
 
     // The pipeline elements are joined using const references, thus no copying is performed.
     if (m_spiral_vase)
-        tbb::parallel_pipeline(12, generator & spiral_mode & cooling & output);
+        tbb::parallel_pipeline(12, enumerator & grouping & generator & spiral_mode & cooling & output);
     else
-        tbb::parallel_pipeline(12, generator & cooling & output);
+        tbb::parallel_pipeline(12, enumerator & grouping & generator & cooling & output);
+    m_gcode_buffers.clear();
+}
+
+void GCode::add_pending_layer_exports(const std::vector<LayerToPrint> &layers)
+{
+    for (const LayerToPrint &layer_to_print : layers) {
+        if (layer_to_print.object_layer)
+            ++ m_pending_layer_exports[layer_to_print.object_layer];
+        if (layer_to_print.support_layer)
+            ++ m_pending_layer_exports[layer_to_print.support_layer];
+    }
+}
+
+void GCode::release_exported_layers(const std::vector<LayerToPrint> &layers)
+{
+    if (m_pending_layer_exports.empty())
+        return;
+    auto release = [this](const Layer *layer) {
+        if (auto it = m_pending_layer_exports.find(layer); it != m_pending_layer_exports.end() && -- it->second == 0) {
+            // The layers belong to the Print, which handed itself over to do_export() from the non-const Print::export_gcode().
+            const_cast<Layer*>(layer)->release_exported_data();
+            m_pending_layer_exports.erase(it);
+        }
+    };
+    for (const LayerToPrint &layer_to_print : layers) {
+        if (layer_to_print.object_layer)
+            release(layer_to_print.object_layer);
+        if (layer_to_print.support_layer)
+            release(layer_to_print.support_layer);
+    }
 }
 
 std::string GCode::placeholder_parser_process(const std::string &name, const std::string &templ, unsigned int current_extruder_id, const DynamicConfig *config_override)
@@ -2938,6 +3040,241 @@ inline std::string get_instance_name(const PrintObject* object, const PrintInsta
     return get_instance_name(object, inst.id);
 }
 
+std::vector<size_t> GCode::assign_islands(const Layer &layer)
+{
+    size_t n_slices = layer.lslices.size();
+    const std::vector<BoundingBox> &layer_surface_bboxes = layer.lslices_bboxes;
+    // Traverse the slices in an increasing order of bounding box size, so that the islands inside another islands are tested first,
+    // so we can just test a point inside ExPolygon::contour and we may skip testing the holes.
+    std::vector<size_t> slices_test_order;
+    slices_test_order.reserve(n_slices);
+    for (size_t i = 0; i < n_slices; ++ i)
+        slices_test_order.emplace_back(i);
+    std::sort(slices_test_order.begin(), slices_test_order.end(), [&layer_surface_bboxes](size_t i, size_t j) {
+        const Vec2d s1 = layer_surface_bboxes[i].size().cast<double>();
+        const Vec2d s2 = layer_surface_bboxes[j].size().cast<double>();
+        return s1.x() * s1.y() < s2.x() * s2.y();
+    });
+    auto point_inside_surface = [&layer, &layer_surface_bboxes](const size_t i, const Point &point) {
+        const BoundingBox &bbox = layer_surface_bboxes[i];
+        return point(0) >= bbox.min(0) && point(0) < bbox.max(0) &&
+               point(1) >= bbox.min(1) && point(1) < bbox.max(1) &&
+               layer.lslices[i].contour.contains(point);
+    };
+
+    std::vector<size_t> out;
+    for (const LayerRegion *layerm : layer.regions()) {
+        if (layerm == nullptr)
+            continue;
+        for (const ExtrusionEntitiesPtr *entities : { &layerm->fills.entities, &layerm->perimeters.entities })
+            for (const ExtrusionEntity *ee : *entities) {
+                const auto *extrusions = static_cast<const ExtrusionEntityCollection*>(ee);
+                // Not inside any slice, also for an empty collection, which is skipped by process_layer().
+                size_t island_idx = n_slices;
+                if (! extrusions->entities.empty()) {
+                    const Point first_point = extrusions->first_point();
+                    for (size_t i : slices_test_order)
+                        if (point_inside_surface(i, first_point)) {
+                            island_idx = i;
+                            break;
+                        }
+                }
+                out.emplace_back(island_idx);
+            }
+    }
+    return out;
+}
+
+std::map<unsigned int, std::vector<GCode::ObjectByExtruder>> GCode::group_extrusions_by_extruder(
+    const Print                     &print,
+    const std::vector<LayerToPrint> &layers,
+    const LayerTools                &layer_tools)
+{
+    std::map<unsigned int, std::vector<ObjectByExtruder>> by_extruder;
+    if (layer_tools.extruders.empty())
+        return by_extruder;
+    unsigned int first_extruder_id = layer_tools.extruders.front();
+    bool is_anything_overridden = const_cast<LayerTools&>(layer_tools).wiping_extrusions().is_anything_overridden();
+    for (const LayerToPrint &layer_to_print : layers) {
+        if (layer_to_print.support_layer != nullptr) {
+            const SupportLayer &support_layer = *layer_to_print.support_layer;
+            const PrintObject& object = *layer_to_print.original_object;
+            if (! support_layer.support_fills.entities.empty()) {
+                ExtrusionRole   role               = support_layer.support_fills.role();
+                bool            has_support        = role == erMixed || role == erSupportMaterial || role == erSupportTransition;
+                bool            has_interface      = role == erMixed || role == erSupportMaterialInterface;
+                // Extruder ID of the support base. -1 if "don't care".
+                unsigned int    support_extruder   = object.config().support_filament.value - 1;
+                // Shall the support be printed with the active extruder, preferably with non-soluble, to avoid tool changes?
+                bool            support_dontcare   = object.config().support_filament.value == 0;
+                // Extruder ID of the support interface. -1 if "don't care".
+                unsigned int    interface_extruder = object.config().support_interface_filament.value - 1;
+                // Shall the support interface be printed with the active extruder, preferably with non-soluble, to avoid tool changes?
+                bool            interface_dontcare = object.config().support_interface_filament.value == 0;
+
+                // BBS: apply wiping overridden extruders
+                WipingExtrusions& wiping_extrusions = const_cast<LayerTools&>(layer_tools).wiping_extrusions();
+                if (support_dontcare) {
+                    int extruder_override = wiping_extrusions.get_support_extruder_overrides(&object);
+                    if (extruder_override >= 0) {
+                        support_extruder = extruder_override;
+                        support_dontcare = false;
+                    }
+                }
+
+                if (interface_dontcare) {
+                    int extruder_override = wiping_extrusions.get_support_interface_extruder_overrides(&object);
+                    if (extruder_override >= 0) {
+                        interface_extruder = extruder_override;
+                        interface_dontcare = false;
+                    }
+                }
+
+                // BBS: try to print support base with a filament other than interface filament
+                if (support_dontcare && !interface_dontcare) {
+                    unsigned int dontcare_extruder = first_extruder_id;
+                    for (unsigned int extruder_id : layer_tools.extruders) {
+                        if (print.config().filament_soluble.get_at(extruder_id))
+                            continue;
+
+                        //BBS: now we don't consider interface filament used in other object
+                        if (extruder_id == interface_extruder)
+                            continue;
+
+                        dontcare_extruder = extruder_id;
+                        break;
+                    }
+                #if 0
+                    //BBS: not found a suitable extruder in current layer ,dontcare_extruider==first_extruder_id==interface_extruder
+                    if (dontcare_extruder == interface_extruder && (object.config().support_interface_not_for_body && object.config().support_interface_filament.value!=0)) {
+                        // BBS : get a suitable extruder from other layer
+                        auto all_extruders = print.extruders();
+                        dontcare_extruder = get_next_extruder(dontcare_extruder, all_extruders);
+                    }
+                #endif
+
+                    if (support_dontcare)
+                        support_extruder = dontcare_extruder;
+                }
+                else if (support_dontcare || interface_dontcare) {
+                    // Some support will be printed with "don't care" material, preferably non-soluble.
+                    // Is the current extruder assigned a soluble filament?
+                    unsigned int dontcare_extruder = first_extruder_id;
+                    if (print.config().filament_soluble.get_at(dontcare_extruder)) {
+                        // The last extruder printed on the previous layer extrudes soluble filament.
+                        // Try to find a non-soluble extruder on the same layer.
+                        for (unsigned int extruder_id : layer_tools.extruders)
+                            if (! print.config().filament_soluble.get_at(extruder_id)) {
+                                dontcare_extruder = extruder_id;
+                                break;
+                            }
+                    }
+                    if (support_dontcare)
+                        support_extruder = dontcare_extruder;
+                    if (interface_dontcare)
+                        interface_extruder = dontcare_extruder;
+                }
+                // Both the support and the support interface are printed with the same extruder, therefore
+                // the interface may be interleaved with the support base.
+                bool single_extruder = ! has_support || support_extruder == interface_extruder;
+                // Assign an extruder to the base.
+                ObjectByExtruder &obj = object_by_extruder(by_extruder, has_support ? support_extruder : interface_extruder, &layer_to_print - layers.data(), layers.size());
+                obj.support = &support_layer.support_fills;
+                obj.support_extrusion_role = single_extruder ? erMixed : erSupportMaterial;
+                if (! single_extruder && has_interface) {
+                    ObjectByExtruder &obj_interface = object_by_extruder(by_extruder, interface_extruder, &layer_to_print - layers.data(), layers.size());
+                    obj_interface.support = &support_layer.support_fills;
+                    obj_interface.support_extrusion_role = erSupportMaterialInterface;
+                }
+            }
+        }
+
+        if (layer_to_print.object_layer != nullptr) {
+            const Layer &layer = *layer_to_print.object_layer;
+            // We now define a strategy for building perimeters and fills. The separation
+            // between regions doesn't matter in terms of printing order, as we follow
+            // another logic instead:
+            // - we group all extrusions by extruder so that we minimize toolchanges
+            // - we start from the last used extruder
+            // - for each extruder, we group extrusions by island
+            // - for each island, we extrude perimeters first, unless user set the infill_first
+            //   option
+            // (Still, we have to keep track of regions because we need to apply their config)
+            size_t n_slices = layer.lslices.size();
+            // Islands of the extrusion collections in the order the collections are traversed here.
+            const std::vector<size_t>  entity_islands = assign_islands(layer);
+            size_t                     entity_idx     = 0;
+
+            for (size_t region_id = 0; region_id < layer.regions().size(); ++ region_id) {
+                const LayerRegion *layerm = layer.regions()[region_id];
+                if (layerm == nullptr)
+                    continue;
+                // PrintObjects own the PrintRegions, thus the pointer to PrintRegion would be unique to a PrintObject, they would not
+                // identify the content of PrintRegion accross the whole print uniquely. Translate to a Print specific PrintRegion.
+                const PrintRegion &region = print.get_print_region(layerm->region().print_region_id());
+
+                // Now we must process perimeters and infills and create islands of extrusions in by_region std::map.
+                // It is also necessary to save which extrusions are part of MM wiping and which are not.
+                // The process is almost the same for perimeters and infills - we will do it in a cycle that repeats twice:
+                std::vector<unsigned int> printing_extruders;
+                for (const ObjectByExtruder::Island::Region::Type entity_type : { ObjectByExtruder::Island::Region::INFILL, ObjectByExtruder::Island::Region::PERIMETERS }) {
+                    for (const ExtrusionEntity *ee : (entity_type == ObjectByExtruder::Island::Region::INFILL) ? layerm->fills.entities : layerm->perimeters.entities) {
+                        // extrusions represents infill or perimeter extrusions of a single island.
+                        assert(dynamic_cast<const ExtrusionEntityCollection*>(ee) != nullptr);
+                        const auto *extrusions = static_cast<const ExtrusionEntityCollection*>(ee);
+                        assert(entity_idx < entity_islands.size());
+                        const size_t island_idx = entity_islands[entity_idx ++];
+                        if (extrusions->entities.empty()) // This shouldn't happen but first_point() would fail.
+                            continue;
+
+                        // This extrusion is part of certain Region, which tells us which extruder should be used for it:
+                        int correct_extruder_id = layer_tools.extruder(*extrusions, region);
+
+                        // Let's recover vector of extruder overrides:
+                        const WipingExtrusions::ExtruderPerCopy *entity_overrides = nullptr;
+                        if (! layer_tools.has_extruder(correct_extruder_id)) {
+                            // this entity is not overridden, but its extruder is not in layer_tools - we'll print it
+                            // by last extruder on this layer (could happen e.g. when a wiping object is taller than others - dontcare extruders are eradicated from layer_tools)
+                            correct_extruder_id = layer_tools.extruders.back();
+                        }
+                        printing_extruders.clear();
+                        if (is_anything_overridden) {
+                            entity_overrides = const_cast<LayerTools&>(layer_tools).wiping_extrusions().get_extruder_overrides(extrusions, layer_to_print.original_object, correct_extruder_id, layer_to_print.object()->instances().size());
+                            if (entity_overrides == nullptr) {
+                                printing_extruders.emplace_back(correct_extruder_id);
+                            } else {
+                                printing_extruders.reserve(entity_overrides->size());
+                                for (int extruder : *entity_overrides)
+                                    printing_extruders.emplace_back(extruder >= 0 ?
+                                        // at least one copy is overridden to use this extruder
+                                        extruder :
+                                        // at least one copy would normally be printed with this extruder (see get_extruder_overrides function for explanation)
+                                        static_cast<unsigned int>(- extruder - 1));
+                                Slic3r::sort_remove_duplicates(printing_extruders);
+                            }
+                        } else
+                            printing_extruders.emplace_back(correct_extruder_id);
+
+                        // Now we must add this extrusion into the by_extruder map, once for each extruder that will print it:
+                        for (unsigned int extruder : printing_extruders)
+                        {
+                            std::vector<ObjectByExtruder::Island> &islands = object_islands_by_extruder(
+                                by_extruder,
+                                extruder,
+                                &layer_to_print - layers.data(),
+                                layers.size(), n_slices+1);
+                            if (islands[island_idx].by_region.empty())
+                                islands[island_idx].by_region.assign(print.num_print_regions(), ObjectByExtruder::Island::Region());
+                            islands[island_idx].by_region[region.print_region_id()].append(entity_type, extrusions, entity_overrides);
+                        }
+                    }
+                }
+            } // for regions
+        }
+    } // for objects
+    return by_extruder;
+}
+
 // In sequential mode, process_layer is called once per each object and its copy,
 // therefore layers will contain a single entry and single_object_instance_idx will point to the copy of the object.
 // In non-sequential mode, process_layer is called per each print_z height with all object and support layers accumulated.
@@ -2951,6 +3288,8 @@ GCode::LayerResult GCode::process_layer(
     const bool                               last_layer,
     // Pairs of PrintObject index and its instance index.
     const std::vector<const PrintInstance*> *ordering,
+    // Output of group_extrusions_by_extruder() for layers.
+    std::map<unsigned int, std::vector<ObjectByExtruder>> &by_extruder,
     // If set to size_t(-1), then print all copies of all objects.
     // Otherwise print a single copy of a single object.
     const size_t                     		 single_object_instance_idx,
@@ -3017,7 +3356,8 @@ GCode::LayerResult GCode::process_layer(
         m_enable_loop_clipping = !enable;
     }
 
-    std::string gcode;
+    // Append into a buffer released by one of the previous layers, see process_layers().
+    std::string gcode = m_gcode_buffers.acquire();
     assert(is_decimal_separator_point()); // for the sprintfs
 
     // add tag for processor
@@ -3211,209 +3551,9 @@ GCode::LayerResult GCode::process_layer(
         return next_extruder;
     };
 
-    // Group extrusions by an extruder, then by an object, an island and a region.
-    std::map<unsigned int, std::vector<ObjectByExtruder>> by_extruder;
+    // The extrusions were already grouped by an extruder, then by an object, an island and a region
+    // by group_extrusions_by_extruder() in the parallel stage of process_layers().
     bool is_anything_overridden = const_cast<LayerTools&>(layer_tools).wiping_extrusions().is_anything_overridden();
-    for (const LayerToPrint &layer_to_print : layers) {
-        if (layer_to_print.support_layer != nullptr) {
-            const SupportLayer &support_layer = *layer_to_print.support_layer;
-            const PrintObject& object = *layer_to_print.original_object;
-            if (! support_layer.support_fills.entities.empty()) {
-                ExtrusionRole   role               = support_layer.support_fills.role();
-                bool            has_support        = role == erMixed || role == erSupportMaterial || role == erSupportTransition;
-                bool            has_interface      = role == erMixed || role == erSupportMaterialInterface;
-                // Extruder ID of the support base. -1 if "don't care".
-                unsigned int    support_extruder   = object.config().support_filament.value - 1;
-                // Shall the support be printed with the active extruder, preferably with non-soluble, to avoid tool changes?
-                bool            support_dontcare   = object.config().support_filament.value == 0;
-                // Extruder ID of the support interface. -1 if "don't care".
-                unsigned int    interface_extruder = object.config().support_interface_filament.value - 1;
-                // Shall the support interface be printed with the active extruder, preferably with non-soluble, to avoid tool changes?
-                bool            interface_dontcare = object.config().support_interface_filament.value == 0;
-
-                // BBS: apply wiping overridden extruders
-                WipingExtrusions& wiping_extrusions = const_cast<LayerTools&>(layer_tools).wiping_extrusions();
-                if (support_dontcare) {
-                    int extruder_override = wiping_extrusions.get_support_extruder_overrides(&object);
-                    if (extruder_override >= 0) {
-                        support_extruder = extruder_override;
-                        support_dontcare = false;
-                    }
-                }
-
-                if (interface_dontcare) {
-                    int extruder_override = wiping_extrusions.get_support_interface_extruder_overrides(&object);
-                    if (extruder_override >= 0) {
-                        interface_extruder = extruder_override;
-                        interface_dontcare = false;
-                    }
-                }
-
-                // BBS: try to print support base with a filament other than interface filament
-                if (support_dontcare && !interface_dontcare) {
-                    unsigned int dontcare_extruder = first_extruder_id;
-                    for (unsigned int extruder_id : layer_tools.extruders) {
-                        if (print.config().filament_soluble.get_at(extruder_id))
-                            continue;
-
-                        //BBS: now we don't consider interface filament used in other object
-                        if (extruder_id == interface_extruder)
-                            continue;
-
-                        dontcare_extruder = extruder_id;
-                        break;
-                    }
-                #if 0
-                    //BBS: not found a suitable extruder in current layer ,dontcare_extruider==first_extruder_id==interface_extruder
-                    if (dontcare_extruder == interface_extruder && (object.config().support_interface_not_for_body && object.config().support_interface_filament.value!=0)) {
-                        // BBS : get a suitable extruder from other layer
-                        auto all_extruders = print.extruders();
-                        dontcare_extruder = get_next_extruder(dontcare_extruder, all_extruders);
-                    }
-                #endif
-
-                    if (support_dontcare)
-                        support_extruder = dontcare_extruder;
-                }
-                else if (support_dontcare || interface_dontcare) {
-                    // Some support will be printed with "don't care" material, preferably non-soluble.
-                    // Is the current extruder assigned a soluble filament?
-                    unsigned int dontcare_extruder = first_extruder_id;
-                    if (print.config().filament_soluble.get_at(dontcare_extruder)) {
-                        // The last extruder printed on the previous layer extrudes soluble filament.
-                        // Try to find a non-soluble extruder on the same layer.
-                        for (unsigned int extruder_id : layer_tools.extruders)
-                            if (! print.config().filament_soluble.get_at(extruder_id)) {
-                                dontcare_extruder = extruder_id;
-                                break;
-                            }
-                    }
-                    if (support_dontcare)
-                        support_extruder = dontcare_extruder;
-                    if (interface_dontcare)
-                        interface_extruder = dontcare_extruder;
-                }
-                // Both the support and the support interface are printed with the same extruder, therefore
-                // the interface may be interleaved with the support base.
-                bool single_extruder = ! has_support || support_extruder == interface_extruder;
-                // Assign an extruder to the base.
-                ObjectByExtruder &obj = object_by_extruder(by_extruder, has_support ? support_extruder : interface_extruder, &layer_to_print - layers.data(), layers.size());
-                obj.support = &support_layer.support_fills;
-                obj.support_extrusion_role = single_extruder ? erMixed : erSupportMaterial;
-                if (! single_extruder && has_interface) {
-                    ObjectByExtruder &obj_interface = object_by_extruder(by_extruder, interface_extruder, &layer_to_print - layers.data(), layers.size());
-                    obj_interface.support = &support_layer.support_fills;
-                    obj_interface.support_extrusion_role = erSupportMaterialInterface;
-                }
-            }
-        }
-
-        if (layer_to_print.object_layer != nullptr) {
-            const Layer &layer = *layer_to_print.object_layer;
-            // We now define a strategy for building perimeters and fills. The separation
-            // between regions doesn't matter in terms of printing order, as we follow
-            // another logic instead:
-            // - we group all extrusions by extruder so that we minimize toolchanges
-            // - we start from the last used extruder
-            // - for each extruder, we group extrusions by island
-            // - for each island, we extrude perimeters first, unless user set the infill_first
-            //   option
-            // (Still, we have to keep track of regions because we need to apply their config)
-            size_t n_slices = layer.lslices.size();
-            const std::vector<BoundingBox> &layer_surface_bboxes = layer.lslices_bboxes;
-            // Traverse the slices in an increasing order of bounding box size, so that the islands inside another islands are tested first,
-            // so we can just test a point inside ExPolygon::contour and we may skip testing the holes.
-            std::vector<size_t> slices_test_order;
-            slices_test_order.reserve(n_slices);
-            for (size_t i = 0; i < n_slices; ++ i)
-                slices_test_order.emplace_back(i);
-            std::sort(slices_test_order.begin(), slices_test_order.end(), [&layer_surface_bboxes](size_t i, size_t j) {
-                const Vec2d s1 = layer_surface_bboxes[i].size().cast<double>();
-                const Vec2d s2 = layer_surface_bboxes[j].size().cast<double>();
-                return s1.x() * s1.y() < s2.x() * s2.y();
-            });
-            auto point_inside_surface = [&layer, &layer_surface_bboxes](const size_t i, const Point &point) {
-                const BoundingBox &bbox = layer_surface_bboxes[i];
-                return point(0) >= bbox.min(0) && point(0) < bbox.max(0) &&
-                       point(1) >= bbox.min(1) && point(1) < bbox.max(1) &&
-                       layer.lslices[i].contour.contains(point);
-            };
-
-            for (size_t region_id = 0; region_id < layer.regions().size(); ++ region_id) {
-                const LayerRegion *layerm = layer.regions()[region_id];
-                if (layerm == nullptr)
-                    continue;
-                // PrintObjects own the PrintRegions, thus the pointer to PrintRegion would be unique to a PrintObject, they would not
-                // identify the content of PrintRegion accross the whole print uniquely. Translate to a Print specific PrintRegion.
-                const PrintRegion &region = print.get_print_region(layerm->region().print_region_id());
-
-                // Now we must process perimeters and infills and create islands of extrusions in by_region std::map.
-                // It is also necessary to save which extrusions are part of MM wiping and which are not.
-                // The process is almost the same for perimeters and infills - we will do it in a cycle that repeats twice:
-                std::vector<unsigned int> printing_extruders;
-                for (const ObjectByExtruder::Island::Region::Type entity_type : { ObjectByExtruder::Island::Region::INFILL, ObjectByExtruder::Island::Region::PERIMETERS }) {
-                    for (const ExtrusionEntity *ee : (entity_type == ObjectByExtruder::Island::Region::INFILL) ? layerm->fills.entities : layerm->perimeters.entities) {
-                        // extrusions represents infill or perimeter extrusions of a single island.
-                        assert(dynamic_cast<const ExtrusionEntityCollection*>(ee) != nullptr);
-                        const auto *extrusions = static_cast<const ExtrusionEntityCollection*>(ee);
-                        if (extrusions->entities.empty()) // This shouldn't happen but first_point() would fail.
-                            continue;
-
-                        // This extrusion is part of certain Region, which tells us which extruder should be used for it:
-                        int correct_extruder_id = layer_tools.extruder(*extrusions, region);
-
-                        // Let's recover vector of extruder overrides:
-                        const WipingExtrusions::ExtruderPerCopy *entity_overrides = nullptr;
-                        if (! layer_tools.has_extruder(correct_extruder_id)) {
-                            // this entity is not overridden, but its extruder is not in layer_tools - we'll print it
-                            // by last extruder on this layer (could happen e.g. when a wiping object is taller than others - dontcare extruders are eradicated from layer_tools)
-                            correct_extruder_id = layer_tools.extruders.back();
-                        }
-                        printing_extruders.clear();
-                        if (is_anything_overridden) {
-                            entity_overrides = const_cast<LayerTools&>(layer_tools).wiping_extrusions().get_extruder_overrides(extrusions, layer_to_print.original_object, correct_extruder_id, layer_to_print.object()->instances().size());
-                            if (entity_overrides == nullptr) {
-                                printing_extruders.emplace_back(correct_extruder_id);
-                            } else {
-                                printing_extruders.reserve(entity_overrides->size());
-                                for (int extruder : *entity_overrides)
-                                    printing_extruders.emplace_back(extruder >= 0 ?
-                                        // at least one copy is overridden to use this extruder
-                                        extruder :
-                                        // at least one copy would normally be printed with this extruder (see get_extruder_overrides function for explanation)
-                                        static_cast<unsigned int>(- extruder - 1));
-                                Slic3r::sort_remove_duplicates(printing_extruders);
-                            }
-                        } else
-                            printing_extruders.emplace_back(correct_extruder_id);
-
-                        // Now we must add this extrusion into the by_extruder map, once for each extruder that will print it:
-                        for (unsigned int extruder : printing_extruders)
-                        {
-                            std::vector<ObjectByExtruder::Island> &islands = object_islands_by_extruder(
-                                by_extruder,
-                                extruder,
-                                &layer_to_print - layers.data(),
-                                layers.size(), n_slices+1);
-                            for (size_t i = 0; i <= n_slices; ++ i) {
-                                bool   last = i == n_slices;
-                                size_t island_idx = last ? n_slices : slices_test_order[i];
-                                if (// extrusions->first_point does not fit inside any slice
-                                    last ||
-                                    // extrusions->first_point fits inside ith slice
-                                    point_inside_surface(island_idx, extrusions->first_point())) {
-                                    if (islands[island_idx].by_region.empty())
-                                        islands[island_idx].by_region.assign(print.num_print_regions(), ObjectByExtruder::Island::Region());
-                                    islands[island_idx].by_region[region.print_region_id()].append(entity_type, extrusions, entity_overrides);
-                                    break;
-                                }
-                            }
-                        }
-                    }
-                }
-            } // for regions
-        }
-    } // for objects
 
     if (m_wipe_tower)
         m_wipe_tower->set_is_first_print(true);
@@ -4661,7 +4801,7 @@ std::string GCode::_extrude(const ExtrusionPath &path, std::string description,
                 path_length += line_length;
 
                 if (sloped == nullptr) {
-                    gcode += m_writer.extrude_to_xy(
+                    m_writer.extrude_to_xy(gcode,
                         this->point_to_gcode(line.b),
                         e_per_mm * line_length,
                         comment);
@@ -4675,7 +4815,7 @@ std::string GCode::_extrude(const ExtrusionPath &path, std::string description,
                     Vec3d dest3d(dest2d(0), dest2d(1), get_sloped_z(z_ratio));
                     //BBS: todo, should use small e at start to get good seam
                     double slope_e = dE * e_ratio;
-                    gcode += m_writer.extrude_to_xyz(dest3d, slope_e);
+                    m_writer.extrude_to_xyz(gcode, dest3d, slope_e);
                 }
             }
         } else {
@@ -4693,7 +4833,7 @@ std::string GCode::_extrude(const ExtrusionPath &path, std::string description,
                         if (line_length < EPSILON)
                             continue;
                         path_length += line_length;
-                        gcode += m_writer.extrude_to_xy(
+                        m_writer.extrude_to_xy(gcode,
                             this->point_to_gcode(line.b),
                             e_per_mm * line_length,
                             comment, path.is_force_no_extrusion());
@@ -4709,7 +4849,7 @@ std::string GCode::_extrude(const ExtrusionPath &path, std::string description,
                         continue;
                     const Vec2d center_offset = this->point_to_gcode(arc.center) - this->point_to_gcode(arc.start_point);
                     path_length += arc_length;
-                    gcode += m_writer.extrude_arc_to_xy(
+                    m_writer.extrude_arc_to_xy(gcode,
                             this->point_to_gcode(arc.end_point),
                             center_offset,
                             e_per_mm * arc_length,
@@ -4851,7 +4991,7 @@ std::string GCode::travel_to(const Point &point, ExtrusionRole role, std::string
         if (m_spiral_vase) {
             // No lazy z lift for spiral vase mode
             for (size_t i = 1; i < travel.size(); ++i)
-                gcode += m_writer.travel_to_xy(this->point_to_gcode(travel.points[i]), comment);
+                m_writer.travel_to_xy(gcode, this->point_to_gcode(travel.points[i]), comment);
         } else {
             if (travel.size() == 2) {
                 // No extra movements emitted by avoid_crossing_perimeters, simply move to the end point with z change
@@ -4874,7 +5014,7 @@ std::string GCode::travel_to(const Point &point, ExtrusionRole role, std::string
                         gcode += m_writer.travel_to_xyz(dest3d, comment);
                     } else {
                         // For all points in between, no z change
-                        gcode += m_writer.travel_to_xy(this->point_to_gcode(travel.points[i]), comment );
+                        m_writer.travel_to_xy(gcode, this->point_to_gcode(travel.points[i]), comment);
                     }
                 }
             }
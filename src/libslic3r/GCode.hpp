@@ -25,6 +25,7 @@
 #include <map>
 #include <set>
 #include <string>
+#include <unordered_map>
 
 #ifdef HAS_PRESSURE_EQUALIZER
 #include "GCode/PressureEqualizer.hpp"
@@ -294,6 +295,12 @@ private:
         // Should the cooling buffer content be flushed at the end of this layer?
         bool        cooling_buffer_flush { false };
     };
+    // Island of each infill and perimeter collection of an object layer: index into Layer::lslices,
+    // or Layer::lslices.size() if the collection does not start inside any island.
+    // Ordered as the collections of LayerRegion::fills followed by LayerRegion::perimeters, region by region.
+    // Depends on the layer geometry only, called by group_extrusions_by_extruder().
+    static std::vector<size_t> assign_islands(const Layer &layer);
+    struct ObjectByExtruder;
     LayerResult process_layer(
         const Print                     &print,
         // Set of object & print layers of the same PrintObject and with the same print_z.
@@ -302,6 +309,8 @@ private:
         const bool                       last_layer,
 		// Pairs of PrintObject index and its instance index.
 		const std::vector<const PrintInstance*> *ordering,
+        // Output of group_extrusions_by_extruder() for layers.
+        std::map<unsigned int, std::vector<ObjectByExtruder>> &by_extruder,
         // If set to size_t(-1), then print all copies of all objects.
         // Otherwise print a single copy of a single object.
         const size_t                     single_object_idx = size_t(-1),
@@ -327,6 +336,10 @@ private:
         GCodeOutputStream                       &output_stream,
         // BBS
         const bool                               prime_extruder = false);
+    //BBS: low memory mode (Print::low_memory_mode()), count the exports of each layer, then release the layers with
+    // their last export generated. release_exported_layers() is called by the serial stage of process_layers() after process_layer().
+    void add_pending_layer_exports(const std::vector<LayerToPrint> &layers);
+    void release_exported_layers(const std::vector<LayerToPrint> &layers);
 
     //BBS
     void check_placeholder_parser_failed();
@@ -382,6 +395,15 @@ private:
         std::vector<Island>         islands;
     };
 
+    // Groups the extrusions of layers with the same print_z by an extruder, then by an object, an island and a region.
+    // Called by a parallel stage of process_layers(), process_layer() then emits the groups.
+    static std::map<unsigned int, std::vector<ObjectByExtruder>> group_extrusions_by_extruder(
+        const Print &print, const std::vector<LayerToPrint> &layers, const LayerTools &layer_tools);
+    struct LayerExtrusions {
+        size_t                                                  layer_to_print_idx;
+        std::map<unsigned int, std::vector<ObjectByExtruder>>   by_extruder;
+    };
+
 	struct InstanceToPrint
 	{
 		InstanceToPrint(ObjectByExtruder &object_by_extruder, size_t layer_id, const PrintObject &print_object, size_t instance_id, size_t label_object_id) :
@@ -476,6 +498,11 @@ private:
 
     std::unique_ptr<CoolingBuffer>      m_cooling_buffer;
     std::unique_ptr<SpiralVase>         m_spiral_vase;
+    // Layer G-code buffers recycled between the stages of the process_layers() pipeline.
+    GCodeBufferPool                     m_gcode_buffers;
+    // Low memory mode: number of the exports of an object or support layer not generated yet.
+    // A layer is exported once per instance in sequential mode and once per PrintObject sharing it.
+    std::unordered_map<const Layer*, size_t> m_pending_layer_exports;
 #ifdef HAS_PRESSURE_EQUALIZER
     std::unique_ptr<PressureEqualizer>  m_pressure_equalizer;
 #endif /* HAS_PRESSURE_EQUALIZER */
@@ -1,8 +1,8 @@
 #include "ConflictChecker.hpp"
 
 #include <tbb/parallel_for.h>
-#include <tbb/concurrent_vector.h>
 
+#include <algorithm>
 #include <map>
 #include <functional>
 #include <atomic>
@@ -11,7 +11,6 @@ namespace Slic3r {
 
 namespace RasterizationImpl {
 using IndexPair = std::pair<int64_t, int64_t>;
-using Grids     = std::vector<IndexPair>;
 
 inline constexpr int64_t RasteXDistance = scale_(1);
 inline constexpr int64_t RasteYDistance = scale_(1);
@@ -25,9 +24,13 @@ inline IndexPair point_map_grid_index(const Point &pt, int64_t xdist, int64_t yd
 
 inline bool nearly_equal(const Point &p1, const Point &p2) { return std::abs(p1.x() - p2.x()) < SCALED_EPSILON && std::abs(p1.y() - p2.y()) < SCALED_EPSILON; }
 
-inline Grids line_rasterization(const Line &line, int64_t xdist = RasteXDistance, int64_t ydist = RasteYDistance)
+// Key of a grid cell in the flat cell list used by ConflictChecker::find_inter_of_lines().
+inline uint64_t grid_key(const IndexPair &index) { return (uint64_t(uint32_t(int32_t(index.first))) << 32) | uint64_t(uint32_t(int32_t(index.second))); }
+
+// Calls visitor for each grid cell crossed by the line.
+template<typename Visitor>
+inline void line_rasterization(const Line &line, Visitor &&visitor, int64_t xdist = RasteXDistance, int64_t ydist = RasteYDistance)
 {
-    Grids     res;
     Point     rayStart     = line.a;
     Point     rayEnd       = line.b;
     IndexPair currentVoxel = point_map_grid_index(rayStart, xdist, ydist);
@@ -51,7 +54,8 @@ inline Grids line_rasterization(const Line &line, int64_t xdist = RasteXDistance
     double tDeltaX = ray.x() != 0 ? static_cast<double>(xdist) / ray.x() * stepX : DBL_MAX;
     double tDeltaY = ray.y() != 0 ? static_cast<double>(ydist) / ray.y() * stepY : DBL_MAX;
 
-    res.push_back(currentVoxel);
+    size_t cnt = 1;
+    visitor(currentVoxel);
 
     double tx = tMaxX;
     double ty = tMaxY;
@@ -60,14 +64,14 @@ inline Grids line_rasterization(const Line &line, int64_t xdist = RasteXDistance
         if (lastVoxel.first == currentVoxel.first) {
             for (int64_t i = currentVoxel.second; i != lastVoxel.second; i += (int64_t) stepY) {
                 currentVoxel.second += (int64_t) stepY;
-                res.push_back(currentVoxel);
+                visitor(currentVoxel);
             }
             break;
         }
         if (lastVoxel.second == currentVoxel.second) {
             for (int64_t i = currentVoxel.first; i != lastVoxel.first; i += (int64_t) stepX) {
                 currentVoxel.first += (int64_t) stepX;
-                res.push_back(currentVoxel);
+                visitor(currentVoxel);
             }
             break;
         }
@@ -79,13 +83,12 @@ inline Grids line_rasterization(const Line &line, int64_t xdist = RasteXDistance
             currentVoxel.second += (int64_t) stepY;
             ty += tDeltaY;
         }
-        res.push_back(currentVoxel);
-        if (res.size() >= 100000) { // bug
+        visitor(currentVoxel);
+        if (++ cnt >= 100000) { // bug
             assert(0);
+            break;
         }
     }
-
-    return res;
 }
 } // namespace RasterizationImpl
 
@@ -128,16 +131,52 @@ float LinesBucketQueue::getCurrBottomZ()
     return layerBottomZ;
 }
 
-LineWithIDs LinesBucketQueue::getCurLines() const
+LinesBucketRanges LinesBucketQueue::getCurRanges() const
 {
-    LineWithIDs lines;
+    LinesBucketRanges ranges;
     for (const LinesBucket &bucket : line_buckets) {
         if (bucket.valid()) {
-            LineWithIDs tmpLines = bucket.curLines();
-            lines.insert(lines.end(), tmpLines.begin(), tmpLines.end());
+            auto [b, e] = bucket.curRange();
+            ranges.push_back({ &bucket, b, e });
         }
     }
-    return lines;
+    return ranges;
+}
+
+BoundingBox LinesBucketRange::bounding_box() const
+{
+    BoundingBox bbox;
+    for (int i = begin; i < end; ++i)
+        bucket->_piles[i].get_toolpaths().for_each_path([&bbox](const FlatToolpaths::Path &path, const Point *pt_begin, const Point *pt_end) {
+            if (path.no_extrusion == false)
+                for (const Point *pt = pt_begin; pt != pt_end; ++pt)
+                    bbox.merge(*pt);
+        });
+    if (bbox.defined)
+        bbox.translate(double(bucket->_offset.x()), double(bucket->_offset.y()));
+    return bbox;
+}
+
+void LinesBucketRange::append_lines(LayerLines &out, uint32_t owner, const BoundingBox &clip) const
+{
+    const Point &offset = bucket->_offset;
+    for (int i = begin; i < end; ++i) {
+        bucket->_piles[i].get_toolpaths().for_each_path([&](const FlatToolpaths::Path &path, const Point *pt_begin, const Point *pt_end) {
+            if (path.no_extrusion || path.num_points < 2)
+                return;
+            Point a = *pt_begin + offset;
+            for (const Point *pt = pt_begin + 1; pt != pt_end; ++pt) {
+                Point b = *pt + offset;
+                if (std::max(a.x(), b.x()) >= clip.min.x() && std::min(a.x(), b.x()) <= clip.max.x() &&
+                    std::max(a.y(), b.y()) >= clip.min.y() && std::min(a.y(), b.y()) <= clip.max.y()) {
+                    out.lines.emplace_back(a, b);
+                    out.owners.push_back(owner);
+                    out.roles.push_back(path.role);
+                }
+                a = b;
+            }
+        });
+    }
 }
 
 void getExtrusionPathsFromEntity(const ExtrusionEntityCollection *entity, ExtrusionPaths &paths)
@@ -167,8 +206,7 @@ ExtrusionLayers getExtrusionPathsFromLayer(const LayerRegionPtrs layerRegionPtrs
         perimeters[i].layer    = regionPtr->layer();
         perimeters[i].bottom_z = regionPtr->layer()->bottom_z();
         perimeters[i].height   = regionPtr->layer()->height;
-        getExtrusionPathsFromEntity(&regionPtr->perimeters, perimeters[i].paths);
-        getExtrusionPathsFromEntity(&regionPtr->fills, perimeters[i].paths);
+        perimeters[i].toolpaths = &regionPtr->flat_toolpaths;
         ++i;
     }
     return perimeters;
@@ -177,7 +215,7 @@ ExtrusionLayers getExtrusionPathsFromLayer(const LayerRegionPtrs layerRegionPtrs
 ExtrusionLayer getExtrusionPathsFromSupportLayer(SupportLayer *supportLayer)
 {
     ExtrusionLayer el;
-    getExtrusionPathsFromEntity(&supportLayer->support_fills, el.paths);
+    el.toolpaths = &supportLayer->flat_toolpaths;
     el.layer    = supportLayer;
     el.bottom_z = supportLayer->bottom_z();
     el.height   = supportLayer->height;
@@ -190,7 +228,7 @@ ObjectExtrusions getAllLayersExtrusionPathsFromObject(PrintObject *obj)
 
     for (auto layerPtr : obj->layers()) {
         auto perimeters = getExtrusionPathsFromLayer(layerPtr->regions());
-        oe.perimeters.insert(oe.perimeters.end(), perimeters.begin(), perimeters.end());
+        oe.perimeters.insert(oe.perimeters.end(), std::make_move_iterator(perimeters.begin()), std::make_move_iterator(perimeters.end()));
     }
 
     for (auto supportLayerPtr : obj->support_layers()) { oe.support.push_back(getExtrusionPathsFromSupportLayer(supportLayerPtr)); }
@@ -204,8 +242,9 @@ ConflictComputeOpt ConflictChecker::find_inter_of_lines(const LineWithIDs &lines
     std::map<IndexPair, std::vector<int>> indexToLine;
 
     for (int i = 0; i < lines.size(); ++i) {
-        const LineWithID &l1      = lines[i];
-        auto              indexes = line_rasterization(l1._line);
+        const LineWithID &l1 = lines[i];
+        std::vector<IndexPair> indexes;
+        line_rasterization(l1._line, [&indexes](const IndexPair &index) { indexes.push_back(index); });
         for (auto index : indexes) {
             const auto &possibleIntersectIdxs = indexToLine[index];
             for (auto possibleIntersectIdx : possibleIntersectIdxs) {
@@ -218,6 +257,116 @@ ConflictComputeOpt ConflictChecker::find_inter_of_lines(const LineWithIDs &lines
     return {};
 }
 
+ConflictComputeOpt ConflictChecker::find_inter_of_lines(const LayerLines &lines)
+{
+    using namespace RasterizationImpl;
+    // Flat list of (cell, line) pairs sorted by the cell, instead of a map of cells:
+    // the lines sharing a cell are then adjacent, ordered by their index and thus grouped by their owner.
+    std::vector<std::pair<uint64_t, uint32_t>> cells;
+    cells.reserve(lines.size() * 2);
+    for (size_t i = 0; i < lines.size(); ++i)
+        line_rasterization(lines.lines[i], [&cells, i](const IndexPair &index) { cells.emplace_back(grid_key(index), uint32_t(i)); });
+    std::sort(cells.begin(), cells.end());
+
+    for (size_t begin = 0; begin < cells.size();) {
+        size_t end   = begin + 1;
+        bool   mixed = false;
+        for (; end < cells.size() && cells[end].first == cells[begin].first; ++end)
+            mixed |= lines.owners[cells[end].second] != lines.owners[cells[begin].second];
+        // Skip the cells occupied by a single owner, the lines of one object never conflict.
+        if (mixed) {
+            size_t next_owner = begin;
+            for (size_t i = begin; i < end; ++i) {
+                uint32_t owner = lines.owners[cells[i].second];
+                if (next_owner <= i) {
+                    next_owner = i + 1;
+                    while (next_owner < end && lines.owners[cells[next_owner].second] == owner)
+                        ++next_owner;
+                }
+                for (size_t j = next_owner; j < end; ++j)
+                    if (auto interRes = line_intersect(lines, cells[i].second, cells[j].second); interRes.has_value())
+                        return interRes;
+            }
+        }
+        begin = end;
+    }
+    return {};
+}
+
+ConflictComputeOpt ConflictChecker::find_inter_of_layer(const LinesBucketRanges &ranges)
+{
+    // Bounding boxes per id, an object contributes its perimeter and its support buckets.
+    std::vector<const void *> ids;
+    std::vector<BoundingBox>  id_bboxes;
+    std::vector<uint32_t>     range_owners(ranges.size());
+    for (size_t i = 0; i < ranges.size(); ++i) {
+        const void *id = ranges[i].bucket->_id;
+        auto        it = std::find(ids.begin(), ids.end(), id);
+        if (it == ids.end()) {
+            ids.push_back(id);
+            id_bboxes.emplace_back();
+            it = ids.end() - 1;
+        }
+        range_owners[i] = uint32_t(it - ids.begin());
+        BoundingBox bbox = ranges[i].bounding_box();
+        if (bbox.defined)
+            id_bboxes[range_owners[i]].merge(bbox);
+    }
+
+    // Overlap of the bounding box of each id with the bounding boxes of the other ids.
+    std::vector<BoundingBox> clips(ids.size());
+    bool                     any_overlap = false;
+    for (size_t i = 0; i < ids.size(); ++i)
+        for (size_t j = i + 1; j < ids.size(); ++j) {
+            const BoundingBox &b1 = id_bboxes[i];
+            const BoundingBox &b2 = id_bboxes[j];
+            if (b1.defined && b2.defined && b1.overlap(b2)) {
+                BoundingBox overlap(Point(std::max(b1.min.x(), b2.min.x()), std::max(b1.min.y(), b2.min.y())),
+                                    Point(std::min(b1.max.x(), b2.max.x()), std::min(b1.max.y(), b2.max.y())));
+                clips[i].merge(overlap);
+                clips[j].merge(overlap);
+                any_overlap = true;
+            }
+        }
+    if (!any_overlap)
+        return {};
+
+    LayerLines lines;
+    lines.ids = std::move(ids);
+    for (size_t i = 0; i < ranges.size(); ++i)
+        if (const BoundingBox &clip = clips[range_owners[i]]; clip.defined)
+            ranges[i].append_lines(lines, range_owners[i], clip);
+    return find_inter_of_lines(lines);
+}
+
+std::optional<std::pair<ConflictComputeResult, float>> ConflictChecker::find_inter_of_buckets(LinesBucketQueue &queue)
+{
+    std::vector<LinesBucketRanges> layersRanges;
+    std::vector<float>             bottomZs;
+    while (queue.valid()) {
+        layersRanges.push_back(queue.getCurRanges());
+        bottomZs.push_back(queue.getCurrBottomZ());
+    }
+
+    // Report the lowest conflicting layer, the layers above the lowest conflict found so far are skipped.
+    std::atomic<size_t>                  conflictLayer(layersRanges.size());
+    std::vector<ConflictComputeOpt>      conflicts(layersRanges.size());
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, layersRanges.size()), [&](tbb::blocked_range<size_t> range) {
+        for (size_t i = range.begin(); i < range.end() && i < conflictLayer.load(std::memory_order_relaxed); i++) {
+            conflicts[i] = find_inter_of_layer(layersRanges[i]);
+            if (conflicts[i].has_value()) {
+                size_t cur = conflictLayer.load();
+                while (i < cur && !conflictLayer.compare_exchange_weak(cur, i));
+                break;
+            }
+        }
+    });
+
+    if (size_t i = conflictLayer.load(); i < layersRanges.size())
+        return std::make_pair(*conflicts[i], bottomZs[i]);
+    return {};
+}
+
 ConflictResultOpt ConflictChecker::find_inter_of_lines_in_diff_objs(PrintObjectPtrs                      objs,
                                                                     std::optional<const FakeWipeTower *> wtdptr) // find the first intersection point of lines in different objects
 {
@@ -230,10 +379,10 @@ ConflictResultOpt ConflictChecker::find_inter_of_lines_in_diff_objs(PrintObjectP
         wtels.type = ExtrusionLayersType::WIPE_TOWER;
         for (int i = 0; i < wtpaths.size(); ++i) { // assume that wipe tower always has same height
             ExtrusionLayer el;
-            el.paths    = wtpaths[i];
             el.bottom_z = wtpaths[i].front().height * (float) i;
+            el.own_toolpaths = FlatToolpaths(wtpaths[i]);
             el.layer    = nullptr;
-            wtels.push_back(el);
+            wtels.push_back(std::move(el));
         }
         conflictQueue.emplace_back_bucket(std::move(wtels), wtdptr.value(), {wtdptr.value()->plate_origin.x(), wtdptr.value()->plate_origin.y()});
     }
@@ -243,32 +392,11 @@ ConflictResultOpt ConflictChecker::find_inter_of_lines_in_diff_objs(PrintObjectP
         conflictQueue.emplace_back_bucket(std::move(layers.support), obj, obj->instances().front().shift);
     }
 
-    std::vector<LineWithIDs> layersLines;
-    std::vector<float>       bottomZs;
-    while (conflictQueue.valid()) {
-        LineWithIDs lines = conflictQueue.getCurLines();
-        float curBottomZ = conflictQueue.getCurrBottomZ();
-        bottomZs.push_back(curBottomZ);
-        layersLines.push_back(std::move(lines));
-    }
-
-    bool                                                          find = false;
-    tbb::concurrent_vector<std::pair<ConflictComputeResult, float>> conflict;
-    tbb::parallel_for(tbb::blocked_range<size_t>(0, layersLines.size()), [&](tbb::blocked_range<size_t> range) {
-        for (size_t i = range.begin(); i < range.end(); i++) {
-            auto interRes = find_inter_of_lines(layersLines[i]);
-            if (interRes.has_value()) {
-                find = true;
-                conflict.emplace_back(interRes.value(), bottomZs[i]);
-                break;
-            }
-        }
-    });
-
-    if (find) {
-        const void *ptr1           = conflict[0].first._obj1;
-        const void *ptr2           = conflict[0].first._obj2;
-        float       conflictPrintZ = conflict[0].second;
+    auto conflict = find_inter_of_buckets(conflictQueue);
+    if (conflict.has_value()) {
+        const void *ptr1           = conflict->first._obj1;
+        const void *ptr2           = conflict->first._obj2;
+        float       conflictPrintZ = conflict->second;
         if (wtdptr.has_value()) {
             const FakeWipeTower *wtdp = wtdptr.value();
             if (ptr1 == wtdp || ptr2 == wtdp) {
@@ -284,6 +412,12 @@ ConflictResultOpt ConflictChecker::find_inter_of_lines_in_diff_objs(PrintObjectP
         return {};
 }
 
+ConflictComputeOpt ConflictChecker::line_intersect(const LayerLines &lines, size_t idx1, size_t idx2)
+{
+    return line_intersect(LineWithID(lines.lines[idx1], lines.ids[lines.owners[idx1]], lines.roles[idx1]),
+                          LineWithID(lines.lines[idx2], lines.ids[lines.owners[idx2]], lines.roles[idx2]));
+}
+
 ConflictComputeOpt ConflictChecker::line_intersect(const LineWithID &l1, const LineWithID &l2)
 {
     constexpr double SUPPORT_THRESHOLD = 100;  // this large almost disables conflict check of supports
@@ -23,12 +23,30 @@ struct LineWithID
 
 using LineWithIDs = std::vector<LineWithID>;
 
+// Lines of a single layer of several objects, stored as parallel arrays for the broad phase of the conflict check.
+struct LayerLines
+{
+    Lines                      lines;
+    // Index into ids of the owner of each line.
+    std::vector<uint32_t>      owners;
+    std::vector<ExtrusionRole> roles;
+    std::vector<const void *>  ids;
+
+    size_t size() const { return lines.size(); }
+    void   clear() { lines.clear(); owners.clear(); roles.clear(); ids.clear(); }
+};
+
 struct ExtrusionLayer
 {
-    ExtrusionPaths paths;
-    const Layer *  layer;
-    float          bottom_z;
-    float          height;
+    // Extrusions owned by the layer, read in place from its flat toolpaths, the layers outlive the conflict check.
+    const FlatToolpaths *toolpaths { nullptr };
+    // Extrusions not owned by any layer, for example the fake paths of the wipe tower.
+    FlatToolpaths        own_toolpaths;
+    const Layer *        layer;
+    float                bottom_z;
+    float                height;
+
+    const FlatToolpaths& get_toolpaths() const { return toolpaths ? *toolpaths : own_toolpaths; }
 };
 
 enum class ExtrusionLayersType { INFILL, PERIMETERS, SUPPORT, WIPE_TOWER };
@@ -61,7 +79,7 @@ public:
     Point           _offset;
 
 public:
-    LinesBucket(ExtrusionLayers &&paths, const void* id, Point offset) : _piles(paths), _id(id), _offset(offset) {}
+    LinesBucket(ExtrusionLayers &&paths, const void* id, Point offset) : _piles(std::move(paths)), _id(id), _offset(offset) {}
     LinesBucket(LinesBucket &&) = default;
 
     std::pair<int, int> curRange() const
@@ -79,28 +97,26 @@ public:
         _curBottomZ = _curPileIdx == _piles.size() ? _piles.back().bottom_z : _piles[_curPileIdx].bottom_z;
     }
     float curBottomZ() const { return _curBottomZ; }
-    LineWithIDs curLines() const
-    {
-        auto [b, e] = curRange();
-        LineWithIDs lines;
-        for (int i = b; i < e; ++i) {
-            for (const ExtrusionPath &path : _piles[i].paths) {
-                if (path.is_force_no_extrusion() == false) {
-                    Polyline check_polyline = path.polyline;
-                    check_polyline.translate(_offset);
-                    Lines tmpLines = check_polyline.lines();
-                    for (const Line &line : tmpLines) { lines.emplace_back(line, _id, path.role()); }
-                }
-            }
-        }
-        return lines;
-    }
 
     friend bool operator>(const LinesBucket &left, const LinesBucket &right) { return left._curBottomZ > right._curBottomZ; }
     friend bool operator<(const LinesBucket &left, const LinesBucket &right) { return left._curBottomZ < right._curBottomZ; }
     friend bool operator==(const LinesBucket &left, const LinesBucket &right) { return left._curBottomZ == right._curBottomZ; }
 };
 
+// Piles [begin, end) of a bucket printed at the same bottom z.
+struct LinesBucketRange
+{
+    const LinesBucket *bucket;
+    int                begin;
+    int                end;
+
+    BoundingBox bounding_box() const;
+    // Append the translated lines of the piles to out, skipping the lines not overlapping clip.
+    void        append_lines(LayerLines &out, uint32_t owner, const BoundingBox &clip) const;
+};
+
+using LinesBucketRanges = std::vector<LinesBucketRange>;
+
 struct LinesBucketPtrComp
 {
     bool operator()(const LinesBucket *left, const LinesBucket *right) { return *left > *right; }
@@ -116,7 +132,8 @@ public:
     void        emplace_back_bucket(ExtrusionLayers &&els, const void *objPtr, Point offset);
     bool        valid() const { return line_bucket_ptr_queue.empty() == false; }
     float       getCurrBottomZ();
-    LineWithIDs getCurLines() const;
+    // Piles of the current layer of all the buckets, referencing the buckets, no lines are copied.
+    LinesBucketRanges getCurRanges() const;
 };
 
 void getExtrusionPathsFromEntity(const ExtrusionEntityCollection *entity, ExtrusionPaths &paths);
@@ -143,8 +160,17 @@ using ConflictObjName = std::optional<std::pair<std::string, std::string>>;
 struct ConflictChecker
 {
     static ConflictResultOpt  find_inter_of_lines_in_diff_objs(PrintObjectPtrs objs, std::optional<const FakeWipeTower *> wtdptr);
+    // Find the lowest layer with a conflict between the buckets of the queue, returns the conflicting ids and the bottom z of the layer.
+    static std::optional<std::pair<ConflictComputeResult, float>> find_inter_of_buckets(LinesBucketQueue &queue);
+    // Only the layer lines of the buckets whose bounding boxes overlap the bounding box of a bucket with a different id
+    // are rasterized, outside of the overlaps no conflict is possible.
+    static ConflictComputeOpt find_inter_of_layer(const LinesBucketRanges &ranges);
+    // Reference implementation: all lines rasterized into a map of grid cells, each line tested against the lines
+    // already inserted into its cells. Kept for the benchmark and the tests of the flat cell list below.
     static ConflictComputeOpt find_inter_of_lines(const LineWithIDs &lines);
+    static ConflictComputeOpt find_inter_of_lines(const LayerLines &lines);
     static ConflictComputeOpt line_intersect(const LineWithID &l1, const LineWithID &l2);
+    static ConflictComputeOpt line_intersect(const LayerLines &lines, size_t idx1, size_t idx2);
 };
 
 } // namespace Slic3r
@@ -3,8 +3,12 @@
 #include <boost/algorithm/string/predicate.hpp>
 #include <boost/algorithm/string/replace.hpp>
 #include <boost/log/trivial.hpp>
+#include <fast_float/fast_float.h>
+#include <array>
+#include <cctype>
 #include <iostream>
 #include <float.h>
+#include <string_view>
 
 #if 0
     #define DEBUG
@@ -296,22 +300,51 @@ finished:
 
 std::string CoolingBuffer::process_layer(std::string &&gcode, size_t layer_id, bool flush)
 {
-    // Cache the input G-code.
+    std::string out;
+    this->process_layer(std::move(gcode), layer_id, flush, out);
+    return out;
+}
+
+void CoolingBuffer::process_layer(std::string &&gcode, size_t layer_id, bool flush, std::string &out)
+{
+    // Cache the input G-code. Swap rather than move, so that the caller gets back the capacity of the cache.
     if (m_gcode.empty())
-        m_gcode = std::move(gcode);
+        m_gcode.swap(gcode);
     else
         m_gcode += gcode;
 
-    std::string out;
     if (flush) {
         // This is either an object layer or the very last print layer. Calculate cool down over the collected support layers
         // and one object layer.
         std::vector<PerExtruderAdjustments> per_extruder_adjustments = this->parse_layer_gcode(m_gcode, m_current_pos);
         float layer_time_stretched = this->calculate_layer_slowdown(per_extruder_adjustments);
-        out = this->apply_layer_cooldown(m_gcode, layer_id, layer_time_stretched, per_extruder_adjustments);
+        this->apply_layer_cooldown(m_gcode, layer_id, layer_time_stretched, per_extruder_adjustments, out);
         m_gcode.clear();
     }
-    return out;
+}
+
+// Helpers for parse_layer_gcode(), working on lines of the layer G-code without copying them.
+static inline bool line_starts_with(const std::string_view &line, const std::string_view &prefix)
+{
+    return line.size() >= prefix.size() && memcmp(line.data(), prefix.data(), prefix.size()) == 0;
+}
+
+static inline bool line_contains(const std::string_view &line, const std::string_view &what)
+{
+    return line.find(what) != std::string_view::npos;
+}
+
+// Parse a number of an axis up to end. Like atof(), returns zero if no number could be parsed.
+static inline float parse_float(const char *begin, const char *end)
+{
+    // atof() skipped leading whitespaces and accepted a leading '+' (e.g. "F+1200"), fast_float does neither.
+    for (; begin != end && std::isspace(static_cast<unsigned char>(*begin)); ++ begin) ;
+    if (begin != end && *begin == '+' && begin + 1 != end && (std::isdigit(static_cast<unsigned char>(begin[1])) || begin[1] == '.'))
+        ++ begin;
+    // Parse into double and round to float as float(atof()) did.
+    double out = 0.;
+    fast_float::from_chars(begin, end, out);
+    return float(out);
 }
 
 // Parse the layer G-code for the moves, which could be adjusted.
@@ -338,44 +371,49 @@ std::vector<PerExtruderAdjustments> CoolingBuffer::parse_layer_gcode(const std::
     // for a sequence of extrusion moves.
     size_t            active_speed_modifier = size_t(-1);
 
-    for (; *line_start != 0; line_start = line_end) 
+    const char       *gcode_end  = gcode.c_str() + gcode.size();
+    // Working copy of current_pos for the line being parsed, to avoid allocating a vector for each move.
+    assert(current_pos.size() == 7);
+    std::array<float, 7> new_pos;
+    for (; line_start != gcode_end; line_start = line_end)
     {
-        while (*line_end != '\n' && *line_end != 0)
-            ++ line_end;
-        // sline will not contain the trailing '\n'.
-        std::string sline(line_start, line_end);
+        line_end = static_cast<const char*>(memchr(line_start, '\n', gcode_end - line_start));
+        if (line_end == nullptr)
+            line_end = gcode_end;
+        // sline will not contain the trailing '\n'. It points into gcode, the lines are not copied.
+        std::string_view sline(line_start, line_end - line_start);
         // CoolingLine will contain the trailing '\n'.
-        if (*line_end == '\n')
+        if (line_end != gcode_end)
             ++ line_end;
         CoolingLine line(0, line_start - gcode.c_str(), line_end - gcode.c_str());
-        if (boost::starts_with(sline, "G0 "))
+        if (line_starts_with(sline, "G0 "))
             line.type = CoolingLine::TYPE_G0;
-        else if (boost::starts_with(sline, "G1 "))
+        else if (line_starts_with(sline, "G1 "))
             line.type = CoolingLine::TYPE_G1;
-        else if (boost::starts_with(sline, "G92 "))
+        else if (line_starts_with(sline, "G92 "))
             line.type = CoolingLine::TYPE_G92;
-        else if (boost::starts_with(sline, "G2 "))
+        else if (line_starts_with(sline, "G2 "))
             line.type = CoolingLine::TYPE_G2;
-        else if (boost::starts_with(sline, "G3 "))
+        else if (line_starts_with(sline, "G3 "))
             line.type = CoolingLine::TYPE_G3;
         if (line.type) {
             // G0, G1 or G92
             // Parse the G-code line.
-            std::vector<float> new_pos(current_pos);
-            const char *c = sline.data() + 3;
+            std::copy(current_pos.begin(), current_pos.end(), new_pos.begin());
+            const char *c   = sline.data() + 3;
+            const char *end = sline.data() + sline.size();
             for (;;) {
                 // Skip whitespaces.
-                for (; *c == ' ' || *c == '\t'; ++ c);
-                if (*c == 0 || *c == ';')
+                for (; c != end && (*c == ' ' || *c == '\t'); ++ c);
+                if (c == end || *c == ';')
                     break;
 
-                assert(is_decimal_separator_point()); // for atof
                 //BBS: Parse the axis.
                 size_t axis = (*c >= 'X' && *c <= 'Z') ? (*c - 'X') :
                               (*c == 'E') ? 3 : (*c == 'F') ? 4 :
                               (*c == 'I') ? 5 : (*c == 'J') ? 6 : size_t(-1);
                 if (axis != size_t(-1)) {
-                    new_pos[axis] = float(atof(++c));
+                    new_pos[axis] = parse_float(++c, end);
                     if (axis == 4) {
                         // Convert mm/min to mm/sec.
                         new_pos[4] /= 60.f;
@@ -388,15 +426,15 @@ std::vector<PerExtruderAdjustments> CoolingBuffer::parse_layer_gcode(const std::
                     }
                 }
                 // Skip this word.
-                for (; *c != ' ' && *c != '\t' && *c != 0; ++ c);
+                for (; c != end && *c != ' ' && *c != '\t'; ++ c);
             }
-            bool external_perimeter = boost::contains(sline, ";_EXTERNAL_PERIMETER");
-            bool wipe               = boost::contains(sline, ";_WIPE");
+            bool external_perimeter = line_contains(sline, ";_EXTERNAL_PERIMETER");
+            bool wipe               = line_contains(sline, ";_WIPE");
             if (external_perimeter)
                 line.type |= CoolingLine::TYPE_EXTERNAL_PERIMETER;
             if (wipe)
                 line.type |= CoolingLine::TYPE_WIPE;
-            if (boost::contains(sline, ";_EXTRUDE_SET_SPEED") && ! wipe) {
+            if (line_contains(sline, ";_EXTRUDE_SET_SPEED") && ! wipe) {
                 line.type |= CoolingLine::TYPE_ADJUSTABLE;
                 active_speed_modifier = adjustment->lines.size();
             }
@@ -455,12 +493,13 @@ std::vector<PerExtruderAdjustments> CoolingBuffer::parse_layer_gcode(const std::
                     line.type = 0;
                 }
             }
-            current_pos = std::move(new_pos);
-        } else if (boost::starts_with(sline, ";_EXTRUDE_END")) {
+            std::copy(new_pos.begin(), new_pos.end(), current_pos.begin());
+        } else if (line_starts_with(sline, ";_EXTRUDE_END")) {
             line.type = CoolingLine::TYPE_EXTRUDE_END;
             active_speed_modifier = size_t(-1);
-        } else if (boost::starts_with(sline, m_toolchange_prefix)) {
-            unsigned int new_extruder = (unsigned int)atoi(sline.c_str() + m_toolchange_prefix.size());
+        } else if (line_starts_with(sline, m_toolchange_prefix)) {
+            // sline points into the zero terminated gcode, atoi() stops at the end of line.
+            unsigned int new_extruder = (unsigned int)atoi(sline.data() + m_toolchange_prefix.size());
             // Only change extruder in case the number is meaningful. User could provide an out-of-range index through custom gcodes - those shall be ignored.
             if (new_extruder < map_extruder_to_per_extruder_adjustment.size()) {
                 if (new_extruder != current_extruder) {
@@ -473,25 +512,25 @@ std::vector<PerExtruderAdjustments> CoolingBuffer::parse_layer_gcode(const std::
             else {
                 // Only log the error in case of MM printer. Single extruder printers likely ignore any T anyway.
                 if (map_extruder_to_per_extruder_adjustment.size() > 1)
-                    BOOST_LOG_TRIVIAL(error) << "CoolingBuffer encountered an invalid toolchange, maybe from a custom gcode: " << sline;
+                    BOOST_LOG_TRIVIAL(error) << "CoolingBuffer encountered an invalid toolchange, maybe from a custom gcode: " << std::string(sline);
             }
 
-        } else if (boost::starts_with(sline, ";_OVERHANG_FAN_START")) {
+        } else if (line_starts_with(sline, ";_OVERHANG_FAN_START")) {
             line.type = CoolingLine::TYPE_OVERHANG_FAN_START;
-        } else if (boost::starts_with(sline, ";_OVERHANG_FAN_END")) {
+        } else if (line_starts_with(sline, ";_OVERHANG_FAN_END")) {
             line.type = CoolingLine::TYPE_OVERHANG_FAN_END;
-        } else if (boost::starts_with(sline, "G4 ")) {
+        } else if (line_starts_with(sline, "G4 ")) {
             // Parse the wait time.
             line.type = CoolingLine::TYPE_G4;
             size_t pos_S = sline.find('S', 3);
             size_t pos_P = sline.find('P', 3);
             assert(is_decimal_separator_point()); // for atof
             line.time = line.time_max = float(
-                (pos_S > 0) ? atof(sline.c_str() + pos_S + 1) :
-                (pos_P > 0) ? atof(sline.c_str() + pos_P + 1) * 0.001 : 0.);
-        } else if (boost::starts_with(sline, ";_FORCE_RESUME_FAN_SPEED")) {
+                (pos_S > 0) ? atof(sline.data() + pos_S + 1) :
+                (pos_P > 0) ? atof(sline.data() + pos_P + 1) * 0.001 : 0.);
+        } else if (line_starts_with(sline, ";_FORCE_RESUME_FAN_SPEED")) {
             line.type = CoolingLine::TYPE_FORCE_RESUME_FAN;
-        } else if (boost::starts_with(sline, ";_SET_FAN_SPEED_CHANGING_LAYER")) {
+        } else if (line_starts_with(sline, ";_SET_FAN_SPEED_CHANGING_LAYER")) {
             line.type = CoolingLine::TYPE_SET_FAN_CHANGING_LAYER;
         }
         if (line.type != 0)
@@ -697,8 +736,8 @@ float CoolingBuffer::calculate_layer_slowdown(std::vector<PerExtruderAdjustments
 }
 
 // Apply slow down over G-code lines stored in per_extruder_adjustments, enable fan if needed.
-// Returns the adjusted G-code.
-std::string CoolingBuffer::apply_layer_cooldown(
+// The adjusted G-code is appended to new_gcode.
+void CoolingBuffer::apply_layer_cooldown(
     // Source G-code for the current layer.
     const std::string                      &gcode,
     // ID of the current layer, used to disable fan for the first n layers.
@@ -706,7 +745,9 @@ std::string CoolingBuffer::apply_layer_cooldown(
     // Total time of this layer after slow down, used to control the fan.
     float                                   layer_time,
     // Per extruder list of G-code lines and their cool down attributes.
-    std::vector<PerExtruderAdjustments>    &per_extruder_adjustments)
+    std::vector<PerExtruderAdjustments>    &per_extruder_adjustments,
+    // Output G-code, usually an empty buffer with capacity reserved by one of the previous layers.
+    std::string                            &new_gcode)
 {
     // First sort the adjustment lines by of multiple extruders by their position in the source G-code.
     std::vector<const CoolingLine*> lines;
@@ -721,8 +762,7 @@ std::string CoolingBuffer::apply_layer_cooldown(
         std::sort(lines.begin(), lines.end(), [](const CoolingLine *ln1, const CoolingLine *ln2) { return ln1->line_start < ln2->line_start; } );
     }
     // Second generate the adjusted G-code.
-    std::string new_gcode;
-    new_gcode.reserve(gcode.size() * 2);
+    new_gcode.reserve(new_gcode.size() + gcode.size() * 2);
     bool overhang_fan_control= false;
     int  overhang_fan_speed   = 0;
 
@@ -934,8 +974,6 @@ std::string CoolingBuffer::apply_layer_cooldown(
     const char *gcode_end = gcode.c_str() + gcode.size();
     if (pos < gcode_end)
         new_gcode.append(pos, gcode_end - pos);
-
-    return new_gcode;
 }
 
 } // namespace Slic3r
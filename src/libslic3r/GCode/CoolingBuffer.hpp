@@ -26,14 +26,19 @@ public:
     void        reset(const Vec3d &position);
     void        set_current_extruder(unsigned int extruder_id) { m_current_extruder = extruder_id; }
     std::string process_layer(std::string &&gcode, size_t layer_id, bool flush);
+    // Append the processed G-code to out. The capacity of gcode is left to the caller for reuse.
+    void        process_layer(std::string &&gcode, size_t layer_id, bool flush, std::string &out);
 
 private:
 	CoolingBuffer& operator=(const CoolingBuffer&) = delete;
+    // Parses the layer G-code in place, without copying its lines. The layers are still passed between the stages of
+    // GCode::process_layers() as text, a structured move representation would have to be produced by every G-code emitter,
+    // by the custom G-code and by the wipe tower.
     std::vector<PerExtruderAdjustments> parse_layer_gcode(const std::string &gcode, std::vector<float> &current_pos) const;
     float       calculate_layer_slowdown(std::vector<PerExtruderAdjustments> &per_extruder_adjustments);
     // Apply slow down over G-code lines stored in per_extruder_adjustments, enable fan if needed.
-    // Returns the adjusted G-code.
-    std::string apply_layer_cooldown(const std::string &gcode, size_t layer_id, float layer_time, std::vector<PerExtruderAdjustments> &per_extruder_adjustments);
+    // The adjusted G-code is appended to new_gcode.
+    void        apply_layer_cooldown(const std::string &gcode, size_t layer_id, float layer_time, std::vector<PerExtruderAdjustments> &per_extruder_adjustments, std::string &new_gcode);
 
     // G-code snippet cached for the support layers preceding an object layer.
     std::string                 m_gcode;
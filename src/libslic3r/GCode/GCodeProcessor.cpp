@@ -1496,7 +1496,7 @@ void GCodeProcessor::process_file(const std::string& filename, std::function<voi
     // 1st move must be a dummy move
     m_result.moves.emplace_back(GCodeProcessorResult::MoveVertex());
     size_t parse_line_callback_cntr = 10000;
-    m_parser.parse_file(filename, [this, cancel_callback, &parse_line_callback_cntr](GCodeReader& reader, const GCodeReader::GCodeLine& line) {
+    auto process_line = [this, cancel_callback, &parse_line_callback_cntr](GCodeReader& reader, const GCodeReader::GCodeLine& line) {
         if (-- parse_line_callback_cntr == 0) {
             // Don't call the cancel_callback() too often, do it every at every 10000'th line.
             parse_line_callback_cntr = 10000;
@@ -1504,7 +1504,12 @@ void GCodeProcessor::process_file(const std::string& filename, std::function<voi
                 cancel_callback();
         }
         this->process_gcode_line(line, true);
-    }, m_result.lines_ends);
+    };
+    if (m_parallel_parsing)
+        // The moves do not need their raw text, only the axes parsed on the worker threads.
+        m_parser.parse_file_parallel(filename, process_line, m_result.lines_ends, false);
+    else
+        m_parser.parse_file(filename, process_line, m_result.lines_ends);
 
     // Don't post-process the G-code to update time stamps.
     this->finalize(false);
@@ -1783,6 +1788,15 @@ void GCodeProcessor::process_gcode_line(const GCodeReader::GCodeLine& line, bool
     // update start position
     m_start_position = m_end_position;
 
+    // The moves were already classified by the tokenizer, possibly on a worker thread of GCodeReader::parse_file_parallel().
+    switch (line.cmd_type()) {
+    case GCodeReader::GCodeLine::ECmd::G0: { process_G0(line); return; }
+    case GCodeReader::GCodeLine::ECmd::G1: { process_G1(line); return; }
+    case GCodeReader::GCodeLine::ECmd::G2:
+    case GCodeReader::GCodeLine::ECmd::G3: { process_G2_G3(line); return; }
+    default: break;
+    }
+
     const std::string_view cmd = line.cmd();
     //OrcaSlicer
     if (m_flavor == gcfKlipper)
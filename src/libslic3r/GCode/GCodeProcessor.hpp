@@ -712,6 +712,8 @@ namespace Slic3r {
         OptionsZCorrector m_options_z_corrector;
         size_t m_last_default_color_id;
         bool m_detect_layer_based_on_tag {false};
+        // Tokenize the G-code file on worker threads in process_file(), see GCodeReader::parse_file_parallel().
+        bool m_parallel_parsing {true};
         int m_seams_count;
 #if ENABLE_GCODE_VIEWER_STATISTICS
         std::chrono::time_point<std::chrono::high_resolution_clock> m_start_time;
@@ -764,6 +766,9 @@ namespace Slic3r {
         // Load a G-code into a stand-alone G-code viewer.
         // throws CanceledException through print->throw_if_canceled() (sent by the caller as callback).
         void process_file(const std::string& filename, std::function<void()> cancel_callback = nullptr);
+        // Only the tokenizing of the lines runs in parallel, the lines are still processed serially and in order,
+        // therefore the result is the same in both modes.
+        void enable_parallel_parsing(bool enabled) { m_parallel_parsing = enabled; }
 
         // Streaming interface, for processing G-codes just generated by PrusaSlicer in a pipelined fashion.
         void initialize(const std::string& filename);
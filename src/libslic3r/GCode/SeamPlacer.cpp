@@ -370,34 +370,38 @@ Polygons extract_perimeter_polygons(const Layer *layer, const SeamPosition confi
 {
     Polygons polygons;
     for (const LayerRegion *layer_region : layer->regions()) {
-        for (const ExtrusionEntity *ex_entity : layer_region->perimeters.entities) {
-            if (ex_entity->is_collection()) { // collection of inner, outer, and overhang perimeters
-                for (const ExtrusionEntity *perimeter : static_cast<const ExtrusionEntityCollection *>(ex_entity)->entities) {
-                    ExtrusionRole role = perimeter->role();
-                    if (perimeter->is_loop()) {
-                        for (const ExtrusionPath &path : static_cast<const ExtrusionLoop *>(perimeter)->paths) {
-                            if (path.role() == ExtrusionRole::erExternalPerimeter) { role = ExtrusionRole::erExternalPerimeter; }
+        // BBS: read the perimeters from the flat toolpaths of the region, the points of each entity are contiguous there.
+        const FlatToolpaths                      &toolpaths = layer_region->flat_toolpaths;
+        FlatToolpaths::Span<FlatToolpaths::Entity> entities  = toolpaths.entities();
+        if (entities.empty())
+            continue;
+        // The perimeters are the first top level collection.
+        const size_t perimeters_end = toolpaths.next_sibling(0);
+        for (size_t ex_entity = 1; ex_entity < perimeters_end; ex_entity = toolpaths.next_sibling(ex_entity)) {
+            if (entities[ex_entity].type == FlatToolpaths::EntityType::Collection) { // collection of inner, outer, and overhang perimeters
+                for (size_t perimeter = ex_entity + 1; perimeter < toolpaths.next_sibling(ex_entity); perimeter = toolpaths.next_sibling(perimeter)) {
+                    ExtrusionRole role = entities[perimeter].role;
+                    if (entities[perimeter].type == FlatToolpaths::EntityType::Loop) {
+                        for (const FlatToolpaths::Path &path : toolpaths.entity_paths(perimeter)) {
+                            if (path.role == ExtrusionRole::erExternalPerimeter) { role = ExtrusionRole::erExternalPerimeter; }
                         }
                     }
 
                     if (role == ExtrusionRole::erExternalPerimeter ||
                         (is_perimeter(role) && configured_seam_preference == spRandom)) { // for random seam alignment, extract all perimeters
-                        Points p;
-                        perimeter->collect_points(p);
-                        polygons.emplace_back(std::move(p));
+                        FlatToolpaths::Span<Point> p = toolpaths.entity_points(perimeter);
+                        polygons.emplace_back(Points(p.begin(), p.end()));
                         corresponding_regions_out.push_back(layer_region);
                     }
                 }
                 if (polygons.empty()) {
-                    Points p;
-                    ex_entity->collect_points(p);
-                    polygons.emplace_back(std::move(p));
+                    FlatToolpaths::Span<Point> p = toolpaths.entity_points(ex_entity);
+                    polygons.emplace_back(Points(p.begin(), p.end()));
                     corresponding_regions_out.push_back(layer_region);
                 }
             } else {
-                Points p;
-                ex_entity->collect_points(p);
-                polygons.emplace_back(std::move(p));
+                FlatToolpaths::Span<Point> p = toolpaths.entity_points(ex_entity);
+                polygons.emplace_back(Points(p.begin(), p.end()));
                 corresponding_regions_out.push_back(layer_region);
             }
         }
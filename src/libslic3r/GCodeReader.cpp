@@ -4,9 +4,12 @@
 #include <boost/log/trivial.hpp>
 #include <boost/nowide/fstream.hpp>
 #include <boost/nowide/cstdio.hpp>
+#include <boost/iostreams/device/mapped_file.hpp>
 #include <fstream>
 #include <iostream>
 #include <iomanip>
+#include <algorithm>
+#include <memory>
 #include "Utils.hpp"
 
 #include "LocalesUtils.hpp"
@@ -14,8 +17,206 @@
 #include <Shiny/Shiny.h>
 #include <fast_float/fast_float.h>
 
+#include <tbb/task_arena.h>
+// Intel redesigned some TBB interface considerably when merging TBB with their oneAPI set of libraries, see GH #7332.
+// We are using quite an old TBB 2017 U7. Before we update our build servers, let's use the old API, which is deprecated in up to date TBB.
+#if ! defined(TBB_VERSION_MAJOR)
+    #include <tbb/version.h>
+#endif
+#if ! defined(TBB_VERSION_MAJOR)
+    static_assert(false, "TBB_VERSION_MAJOR not defined");
+#endif
+#if TBB_VERSION_MAJOR >= 2021
+    #include <tbb/parallel_pipeline.h>
+    using slic3r_tbb_filtermode = tbb::filter_mode;
+#else
+    #include <tbb/pipeline.h>
+    using slic3r_tbb_filtermode = tbb::filter;
+#endif
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+    #define SLIC3R_GCODEREADER_X86 1
+    #include <immintrin.h>
+    #ifdef _MSC_VER
+        #include <intrin.h>
+        // MSVC allows AVX2 intrinsics without enabling AVX2 code generation for the whole translation unit.
+        #define SLIC3R_TARGET_AVX2
+    #else
+        #define SLIC3R_TARGET_AVX2 __attribute__((target("avx2")))
+    #endif
+#endif
+
 namespace Slic3r {
 
+namespace {
+
+// Searching for the end of line dominates the parsing of long comments and the splitting of a file into lines.
+// The search is vectorized, the widest implementation supported by the CPU is picked at runtime.
+using find_eol_fn = const char* (*)(const char *begin, const char *end);
+
+// Returns pointer to the first '\r' or '\n' in <begin, end), or end.
+const char* find_eol_scalar(const char *begin, const char *end)
+{
+    for (; begin != end && *begin != '\r' && *begin != '\n'; ++ begin) ;
+    return begin;
+}
+
+#ifdef SLIC3R_GCODEREADER_X86
+inline unsigned int count_trailing_zeros(unsigned int mask)
+{
+#ifdef _MSC_VER
+    unsigned long idx;
+    _BitScanForward(&idx, mask);
+    return (unsigned int)idx;
+#else
+    return (unsigned int)__builtin_ctz(mask);
+#endif
+}
+
+inline unsigned int count_trailing_zeros64(uint64_t mask)
+{
+#if defined(_MSC_VER) && defined(_M_X64)
+    unsigned long idx;
+    _BitScanForward64(&idx, mask);
+    return (unsigned int)idx;
+#elif defined(_MSC_VER)
+    return uint32_t(mask) != 0 ? count_trailing_zeros(uint32_t(mask)) : 32 + count_trailing_zeros(uint32_t(mask >> 32));
+#else
+    return (unsigned int)__builtin_ctzll(mask);
+#endif
+}
+
+// SSE2 is always available on x86-64.
+const char* find_eol_sse2(const char *begin, const char *end)
+{
+    const __m128i cr = _mm_set1_epi8('\r');
+    const __m128i lf = _mm_set1_epi8('\n');
+    for (; end - begin >= 16; begin += 16) {
+        __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(begin));
+        int     mask  = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(block, cr), _mm_cmpeq_epi8(block, lf)));
+        if (mask != 0)
+            return begin + count_trailing_zeros((unsigned int)mask);
+    }
+    return find_eol_scalar(begin, end);
+}
+
+SLIC3R_TARGET_AVX2 const char* find_eol_avx2(const char *begin, const char *end)
+{
+    const __m256i cr = _mm256_set1_epi8('\r');
+    const __m256i lf = _mm256_set1_epi8('\n');
+    // Two 32 byte blocks per iteration, G-code lines are mostly 20 to 60 characters long.
+    for (; end - begin >= 64; begin += 64) {
+        __m256i      block1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(begin));
+        __m256i      block2 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(begin + 32));
+        unsigned int mask1  = (unsigned int)_mm256_movemask_epi8(_mm256_or_si256(_mm256_cmpeq_epi8(block1, cr), _mm256_cmpeq_epi8(block1, lf)));
+        if (mask1 != 0)
+            return begin + count_trailing_zeros(mask1);
+        unsigned int mask2  = (unsigned int)_mm256_movemask_epi8(_mm256_or_si256(_mm256_cmpeq_epi8(block2, cr), _mm256_cmpeq_epi8(block2, lf)));
+        if (mask2 != 0)
+            return begin + 32 + count_trailing_zeros(mask2);
+    }
+    return find_eol_sse2(begin, end);
+}
+
+bool cpu_supports_avx2()
+{
+#ifdef _MSC_VER
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7)
+        return false;
+    __cpuid(info, 1);
+    // The OS has to save the YMM registers on context switch.
+    if ((info[2] & (1 << 27)) == 0 || (info[2] & (1 << 28)) == 0 || (_xgetbv(0) & 6) != 6)
+        return false;
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#else
+    return __builtin_cpu_supports("avx2");
+#endif
+}
+// The tokenizer splits a line into words with the masks of the whitespaces and of the line ends (';', '\r', '\n', 0)
+// in a window of 64 characters, bit i of a mask corresponding to begin[i]. Only called if 64 characters may be read.
+using find_separators_fn = void (*)(const char *begin, uint64_t &whitespaces, uint64_t &line_ends);
+
+void find_separators_sse2(const char *begin, uint64_t &whitespaces, uint64_t &line_ends)
+{
+    const __m128i space     = _mm_set1_epi8(' ');
+    const __m128i tab       = _mm_set1_epi8('\t');
+    const __m128i semicolon = _mm_set1_epi8(';');
+    const __m128i cr        = _mm_set1_epi8('\r');
+    const __m128i lf        = _mm_set1_epi8('\n');
+    const __m128i zero      = _mm_setzero_si128();
+    whitespaces = 0;
+    line_ends   = 0;
+    for (int i = 0; i < 4; ++ i) {
+        __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(begin + 16 * i));
+        uint64_t ws   = uint16_t(_mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(block, space), _mm_cmpeq_epi8(block, tab))));
+        uint64_t eol  = uint16_t(_mm_movemask_epi8(_mm_or_si128(
+            _mm_or_si128(_mm_cmpeq_epi8(block, semicolon), _mm_cmpeq_epi8(block, zero)),
+            _mm_or_si128(_mm_cmpeq_epi8(block, cr), _mm_cmpeq_epi8(block, lf)))));
+        whitespaces |= ws << (16 * i);
+        line_ends   |= eol << (16 * i);
+    }
+}
+
+SLIC3R_TARGET_AVX2 void find_separators_avx2(const char *begin, uint64_t &whitespaces, uint64_t &line_ends)
+{
+    const __m256i space     = _mm256_set1_epi8(' ');
+    const __m256i tab       = _mm256_set1_epi8('\t');
+    const __m256i semicolon = _mm256_set1_epi8(';');
+    const __m256i cr        = _mm256_set1_epi8('\r');
+    const __m256i lf        = _mm256_set1_epi8('\n');
+    const __m256i zero      = _mm256_setzero_si256();
+    whitespaces = 0;
+    line_ends   = 0;
+    for (int i = 0; i < 2; ++ i) {
+        __m256i  block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(begin + 32 * i));
+        uint64_t ws    = uint32_t(_mm256_movemask_epi8(_mm256_or_si256(_mm256_cmpeq_epi8(block, space), _mm256_cmpeq_epi8(block, tab))));
+        uint64_t eol   = uint32_t(_mm256_movemask_epi8(_mm256_or_si256(
+            _mm256_or_si256(_mm256_cmpeq_epi8(block, semicolon), _mm256_cmpeq_epi8(block, zero)),
+            _mm256_or_si256(_mm256_cmpeq_epi8(block, cr), _mm256_cmpeq_epi8(block, lf)))));
+        whitespaces |= ws << (32 * i);
+        line_ends   |= eol << (32 * i);
+    }
+}
+#endif // SLIC3R_GCODEREADER_X86
+
+find_eol_fn select_find_eol()
+{
+#ifdef SLIC3R_GCODEREADER_X86
+    return cpu_supports_avx2() ? find_eol_avx2 : find_eol_sse2;
+#else
+    return find_eol_scalar;
+#endif
+}
+
+const find_eol_fn find_eol = select_find_eol();
+
+#ifdef SLIC3R_GCODEREADER_X86
+const find_separators_fn find_separators = cpu_supports_avx2() ? find_separators_avx2 : find_separators_sse2;
+#endif // SLIC3R_GCODEREADER_X86
+
+inline Axis axis_from_letter(char c)
+{
+    switch (c) {
+    case 'X': return X;
+    case 'Y': return Y;
+    case 'Z': return Z;
+    case 'F': return F;
+    //BBS: add I and J axis
+    case 'I': return I;
+    case 'J': return J;
+    case 'E': return E;
+    case 'P': return P;
+    default:
+        // Unknown axis, but we still want to remember that such a axis was seen.
+        return (c >= 'A' && c <= 'Z') ? UNKNOWN_AXIS : NUM_AXES_WITH_UNKNOWN;
+    }
+}
+
+} // anonymous namespace
+
 void GCodeReader::apply_config(const GCodeConfig &config)
 {
     m_config = config;
@@ -26,12 +227,90 @@ void GCodeReader::apply_config(const DynamicPrintConfig &config)
     m_config.apply(config, true);
 }
 
-const char* GCodeReader::parse_line_internal(const char *ptr, const char *end, GCodeLine &gline, std::pair<const char*, const char*> &command)
+const char* GCodeReader::parse_line_internal(const char *ptr, const char *end, const char *buffer_end, GCodeLine &gline)
 {
     PROFILE_FUNC();
 
     assert(is_decimal_separator_point());
-    
+
+    std::pair<const char*, const char*> command;
+    const char *c = tokenize_line(ptr, end, buffer_end, gline.m_axis, gline.m_mask, command);
+    gline.m_cmd_type = classify_command(command);
+
+    // Copy the raw string including the comment, without the trailing newlines.
+    if (c > ptr) {
+        PROFILE_BLOCK(copy_raw_string);
+        gline.m_raw.assign(ptr, c);
+    }
+
+    // Skip the trailing newlines.
+	if (c != end && *c == '\r')
+		++ c;
+	if (c != end && *c == '\n')
+		++ c;
+
+    if (gline.has(E) && m_config.use_relative_e_distances)
+        m_position[E] = 0;
+
+    if (m_verbose)
+        std::cout << gline.m_raw << std::endl;
+
+    return c;
+}
+
+const char* GCodeReader::tokenize_line_vectorized(const char *ptr, const char *end, const char *buffer_end, float *axis_values, uint32_t &mask, std::pair<const char*, const char*> &command)
+{
+#ifdef SLIC3R_GCODEREADER_X86
+    // Most G-code lines are shorter than 64 characters: split them into words using the vectorized masks of the separators.
+    // The window is bounded by the end of the buffer, the end of the line only stops the tokenizing.
+    if (buffer_end - ptr >= 64) {
+        uint64_t whitespaces, line_ends;
+        find_separators(ptr, whitespaces, line_ends);
+        if (end - ptr < 64)
+            line_ends |= uint64_t(1) << (end - ptr);
+        if (line_ends != 0) {
+            const unsigned int len    = count_trailing_zeros64(line_ends);
+            // Characters of the words up to the end of the G-code line or the start of a comment.
+            const uint64_t     words  = ~whitespaces & ((uint64_t(1) << len) - 1);
+            uint64_t           starts = words & ~(words << 1);
+            auto word_end = [words](unsigned int i) { return i + count_trailing_zeros64(~(words >> i)); };
+            if (starts == 0)
+                command.first = command.second = ptr + len;
+            else {
+                unsigned int i = count_trailing_zeros64(starts);
+                command.first  = ptr + i;
+                command.second = ptr + word_end(i);
+                starts &= starts - 1;
+            }
+            for (; starts != 0; starts &= starts - 1) {
+                const unsigned int i    = count_trailing_zeros64(starts);
+                const Axis         axis = axis_from_letter(ptr[i]);
+                if (axis != NUM_AXES_WITH_UNKNOWN) {
+                    // Try to parse the numeric value, it has to span the rest of the word.
+                    double v;
+                    auto [pend, ec] = fast_float::from_chars(ptr + i + 1, end, v);
+                    if (pend != ptr + i + 1 && pend == ptr + word_end(i)) {
+                        if (axis != UNKNOWN_AXIS)
+                            axis_values[int(axis)] = float(v);
+                        mask |= 1 << int(axis);
+                    }
+                }
+            }
+            const char *c = ptr + len;
+            // Skip the comment.
+            return c == end || is_end_of_line(*c) ? c : find_eol(c, end);
+        }
+    }
+#endif // SLIC3R_GCODEREADER_X86
+    return nullptr;
+}
+
+const char* GCodeReader::tokenize_line(const char *ptr, const char *end, const char *buffer_end, float *axis_values, uint32_t &mask, std::pair<const char*, const char*> &command)
+{
+    // Longer lines and lines close to the end of the buffer are tokenized by the scalar loop below, with the same result.
+    if (const char *c = tokenize_line_vectorized(ptr, end, buffer_end, axis_values, mask, command); c != nullptr)
+        return c;
+
     // command and args
     const char *c = ptr;
     {
@@ -47,23 +326,7 @@ const char* GCodeReader::parse_line_internal(const char *ptr, const char *end, G
 			if (is_end_of_gcode_line(*c))
 				break;
             // Check the name of the axis.
-            Axis axis = NUM_AXES_WITH_UNKNOWN;
-            switch (*c) {
-            case 'X': axis = X; break;
-            case 'Y': axis = Y; break;
-            case 'Z': axis = Z; break;
-            case 'F': axis = F; break;
-            //BBS: add I and J axis
-            case 'I': axis = I; break;
-            case 'J': axis = J; break;
-            case 'E': axis = E; break;
-            case 'P': axis = P; break;
-            default:
-                if (*c >= 'A' && *c <= 'Z')
-                	// Unknown axis, but we still want to remember that such a axis was seen.
-                	axis = UNKNOWN_AXIS;
-                break;
-            }
+            Axis axis = axis_from_letter(*c);
             if (axis != NUM_AXES_WITH_UNKNOWN) {
                 // Try to parse the numeric value.
                 double v;
@@ -71,8 +334,8 @@ const char* GCodeReader::parse_line_internal(const char *ptr, const char *end, G
                 if (pend != c && is_end_of_word(*pend)) {
                     // The axis value has been parsed correctly.
                     if (axis != UNKNOWN_AXIS)
-	                    gline.m_axis[int(axis)] = float(v);
-                    gline.m_mask |= 1 << int(axis);
+	                    axis_values[int(axis)] = float(v);
+                    mask |= 1 << int(axis);
                     c = pend;
                 } else
                     // Skip the rest of the word.
@@ -82,57 +345,88 @@ const char* GCodeReader::parse_line_internal(const char *ptr, const char *end, G
                 c = skip_word(c);
         }
     }
-    
-    if (gline.has(E) && m_config.use_relative_e_distances)
-        m_position[E] = 0;
 
     // Skip the rest of the line.
-    for (; ! is_end_of_line(*c); ++ c);
-
-    // Copy the raw string including the comment, without the trailing newlines.
-    if (c > ptr) {
-        PROFILE_BLOCK(copy_raw_string);
-        gline.m_raw.assign(ptr, c);
-    }
-
-    // Skip the trailing newlines.
-	if (*c == '\r')
-		++ c;
-	if (*c == '\n')
-		++ c;
-
-    if (m_verbose)
-        std::cout << gline.m_raw << std::endl;
+    if (! is_end_of_line(*c))
+        c = find_eol(c, end);
 
     return c;
 }
 
-void GCodeReader::update_coordinates(GCodeLine &gline, std::pair<const char*, const char*> &command)
+GCodeReader::GCodeLine::ECmd GCodeReader::classify_command(const std::pair<const char*, const char*> &command)
 {
-    PROFILE_FUNC();
+    using ECmd = GCodeLine::ECmd;
     if (*command.first == 'G') {
         int cmd_len = int(command.second - command.first);
         //BBS: add support of G2 and G3
-        if ((cmd_len == 2 && (command.first[1] == '0' || command.first[1] == '1' || command.first[1] == '2' || command.first[1] == '3')) ||
-            (cmd_len == 3 &&  command.first[1] == '9' && command.first[2] == '2')) {
-            for (size_t i = 0; i < NUM_AXES; ++ i)
-                if (gline.has(Axis(i)))
-                    m_position[i] = gline.value(Axis(i));
-        }
+        if (cmd_len == 2) {
+            switch (command.first[1]) {
+            case '0': return ECmd::G0;
+            case '1': return ECmd::G1;
+            case '2': return ECmd::G2;
+            case '3': return ECmd::G3;
+            default:  break;
+            }
+        } else if (cmd_len == 3 && command.first[1] == '9' && command.first[2] == '2')
+            return ECmd::G92;
+    }
+    return ECmd::Other;
+}
+
+void GCodeReader::update_coordinates(GCodeLine &gline)
+{
+    PROFILE_FUNC();
+    if (gline.m_cmd_type != GCodeLine::ECmd::Other) {
+        for (size_t i = 0; i < NUM_AXES; ++ i)
+            if (gline.has(Axis(i)))
+                m_position[i] = gline.value(Axis(i));
     }
 }
 
 template<typename ParseLineCallback, typename LineEndCallback>
 bool GCodeReader::parse_file_raw_internal(const std::string &filename, ParseLineCallback parse_line_callback, LineEndCallback line_end_callback)
 {
+    m_parsing = true;
+
+    boost::iostreams::mapped_file_source mapped;
+    if (map_file(filename, mapped)) {
+        // Lines are passed to the callback directly from the mapped memory, without copying.
+        const char *begin = mapped.data();
+        const char *end   = begin + mapped.size();
+        for (const char *it = begin; it != end;) {
+            const char *it_end = find_eol(it, end);
+            if (it_end == end) {
+                // The last line is not terminated. Copy it, as the line parser relies on a terminating character.
+                std::string gcode_line(it, it_end);
+                parse_line_callback(gcode_line.c_str(), gcode_line.c_str() + gcode_line.size(), gcode_line.c_str() + gcode_line.size());
+                break;
+            }
+            // The rest of the mapping is readable, thus the tokenizer may look beyond the end of a short line.
+            parse_line_callback(it, it_end, end);
+            if (! m_parsing)
+                // The callback wishes to exit.
+                return true;
+            // Skip EOL.
+            it = it_end;
+            if (*it == '\r')
+                ++ it;
+            if (it != end && *it == '\n') {
+                ++ it;
+                line_end_callback(size_t(it - begin));
+            }
+        }
+        return true;
+    }
+
     FilePtr in{ boost::nowide::fopen(filename.c_str(), "rb") };
+    if (in.f == nullptr)
+        return false;
 
     // Read the input stream 64kB at a time, extract lines and process them.
     std::vector<char> buffer(65536 * 10, 0);
     // Line buffer.
     std::string gcode_line;
     size_t file_pos = 0;
-    m_parsing = true;
     for (;;) {
         size_t cnt_read = ::fread(buffer.data(), 1, buffer.size(), in.f);
         if (::ferror(in.f))
@@ -142,19 +436,16 @@ bool GCodeReader::parse_file_raw_internal(const std::string &filename, ParseLine
         auto it_bufend = buffer.begin() + cnt_read;
         while (it != it_bufend || (eof && ! gcode_line.empty())) {
             // Find end of line.
-            bool eol    = false;
-            auto it_end = it;
-            for (; it_end != it_bufend && ! (eol = *it_end == '\r' || *it_end == '\n'); ++ it_end)
-                if (*it_end == '\n')
-                    line_end_callback(file_pos + (it_end - buffer.begin()) + 1);
+            auto it_end = it + (find_eol(&(*it), buffer.data() + cnt_read) - &(*it));
+            bool eol    = it_end != it_bufend;
             // End of line is indicated also if end of file was reached.
             eol |= eof && it_end == it_bufend;
             if (eol) {
                 if (gcode_line.empty())
-                    parse_line_callback(&(*it), &(*it_end));
+                    parse_line_callback(&(*it), &(*it_end), buffer.data() + cnt_read);
                 else {
                     gcode_line.insert(gcode_line.end(), it, it_end);
-                    parse_line_callback(gcode_line.c_str(), gcode_line.c_str() + gcode_line.size());
+                    parse_line_callback(gcode_line.c_str(), gcode_line.c_str() + gcode_line.size(), gcode_line.c_str() + gcode_line.size());
                     gcode_line.clear();
                 }
                 if (! m_parsing)
@@ -183,7 +474,7 @@ bool GCodeReader::parse_file_internal(const std::string &filename, ParseLineCall
 {
     GCodeLine gline;    
     return this->parse_file_raw_internal(filename, 
-        [this, &gline, parse_line_callback](const char *begin, const char *end) {
+        [this, &gline, parse_line_callback](const char *begin, const char *end, const char *buffer_end) {
             gline.reset();
 
             const char* begin_new = begin;
@@ -191,7 +482,7 @@ bool GCodeReader::parse_file_internal(const std::string &filename, ParseLineCall
             if (std::toupper(*begin_new) == 'N')
                 begin_new = skip_word(begin_new);
             begin_new = skip_whitespaces(begin_new);
-            this->parse_line(begin_new, end, gline, parse_line_callback);
+            this->parse_line(begin_new, end, gline, parse_line_callback, buffer_end);
         }, 
         line_end_callback);
 }
@@ -218,10 +509,199 @@ bool GCodeReader::parse_file(const std::string &file, callback_t callback, std::
 bool GCodeReader::parse_file_raw(const std::string &filename, raw_line_callback_t line_callback)
 {
     return this->parse_file_raw_internal(filename,
-        [this, line_callback](const char *begin, const char *end) { line_callback(*this, begin, end); }, 
+        [this, line_callback](const char *begin, const char *end, const char *) { line_callback(*this, begin, end); }, 
         [](size_t){});
 }
 
+namespace {
+// Move record of a ParsedChunk, tokenized and classified on a worker thread. The raw line is not copied, it points into the chunk data.
+struct TokenizedLine
+{
+    float                               axis[NUM_AXES];
+    uint32_t                            mask;
+    const char                         *raw_begin;
+    const char                         *raw_end;
+    GCodeReader::GCodeLine::ECmd        cmd_type;
+    // The line contains a comment, thus its raw text is always passed to the callback.
+    bool                                has_comment;
+    // File position after the '\n' terminating the line, 0 if the line is not terminated by '\n'.
+    size_t                              line_end;
+};
+
+// A piece of the G-code file ending at a line boundary, tokenized by parse_file_parallel() on a worker thread.
+struct ParsedChunk
+{
+    // Either points into the memory mapped file or into storage.
+    const char                 *begin { nullptr };
+    const char                 *end { nullptr };
+    // Position of begin in the file.
+    size_t                      file_pos { 0 };
+    // Owned data if the file is not memory mapped or for the last line of a file without a trailing newline.
+    // Zero terminated, the tokenizer relies on a terminating character.
+    std::vector<char>           storage;
+    std::vector<TokenizedLine>  lines;
+};
+using ParsedChunkPtr = std::shared_ptr<ParsedChunk>;
+} // anonymous namespace
+
+bool GCodeReader::parse_file_parallel(const std::string &file, callback_t callback, std::vector<size_t> &lines_ends, bool raw_moves)
+{
+    BOOST_LOG_TRIVIAL(info) << __FUNCTION__ << boost::format(":  before parse_file %1%") % file.c_str();
+    lines_ends.clear();
+
+    boost::iostreams::mapped_file_source mapped;
+    FilePtr in{ nullptr };
+    if (! map_file(file, mapped)) {
+        in.f = boost::nowide::fopen(file.c_str(), "rb");
+        if (in.f == nullptr)
+            return false;
+    }
+
+    // Big enough to amortize the task overhead, small enough to bound the memory of the lines in flight.
+    static constexpr size_t chunk_size = 4 * 1024 * 1024;
+    // Incomplete last line of the previous read, only used if the file is not mapped.
+    std::vector<char> carry;
+    size_t            file_pos     = 0;
+    bool              eof          = false;
+    bool              read_failed  = false;
+    m_parsing = true;
+
+    // Cut the chunk data after the last '\n', returns the cut position or begin if there is no '\n'.
+    auto cut_at_last_eol = [](const char *begin, const char *end) {
+        for (const char *it = end; it != begin; -- it)
+            if (it[-1] == '\n')
+                return it;
+        return begin;
+    };
+
+    auto next_mapped_chunk = [&]() -> ParsedChunkPtr {
+        const char *data     = mapped.data();
+        const char *data_end = data + mapped.size();
+        auto chunk = std::make_shared<ParsedChunk>();
+        chunk->file_pos = file_pos;
+        chunk->begin    = data + file_pos;
+        chunk->end      = chunk->begin + std::min(chunk_size, size_t(data_end - chunk->begin));
+        if (chunk->end != data_end) {
+            const char *cut = cut_at_last_eol(chunk->begin, chunk->end);
+            if (cut == chunk->begin) {
+                // No line end in the whole chunk, extend it up to the next line end.
+                cut = std::find(chunk->end, data_end, '\n');
+                cut = (cut == data_end) ? data_end : cut + 1;
+            }
+            chunk->end = cut;
+        }
+        if (chunk->end == data_end && chunk->end[-1] != '\n') {
+            // The last line is not terminated, copy the last chunk to terminate it.
+            chunk->storage.assign(chunk->begin, chunk->end);
+            chunk->storage.emplace_back(0);
+            chunk->begin = chunk->storage.data();
+            chunk->end   = chunk->begin + chunk->storage.size() - 1;
+        }
+        file_pos += chunk->end - chunk->begin;
+        eof = file_pos == mapped.size();
+        return chunk;
+    };
+
+    auto next_read_chunk = [&]() -> ParsedChunkPtr {
+        auto chunk = std::make_shared<ParsedChunk>();
+        chunk->file_pos = file_pos - carry.size();
+        chunk->storage.swap(carry);
+        size_t old_size = chunk->storage.size();
+        chunk->storage.resize(old_size + chunk_size);
+        size_t cnt_read = ::fread(chunk->storage.data() + old_size, 1, chunk_size, in.f);
+        if (::ferror(in.f)) {
+            read_failed = true;
+            return {};
+        }
+        chunk->storage.resize(old_size + cnt_read);
+        file_pos += cnt_read;
+        eof = cnt_read < chunk_size;
+        if (! eof) {
+            // Pass the incomplete last line to the next chunk.
+            size_t cut = cut_at_last_eol(chunk->storage.data(), chunk->storage.data() + chunk->storage.size()) - chunk->storage.data();
+            carry.assign(chunk->storage.begin() + cut, chunk->storage.end());
+            chunk->storage.resize(cut);
+        }
+        chunk->storage.emplace_back(0);
+        chunk->begin = chunk->storage.data();
+        chunk->end   = chunk->begin + chunk->storage.size() - 1;
+        return chunk;
+    };
+
+    const auto reader = tbb::make_filter<void, ParsedChunkPtr>(slic3r_tbb_filtermode::serial_in_order,
+        [&](tbb::flow_control &fc) -> ParsedChunkPtr {
+            ParsedChunkPtr chunk;
+            if (! eof && m_parsing)
+                chunk = mapped.is_open() ? next_mapped_chunk() : next_read_chunk();
+            if (! chunk)
+                fc.stop();
+            return chunk;
+        });
+
+    const auto tokenizer = tbb::make_filter<ParsedChunkPtr, ParsedChunkPtr>(slic3r_tbb_filtermode::parallel,
+        [](ParsedChunkPtr chunk) -> ParsedChunkPtr {
+            const char *begin = chunk->begin;
+            const char *end   = chunk->end;
+            const char *it    = begin;
+            while (it != end) {
+                // Find end of line.
+                const char *it_end = find_eol(it, end);
+                // Skip the line number, see parse_file_internal().
+                const char *line_begin = skip_whitespaces(it);
+                if (std::toupper(*line_begin) == 'N')
+                    line_begin = skip_word(line_begin);
+                line_begin = skip_whitespaces(line_begin);
+                TokenizedLine &line = chunk->lines.emplace_back();
+                memset(line.axis, 0, sizeof(line.axis));
+                line.mask      = 0;
+                std::pair<const char*, const char*> command;
+                line.raw_begin   = line_begin;
+                line.raw_end     = std::max(line_begin, tokenize_line(line_begin, it_end, end, line.axis, line.mask, command));
+                line.cmd_type    = classify_command(command);
+                line.has_comment = std::find(command.second, line.raw_end, ';') != line.raw_end;
+                // Skip EOL.
+                it = it_end;
+                if (it != end && *it == '\r')
+                    ++ it;
+                line.line_end = 0;
+                if (it != end && *it == '\n') {
+                    ++ it;
+                    line.line_end = chunk->file_pos + (it - begin);
+                }
+            }
+            return chunk;
+        });
+
+    GCodeLine gline;
+    const auto consumer = tbb::make_filter<ParsedChunkPtr, void>(slic3r_tbb_filtermode::serial_in_order,
+        [this, &callback, &lines_ends, &gline, raw_moves](ParsedChunkPtr chunk) {
+            for (size_t i = 0; i < chunk->lines.size() && m_parsing; ++ i) {
+                TokenizedLine &line = chunk->lines[i];
+                // Reuse a single GCodeLine, so that its raw string is only reallocated when a longer line is met.
+                memcpy(gline.m_axis, line.axis, sizeof(gline.m_axis));
+                gline.m_mask     = line.mask;
+                gline.m_cmd_type = line.cmd_type;
+                if (raw_moves || line.has_comment || ! gline.is_move())
+                    gline.m_raw.assign(line.raw_begin, line.raw_end);
+                else
+                    gline.m_raw.clear();
+                if (gline.has(E) && m_config.use_relative_e_distances)
+                    m_position[E] = 0;
+                if (m_verbose)
+                    std::cout << gline.m_raw << std::endl;
+                callback(*this, gline);
+                update_coordinates(gline);
+                if (m_parsing && line.line_end != 0)
+                    lines_ends.emplace_back(line.line_end);
+            }
+        });
+
+    tbb::parallel_pipeline(std::max<size_t>(4, 2 * tbb::this_task_arena::max_concurrency()), reader & tokenizer & consumer);
+
+    BOOST_LOG_TRIVIAL(info) << __FUNCTION__ << boost::format(":  finished parse_file %1%") % file.c_str();
+    return ! read_failed;
+}
+
 bool GCodeReader::GCodeLine::has(char axis) const
 {
     const char *c = m_raw.c_str();
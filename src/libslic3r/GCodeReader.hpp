@@ -15,14 +15,22 @@ class GCodeReader {
 public:
     class GCodeLine {
     public:
+        // Command classified by the tokenizer, thus the consumers of the moves do not need to parse the command again.
+        enum class ECmd : unsigned char { Other, G0, G1, G2, G3, G92 };
+
         GCodeLine() { reset(); }
-        void reset() { m_mask = 0; memset(m_axis, 0, sizeof(m_axis)); m_raw.clear(); }
+        void reset() { m_mask = 0; m_cmd_type = ECmd::Other; memset(m_axis, 0, sizeof(m_axis)); m_raw.clear(); }
 
+        // May be empty for a move without a comment, see parse_file_parallel().
         const std::string&      raw() const { return m_raw; }
         const std::string_view  cmd() const { 
+            if (m_cmd_type != ECmd::Other)
+                return cmd_name(m_cmd_type);
             const char *cmd = GCodeReader::skip_whitespaces(m_raw.c_str());
             return std::string_view(cmd, GCodeReader::skip_word(cmd) - cmd);
         }
+        ECmd  cmd_type() const { return m_cmd_type; }
+        bool  is_move() const { return m_cmd_type >= ECmd::G0 && m_cmd_type <= ECmd::G3; }
         const std::string_view  comment() const
             { size_t pos = m_raw.find(';'); return (pos == std::string::npos) ? std::string_view() : std::string_view(m_raw).substr(pos + 1); }
 
@@ -45,7 +53,7 @@ public:
             float y = this->has(Y) ? (this->y() - reader.y()) : 0;
             return sqrt(x*x + y*y);
         }
-        bool cmd_is(const char *cmd_test)          const { return cmd_is(m_raw, cmd_test); }
+        bool cmd_is(const char *cmd_test)          const { return this->cmd() == cmd_test; }
         //BBS: modify to support G2 and G3
         bool extruding(const GCodeReader &reader)  const { return (this->cmd_is("G1") || this->cmd_is("G2") || this->cmd_is("G3")) && this->dist_E(reader) > 0; }
         bool retracting(const GCodeReader &reader) const { return (this->cmd_is("G1") || this->cmd_is("G2") || this->cmd_is("G3")) && this->dist_E(reader) < 0; }
@@ -78,11 +86,22 @@ public:
             size_t len = strlen(cmd_test); 
             return strncmp(cmd, cmd_test, len) == 0 && GCodeReader::is_end_of_word(cmd[len]);
         }
+        static std::string_view cmd_name(ECmd cmd_type) {
+            switch (cmd_type) {
+            case ECmd::G0:  return "G0";
+            case ECmd::G1:  return "G1";
+            case ECmd::G2:  return "G2";
+            case ECmd::G3:  return "G3";
+            case ECmd::G92: return "G92";
+            default:        return {};
+            }
+        }
 
     private:
         std::string      m_raw;
         float            m_axis[NUM_AXES];
         uint32_t         m_mask;
+        ECmd             m_cmd_type;
         friend class GCodeReader;
     };
 
@@ -110,13 +129,13 @@ public:
     void parse_buffer(const std::string &buffer)
         { this->parse_buffer(buffer, [](GCodeReader&, const GCodeReader::GCodeLine&){}); }
 
+    // buffer_end is the end of the readable memory the line is part of, it may extend beyond the end of the line.
     template<typename Callback>
-    const char* parse_line(const char *ptr, const char *end, GCodeLine &gline, Callback &callback)
+    const char* parse_line(const char *ptr, const char *end, GCodeLine &gline, Callback &callback, const char *buffer_end = nullptr)
     {
-        std::pair<const char*, const char*> cmd;
-        const char *line_end = parse_line_internal(ptr, end, gline, cmd);
+        const char *line_end = parse_line_internal(ptr, end, buffer_end ? buffer_end : end, gline);
         callback(*this, gline);
-        update_coordinates(gline, cmd);
+        update_coordinates(gline);
         return line_end;
     }
 
@@ -130,7 +149,19 @@ public:
     // as an overlay in the 3D scene.
     bool parse_file(const std::string &file, callback_t callback, std::vector<size_t> &lines_ends);
     // Just read the G-code file line by line, calls callback (const char *begin, const char *end). Returns false if reading the file failed.
+    // The file is memory mapped if possible and the lines are passed to the callback without copying.
     bool parse_file_raw(const std::string &file, raw_line_callback_t callback);
+    // Same as parse_file() with lines_ends, but the file is split into chunks at line boundaries and the chunks are tokenized
+    // into GCodeLines on TBB worker threads. The callback and the update of the current position are still called serially
+    // in the order of the lines, thus the callback sees exactly the same sequence of lines as with parse_file().
+    // The workers emit move records with the command already classified. If raw_moves is false, the raw text of the G0 to G3 moves
+    // without a comment is not copied for the callback, which then has to rely on the axes and on cmd_type() / cmd() of such moves.
+    bool parse_file_parallel(const std::string &file, callback_t callback, std::vector<size_t> &lines_ends, bool raw_moves = true);
+
+    // Vectorized part of the tokenizer of a line <ptr, end), which lies in a readable buffer ending at buffer_end.
+    // The separators are searched in a 64 byte window, which has to fit into the buffer, though not necessarily into the line.
+    // Returns nullptr if the line could not be tokenized this way, otherwise the same as the scalar tokenizer.
+    static const char* tokenize_line_vectorized(const char *ptr, const char *end, const char *buffer_end, float *axis_values, uint32_t &mask, std::pair<const char*, const char*> &command);
 
     // To be called by the callback to stop parsing.
     void quit_parsing() { m_parsing = false; }
@@ -157,8 +188,12 @@ private:
     template<typename ParseLineCallback, typename LineEndCallback>
     bool        parse_file_internal(const std::string &filename, ParseLineCallback parse_line_callback, LineEndCallback line_end_callback);
 
-    const char* parse_line_internal(const char *ptr, const char *end, GCodeLine &gline, std::pair<const char*, const char*> &command);
-    void        update_coordinates(GCodeLine &gline, std::pair<const char*, const char*> &command);
+    const char* parse_line_internal(const char *ptr, const char *end, const char *buffer_end, GCodeLine &gline);
+    // Stateless part of parse_line_internal(), may be called from worker threads.
+    // Fills in the axis values and mask, returns the end of the line without the trailing newlines.
+    static const char* tokenize_line(const char *ptr, const char *end, const char *buffer_end, float *axis_values, uint32_t &mask, std::pair<const char*, const char*> &command);
+    static GCodeLine::ECmd classify_command(const std::pair<const char*, const char*> &command);
+    void        update_coordinates(GCodeLine &gline);
 
     static bool         is_whitespace(char c)           { return c == ' ' || c == '\t'; }
     static bool         is_end_of_line(char c)          { return c == '\r' || c == '\n' || c == 0; }
@@ -4,6 +4,7 @@
 #include "libslic3r.h"
 #include <string>
 #include <charconv>
+#include <mutex>
 #include "Extruder.hpp"
 #include "Point.hpp"
 #include "PrintConfig.hpp"
@@ -67,13 +68,19 @@ public:
     std::string toolchange(unsigned int extruder_id);
     std::string set_speed(double F, const std::string &comment = std::string(), const std::string &cooling_marker = std::string()) const;
     std::string travel_to_xy(const Vec2d &point, const std::string &comment = std::string());
+    // Variants of the moves above, which append the G-code line to out instead of returning a new string.
+    // To be used in loops over path points.
+    void        travel_to_xy(std::string &out, const Vec2d &point, const std::string &comment = std::string());
     std::string travel_to_xyz(const Vec3d &point, const std::string &comment = std::string());
     std::string travel_to_z(double z, const std::string &comment = std::string());
     bool        will_move_z(double z) const;
     std::string extrude_to_xy(const Vec2d &point, double dE, const std::string &comment = std::string(), bool force_no_extrusion = false);
+    void        extrude_to_xy(std::string &out, const Vec2d &point, double dE, const std::string &comment = std::string(), bool force_no_extrusion = false);
     //BBS: generate G2 or G3 extrude which moves by arc
     std::string extrude_arc_to_xy(const Vec2d &point, const Vec2d &center_offset, double dE, const bool is_ccw, const std::string &comment = std::string(), bool force_no_extrusion = false);
+    void        extrude_arc_to_xy(std::string &out, const Vec2d &point, const Vec2d &center_offset, double dE, const bool is_ccw, const std::string &comment = std::string(), bool force_no_extrusion = false);
     std::string extrude_to_xyz(const Vec3d &point, double dE, const std::string &comment = std::string(), bool force_no_extrusion = false);
+    void        extrude_to_xyz(std::string &out, const Vec3d &point, double dE, const std::string &comment = std::string(), bool force_no_extrusion = false);
     std::string retract(bool before_wipe = false);
     std::string retract_for_toolchange(bool before_wipe = false);
     std::string unretract();
@@ -221,6 +228,12 @@ public:
         return std::string(this->buf, ptr_err.ptr - buf);
     }
 
+    // Terminate the line and append it to out, without creating a temporary string.
+    void append_to(std::string &out) {
+        *ptr_err.ptr ++ = '\n';
+        out.append(this->buf, ptr_err.ptr - buf);
+    }
+
 protected:
     static constexpr const size_t   buflen = 256;
     char                            buf[buflen];
@@ -254,6 +267,47 @@ public:
     GCodeG2G3Formatter& operator=(const GCodeG2G3Formatter&) = delete;
 };
 
+// Free list of G-code buffers shared by the stages of the G-code export pipeline.
+// The G-code of a layer is generated into a buffer released by one of the previous layers,
+// thus after the first few layers the layer G-code is appended into already allocated memory.
+// Thread safe, the pipeline stages run on different threads.
+class GCodeBufferPool {
+public:
+    // Returns an empty buffer, with the capacity of a previously released buffer if one is available.
+    std::string acquire() {
+        std::string out;
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (! m_buffers.empty()) {
+            out.swap(m_buffers.back());
+            m_buffers.pop_back();
+        }
+        return out;
+    }
+
+    // Return a buffer to the pool. Its content is discarded, its capacity is kept for the next acquire().
+    void release(std::string &&buffer) {
+        if (buffer.capacity() < min_capacity)
+            return;
+        buffer.clear();
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_buffers.size() < max_buffers)
+            m_buffers.emplace_back(std::move(buffer));
+    }
+
+    void clear() {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_buffers.clear();
+    }
+
+private:
+    // Don't bother with short strings, they may live in the small string buffer.
+    static constexpr const size_t   min_capacity = 4096;
+    // Enough for the layers in flight in the export pipeline.
+    static constexpr const size_t   max_buffers  = 32;
+    std::mutex                      m_mutex;
+    std::vector<std::string>        m_buffers;
+};
+
 } /* namespace Slic3r */
 
 #endif /* slic3r_GCodeWriter_hpp_ */
@@ -402,6 +402,26 @@ coordf_t Layer::get_sparse_infill_max_void_area()
     return max_void_area;
 }
 
+void Layer::release_exported_data()
+{
+    for (LayerRegion *layerm : m_regions) {
+        layerm->perimeters.clear();
+        layerm->fills.clear();
+        layerm->flat_toolpaths.clear();
+        layerm->thin_fills.clear();
+        ExPolygons().swap(layerm->fill_expolygons);
+        ExPolygons().swap(layerm->fill_no_overlap_expolygons);
+        Polylines().swap(layerm->unsupported_bridge_edges);
+    }
+}
+
+void SupportLayer::release_exported_data()
+{
+    Layer::release_exported_data();
+    support_fills.clear();
+    flat_toolpaths.clear();
+}
+
 BoundingBox get_extents(const LayerRegion &layer_region)
 {
     BoundingBox bbox;
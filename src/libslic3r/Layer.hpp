@@ -6,6 +6,7 @@
 #include "Flow.hpp"
 #include "SurfaceCollection.hpp"
 #include "ExtrusionEntityCollection.hpp"
+#include "FlatToolpaths.hpp"
 #include "RegionExpansion.hpp"
 
 
@@ -73,6 +74,10 @@ public:
     // (this collection contains only ExtrusionEntityCollection objects)
     ExtrusionEntityCollection   fills;
 
+    // BBS: flat copy of the final perimeters and fills, stored as two top level collections in this order.
+    // Built by PrintObject::make_flat_toolpaths(), read by the conflict checker and the seam placer.
+    FlatToolpaths               flat_toolpaths;
+
     Flow    flow(FlowRole role) const;
     Flow    flow(FlowRole role, double layer_height) const;
     Flow    bridging_flow(FlowRole role, bool thick_bridge = false) const;
@@ -100,6 +105,7 @@ public:
     //BBS
     void    simplify_infill_extrusion_entity() { simplify_entity_collection(&fills); }
     void    simplify_wall_extrusion_entity() { simplify_entity_collection(&perimeters); }
+    void    make_flat_toolpaths() { this->flat_toolpaths = FlatToolpaths({ &this->perimeters, &this->fills }); }
 private:
     void    simplify_entity_collection(ExtrusionEntityCollection* entity_collection);
     void    simplify_path(ExtrusionPath* path);
@@ -203,6 +209,11 @@ public:
     void simplify_infill_extrusion_path() { for (auto layerm : m_regions) layerm->simplify_infill_extrusion_entity(); }
     //BBS: this function calculate the maximum void grid area of sparse infill of this layer. Just estimated value
     coordf_t get_sparse_infill_max_void_area();
+    //BBS: low memory mode (Print::low_memory_mode()), release the toolpaths once the G-code of the layer was generated.
+    // The slices and surfaces are kept: the G-code of the objects printed later reads them, for example
+    // AvoidCrossingPerimeters reads the layers of all the objects at a print_z, and ToolOrdering the raw_slices
+    // of the first layer when printing by object.
+    virtual void release_exported_data();
 
     // FN_HIGHER_EQUAL: the provided object pointer has a Z value >= of an internal threshold.
     // Find the first item with Z value >= of an internal threshold of fn_higher_equal.
@@ -275,6 +286,8 @@ public:
     ExPolygons                  support_islands;
     // Extrusion paths for the support base and for the support interface and contacts.
     ExtrusionEntityCollection   support_fills;
+    // BBS: flat copy of the final support_fills, built by PrintObject::make_flat_toolpaths().
+    FlatToolpaths               flat_toolpaths;
     SupportInnerType            support_type = stInnerNormal;
 
     // for tree supports
@@ -288,6 +301,8 @@ public:
     size_t                      interface_id() const { return m_interface_id; }
 
     void simplify_support_extrusion_path() { this->simplify_support_entity_collection(&support_fills); }
+    void make_flat_toolpaths() { this->flat_toolpaths = FlatToolpaths({ &this->support_fills }); }
+    void release_exported_data() override;
 
 protected:
     friend class PrintObject;
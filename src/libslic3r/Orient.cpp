@@ -1,6 +1,7 @@
 #include "Orient.hpp"
 #include "Geometry.hpp"
 #include <numeric>
+#include <memory>
 #include <ClipperUtils.hpp>
 #include <boost/geometry/index/rtree.hpp>
 #include <tbb/parallel_for.h>
@@ -52,6 +53,54 @@ namespace orientation {
     };
 
 
+    // BBS: facet areas bucketed by the direction of the facet normal into a grid of equal area cells on the unit sphere:
+    // rings of equal height in z (the area of a spherical zone only depends on its height), each split into sectors
+    // of equal azimuth. A direction is scored on the non-empty bins instead of on all the facets.
+    struct NormalHistogram {
+        static constexpr int rings   = 32;
+        static constexpr int sectors = 64;
+
+        struct Bin {
+            Vec3f normal { 0, 0, 0 };       // area weighted mean of the facet normals
+            float area = 0;
+            float area_appearance = 0;      // area with the penalty of the appearance facets
+            Vec3f largest_normal { 0, 0, 0 };
+            float largest_area = 0;
+        };
+        std::vector<Bin> bins;              // non-empty bins only
+
+        NormalHistogram(const std::vector<Vec3f>& normals, const Eigen::VectorXf& areas, const Eigen::VectorXf* is_apperance, float apperance_penalty)
+        {
+            std::vector<Bin> grid(rings * sectors);
+            for (size_t i = 0; i < normals.size(); i++) {
+                const Vec3f& n = normals[i];
+                if (n.squaredNorm() < 0.5f)
+                    continue;   // degenerate facet
+                Bin& bin = grid[index(n)];
+                float area = areas(i);
+                bin.normal += n * area;
+                bin.area += area;
+                bin.area_appearance += is_apperance ? area * ((*is_apperance)(i) * apperance_penalty + 1) : area;
+                if (area > bin.largest_area) {
+                    bin.largest_area = area;
+                    bin.largest_normal = n;
+                }
+            }
+            for (Bin& bin : grid)
+                if (bin.area > 0) {
+                    float len = bin.normal.norm();
+                    bin.normal = len > EPSILON ? Vec3f(bin.normal / len) : bin.largest_normal;
+                    bins.emplace_back(bin);
+                }
+        }
+
+        static int index(const Vec3f& n)
+        {
+            int ring   = std::clamp(int((n.z() + 1.f) * 0.5f * rings), 0, rings - 1);
+            int sector = std::clamp(int((std::atan2(n.y(), n.x()) + float(PI)) / float(2. * PI) * sectors), 0, sectors - 1);
+            return ring * sectors + sector;
+        }
+    };
 
 // A class encapsulating the libnest2d Nester class and extending it with other
 // management and spatial index structures for acceleration.
@@ -64,13 +113,18 @@ public:
     Eigen::MatrixXf normals, normals_quantize, normals_hull, normals_hull_quantize;
     Eigen::VectorXf areas, areas_hull;
     Eigen::VectorXf is_apperance; // whether a facet is outer apperance
-    Eigen::MatrixXf z_projected;
-    Eigen::VectorXf z_max, z_max_hull;  // max of projected z
-    Eigen::VectorXf z_median;  // median of projected z
-    Eigen::VectorXf z_mean;  // mean of projected z
     std::vector<Vec3f> face_normals;
     std::vector<Vec3f> face_normals_hull;
     OrientParams params;
+    float area_total = 0, radius = 0, volume = 0;
+
+    // Facet vertices projected to an orientation. Kept per orientation, so that the orientations may be evaluated in parallel.
+    struct Projection {
+        Eigen::MatrixXf z_projected;
+        Eigen::VectorXf z_max, z_max_hull;  // max of projected z
+        Eigen::VectorXf z_median;  // median of projected z
+        Eigen::VectorXf z_mean;  // mean of projected z
+    };
 
 
     std::vector< Vec3f> orientations;  // Vec3f == stl_normal
@@ -123,34 +177,52 @@ public:
         if(progressind)
             progressind(20);
 
+        // BBS: rank the candidates on the histograms of the facet normals, evaluate only the best ones exactly.
+        bool use_histogram = params.exact_candidates > 0;
+        std::unique_ptr<NormalHistogram> histogram, histogram_hull;
+        if (use_histogram) {
+            histogram      = std::make_unique<NormalHistogram>(face_normals, areas, &is_apperance, params.APPERANCE_FACE_SUPP);
+            histogram_hull = std::make_unique<NormalHistogram>(face_normals_hull, areas_hull, nullptr, 0.f);
+            add_histogram_directions(*histogram);
+        }
+
         remove_duplicates();
 
+        if (use_histogram)
+            select_candidates(*histogram, *histogram_hull, size_t(params.exact_candidates));
+
         if (progressind)
             progressind(30);
 
-        std::unordered_map<Vec3f, CostItems, VecHash> results;
-        BOOST_LOG_TRIVIAL(info) << CostItems::field_names();
-        std::cout << CostItems::field_names() << std::endl;
-        for (int i = 0; i < orientations.size();i++) {
-            auto orientation = -orientations[i];
+        typedef std::pair<Vec3f, CostItems> PAIR;
+        std::vector<PAIR> results_vector(orientations.size());
+        // BBS: the candidates are always evaluated in parallel, also when the meshes are oriented one by one
+        // (OrientParams::parallel is false, as with the CLI --orient): a single mesh is the common case.
+        tbb::parallel_for(tbb::blocked_range<size_t>(0, orientations.size()), [this, &results_vector](const tbb::blocked_range<size_t>& range) {
+            Projection proj;
+            for (size_t i = range.begin(); i < range.end(); ++ i) {
+                auto orientation = -orientations[i];
 
-            project_vertices(orientation);
+                project_vertices(orientation, proj);
 
-            auto cost_items = get_features(orientation, params.min_volume);
+                auto cost_items = get_features(orientation, proj, params.min_volume);
 
-            float unprintability = target_function(cost_items, params.min_volume);
+                target_function(cost_items, params.min_volume);
 
-            results[orientation] = cost_items;
+                results_vector[i] = { orientation, cost_items };
+            }
+        });
 
-            BOOST_LOG_TRIVIAL(info) << std::fixed << std::setprecision(4) << "orientation:" << orientation.transpose() << ", cost:" << std::fixed << std::setprecision(4) << cost_items.field_values();
-            std::cout << std::fixed << std::setprecision(4) << "orientation:" << orientation.transpose() << ", cost:" << std::fixed << std::setprecision(4) << cost_items.field_values() << std::endl;
+        BOOST_LOG_TRIVIAL(info) << CostItems::field_names();
+        std::cout << CostItems::field_names() << std::endl;
+        for (PAIR& result : results_vector) {
+            BOOST_LOG_TRIVIAL(info) << std::fixed << std::setprecision(4) << "orientation:" << result.first.transpose() << ", cost:" << std::fixed << std::setprecision(4) << result.second.field_values();
+            std::cout << std::fixed << std::setprecision(4) << "orientation:" << result.first.transpose() << ", cost:" << std::fixed << std::setprecision(4) << result.second.field_values() << std::endl;
         }
         if (progressind)
             progressind(60);
 
-        typedef std::pair<Vec3f, CostItems> PAIR;
-        std::vector<PAIR> results_vector(results.begin(), results.end());
-        sort(results_vector.begin(), results_vector.end(), [](const PAIR& p1, const PAIR& p2) {return p1.second.unprintability < p2.second.unprintability; });
+        std::stable_sort(results_vector.begin(), results_vector.end(), [](const PAIR& p1, const PAIR& p2) {return p1.second.unprintability < p2.second.unprintability; });
 
         if (progressind)
             progressind(80);
@@ -203,6 +275,11 @@ public:
         if (orient_mesh)
             BOOST_LOG_TRIVIAL(debug) <<orient_mesh->name<< ", count_apperance=" << count_apperance;
 
+        // independent of the orientation
+        area_total = mesh->bounding_box().area();
+        radius = mesh->bounding_box().radius();
+        volume = mesh->stats().volume > 0 ? mesh->stats().volume : its_volume(mesh->its);
+
         // get convex hull statistics
         {
             mesh_convex_hull = mesh->convex_hull_3d();
@@ -292,6 +369,80 @@ public:
         orientations.insert(orientations.end(), vecs.begin(), vecs.end());
     }
 
+    // BBS: the directions of the bins holding the largest areas, taken from their largest facets.
+    void add_histogram_directions(const NormalHistogram& histogram, size_t num_directions = 32)
+    {
+        std::vector<const NormalHistogram::Bin*> bins;
+        for (const NormalHistogram::Bin& bin : histogram.bins)
+            bins.emplace_back(&bin);
+        num_directions = std::min(num_directions, bins.size());
+        std::partial_sort(bins.begin(), bins.begin() + num_directions, bins.end(),
+            [](const NormalHistogram::Bin* b1, const NormalHistogram::Bin* b2) { return b1->area > b2->area; });
+        for (size_t i = 0; i < num_directions; i++)
+            orientations.push_back(bins[i]->largest_normal);
+    }
+
+    // BBS: estimate of the costs of an orientation from the histograms of the facet normals.
+    // The facets facing down are taken as the bottom, up to the bottom of the convex hull, the other facets
+    // facing down below the overhang angle as the overhang. The heights of the facets are not known,
+    // thus the minimum volume overhang uses the radius of the bounding box as the height.
+    CostItems coarse_features(const Vec3f& orientation, const NormalHistogram& histogram, const NormalHistogram& histogram_hull) const
+    {
+        const float cos_bottom = params.LAF_MAX;
+        CostItems costs;
+        costs.area_total = area_total;
+        costs.radius = radius;
+        costs.volume = volume;
+
+        for (const NormalHistogram::Bin& bin : histogram_hull.bins)
+            if (bin.normal.dot(orientation) < -cos_bottom)
+                costs.bottom_hull += bin.area;
+
+        float facing_down = 0, facing_down_appearance = 0, overhang = 0;
+        for (const NormalHistogram::Bin& bin : histogram.bins) {
+            float proj = bin.normal.dot(orientation);
+            if (proj < -cos_bottom) {
+                facing_down += bin.area;
+                facing_down_appearance += bin.area_appearance;
+            } else if (proj < params.ASCENT) {
+                overhang += bin.area_appearance * (params.min_volume ? (params.ASCENT - proj) * radius : 1.f);
+            }
+            float proj_abs = std::abs(proj);
+            if (proj_abs < params.LAF_MAX && proj_abs > params.LAF_MIN)
+                costs.area_laf += bin.area;
+        }
+        float bottom = std::min(facing_down, costs.bottom_hull);
+        if (facing_down > 0)
+            overhang += facing_down_appearance * (1.f - bottom / facing_down) * (params.min_volume ? (params.ASCENT + 1.f) * radius : 1.f);
+        // a flat bottom is counted by both the first layer and the half of the first layer in get_features()
+        costs.bottom = 1.5f * bottom;
+        costs.overhang = overhang;
+        costs.contour = 4 * sqrt(costs.bottom);
+        return costs;
+    }
+
+    // BBS: keep the original orientation and the candidates with the lowest estimated costs.
+    void select_candidates(const NormalHistogram& histogram, const NormalHistogram& histogram_hull, size_t num_candidates)
+    {
+        if (orientations.size() <= num_candidates)
+            return;
+        std::vector<float> estimates(orientations.size());
+        for (size_t i = 0; i < orientations.size(); i++) {
+            CostItems costs = coarse_features(-orientations[i], histogram, histogram_hull);
+            estimates[i] = target_function(costs, params.min_volume);
+        }
+        std::vector<size_t> order(orientations.size() - 1);
+        std::iota(order.begin(), order.end(), 1);
+        std::stable_sort(order.begin(), order.end(), [&estimates](size_t i1, size_t i2) { return estimates[i1] < estimates[i2]; });
+        order.resize(num_candidates - 1);
+        std::sort(order.begin(), order.end());
+
+        std::vector<Vec3f> selected = { orientations.front() };
+        for (size_t i : order)
+            selected.emplace_back(orientations[i]);
+        orientations = std::move(selected);
+    }
+
     /// <summary>
     /// remove duplicate orientations
     /// </summary>
@@ -316,35 +467,35 @@ public:
         }
     }
 
-    void project_vertices(Vec3f orientation)
+    void project_vertices(Vec3f orientation, Projection& proj) const
     {
         int face_count = mesh->facets_count();
-        auto its = mesh->its;
-        z_projected.resize(face_count, 3);
-        z_max.resize(face_count, 1);
-        z_median.resize(face_count, 1);
-        z_mean.resize(face_count, 1);
+        const indexed_triangle_set& its = mesh->its;
+        proj.z_projected.resize(face_count, 3);
+        proj.z_max.resize(face_count, 1);
+        proj.z_median.resize(face_count, 1);
+        proj.z_mean.resize(face_count, 1);
         for (size_t i = 0; i < face_count; i++)
         {
             float z0 = its.get_vertex(i,0).dot(orientation);
             float z1 = its.get_vertex(i,1).dot(orientation);
             float z2 = its.get_vertex(i,2).dot(orientation);
-            z_projected(i, 0) = z0;
-            z_projected(i, 1) = z1;
-            z_projected(i, 2) = z2;
-            z_max(i) = MAX3(z0,z1,z2);
-            z_median(i) = MEDIAN3(z0,z1,z2);
-            z_mean(i) = (z0 + z1 + z2) / 3;
+            proj.z_projected(i, 0) = z0;
+            proj.z_projected(i, 1) = z1;
+            proj.z_projected(i, 2) = z2;
+            proj.z_max(i) = MAX3(z0,z1,z2);
+            proj.z_median(i) = MEDIAN3(z0,z1,z2);
+            proj.z_mean(i) = (z0 + z1 + z2) / 3;
         }
 
-        z_max_hull.resize(mesh_convex_hull.facets_count(), 1);
-        its = mesh_convex_hull.its;
-        for (size_t i = 0; i < z_max_hull.rows(); i++)
+        const indexed_triangle_set& its_hull = mesh_convex_hull.its;
+        proj.z_max_hull.resize(mesh_convex_hull.facets_count(), 1);
+        for (size_t i = 0; i < proj.z_max_hull.rows(); i++)
         {
-            float z0 = its.get_vertex(i,0).dot(orientation);
-            float z1 = its.get_vertex(i,1).dot(orientation);
-            float z2 = its.get_vertex(i,2).dot(orientation);
-            z_max_hull(i) = MAX3(z0, z1, z2);
+            float z0 = its_hull.get_vertex(i,0).dot(orientation);
+            float z1 = its_hull.get_vertex(i,1).dot(orientation);
+            float z2 = its_hull.get_vertex(i,2).dot(orientation);
+            proj.z_max_hull(i) = MAX3(z0, z1, z2);
         }
     }
 
@@ -372,15 +523,16 @@ public:
     }
 
     // previously calc_overhang
-    CostItems get_features(Vec3f orientation, bool min_volume = true)
+    CostItems get_features(Vec3f orientation, const Projection& proj, bool min_volume = true) const
     {
         CostItems costs;
-        costs.area_total = mesh->bounding_box().area();
-        costs.radius = mesh->bounding_box().radius();
-        // volume
-        costs.volume = mesh->stats().volume > 0 ? mesh->stats().volume : its_volume(mesh->its);
+        costs.area_total = area_total;
+        costs.radius = radius;
+        costs.volume = volume;
 
-        float total_min_z = z_projected.minCoeff();
+        const Eigen::VectorXf& z_max = proj.z_max;
+        const Eigen::VectorXf& z_max_hull = proj.z_max_hull;
+        float total_min_z = proj.z_projected.minCoeff();
         // filter bottom area
         auto bottom_condition = z_max.array() < total_min_z + this->params.FIRST_LAY_H - EPSILON;
         auto bottom_condition_hull = z_max_hull.array() < total_min_z + this->params.FIRST_LAY_H - EPSILON;
@@ -403,7 +555,7 @@ public:
         inner = inner.cwiseMin(0).cwiseAbs();
         if (min_volume)
         {
-            Eigen::MatrixXf heights = z_mean.array() - total_min_z;
+            Eigen::MatrixXf heights = proj.z_mean.array() - total_min_z;
             costs.overhang = (heights.array()* overhang_areas.array()*inner.array()).sum();
         }
         else {
@@ -423,7 +575,7 @@ public:
             for (size_t i = 0; i < face_count; i++)
             {
                 if (bottom_condition(i)) {
-                    Eigen::VectorXi index = argsort(z_projected.row(i));
+                    Eigen::VectorXi index = argsort(proj.z_projected.row(i));
                     stl_vertex line = its.get_vertex(i, index(0)) - its.get_vertex(i, index(1));
                     contour += line.norm();
                     contour_amout++;
@@ -448,7 +600,7 @@ public:
         return costs;
     }
 
-    float target_function(CostItems& costs, bool min_volume)
+    float target_function(CostItems& costs, bool min_volume) const
     {
         float cost=0;
         float bottom = costs.bottom;//std::min(costs.bottom, params.BOTTOM_MAX);
@@ -76,7 +76,11 @@ struct OrientParamsArea {
     bool min_volume = false;
     Eigen::Vector3f fun_dir;
 
-    /// Allow parallel execution.
+    /// BBS: Number of candidate orientations evaluated exactly. The candidates are ranked
+    /// by a histogram of the facet normals first. Zero evaluates all the candidates exactly.
+    int exact_candidates = 12;
+
+    /// Orient the meshes in parallel. The candidate orientations of a mesh are evaluated in parallel regardless.
     bool parallel = true;
 
     /// Progress indicator callback called when an object gets packed.
@@ -124,8 +128,12 @@ struct OrientParams {
     bool min_volume = false;
     Eigen::Vector3f fun_dir;
 
+    /// BBS: Number of candidate orientations evaluated exactly. The candidates are ranked
+    /// by a histogram of the facet normals first. Zero evaluates all the candidates exactly.
+    /// Keep the layout of OrientParamsArea in sync, it is copied over OrientParams.
+    int exact_candidates = 12;
 
-    /// Allow parallel execution.
+    /// Orient the meshes in parallel. The candidate orientations of a mesh are evaluated in parallel regardless.
     bool parallel = false;
 
     /// Progress indicator callback called when an object gets packed.
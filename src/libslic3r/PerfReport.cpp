@@ -0,0 +1,231 @@
+#include "PerfReport.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#ifdef WIN32
+    #include <windows.h>
+    #include <psapi.h>
+#else
+    #include <sys/resource.h>
+#endif
+
+#include <boost/log/trivial.hpp>
+#include <boost/nowide/fstream.hpp>
+
+#include "nlohmann/json.hpp"
+
+namespace Slic3r {
+namespace PerfReport {
+
+namespace detail {
+    std::atomic<bool> s_enabled { false };
+}
+
+namespace {
+
+struct Event
+{
+    const char  *category;
+    std::string  name;
+    std::string  object;
+    int          tid;
+    Sample       start;
+    Sample       end;
+    size_t       tasks;
+    // Busy time of a Stage, equals to the duration otherwise.
+    int64_t      busy_us;
+};
+
+using Clock = std::chrono::steady_clock;
+
+std::mutex          s_mutex;
+std::vector<Event>  s_events;
+// Clock::now() when the report was enabled, read by the recording threads.
+std::atomic<Clock::rep> s_epoch { Clock::now().time_since_epoch().count() };
+std::atomic<int>    s_last_tid { 0 };
+
+int64_t wall_us()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(Clock::now().time_since_epoch() - Clock::duration(s_epoch.load(std::memory_order_relaxed))).count();
+}
+
+// Small sequential thread ids, so that the threads are shown in a stable order by the trace viewers.
+int thread_id()
+{
+    thread_local int tid = ++ s_last_tid;
+    return tid;
+}
+
+void process_times(int64_t &cpu_us, int64_t &peak_rss_kb)
+{
+#ifdef WIN32
+    FILETIME creation_time, exit_time, kernel_time, user_time;
+    if (GetProcessTimes(GetCurrentProcess(), &creation_time, &exit_time, &kernel_time, &user_time)) {
+        auto to_us = [](const FILETIME &ft) { return int64_t((uint64_t(ft.dwHighDateTime) << 32) | ft.dwLowDateTime) / 10; };
+        cpu_us = to_us(kernel_time) + to_us(user_time);
+    }
+    PROCESS_MEMORY_COUNTERS pmc;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &pmc, sizeof(pmc)))
+        peak_rss_kb = int64_t(pmc.PeakWorkingSetSize / 1024);
+#else
+    rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) == 0) {
+        cpu_us = int64_t(usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1000000 + usage.ru_utime.tv_usec + usage.ru_stime.tv_usec;
+    #ifdef __APPLE__
+        // ru_maxrss is in bytes on macOS and in kB on linux.
+        peak_rss_kb = int64_t(usage.ru_maxrss / 1024);
+    #else
+        peak_rss_kb = int64_t(usage.ru_maxrss);
+    #endif
+    }
+#endif
+}
+
+void push_event(Event &&event)
+{
+    std::lock_guard<std::mutex> lock(s_mutex);
+    s_events.emplace_back(std::move(event));
+}
+
+} // namespace
+
+void enable(bool enable)
+{
+    std::lock_guard<std::mutex> lock(s_mutex);
+    s_events.clear();
+    s_epoch = Clock::now().time_since_epoch().count();
+    detail::s_enabled = enable;
+}
+
+Sample now()
+{
+    Sample sample;
+    sample.wall_us = wall_us();
+    process_times(sample.cpu_us, sample.peak_rss_kb);
+    return sample;
+}
+
+void record(const char *category, const std::string &name, const std::string &object, const Sample &start, size_t tasks)
+{
+    if (! enabled() || ! start.valid())
+        return;
+    Sample end = now();
+    push_event({ category, name, object, thread_id(), start, end, tasks, end.wall_us - start.wall_us });
+}
+
+Stage::Task::Task(Stage &stage) : m_stage(&stage)
+{
+    if (m_stage->m_start.valid())
+        m_start_us = wall_us();
+}
+
+Stage::Task::~Task()
+{
+    if (m_stage->m_start.valid()) {
+        m_stage->m_busy_us += wall_us() - m_start_us;
+        ++ m_stage->m_tasks;
+    }
+}
+
+Stage::~Stage()
+{
+    if (! enabled() || ! m_start.valid() || m_tasks == 0)
+        return;
+    Sample end = now();
+    push_event({ m_category, m_name, std::string(), thread_id(), m_start, end, m_tasks.load(), m_busy_us.load() });
+}
+
+bool write(const std::string &path)
+{
+    using nlohmann::json;
+
+    std::vector<Event> events;
+    {
+        std::lock_guard<std::mutex> lock(s_mutex);
+        events = s_events;
+    }
+    std::stable_sort(events.begin(), events.end(), [](const Event &l, const Event &r) { return l.start.wall_us < r.start.wall_us; });
+
+    struct Total
+    {
+        size_t  count       { 0 };
+        int64_t wall_us     { 0 };
+        int64_t busy_us     { 0 };
+        int64_t cpu_us      { 0 };
+        int64_t peak_rss_kb { 0 };
+        size_t  tasks       { 0 };
+    };
+    std::map<std::pair<std::string, std::string>, Total> totals;
+
+    json trace_events = json::array();
+    for (const Event &event : events) {
+        json args;
+        if (! event.object.empty())
+            args["object"] = event.object;
+        args["cpu_ms"]                   = double(event.end.cpu_us - event.start.cpu_us) / 1000.;
+        args["busy_ms"]                  = double(event.busy_us) / 1000.;
+        // Peak memory of the whole process, see Sample::peak_rss_kb.
+        args["process_peak_rss_kb"]      = event.end.peak_rss_kb;
+        // How much the process peak memory grew while the step was running.
+        args["process_peak_rss_grow_kb"] = event.end.peak_rss_kb - event.start.peak_rss_kb;
+        args["tasks"]                    = event.tasks;
+
+        json trace_event;
+        trace_event["name"] = event.object.empty() ? event.name : event.name + " " + event.object;
+        trace_event["cat"]  = event.category;
+        trace_event["ph"]   = "X";
+        trace_event["ts"]   = event.start.wall_us;
+        trace_event["dur"]  = event.end.wall_us - event.start.wall_us;
+        trace_event["pid"]  = 1;
+        trace_event["tid"]  = event.tid;
+        trace_event["args"] = std::move(args);
+        trace_events.push_back(std::move(trace_event));
+
+        Total &total = totals[{ event.category, event.name }];
+        ++ total.count;
+        total.wall_us    += event.end.wall_us - event.start.wall_us;
+        total.busy_us    += event.busy_us;
+        total.cpu_us     += event.end.cpu_us - event.start.cpu_us;
+        total.peak_rss_kb = std::max(total.peak_rss_kb, event.end.peak_rss_kb);
+        total.tasks      += event.tasks;
+    }
+
+    // CPU time and peak memory are measured for the whole process, thus steps running concurrently (for example
+    // the supports of several objects) are charged the CPU time of each other, and the peak memory of a step
+    // is the peak of the process up to its end.
+    json summary = json::array();
+    for (const auto &[key, total] : totals) {
+        json item;
+        item["category"]            = key.first;
+        item["name"]                = key.second;
+        item["count"]               = total.count;
+        item["wall_ms"]             = double(total.wall_us) / 1000.;
+        item["busy_ms"]             = double(total.busy_us) / 1000.;
+        item["cpu_ms"]              = double(total.cpu_us) / 1000.;
+        item["process_peak_rss_kb"] = total.peak_rss_kb;
+        item["tasks"]               = total.tasks;
+        summary.push_back(std::move(item));
+    }
+
+    json root;
+    root["traceEvents"]     = std::move(trace_events);
+    root["displayTimeUnit"] = "ms";
+    root["summary"]         = std::move(summary);
+
+    boost::nowide::ofstream c(path, std::ios::out | std::ios::trunc);
+    if (! c.is_open()) {
+        BOOST_LOG_TRIVIAL(error) << __FUNCTION__ << ": can not open " << path << " for writing";
+        return false;
+    }
+    c << root.dump(1) << std::endl;
+    c.close();
+    return ! c.fail();
+}
+
+} // namespace PerfReport
+} // namespace Slic3r
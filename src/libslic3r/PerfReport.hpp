@@ -0,0 +1,93 @@
+#ifndef slic3r_PerfReport_hpp_
+#define slic3r_PerfReport_hpp_
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+namespace Slic3r {
+
+// BBS: lightweight performance telemetry of the slicing steps, enabled by the CLI --perf-report option.
+// Records wall time, process CPU time, process peak resident memory and task counts of every PrintStep and
+// PrintObjectStep (see PrintBaseWithState::set_started() / set_done()) and of the G-code export
+// pipeline stages, and writes them as a Chrome trace (chrome://tracing, Perfetto) with an additional
+// "summary" section aggregated per step.
+// When disabled, all the recording functions return immediately.
+namespace PerfReport {
+
+struct Sample
+{
+    // Microseconds since the report was enabled.
+    int64_t wall_us { -1 };
+    // Microseconds of user + system time of the whole process.
+    int64_t cpu_us  { 0 };
+    // Peak resident set size of the whole process since its start in kB, not of a step: the steps running
+    // concurrently share it, and a step is only charged the memory it adds on top of the previous peak.
+    int64_t peak_rss_kb { 0 };
+
+    bool    valid() const { return wall_us >= 0; }
+};
+
+namespace detail {
+    extern std::atomic<bool> s_enabled;
+}
+
+inline bool enabled() { return detail::s_enabled.load(std::memory_order_relaxed); }
+// Enabling clears the events recorded so far and restarts the clock.
+// To be called before the recorded work starts, the events recording concurrently may be lost.
+void        enable(bool enable);
+
+Sample      now();
+
+// Record a finished interval started at start.
+void        record(const char *category, const std::string &name, const std::string &object, const Sample &start, size_t tasks = 0);
+
+// Write the recorded events as JSON to path. Returns false if the file could not be written.
+bool        write(const std::string &path);
+
+// Records the lifetime of the scope.
+class Scope
+{
+public:
+    Scope(const char *category, const char *name) : m_category(category), m_name(name) { if (enabled()) m_start = now(); }
+    ~Scope() { if (m_start.valid()) record(m_category, m_name, std::string(), m_start, m_tasks); }
+
+    void        add_tasks(size_t tasks) { m_tasks += tasks; }
+
+private:
+    const char *m_category;
+    const char *m_name;
+    Sample      m_start;
+    size_t      m_tasks { 0 };
+};
+
+// Accumulates the busy time of a stage executed many times, possibly in parallel,
+// like a filter of a tbb::parallel_pipeline. Recorded as a single event when destroyed.
+class Stage
+{
+public:
+    Stage(const char *category, const char *name) : m_category(category), m_name(name) { if (enabled()) m_start = now(); }
+    ~Stage();
+
+    class Task
+    {
+    public:
+        Task(Stage &stage);
+        ~Task();
+    private:
+        Stage  *m_stage;
+        int64_t m_start_us { 0 };
+    };
+
+private:
+    const char             *m_category;
+    const char             *m_name;
+    Sample                  m_start;
+    std::atomic<int64_t>    m_busy_us { 0 };
+    std::atomic<size_t>     m_tasks   { 0 };
+};
+
+} // namespace PerfReport
+} // namespace Slic3r
+
+#endif // slic3r_PerfReport_hpp_
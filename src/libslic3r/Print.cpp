@@ -35,6 +35,7 @@
 #include "nlohmann/json.hpp"
 
 #include "GCode/ConflictChecker.hpp"
+#include "SliceCache.hpp"
 
 #include <codecvt>
 
@@ -1559,6 +1560,7 @@ void Print::process(long long *time_cost_with_cache, bool use_cache)
     BOOST_LOG_TRIVIAL(info) << __FUNCTION__ << boost::format(": this=%1%, enter, use_cache=%2%, object size=%3%")%this%use_cache%m_objects.size();
     if (m_objects.empty())
         return;
+    PerfReport::Scope perf_scope("print", "process");
 
     for (PrintObject *obj : m_objects)
         obj->clear_shared_object();
@@ -1875,6 +1877,10 @@ void Print::process(long long *time_cost_with_cache, bool use_cache)
                 obj->set_done(posSimplifySupportPath);
         }
     }
+    //BBS: the objects sharing the layers of another object have no layers of their own
+    for (PrintObject *obj : m_objects)
+        if (! obj->get_shared_object())
+            obj->make_flat_toolpaths();
 
     // BBS
     bool has_adaptive_layer_height = false;
@@ -1889,6 +1895,7 @@ void Print::process(long long *time_cost_with_cache, bool use_cache)
     {
         using Clock                 = std::chrono::high_resolution_clock;
         auto            startTime   = Clock::now();
+        PerfReport::Scope perf_scope("print", "conflict_check");
         std::optional<const FakeWipeTower *> wipe_tower_opt = {};
         if (this->has_wipe_tower()) {
             m_fake_wipe_tower.set_pos({m_config.wipe_tower_x.get_at(m_plate_index), m_config.wipe_tower_y.get_at(m_plate_index)});
@@ -1927,6 +1934,12 @@ std::string Print::export_gcode(const std::string& path_template, GCodeProcessor
         message = L("Generating G-code");
     this->set_status(80, message);
 
+    if (m_low_memory_mode) {
+        for (PrintObject *obj : m_objects)
+            obj->release_intermediate_data();
+        BOOST_LOG_TRIVIAL(info) << "Released the intermediate slicing data." << log_memory_info();
+    }
+
     // The following line may die for multiple reasons.
     GCode gcode;
     //BBS: compute plate offset for gcode-generator
@@ -3353,6 +3366,37 @@ int Print::export_cached_data(const std::string& directory, bool with_space)
     }
 
     int count = 0;
+    if (!with_space) {
+        //BBS: compact binary format by default, the json format is only kept for debugging as it is human readable
+        for (PrintObject *obj : m_objects) {
+            const ModelObject* model_obj = obj->model_object();
+            if (obj->get_shared_object()) {
+                BOOST_LOG_TRIVIAL(info) << boost::format("shared object %1%, skip directly")%model_obj->name;
+                continue;
+            }
+
+            const ModelInstance *model_instance = obj->instances()[0].model_instance;
+            size_t identify_id = (model_instance->loaded_id > 0)?model_instance->loaded_id: model_instance->id().id;
+            std::string file_name = directory +"/obj_"+std::to_string(identify_id)+SliceCache::FILE_EXTENSION;
+
+            BOOST_LOG_TRIVIAL(info) << boost::format("begin to dump object %1%, identify_id %2% to %3%")%model_obj->name %identify_id %file_name;
+            try {
+                int obj_ret = SliceCache::export_object(*obj, model_obj->name, identify_id, file_name);
+                if (obj_ret) {
+                    ret = obj_ret;
+                    continue;
+                }
+                count ++;
+            }
+            catch(std::exception &err) {
+                BOOST_LOG_TRIVIAL(error) << __FUNCTION__<< ": save to "<<file_name<<" got a generic exception, reason = " << err.what();
+                ret = CLI_EXPORT_CACHE_WRITE_FAILED;
+            }
+        }
+        BOOST_LOG_TRIVIAL(info) << __FUNCTION__<< boost::format(": total printobject count %1%, saved %2%, ret=%3%")%m_objects.size() %count %ret;
+        return ret;
+    }
+
     std::vector<std::string> filename_vector;
     std::vector<json> json_vector;
     for (PrintObject *obj : m_objects) {
@@ -3555,6 +3599,98 @@ int Print::export_cached_data(const std::string& directory, bool with_space)
 }
 
 
+//BBS: load the binary slice cache of one object written by SliceCache::export_object(),
+//the layers of the object are expected to be cleared
+static int load_binary_object(PrintObject* obj, const std::string& file_name)
+{
+    auto find_region = [obj](size_t config_hash) -> const PrintRegion* {
+        for (int index = 0; index < obj->num_printing_regions(); index++)
+            if (obj->printing_region(index).config_hash() == config_hash)
+                return &obj->printing_region(index);
+        return nullptr;
+    };
+
+    SliceCache::Reader reader;
+    int ret = reader.open(file_name);
+    if (ret)
+        return ret;
+    if (reader.checksum() != SliceCache::object_checksum(*obj)) {
+        BOOST_LOG_TRIVIAL(warning) << __FUNCTION__<< boost::format(": checksum of %1% does not match the object %2%, config or mesh changed")%file_name %obj->model_object()->name;
+        return CLI_IMPORT_CACHE_DATA_CAN_NOT_USE;
+    }
+
+    BOOST_LOG_TRIVIAL(info) << __FUNCTION__<<boost::format(":will load %1%, identify_id %2%, layer_count %3%, support_layer_count %4%")
+        %reader.name() %reader.identify_id() %reader.layer_count() %reader.support_layer_count();
+
+    //create layer and layer regions from the layer headers, the geometry is decoded later in parallel
+    Layer* previous_layer = NULL;
+    for (size_t index = 0; index < reader.layer_count(); index++)
+    {
+        SliceCache::LayerInfo info = reader.layer_info(index);
+        Layer* new_layer = obj->add_layer(info.id, info.height, info.print_z, info.slice_z);
+        if (previous_layer) {
+            previous_layer->upper_layer = new_layer;
+            new_layer->lower_layer = previous_layer;
+        }
+        previous_layer = new_layer;
+
+        for (size_t region_index = 0; region_index < info.region_config_hashes.size(); region_index++)
+        {
+            const PrintRegion *print_region = find_region(info.region_config_hashes[region_index]);
+            if (!print_region){
+                BOOST_LOG_TRIVIAL(error) <<__FUNCTION__<< boost::format(":can not find print region of object %1%, layer %2%, print_z %3%, layer_region %4%")
+                    %reader.name() % index %new_layer->print_z %region_index;
+                return CLI_IMPORT_CACHE_DATA_CAN_NOT_USE;
+            }
+            new_layer->add_region(print_region);
+        }
+    }
+
+    Layer* previous_support_layer = NULL;
+    for (size_t index = 0; index < reader.support_layer_count(); index++)
+    {
+        SliceCache::LayerInfo info = reader.support_layer_info(index);
+        SupportLayer* new_support_layer = obj->add_support_layer(info.id, info.interface_id, info.height, info.print_z);
+        if (previous_support_layer) {
+            previous_support_layer->upper_layer = new_support_layer;
+            new_support_layer->lower_layer = previous_support_layer;
+        }
+        previous_support_layer = new_support_layer;
+    }
+
+    tbb::parallel_for(
+        tbb::blocked_range<size_t>(0, obj->layer_count()),
+        [&reader, obj](const tbb::blocked_range<size_t>& layer_range) {
+            for (size_t layer_index = layer_range.begin(); layer_index < layer_range.end(); ++ layer_index)
+                reader.load_layer(layer_index, *obj->get_layer(int(layer_index)));
+        }
+    );
+    tbb::parallel_for(
+        tbb::blocked_range<size_t>(0, obj->support_layer_count()),
+        [&reader, obj](const tbb::blocked_range<size_t>& support_layer_range) {
+            for (size_t layer_index = support_layer_range.begin(); layer_index < support_layer_range.end(); ++ layer_index)
+                reader.load_support_layer(layer_index, *obj->get_support_layer(int(layer_index)));
+        }
+    );
+
+    std::vector<groupedVolumeSlices>& firstlayer_objgroups = obj->firstLayerObjGroupsMod();
+    ModelVolumePtrs& volumes_ptr = obj->model_object()->volumes;
+    for (groupedVolumeSlices& firstlayer_group : reader.first_layer_groups())
+    {
+        for (ObjectID& obj_id : firstlayer_group.volume_ids)
+        {
+            if (obj_id.id >= volumes_ptr.size()) {
+                BOOST_LOG_TRIVIAL(error) << __FUNCTION__<< boost::format(": can not find volume_id %1% from object file %2% in firstlayer groups, volume_count %3%!")
+                    %obj_id.id %file_name %volumes_ptr.size();
+                return CLI_IMPORT_CACHE_LOAD_FAILED;
+            }
+            obj_id = volumes_ptr[obj_id.id]->id();
+        }
+        firstlayer_objgroups.push_back(std::move(firstlayer_group));
+    }
+    return 0;
+}
+
 int Print::load_cached_data(const std::string& directory)
 {
     int ret = 0;
@@ -3594,6 +3730,24 @@ int Print::load_cached_data(const std::string& directory)
             BOOST_LOG_TRIVIAL(info) << __FUNCTION__<< boost::format(": object %1%'s loaded_id is 0, need to use the instance_id %2%")%model_obj->name %identify_id;
             //continue;
         }
+        std::string binary_file_name = directory +"/obj_"+std::to_string(identify_id)+SliceCache::FILE_EXTENSION;
+        if (fs::exists(binary_file_name)) {
+            try {
+                int obj_ret = load_binary_object(obj, binary_file_name);
+                if (obj_ret) {
+                    BOOST_LOG_TRIVIAL(error) << __FUNCTION__<< boost::format(": load from %1% failed, ret=%2%")%binary_file_name %obj_ret;
+                    return obj_ret;
+                }
+            }
+            catch(std::exception &err) {
+                BOOST_LOG_TRIVIAL(error) << __FUNCTION__<< ": load from "<<binary_file_name<<" got a generic exception, reason = " << err.what();
+                return CLI_IMPORT_CACHE_LOAD_FAILED;
+            }
+            count ++;
+            BOOST_LOG_TRIVIAL(info) << __FUNCTION__<< boost::format(": load object %1% from %2% successfully.")%count%binary_file_name;
+            continue;
+        }
+
         std::string file_name = directory +"/obj_"+std::to_string(identify_id)+".json";
 
         if (!fs::exists(file_name)) {
@@ -3771,6 +3925,101 @@ int Print::load_cached_data(const std::string& directory)
     return ret;
 }
 
+int Print::load_slice_cache(const std::string& cache_dir)
+{
+    int count = 0;
+    if (!fs::exists(fs::path(cache_dir))) {
+        BOOST_LOG_TRIVIAL(info) << __FUNCTION__<< boost::format(": slice cache %1% not exist yet.")%cache_dir;
+        return count;
+    }
+
+    for (PrintObject *obj : m_objects) {
+        obj->clear_layers();
+        obj->clear_support_layers();
+        obj->firstLayerObjGroupsMod().clear();
+
+        std::string file_name = cache_dir + "/" + SliceCache::content_file_name(*obj);
+        if (!fs::exists(file_name)) {
+            BOOST_LOG_TRIVIAL(info) << __FUNCTION__<< boost::format(": object %1% not found in the slice cache as %2%")%obj->model_object()->name %file_name;
+            continue;
+        }
+        int obj_ret = 0;
+        try {
+            obj_ret = load_binary_object(obj, file_name);
+        }
+        catch(std::exception &err) {
+            BOOST_LOG_TRIVIAL(error) << __FUNCTION__<< ": load from "<<file_name<<" got a generic exception, reason = " << err.what();
+            obj_ret = CLI_IMPORT_CACHE_LOAD_FAILED;
+        }
+        if (obj_ret) {
+            //a broken entry is a cache miss, the object will be sliced and the entry rewritten
+            BOOST_LOG_TRIVIAL(warning) << __FUNCTION__<< boost::format(": load from %1% failed, ret=%2%, will slice object %3%")%file_name %obj_ret %obj->model_object()->name;
+            obj->clear_layers();
+            obj->clear_support_layers();
+            obj->firstLayerObjGroupsMod().clear();
+            boost::system::error_code ec;
+            fs::remove(file_name, ec);
+            continue;
+        }
+        //the entries used last are kept when the cache size is limited
+        touch_cache_file(file_name);
+        count ++;
+    }
+
+    BOOST_LOG_TRIVIAL(info) << __FUNCTION__<< boost::format(": total printobject count %1%, loaded from slice cache %2%")%m_objects.size() %count;
+    return count;
+}
+
+int Print::store_slice_cache(const std::string& cache_dir, uint64_t max_size) const
+{
+    int ret = 0;
+    try {
+        fs::create_directories(fs::path(cache_dir));
+    }
+    catch (...)
+    {
+        BOOST_LOG_TRIVIAL(error) << boost::format("create directory %1% failed")%cache_dir;
+        return CLI_EXPORT_CACHE_DIRECTORY_CREATE_FAILED;
+    }
+
+    int count = 0;
+    for (const PrintObject *obj : m_objects) {
+        if (obj->get_shared_object() || obj->layer_count() == 0)
+            continue;
+
+        std::string file_name = cache_dir + "/" + SliceCache::content_file_name(*obj);
+        if (fs::exists(file_name))
+            continue;
+
+        //write to a temporary file first, so that concurrent runs sharing the cache never see a partial entry
+        const ModelInstance *model_instance = obj->instances()[0].model_instance;
+        size_t identify_id = (model_instance->loaded_id > 0)?model_instance->loaded_id: model_instance->id().id;
+        std::string temp_name = file_name + "." + fs::unique_path().string() + ".tmp";
+        try {
+            int obj_ret = SliceCache::export_object(*obj, obj->model_object()->name, identify_id, temp_name);
+            if (obj_ret) {
+                fs::remove(temp_name);
+                ret = obj_ret;
+                continue;
+            }
+            fs::rename(temp_name, file_name);
+            count ++;
+        }
+        catch(std::exception &err) {
+            BOOST_LOG_TRIVIAL(error) << __FUNCTION__<< ": save to "<<file_name<<" got a generic exception, reason = " << err.what();
+            boost::system::error_code ec;
+            fs::remove(temp_name, ec);
+            ret = CLI_EXPORT_CACHE_WRITE_FAILED;
+        }
+    }
+
+    if (max_size > 0)
+        limit_cache_directory(cache_dir, SliceCache::FILE_EXTENSION, max_size);
+
+    BOOST_LOG_TRIVIAL(info) << __FUNCTION__<< boost::format(": total printobject count %1%, stored to slice cache %2%, ret=%3%")%m_objects.size() %count %ret;
+    return ret;
+}
+
 BoundingBoxf3 PrintInstance::get_bounding_box() {
     return print_object->model_object()->instance_bounding_box(*model_instance, false);
 }
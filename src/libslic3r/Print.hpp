@@ -22,6 +22,7 @@
 #include <Eigen/Geometry>
 
 #include <functional>
+#include <mutex>
 #include <set>
 #include "Calib.hpp"
 
@@ -46,6 +47,14 @@ struct VolumeSlices
     std::vector<ExPolygons> slices;
 };
 
+// BBS: MeshSlicingSession of a ModelVolume, valid while the volume keeps its mesh and transformation.
+struct VolumeSlicingSession
+{
+    std::shared_ptr<const TriangleMesh>         mesh;
+    Transform3d                                 trafo { Transform3d::Identity() };
+    std::shared_ptr<const MeshSlicingSession>   session;
+};
+
 struct groupedVolumeSlices
 {
     int                     groupId = -1;
@@ -98,6 +107,35 @@ enum PrintObjectStep {
     posCount,
 };
 
+// Step names used by PerfReport.
+inline const char* perf_step_name(PrintStep step)
+{
+    switch (step) {
+    case psWipeTower:       return "wipe_tower";
+    case psSkirtBrim:       return "skirt_brim";
+    case psGCodeExport:     return "gcode_export";
+    case psConflictCheck:   return "conflict_check";
+    default:                return "unknown";
+    }
+}
+
+inline const char* perf_step_name(PrintObjectStep step)
+{
+    switch (step) {
+    case posSlice:                  return "slice";
+    case posPerimeters:             return "perimeters";
+    case posPrepareInfill:          return "prepare_infill";
+    case posInfill:                 return "infill";
+    case posIroning:                return "ironing";
+    case posSupportMaterial:        return "support_material";
+    case posDetectOverhangsForLift: return "detect_overhangs_for_lift";
+    case posSimplifyWall:           return "simplify_wall";
+    case posSimplifyInfill:         return "simplify_infill";
+    case posSimplifySupportPath:    return "simplify_support_path";
+    default:                        return "unknown";
+    }
+}
+
 // A PrintRegion object represents a group of volumes to print
 // sharing the same config (including the same assigned extruder(s))
 class PrintRegion
@@ -380,6 +418,12 @@ public:
     SupportLayer* add_tree_support_layer(int id, coordf_t height, coordf_t print_z, coordf_t slice_z);
     std::shared_ptr<TreeSupportData> alloc_tree_support_preview_cache();
     void clear_tree_support_preview_cache() { m_tree_support_preview_cache.reset(); }
+    void clear_support_volume_sessions() { std::lock_guard<std::mutex> lock(m_support_volume_sessions_mutex); m_support_volume_sessions.clear(); }
+    // BBS: low memory mode (Print::low_memory_mode()), release the data of the slicing steps not used by the G-code export.
+    // The steps are not invalidated, thus the object can not be processed again afterwards.
+    void release_intermediate_data();
+    // Release just the data whose last consumer is the given step (posInfill or posSupportMaterial), called once the step is done.
+    void release_intermediate_data(PrintObjectStep step);
 
     size_t          support_layer_count() const { return m_support_layers.size(); }
     void            clear_support_layers();
@@ -453,6 +497,8 @@ private:
 	PrintObject(Print* print, ModelObject* model_object, const Transform3d& trafo, PrintInstances&& instances);
 	~PrintObject();
 
+    size_t                  perf_task_count() const override { return this->total_layer_count(); }
+
     void                    config_apply(const ConfigBase &other, bool ignore_nonexistent = false) { m_config.apply(other, ignore_nonexistent); }
     void                    config_apply_only(const ConfigBase &other, const t_config_option_keys &keys, bool ignore_nonexistent = false) { m_config.apply_only(other, keys, ignore_nonexistent); }
     PrintBase::ApplyStatus  set_instances(PrintInstances &&instances);
@@ -476,6 +522,9 @@ private:
     void ironing();
     void generate_support_material();
     void simplify_extrusion_path();
+    // BBS: copy the final extrusions of the layer regions and of the support layers into their flat toolpaths,
+    // the layers whose extrusions did not change since the last copy are skipped.
+    void make_flat_toolpaths();
 
     void slice_volumes();
     //BBS
@@ -521,6 +570,13 @@ private:
     SupportLayerPtrs                        m_support_layers;
     // BBS
     std::shared_ptr<TreeSupportData>        m_tree_support_preview_cache;
+    // BBS: slicing sessions of the support enforcers and blockers, one per volume and transformation. Each generate_support_material()
+    // slices these volumes again, the tree supports even twice. The sessions are released when posSlice is invalidated.
+    mutable std::map<ObjectID, VolumeSlicingSession> m_support_volume_sessions;
+    mutable std::mutex                      m_support_volume_sessions_mutex;
+    // BBS: the flat toolpaths of the layer regions / of the support layers match their extrusions, see make_flat_toolpaths().
+    bool                                    m_region_toolpaths_valid { false };
+    bool                                    m_support_toolpaths_valid { false };
 
     // this is set to true when LayerRegion->slices is split in top/internal/bottom
     // so that next call to make_perimeters() performs a union() before computing loops
@@ -724,6 +780,11 @@ public:
     //return 0 means successful
     int                 export_cached_data(const std::string& dir_path, bool with_space=false);
     int                 load_cached_data(const std::string& directory);
+    // BBS: content addressed cache of sliced objects shared between CLI runs, see SliceCache::content_key().
+    // load_slice_cache() returns the number of objects loaded, the others are left without layers and are sliced by process(nullptr, true).
+    // store_slice_cache() then removes the least recently used entries while the cache is bigger than max_size bytes, 0 for no limit.
+    int                 load_slice_cache(const std::string& cache_dir);
+    int                 store_slice_cache(const std::string& cache_dir, uint64_t max_size = 0) const;
 
     // methods for handling state
     bool                is_step_done(PrintStep step) const { return Inherited::is_step_done(step); }
@@ -816,6 +877,12 @@ public:
     bool is_support_used() const {return m_support_used;}
     bool is_BBL_Printer() const { return m_isBBLPrinter;}
     void set_BBL_Printer(const bool isBBL) { m_isBBLPrinter = isBBL;}
+    //BBS: low memory mode of the CLI (--low_memory). process() releases the inputs of the infill and of the supports once these steps
+    // are done, export_gcode() the rest of the intermediate data of the slicing steps, then the toolpaths of each layer as soon as
+    // its G-code was generated, so that the G-code export does not add its own buffers on top of the whole sliced print.
+    // The objects can not be processed nor exported again afterwards.
+    void set_low_memory_mode(bool low_memory) { m_low_memory_mode = low_memory; }
+    bool low_memory_mode() const { return m_low_memory_mode; }
     std::string get_conflict_string() const
     {
         std::string result;
@@ -879,6 +946,7 @@ private:
     PrintRegionPtrs                         m_print_regions;
     //BBS.
     bool m_isBBLPrinter = false;
+    bool m_low_memory_mode = false;
     // Ordered collections of extrusion paths to build skirt loops and brim.
     ExtrusionEntityCollection               m_skirt;
     // BBS: collecting extrusion paths to build brim by objs
@@ -2,6 +2,7 @@
 #define slic3r_PrintBase_hpp_
 
 #include "libslic3r.h"
+#include <array>
 #include <set>
 #include <vector>
 #include <string>
@@ -11,6 +12,7 @@
 
 #include "ObjectID.hpp"
 #include "Model.hpp"
+#include "PerfReport.hpp"
 #include "PlaceholderParser.hpp"
 #include "PrintConfig.hpp"
 
@@ -348,6 +350,8 @@ protected:
     void status_update_warnings(PrintBase *print, int step, PrintStateBase::WarningLevel warning_level,
         const std::string &message, PrintStateBase::SlicingNotificationType message_id = PrintStateBase::SlicingDefaultNotification);
     void emptylayer_update_msg(PrintBase* print, int type, const std::string& message, bool overwrite);
+    // Number of tasks (layers) processed by a step, reported by PerfReport.
+    virtual size_t perf_task_count() const { return 0; }
 
     ModelObject                  *m_model_object;
 };
@@ -584,9 +588,19 @@ public:
     PrintStateBase::StateWithWarnings  step_state_with_warnings(PrintStepEnum step) const { return m_state.state_with_warnings(step, this->state_mutex()); }
 
 protected:
-    bool            set_started(PrintStepEnum step) { return m_state.set_started(step, this->state_mutex(), [this](){ this->throw_if_canceled(); }); }
+    bool            set_started(PrintStepEnum step) {
+        bool started = m_state.set_started(step, this->state_mutex(), [this](){ this->throw_if_canceled(); });
+        if (started && PerfReport::enabled())
+            m_perf_start[step] = PerfReport::now();
+        return started;
+    }
 	PrintStateBase::TimeStamp set_done(PrintStepEnum step) {
 		std::pair<PrintStateBase::TimeStamp, bool> status = m_state.set_done(step, this->state_mutex(), [this](){ this->throw_if_canceled(); });
+        if (PerfReport::enabled()) {
+            // perf_step_name() is declared next to the step enum, found by argument dependent lookup.
+            PerfReport::record("print", perf_step_name(step), std::string(), m_perf_start[step]);
+            m_perf_start[step] = PerfReport::Sample();
+        }
         if (status.second)
             this->status_update_warnings(static_cast<int>(step), PrintStateBase::WarningLevel::NON_CRITICAL, std::string());
         return status.first;
@@ -617,6 +631,8 @@ protected:
 
 private:
     PrintState<PrintStepEnum, COUNT> m_state;
+    // Start of the running steps, only filled in when PerfReport is enabled.
+    std::array<PerfReport::Sample, COUNT> m_perf_start;
 };
 
 template<typename PrintType, typename PrintObjectStepEnum, const size_t COUNT>
@@ -634,10 +650,18 @@ public:
 protected:
 	PrintObjectBaseWithState(PrintType *print, ModelObject *model_object) : PrintObjectBase(model_object), m_print(print) {}
 
-    bool            set_started(PrintObjectStepEnum step)
-        { return m_state.set_started(step, PrintObjectBase::state_mutex(m_print), [this](){ this->throw_if_canceled(); }); }
+    bool            set_started(PrintObjectStepEnum step) {
+        bool started = m_state.set_started(step, PrintObjectBase::state_mutex(m_print), [this](){ this->throw_if_canceled(); });
+        if (started && PerfReport::enabled())
+            m_perf_start[step] = PerfReport::now();
+        return started;
+    }
 	PrintStateBase::TimeStamp set_done(PrintObjectStepEnum step) {
 		std::pair<PrintStateBase::TimeStamp, bool> status = m_state.set_done(step, PrintObjectBase::state_mutex(m_print), [this](){ this->throw_if_canceled(); });
+        if (PerfReport::enabled()) {
+            PerfReport::record("object", perf_step_name(step), m_model_object->name, m_perf_start[step], this->perf_task_count());
+            m_perf_start[step] = PerfReport::Sample();
+        }
         if (status.second)
             this->status_update_warnings(m_print, static_cast<int>(step), PrintStateBase::WarningLevel::NON_CRITICAL, std::string());
         return status.first;
@@ -677,6 +701,7 @@ protected:
 
 private:
     PrintState<PrintObjectStepEnum, COUNT>   m_state;
+    std::array<PerfReport::Sample, COUNT>    m_perf_start;
 };
 
 } // namespace Slic3r
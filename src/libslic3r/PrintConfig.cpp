@@ -5505,6 +5505,14 @@ CLIActionsConfigDef::CLIActionsConfigDef()
     def->tooltip = "Send progress to pipe.";
     def->cli_params = "pipename";
     def->set_default_value(new ConfigOptionString(""));
+
+    def = this->add("serve", coString);
+    def->label = "Serve slicing jobs";
+    def->tooltip = "Keep running and process slicing jobs received over the given UNIX socket, one job per connection. "
+                   "A job is the list of its command line arguments, one per line, terminated by an empty line. "
+                   "The job result is sent back as a single line of JSON. A job consisting of the single line shutdown stops the server. Linux only.";
+    def->cli_params = "socketname";
+    def->set_default_value(new ConfigOptionString(""));
 }
 
 //BBS: remove unused command currently
@@ -5742,6 +5750,35 @@ CLIMiscConfigDef::CLIMiscConfigDef()
     def->cli_params = "custom_gcode_toolchange.json";
     def->set_default_value(new ConfigOptionString());
 
+    def = this->add("perf_report", coString);
+    def->label = "Performance report";
+    def->tooltip = "Record the wall time, CPU time, process peak memory and task counts of the slicing steps and the G-code export "
+                   "and write them to a JSON file in the Chrome trace event format, with a summary per step.";
+    def->cli_params = "file.json";
+    def->set_default_value(new ConfigOptionString());
+
+    def = this->add("slice_cache", coString);
+    def->label = "Slice cache directory";
+    def->tooltip = "Directory of a persistent cache of sliced objects shared between runs. Objects whose mesh, placement "
+                   "and slicing related settings are unchanged are loaded from the cache instead of being sliced again.";
+    def->cli_params = "dir";
+    def->set_default_value(new ConfigOptionString());
+
+    def = this->add("slice_cache_size", coInt);
+    def->label = "Slice cache size limit";
+    def->tooltip = "Maximum size of the slice cache directory in MB. The least recently used objects are removed from the cache "
+                   "when it grows bigger. 0 for no limit, the cache then has to be cleaned up by an external job.";
+    def->min = 0;
+    def->cli_params = "MB";
+    def->set_default_value(new ConfigOptionInt(10240));
+
+    def = this->add("low_memory", coBool);
+    def->label = "Low memory slicing";
+    def->tooltip = "Lower the peak memory of big prints: the intermediate slicing data are released as soon as the last slicing step reading them is done "
+                   "and the toolpaths of each layer as soon as its G-code is generated. "
+                   "The sliced data are not kept, thus this can not be combined with --export_slicedata.";
+    def->set_default_value(new ConfigOptionBool(false));
+
     def = this->add("load_filament_ids", coInts);
     def->label = "Load filament ids";
     def->tooltip = "Load filament ids for each object";
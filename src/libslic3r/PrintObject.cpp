@@ -227,6 +227,8 @@ void PrintObject::make_perimeters()
     tbb::parallel_for(
         tbb::blocked_range<size_t>(0, m_layers.size()),
         [this](const tbb::blocked_range<size_t>& range) {
+            // BBS: temporaries of the Clipper operations of this task are allocated from a thread local arena.
+            ClipperLib::ArenaScope clipper_arena;
             for (size_t layer_idx = range.begin(); layer_idx < range.end(); ++ layer_idx) {
                 m_print->throw_if_canceled();
                 m_layers[layer_idx]->make_perimeters();
@@ -378,6 +380,7 @@ void PrintObject::infill()
         tbb::parallel_for(
             tbb::blocked_range<size_t>(0, m_layers.size()),
             [this, &adaptive_fill_octree = adaptive_fill_octree, &support_fill_octree = support_fill_octree](const tbb::blocked_range<size_t>& range) {
+                ClipperLib::ArenaScope clipper_arena;
                 for (size_t layer_idx = range.begin(); layer_idx < range.end(); ++ layer_idx) {
                     m_print->throw_if_canceled();
                     m_layers[layer_idx]->make_fills(adaptive_fill_octree.get(), support_fill_octree.get(), this->m_lightning_generator.get());
@@ -390,6 +393,9 @@ void PrintObject::infill()
         ### $_->fill_surfaces->clear for map @{$_->regions}, @{$object->layers};
         */
         this->set_done(posInfill);
+        //BBS: the low memory mode does not process the object again, free the inputs of the infill before the supports are generated.
+        if (m_print->low_memory_mode())
+            this->release_intermediate_data(posInfill);
     }
 }
 
@@ -496,6 +502,8 @@ void PrintObject::generate_support_material()
             m_print->throw_if_canceled();
         }
         this->set_done(posSupportMaterial);
+        if (m_print->low_memory_mode())
+            this->release_intermediate_data(posSupportMaterial);
     }
 }
 
@@ -556,6 +564,38 @@ void PrintObject::simplify_extrusion_path()
     }
 }
 
+void PrintObject::make_flat_toolpaths()
+{
+    if (! m_region_toolpaths_valid) {
+        tbb::parallel_for(
+            tbb::blocked_range<size_t>(0, m_layers.size()),
+            [this](const tbb::blocked_range<size_t>& range) {
+                for (size_t layer_idx = range.begin(); layer_idx < range.end(); ++ layer_idx) {
+                    m_print->throw_if_canceled();
+                    for (LayerRegion *layerm : m_layers[layer_idx]->regions())
+                        layerm->make_flat_toolpaths();
+                }
+            }
+        );
+        m_print->throw_if_canceled();
+        m_region_toolpaths_valid = true;
+    }
+
+    if (! m_support_toolpaths_valid) {
+        tbb::parallel_for(
+            tbb::blocked_range<size_t>(0, m_support_layers.size()),
+            [this](const tbb::blocked_range<size_t>& range) {
+                for (size_t layer_idx = range.begin(); layer_idx < range.end(); ++ layer_idx) {
+                    m_print->throw_if_canceled();
+                    m_support_layers[layer_idx]->make_flat_toolpaths();
+                }
+            }
+        );
+        m_print->throw_if_canceled();
+        m_support_toolpaths_valid = true;
+    }
+}
+
 std::pair<FillAdaptive::OctreePtr, FillAdaptive::OctreePtr> PrintObject::prepare_adaptive_infill_data(
     const std::vector<std::pair<const Surface *, float>> &surfaces_w_bottom_z) const
 {
@@ -611,6 +651,7 @@ void PrintObject::clear_layers()
         for (Layer *l : m_layers)
             delete l;
         m_layers.clear();
+        m_region_toolpaths_valid = false;
     }
 }
 
@@ -638,6 +679,7 @@ void PrintObject::clear_support_layers()
         for (SupportLayer* l : m_support_layers)
             delete l;
         m_support_layers.clear();
+        m_support_toolpaths_valid = false;
         for (auto l : m_layers) {
             l->sharp_tails.clear();
             l->sharp_tails_height.clear();
@@ -646,6 +688,50 @@ void PrintObject::clear_support_layers()
     }
 }
 
+void PrintObject::release_intermediate_data()
+{
+    this->release_intermediate_data(posInfill);
+    this->release_intermediate_data(posSupportMaterial);
+}
+
+void PrintObject::release_intermediate_data(PrintObjectStep step)
+{
+    if (step == posInfill) {
+        // The infill generators and the fill areas are only read by prepare_infill() and make_fills().
+        m_adaptive_fill_octrees.first.reset();
+        m_adaptive_fill_octrees.second.reset();
+        m_lightning_generator.reset();
+    } else if (step == posSupportMaterial) {
+        m_tree_support_preview_cache.reset();
+        this->clear_support_volume_sessions();
+    } else
+        return;
+
+    if (m_shared_object)
+        // The layers belong to the shared object.
+        return;
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, m_layers.size()),
+        [this, step](const tbb::blocked_range<size_t> &range) {
+            for (size_t layer_idx = range.begin(); layer_idx < range.end(); ++ layer_idx) {
+                Layer *layer = m_layers[layer_idx];
+                if (step == posInfill) {
+                    // raw_slices, slices and fill_surfaces are kept, the brim, ToolOrdering and AvoidCrossingPerimeters read them.
+                    for (LayerRegion *layerm : layer->regions()) {
+                        ExPolygons().swap(layerm->fill_expolygons);
+                        ExPolygons().swap(layerm->fill_no_overlap_expolygons);
+                    }
+                } else {
+                    for (LayerRegion *layerm : layer->regions())
+                        Polylines().swap(layerm->unsupported_bridge_edges);
+                    ExPolygons().swap(layer->lslices_extrudable);
+                    ExPolygons().swap(layer->sharp_tails);
+                    ExPolygons().swap(layer->cantilevers);
+                    std::vector<float>().swap(layer->sharp_tails_height);
+                }
+            }
+        });
+}
+
 std::shared_ptr<TreeSupportData> PrintObject::alloc_tree_support_preview_cache()
 {
     if (!m_tree_support_preview_cache) {
@@ -943,6 +1029,13 @@ bool PrintObject::invalidate_step(PrintObjectStep step)
 {
 	bool invalidated = Inherited::invalidate_step(step);
 
+    // BBS: the flat toolpaths are copies of the extrusions of these steps.
+    if (step == posSlice || step == posPerimeters || step == posPrepareInfill || step == posInfill || step == posIroning ||
+        step == posSimplifyWall || step == posSimplifyInfill)
+        m_region_toolpaths_valid = false;
+    if (step == posSlice || step == posSupportMaterial || step == posSimplifySupportPath)
+        m_support_toolpaths_valid = false;
+
     // propagate to dependent steps
     if (step == posPerimeters) {
 		invalidated |= this->invalidate_steps({ posPrepareInfill, posInfill, posIroning, posSimplifyWall, posSimplifyInfill });
@@ -956,6 +1049,7 @@ bool PrintObject::invalidate_step(PrintObjectStep step)
 		invalidated |= this->invalidate_steps({ posPerimeters, posPrepareInfill, posInfill, posIroning, posSupportMaterial, posSimplifyWall, posSimplifyInfill });
         invalidated |= m_print->invalidate_steps({ psSkirtBrim });
         m_slicing_params.valid = false;
+        this->clear_support_volume_sessions();
     } else if (step == posSupportMaterial) {
         invalidated |= this->invalidate_steps({ posSimplifySupportPath });
         invalidated |= m_print->invalidate_steps({ psSkirtBrim });
@@ -977,6 +1071,9 @@ bool PrintObject::invalidate_all_steps()
     bool result = Inherited::invalidate_all_steps() | m_print->invalidate_all_steps();
 	// Then reset some of the depending values.
 	m_slicing_params.valid = false;
+    m_region_toolpaths_valid  = false;
+    m_support_toolpaths_valid = false;
+    this->clear_support_volume_sessions();
 	return result;
 }
 
@@ -1269,6 +1366,7 @@ void PrintObject::process_external_surfaces()
         tbb::parallel_for(
             tbb::blocked_range<size_t>(0, m_layers.size()),
             [this, &surfaces_covered, region_id](const tbb::blocked_range<size_t>& range) {
+                ClipperLib::ArenaScope clipper_arena;
                 for (size_t layer_idx = range.begin(); layer_idx < range.end(); ++ layer_idx) {
                     m_print->throw_if_canceled();
                     // BOOST_LOG_TRIVIAL(trace) << "Processing external surface, layer" << m_layers[layer_idx]->print_z;
@@ -1324,6 +1422,7 @@ void PrintObject::discover_vertical_shells()
         tbb::parallel_for(
             tbb::blocked_range<size_t>(0, num_layers, grain_size),
             [this, &cache_top_botom_regions](const tbb::blocked_range<size_t>& range) {
+                ClipperLib::ArenaScope clipper_arena;
                 const std::initializer_list<SurfaceType> surfaces_bottom{ stBottom, stBottomBridge };
                 const size_t num_regions = this->num_printing_regions();
                 for (size_t idx_layer = range.begin(); idx_layer < range.end(); ++idx_layer) {
@@ -1401,6 +1500,7 @@ void PrintObject::discover_vertical_shells()
             tbb::parallel_for(
                 tbb::blocked_range<size_t>(0, num_layers, grain_size),
                 [this, region_id, &cache_top_botom_regions](const tbb::blocked_range<size_t>& range) {
+                    ClipperLib::ArenaScope clipper_arena;
                     const std::initializer_list<SurfaceType> surfaces_bottom { stBottom, stBottomBridge };
                     for (size_t idx_layer = range.begin(); idx_layer < range.end(); ++ idx_layer) {
                         m_print->throw_if_canceled();
@@ -1431,6 +1531,7 @@ void PrintObject::discover_vertical_shells()
             tbb::blocked_range<size_t>(0, num_layers, grain_size),
             [this, region_id, &cache_top_botom_regions]
             (const tbb::blocked_range<size_t>& range) {
+                ClipperLib::ArenaScope clipper_arena;
                 // printf("discover_vertical_shells from %d to %d\n", range.begin(), range.end());
                 for (size_t idx_layer = range.begin(); idx_layer < range.end(); ++ idx_layer) {
                     m_print->throw_if_canceled();
@@ -45,23 +45,33 @@ LayerPtrs new_layers(
 }
 
 // Slice single triangle mesh.
+// If session is not null, the MeshSlicingSession stored there is reused if it was created for the same mesh and transformation,
+// otherwise a new one is stored there. Without a session, the transformed copy of the mesh is not kept after slicing.
 static std::vector<ExPolygons> slice_volume(
     const ModelVolume             &volume,
     const std::vector<float>      &zs,
     const MeshSlicingParamsEx     &params,
-    const std::function<void()>   &throw_on_cancel_callback)
+    const std::function<void()>   &throw_on_cancel_callback,
+    VolumeSlicingSession          *session = nullptr)
 {
     std::vector<ExPolygons> layers;
-    if (! zs.empty()) {
-        indexed_triangle_set its = volume.mesh().its;
-        if (its.indices.size() > 0) {
-            MeshSlicingParamsEx params2 { params };
-            params2.trafo = params2.trafo * volume.get_matrix();
-            if (params2.trafo.rotation().determinant() < 0.)
-                its_flip_triangles(its);
-            layers = slice_mesh_ex(its, zs, params2, throw_on_cancel_callback);
-            throw_on_cancel_callback();
+    if (! zs.empty() && ! volume.mesh().its.indices.empty()) {
+        MeshSlicingParamsEx params2 { params };
+        params2.trafo = params2.trafo * volume.get_matrix();
+        // Mirroring transformation flips the triangles, the session flips them back without copying the mesh.
+        const bool flip = params2.trafo.rotation().determinant() < 0.;
+        if (session == nullptr)
+            layers = MeshSlicingSession(volume.mesh().its, params2.trafo, flip, throw_on_cancel_callback).slice_ex(zs, params2, throw_on_cancel_callback);
+        else {
+            if (! session->session || session->mesh != volume.get_mesh_shared_ptr() || session->trafo.matrix() != params2.trafo.matrix()) {
+                session->session.reset();
+                session->session = std::make_shared<const MeshSlicingSession>(volume.mesh().its, params2.trafo, flip, throw_on_cancel_callback);
+                session->mesh    = volume.get_mesh_shared_ptr();
+                session->trafo   = params2.trafo;
+            }
+            layers = session->session->slice_ex(zs, params2, throw_on_cancel_callback);
         }
+        throw_on_cancel_callback();
     }
     return layers;
 }
@@ -1230,6 +1240,16 @@ std::vector<Polygons> PrintObject::slice_support_volumes(const ModelVolumeType m
     auto it_volume_end = this->model_object()->volumes.end();
     for (; it_volume != it_volume_end && (*it_volume)->type() != model_volume_type; ++ it_volume) ;
     std::vector<Polygons> slices;
+    {
+        // Drop the sessions of the deleted volumes.
+        std::lock_guard<std::mutex> lock(m_support_volume_sessions_mutex);
+        const ModelVolumePtrs &volumes = this->model_object()->volumes;
+        for (auto it = m_support_volume_sessions.begin(); it != m_support_volume_sessions.end();)
+            if (std::any_of(volumes.begin(), volumes.end(), [&it](const ModelVolume *v) { return v->id() == it->first; }))
+                ++ it;
+            else
+                it = m_support_volume_sessions.erase(it);
+    }
     if (it_volume != it_volume_end) {
         // Found at least a single support volume of model_volume_type.
         std::vector<float> zs = zs_from_layers(this->layers());
@@ -1241,7 +1261,20 @@ std::vector<Polygons> PrintObject::slice_support_volumes(const ModelVolumeType m
         params.trafo = this->trafo_centered();
         for (; it_volume != it_volume_end; ++ it_volume)
             if ((*it_volume)->type() == model_volume_type) {
-                std::vector<ExPolygons> slices2 = slice_volume(*(*it_volume), zs, params, throw_on_cancel_callback);
+                // The session is built and used outside of the lock, as both run parallel loops. Concurrent calls may build
+                // the same session twice, the last one is kept.
+                VolumeSlicingSession session;
+                {
+                    std::lock_guard<std::mutex> lock(m_support_volume_sessions_mutex);
+                    if (auto it = m_support_volume_sessions.find((*it_volume)->id()); it != m_support_volume_sessions.end())
+                        session = it->second;
+                }
+                std::shared_ptr<const MeshSlicingSession> old_session = session.session;
+                std::vector<ExPolygons> slices2 = slice_volume(*(*it_volume), zs, params, throw_on_cancel_callback, &session);
+                if (session.session != old_session) {
+                    std::lock_guard<std::mutex> lock(m_support_volume_sessions_mutex);
+                    m_support_volume_sessions[(*it_volume)->id()] = std::move(session);
+                }
                 if (slices.empty()) {
                     slices.reserve(slices2.size());
                     for (ExPolygons &src : slices2)
@@ -29,6 +29,30 @@ enum SLAPrintObjectStep : unsigned int {
 	slaposCount
 };
 
+// Step names used by PerfReport.
+inline const char* perf_step_name(SLAPrintStep step)
+{
+    switch (step) {
+    case slapsMergeSlicesAndEval:   return "merge_slices_and_eval";
+    case slapsRasterize:            return "rasterize";
+    default:                        return "unknown";
+    }
+}
+
+inline const char* perf_step_name(SLAPrintObjectStep step)
+{
+    switch (step) {
+    case slaposHollowing:           return "hollowing";
+    case slaposDrillHoles:          return "drill_holes";
+    case slaposObjectSlice:         return "object_slice";
+    case slaposSupportPoints:       return "support_points";
+    case slaposSupportTree:         return "support_tree";
+    case slaposPad:                 return "pad";
+    case slaposSliceSupports:       return "slice_supports";
+    default:                        return "unknown";
+    }
+}
+
 class SLAPrint;
 class GLCanvas;
 
@@ -0,0 +1,777 @@
+#include "SliceCache.hpp"
+
+#include "Exception.hpp"
+#include "ExtrusionEntity.hpp"
+#include "ExtrusionEntityCollection.hpp"
+#include "Layer.hpp"
+#include "Model.hpp"
+#include "Print.hpp"
+#include "Utils.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <type_traits>
+#include <unordered_set>
+
+#include <boost/filesystem.hpp>
+#include <boost/format.hpp>
+#include <boost/iostreams/device/mapped_file.hpp>
+#include <boost/log/trivial.hpp>
+#include <boost/nowide/cstdio.hpp>
+
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_for.h>
+
+namespace Slic3r {
+namespace SliceCache {
+
+namespace {
+
+enum EntityType : uint8_t {
+    etPath       = 0,
+    etMultiPath  = 1,
+    etLoop       = 2,
+    etCollection = 3,
+};
+
+// FNV-1a style hash processing 64 bit words, used for hashing the meshes which may be large.
+struct Hasher
+{
+    uint64_t h { 0xcbf29ce484222325ull };
+
+    void add_bytes(const void *data, size_t len) {
+        static constexpr uint64_t prime = 0x100000001b3ull;
+        const unsigned char *p = static_cast<const unsigned char*>(data);
+        for (; len >= 8; p += 8, len -= 8) {
+            uint64_t w;
+            memcpy(&w, p, 8);
+            h = (h ^ w) * prime;
+        }
+        for (; len > 0; ++ p, -- len)
+            h = (h ^ *p) * prime;
+    }
+    template<typename T> void add(const T &v) {
+        static_assert(std::is_trivially_copyable<T>::value, "Hasher::add() requires a trivially copyable type");
+        this->add_bytes(&v, sizeof(T));
+    }
+};
+
+class Writer
+{
+public:
+    std::string data;
+
+    void put_u8(uint8_t v) { data.push_back(char(v)); }
+    template<typename T> void put_raw(T v) {
+        static_assert(std::is_trivially_copyable<T>::value, "Writer::put_raw() requires a trivially copyable type");
+        data.append(reinterpret_cast<const char*>(&v), sizeof(T));
+    }
+    void put_varint(uint64_t v) {
+        while (v >= 0x80) {
+            data.push_back(char(uint8_t(v) | 0x80));
+            v >>= 7;
+        }
+        data.push_back(char(v));
+    }
+    void put_svarint(int64_t v) { this->put_varint((uint64_t(v) << 1) ^ uint64_t(v >> 63)); }
+    void put_double(double v) { this->put_raw(v); }
+    void put_float(float v) { this->put_raw(v); }
+
+    void put_point(const Point &pt) {
+        this->put_svarint(pt.x());
+        this->put_svarint(pt.y());
+    }
+    void put_points(const Points &pts) {
+        this->put_varint(pts.size());
+        Point prev(0, 0);
+        for (const Point &pt : pts) {
+            this->put_svarint(int64_t(pt.x()) - int64_t(prev.x()));
+            this->put_svarint(int64_t(pt.y()) - int64_t(prev.y()));
+            prev = pt;
+        }
+    }
+    void put_bbox(const BoundingBox &bbox) {
+        this->put_u8(bbox.defined);
+        this->put_point(bbox.min);
+        this->put_point(bbox.max);
+    }
+    void put_expolygon(const ExPolygon &expoly) {
+        this->put_points(expoly.contour.points);
+        this->put_varint(expoly.holes.size());
+        for (const Polygon &hole : expoly.holes)
+            this->put_points(hole.points);
+    }
+    void put_expolygons(const ExPolygons &expolys) {
+        this->put_varint(expolys.size());
+        for (const ExPolygon &expoly : expolys)
+            this->put_expolygon(expoly);
+    }
+    void put_surfaces(const Surfaces &surfaces) {
+        this->put_varint(surfaces.size());
+        for (const Surface &surface : surfaces) {
+            this->put_u8(uint8_t(surface.surface_type));
+            this->put_expolygon(surface.expolygon);
+            this->put_double(surface.thickness);
+            this->put_varint(surface.thickness_layers);
+            this->put_double(surface.bridge_angle);
+            this->put_varint(surface.extra_perimeters);
+        }
+    }
+    void put_arc(const ArcSegment &arc) {
+        this->put_double(arc.length);
+        this->put_double(arc.angle_radians);
+        this->put_double(arc.polar_start_theta);
+        this->put_double(arc.polar_end_theta);
+        this->put_point(arc.start_point);
+        this->put_point(arc.end_point);
+        this->put_u8(uint8_t(arc.direction));
+        this->put_double(arc.radius);
+        this->put_point(arc.center);
+    }
+    void put_polyline(const Polyline &polyline) {
+        this->put_points(polyline.points);
+        this->put_varint(polyline.fitting_result.size());
+        for (const PathFittingData &fitting : polyline.fitting_result) {
+            this->put_varint(fitting.start_point_index);
+            this->put_varint(fitting.end_point_index);
+            this->put_u8(uint8_t(fitting.path_type));
+            this->put_u8(fitting.arc_data.is_arc);
+            if (fitting.arc_data.is_arc)
+                this->put_arc(fitting.arc_data);
+        }
+    }
+    void put_polylines(const Polylines &polylines) {
+        this->put_varint(polylines.size());
+        for (const Polyline &polyline : polylines)
+            this->put_polyline(polyline);
+    }
+    void put_path(const ExtrusionPath &path) {
+        this->put_polyline(path.polyline);
+        this->put_double(path.overhang_degree);
+        this->put_svarint(path.curve_degree);
+        this->put_double(path.mm3_per_mm);
+        this->put_float(path.width);
+        this->put_float(path.height);
+        this->put_u8(uint8_t(path.role()));
+        this->put_u8(path.is_force_no_extrusion());
+    }
+    void put_paths(const ExtrusionPaths &paths) {
+        this->put_varint(paths.size());
+        for (const ExtrusionPath &path : paths)
+            this->put_path(path);
+    }
+    void put_entity(const ExtrusionEntity *entity) {
+        if (const ExtrusionEntityCollection *collection = dynamic_cast<const ExtrusionEntityCollection*>(entity)) {
+            this->put_u8(etCollection);
+            this->put_collection(*collection);
+        } else if (const ExtrusionPath *path = dynamic_cast<const ExtrusionPath*>(entity)) {
+            this->put_u8(etPath);
+            this->put_path(*path);
+        } else if (const ExtrusionMultiPath *multipath = dynamic_cast<const ExtrusionMultiPath*>(entity)) {
+            this->put_u8(etMultiPath);
+            this->put_paths(multipath->paths);
+        } else if (const ExtrusionLoop *loop = dynamic_cast<const ExtrusionLoop*>(entity)) {
+            this->put_u8(etLoop);
+            this->put_u8(uint8_t(loop->loop_role()));
+            this->put_paths(loop->paths);
+        } else
+            throw Slic3r::FileIOError("SliceCache: unsupported extrusion entity type");
+    }
+    void put_collection(const ExtrusionEntityCollection &collection) {
+        this->put_u8(collection.no_sort);
+        this->put_varint(collection.entities.size());
+        for (const ExtrusionEntity *entity : collection.entities)
+            this->put_entity(entity);
+    }
+    void put_layer_header(const Layer &layer, int interface_id) {
+        this->put_svarint(layer.id());
+        this->put_double(layer.height);
+        this->put_double(layer.print_z);
+        this->put_double(layer.slice_z);
+        this->put_svarint(interface_id);
+        this->put_varint(layer.regions().size());
+        for (const LayerRegion *layerm : layer.regions())
+            this->put_raw<uint64_t>(layerm->region().config_hash());
+    }
+    void put_layer_body(const Layer &layer) {
+        this->put_expolygons(layer.lslices);
+        this->put_varint(layer.lslices_bboxes.size());
+        for (const BoundingBox &bbox : layer.lslices_bboxes)
+            this->put_bbox(bbox);
+        this->put_expolygons(layer.loverhangs);
+        this->put_bbox(layer.loverhangs_bbox);
+        for (const LayerRegion *layerm : layer.regions()) {
+            this->put_surfaces(layerm->slices.surfaces);
+            this->put_expolygons(layerm->raw_slices);
+            this->put_collection(layerm->thin_fills);
+            this->put_expolygons(layerm->fill_expolygons);
+            this->put_surfaces(layerm->fill_surfaces.surfaces);
+            this->put_expolygons(layerm->fill_no_overlap_expolygons);
+            this->put_polylines(layerm->unsupported_bridge_edges);
+            this->put_collection(layerm->perimeters);
+            this->put_collection(layerm->fills);
+        }
+    }
+};
+
+class Decoder
+{
+public:
+    Decoder(const char *begin, const char *end) : m_cur(begin), m_end(end) {}
+
+    uint8_t get_u8() {
+        this->require(1);
+        return uint8_t(*m_cur ++);
+    }
+    template<typename T> T get_raw() {
+        this->require(sizeof(T));
+        T v;
+        memcpy(&v, m_cur, sizeof(T));
+        m_cur += sizeof(T);
+        return v;
+    }
+    uint64_t get_varint() {
+        uint64_t v = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            uint8_t b = this->get_u8();
+            v |= uint64_t(b & 0x7f) << shift;
+            if ((b & 0x80) == 0)
+                return v;
+        }
+        throw Slic3r::FileIOError("SliceCache: malformed varint");
+    }
+    int64_t get_svarint() {
+        uint64_t v = this->get_varint();
+        return int64_t(v >> 1) ^ -int64_t(v & 1);
+    }
+    double get_double() { return this->get_raw<double>(); }
+    float  get_float()  { return this->get_raw<float>(); }
+    // Number of elements which follows, sanity checked against the remaining data
+    // so that a corrupted file does not trigger a huge allocation.
+    size_t get_count() {
+        uint64_t n = this->get_varint();
+        if (n > uint64_t(m_end - m_cur))
+            throw Slic3r::FileIOError("SliceCache: element count exceeds the data size");
+        return size_t(n);
+    }
+
+    Point get_point() {
+        coord_t x = coord_t(this->get_svarint());
+        coord_t y = coord_t(this->get_svarint());
+        return Point(x, y);
+    }
+    void get_points(Points &pts) {
+        size_t n = this->get_count();
+        pts.reserve(n);
+        int64_t x = 0, y = 0;
+        for (size_t i = 0; i < n; ++ i) {
+            x += this->get_svarint();
+            y += this->get_svarint();
+            pts.emplace_back(coord_t(x), coord_t(y));
+        }
+    }
+    void get_bbox(BoundingBox &bbox) {
+        bbox.defined = this->get_u8() != 0;
+        bbox.min     = this->get_point();
+        bbox.max     = this->get_point();
+    }
+    void get_expolygon(ExPolygon &expoly) {
+        this->get_points(expoly.contour.points);
+        size_t n = this->get_count();
+        expoly.holes.resize(n);
+        for (Polygon &hole : expoly.holes)
+            this->get_points(hole.points);
+    }
+    void get_expolygons(ExPolygons &expolys) {
+        size_t n = this->get_count();
+        expolys.reserve(expolys.size() + n);
+        for (size_t i = 0; i < n; ++ i) {
+            expolys.emplace_back();
+            this->get_expolygon(expolys.back());
+        }
+    }
+    void get_surfaces(Surfaces &surfaces) {
+        size_t n = this->get_count();
+        surfaces.reserve(surfaces.size() + n);
+        for (size_t i = 0; i < n; ++ i) {
+            Surface surface(SurfaceType(this->get_u8()));
+            this->get_expolygon(surface.expolygon);
+            surface.thickness        = this->get_double();
+            surface.thickness_layers = (unsigned short)this->get_varint();
+            surface.bridge_angle     = this->get_double();
+            surface.extra_perimeters = (unsigned short)this->get_varint();
+            surfaces.emplace_back(std::move(surface));
+        }
+    }
+    void get_arc(ArcSegment &arc) {
+        arc.is_arc            = true;
+        arc.length            = this->get_double();
+        arc.angle_radians     = this->get_double();
+        arc.polar_start_theta = this->get_double();
+        arc.polar_end_theta   = this->get_double();
+        arc.start_point       = this->get_point();
+        arc.end_point         = this->get_point();
+        arc.direction         = ArcDirection(this->get_u8());
+        arc.radius            = this->get_double();
+        arc.center            = this->get_point();
+    }
+    void get_polyline(Polyline &polyline) {
+        this->get_points(polyline.points);
+        size_t n = this->get_count();
+        polyline.fitting_result.reserve(n);
+        for (size_t i = 0; i < n; ++ i) {
+            PathFittingData fitting;
+            fitting.start_point_index = size_t(this->get_varint());
+            fitting.end_point_index   = size_t(this->get_varint());
+            fitting.path_type         = EMovePathType(this->get_u8());
+            if (this->get_u8())
+                this->get_arc(fitting.arc_data);
+            polyline.fitting_result.emplace_back(std::move(fitting));
+        }
+    }
+    void get_polylines(Polylines &polylines) {
+        size_t n = this->get_count();
+        polylines.reserve(polylines.size() + n);
+        for (size_t i = 0; i < n; ++ i) {
+            polylines.emplace_back();
+            this->get_polyline(polylines.back());
+        }
+    }
+    void get_path(ExtrusionPath &path) {
+        this->get_polyline(path.polyline);
+        path.overhang_degree = this->get_double();
+        path.curve_degree    = int(this->get_svarint());
+        path.mm3_per_mm      = this->get_double();
+        path.width           = this->get_float();
+        path.height          = this->get_float();
+        path.set_extrusion_role(ExtrusionRole(this->get_u8()));
+        path.set_force_no_extrusion(this->get_u8() != 0);
+    }
+    void get_paths(ExtrusionPaths &paths) {
+        size_t n = this->get_count();
+        paths.resize(n);
+        for (ExtrusionPath &path : paths)
+            this->get_path(path);
+    }
+    ExtrusionEntity* get_entity() {
+        switch (this->get_u8()) {
+        case etPath: {
+            auto path = std::make_unique<ExtrusionPath>();
+            this->get_path(*path);
+            return path.release();
+        }
+        case etMultiPath: {
+            auto multipath = std::make_unique<ExtrusionMultiPath>();
+            this->get_paths(multipath->paths);
+            return multipath.release();
+        }
+        case etLoop: {
+            auto loop = std::make_unique<ExtrusionLoop>();
+            loop->set_loop_role(ExtrusionLoopRole(this->get_u8()));
+            this->get_paths(loop->paths);
+            return loop.release();
+        }
+        case etCollection: {
+            auto collection = std::make_unique<ExtrusionEntityCollection>();
+            this->get_collection(*collection);
+            return collection.release();
+        }
+        default:
+            throw Slic3r::FileIOError("SliceCache: unknown extrusion entity type");
+        }
+    }
+    void get_collection(ExtrusionEntityCollection &collection) {
+        collection.no_sort = this->get_u8() != 0;
+        size_t n = this->get_count();
+        collection.entities.reserve(collection.entities.size() + n);
+        for (size_t i = 0; i < n; ++ i)
+            collection.entities.push_back(this->get_entity());
+    }
+    LayerInfo get_layer_header() {
+        LayerInfo info;
+        info.id           = int(this->get_svarint());
+        info.height       = this->get_double();
+        info.print_z      = this->get_double();
+        info.slice_z      = this->get_double();
+        info.interface_id = int(this->get_svarint());
+        size_t n = this->get_count();
+        info.region_config_hashes.reserve(n);
+        for (size_t i = 0; i < n; ++ i)
+            info.region_config_hashes.push_back(size_t(this->get_raw<uint64_t>()));
+        return info;
+    }
+    void get_layer_body(Layer &layer) {
+        this->get_expolygons(layer.lslices);
+        size_t n = this->get_count();
+        layer.lslices_bboxes.resize(n);
+        for (BoundingBox &bbox : layer.lslices_bboxes)
+            this->get_bbox(bbox);
+        this->get_expolygons(layer.loverhangs);
+        this->get_bbox(layer.loverhangs_bbox);
+        for (LayerRegion *layerm : layer.regions()) {
+            this->get_surfaces(layerm->slices.surfaces);
+            this->get_expolygons(layerm->raw_slices);
+            this->get_collection(layerm->thin_fills);
+            this->get_expolygons(layerm->fill_expolygons);
+            this->get_surfaces(layerm->fill_surfaces.surfaces);
+            this->get_expolygons(layerm->fill_no_overlap_expolygons);
+            this->get_polylines(layerm->unsupported_bridge_edges);
+            this->get_collection(layerm->perimeters);
+            this->get_collection(layerm->fills);
+        }
+    }
+
+private:
+    void require(size_t n) const {
+        if (size_t(m_end - m_cur) < n)
+            throw Slic3r::FileIOError("SliceCache: unexpected end of data");
+    }
+
+    const char *m_cur;
+    const char *m_end;
+};
+
+static std::string encode_layer(const Layer &layer)
+{
+    Writer writer;
+    writer.put_layer_header(layer, 0);
+    writer.put_layer_body(layer);
+    return std::move(writer.data);
+}
+
+static std::string encode_support_layer(const SupportLayer &support_layer)
+{
+    Writer writer;
+    writer.put_layer_header(support_layer, int(support_layer.interface_id()));
+    writer.put_layer_body(support_layer);
+    writer.put_u8(uint8_t(support_layer.support_type));
+    writer.put_expolygons(support_layer.support_islands);
+    writer.put_collection(support_layer.support_fills);
+    return std::move(writer.data);
+}
+
+} // anonymous namespace
+
+static void hash_facets(Hasher &hasher, const FacetsAnnotation &facets)
+{
+    const std::pair<std::vector<std::pair<int, int>>, std::vector<bool>> &data = facets.get_data();
+    hasher.add<uint64_t>(data.first.size());
+    for (const std::pair<int, int> &triangle : data.first) {
+        hasher.add<int>(triangle.first);
+        hasher.add<int>(triangle.second);
+    }
+    hasher.add<uint64_t>(data.second.size());
+    uint64_t bits = 0;
+    for (size_t i = 0; i < data.second.size(); ++ i) {
+        bits |= uint64_t(data.second[i]) << (i % 64);
+        if (i % 64 == 63 || i + 1 == data.second.size()) {
+            hasher.add<uint64_t>(bits);
+            bits = 0;
+        }
+    }
+}
+
+uint64_t object_checksum(const PrintObject &object)
+{
+    Hasher hasher;
+    hasher.add<uint64_t>(object.config().hash());
+    for (size_t i = 0; i < object.num_printing_regions(); ++ i)
+        hasher.add<uint64_t>(object.printing_region(i).config_hash());
+    hasher.add_bytes(object.trafo().data(), sizeof(double) * 16);
+    hasher.add_bytes(object.center_offset().data(), sizeof(coord_t) * 2);
+
+    const ModelObject *model_object = object.model_object();
+    for (const ModelVolume *volume : model_object->volumes) {
+        const indexed_triangle_set &its = volume->mesh().its;
+        hasher.add<int>(int(volume->type()));
+        hasher.add_bytes(volume->get_matrix().data(), sizeof(double) * 16);
+        hasher.add<uint64_t>(its.vertices.size());
+        hasher.add_bytes(its.vertices.data(), its.vertices.size() * sizeof(stl_vertex));
+        hasher.add<uint64_t>(its.indices.size());
+        hasher.add_bytes(its.indices.data(), its.indices.size() * sizeof(stl_triangle_vertex_indices));
+        // Painted support enforcers / blockers, seams and multi-material segmentation change the slices and the supports.
+        hash_facets(hasher, volume->supported_facets);
+        hash_facets(hasher, volume->seam_facets);
+        hash_facets(hasher, volume->mmu_segmentation_facets);
+    }
+    std::vector<coordf_t> layer_height_profile = model_object->layer_height_profile.get();
+    hasher.add_bytes(layer_height_profile.data(), layer_height_profile.size() * sizeof(coordf_t));
+    return hasher.h;
+}
+
+// Print level options, which only influence the G-code export, not the cached layers. All the other print options
+// are part of content_key(), thus an option missing here, for example a newly added one, may only cause a cache miss.
+static const std::unordered_set<std::string> s_gcode_only_print_options {
+    // Custom G-code, post processing and notes.
+    "machine_start_gcode", "machine_end_gcode", "before_layer_change_gcode", "layer_change_gcode", "time_lapse_gcode",
+    "change_filament_gcode", "printing_by_object_gcode", "machine_pause_gcode", "template_custom_gcode",
+    "filament_start_gcode", "filament_end_gcode", "post_process", "filename_format", "gcode_add_line_number",
+    "thumbnail_size", "printer_notes", "process_notes", "filament_notes", "exclude_object", "use_relative_e_distances",
+    // Temperatures.
+    "nozzle_temperature", "nozzle_temperature_initial_layer", "nozzle_temperature_range_low", "nozzle_temperature_range_high",
+    "standby_temperature_delta", "chamber_temperatures", "curr_bed_type",
+    "cool_plate_temp", "cool_plate_temp_initial_layer", "eng_plate_temp", "eng_plate_temp_initial_layer",
+    "hot_plate_temp", "hot_plate_temp_initial_layer", "textured_plate_temp", "textured_plate_temp_initial_layer",
+    // Cooling and air filtration.
+    "fan_min_speed", "fan_max_speed", "fan_cooling_layer_time", "full_fan_speed_layer", "close_fan_the_first_x_layers",
+    "additional_cooling_fan_speed", "auxiliary_fan", "reduce_fan_stop_start_freq", "enable_overhang_bridge_fan",
+    "overhang_fan_speed", "overhang_fan_threshold", "slow_down_for_layer_cooling", "slow_down_layer_time", "slow_down_min_speed",
+    "activate_air_filtration", "during_print_exhaust_fan_speed", "complete_print_exhaust_fan_speed",
+    "support_air_filtration", "support_chamber_temp_control",
+    // Retraction, z hop and wipe.
+    "retraction_length", "retraction_speed", "deretraction_speed", "retraction_minimum_travel", "retract_before_wipe",
+    "retract_when_changing_layer", "retract_length_toolchange", "retract_restart_extra", "retract_restart_extra_toolchange",
+    "retract_lift_above", "retract_lift_below", "reduce_infill_retraction", "use_firmware_retraction", "z_hop", "wipe", "wipe_distance",
+    "enable_long_retraction_when_cut", "long_retractions_when_cut", "retraction_distances_when_cut",
+    // Acceleration, jerk and the machine limits.
+    "default_acceleration", "initial_layer_acceleration", "outer_wall_acceleration", "inner_wall_acceleration",
+    "top_surface_acceleration", "sparse_infill_acceleration", "accel_to_decel_enable", "accel_to_decel_factor",
+    "default_jerk", "initial_layer_jerk", "outer_wall_jerk", "inner_wall_jerk", "infill_jerk", "top_surface_jerk", "travel_jerk",
+    "silent_mode", "machine_max_acceleration_e", "machine_max_acceleration_extruding", "machine_max_acceleration_retracting",
+    "machine_max_acceleration_travel", "machine_max_acceleration_x", "machine_max_acceleration_y", "machine_max_acceleration_z",
+    "machine_max_jerk_e", "machine_max_jerk_x", "machine_max_jerk_y", "machine_max_jerk_z",
+    "machine_max_speed_e", "machine_max_speed_x", "machine_max_speed_y", "machine_max_speed_z",
+    "machine_min_extruding_rate", "machine_min_travel_rate", "machine_load_filament_time", "machine_unload_filament_time",
+    "enable_pressure_advance", "pressure_advance",
+    // Statistics and appearance.
+    "filament_colour", "default_filament_colour", "extruder_colour", "filament_cost", "filament_density",
+    "bed_custom_model", "bed_custom_texture"
+};
+
+uint64_t content_key(const PrintObject &object)
+{
+    Hasher hasher;
+    hasher.add<uint64_t>(object_checksum(object));
+    const PrintConfig &config = object.print()->config();
+    for (const std::string &opt_key : config.keys())
+        if (s_gcode_only_print_options.find(opt_key) == s_gcode_only_print_options.end()) {
+            std::string value = config.option(opt_key)->serialize();
+            hasher.add<uint64_t>(opt_key.size());
+            hasher.add_bytes(opt_key.data(), opt_key.size());
+            hasher.add<uint64_t>(value.size());
+            hasher.add_bytes(value.data(), value.size());
+        }
+    return hasher.h;
+}
+
+std::string content_file_name(const PrintObject &object)
+{
+    char buf[17];
+    snprintf(buf, sizeof(buf), "%016llx", (unsigned long long)content_key(object));
+    return std::string(buf) + FILE_EXTENSION;
+}
+
+int export_object(const PrintObject &object, const std::string &name, size_t identify_id, const std::string &file_path)
+{
+    // Refuse to store an object with missing layers, e.g. if its slicing was interrupted.
+    for (size_t i = 0; i < object.layer_count(); ++ i)
+        if (object.get_layer(int(i)) == nullptr) {
+            BOOST_LOG_TRIVIAL(error) << __FUNCTION__ << boost::format(": object %1% has no layer %2%, not saved") % name % i;
+            return CLI_EXPORT_CACHE_WRITE_FAILED;
+        }
+    for (const SupportLayer *support_layer : object.support_layers())
+        if (support_layer == nullptr) {
+            BOOST_LOG_TRIVIAL(error) << __FUNCTION__ << boost::format(": object %1% has a missing support layer, not saved") % name;
+            return CLI_EXPORT_CACHE_WRITE_FAILED;
+        }
+
+    // Encode the layers in parallel, each into its own buffer.
+    std::vector<std::string> layer_blobs(object.layer_count());
+    std::vector<std::string> support_layer_blobs(object.support_layer_count());
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, layer_blobs.size()),
+        [&layer_blobs, &object](const tbb::blocked_range<size_t> &range) {
+            for (size_t i = range.begin(); i < range.end(); ++ i)
+                layer_blobs[i] = encode_layer(*object.get_layer(int(i)));
+        });
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, support_layer_blobs.size()),
+        [&support_layer_blobs, &object](const tbb::blocked_range<size_t> &range) {
+            for (size_t i = range.begin(); i < range.end(); ++ i)
+                support_layer_blobs[i] = encode_support_layer(*object.support_layers()[i]);
+        });
+
+    // First layer groups, volume ids are converted to indices of ModelObject::volumes.
+    Writer groups;
+    const std::vector<groupedVolumeSlices> &first_layer_groups = object.firstLayerObjGroups();
+    const PrintObject *shared_object = object.get_shared_object() ? object.get_shared_object() : &object;
+    const ModelVolumePtrs &volumes = shared_object->model_object()->volumes;
+    groups.put_varint(first_layer_groups.size());
+    for (const groupedVolumeSlices &group : first_layer_groups) {
+        groups.put_svarint(group.groupId);
+        groups.put_varint(group.volume_ids.size());
+        for (const ObjectID &volume_id : group.volume_ids) {
+            auto it = std::find_if(volumes.begin(), volumes.end(), [&volume_id](const ModelVolume *v) { return v->id() == volume_id; });
+            groups.put_varint(it == volumes.end() ? volume_id.id : size_t(it - volumes.begin()));
+        }
+        groups.put_expolygons(group.slices);
+    }
+
+    // Header and offset tables.
+    Writer header;
+    header.put_raw<uint32_t>(MAGIC);
+    header.put_raw<uint32_t>(VERSION);
+    header.put_raw<uint64_t>(object_checksum(object));
+    header.put_raw<uint64_t>(identify_id);
+    header.put_raw<uint32_t>(uint32_t(layer_blobs.size()));
+    header.put_raw<uint32_t>(uint32_t(support_layer_blobs.size()));
+    header.put_raw<uint32_t>(uint32_t(name.size()));
+    header.data += name;
+
+    uint64_t offset = header.data.size() + sizeof(uint64_t) * (layer_blobs.size() + 1 + support_layer_blobs.size() + 1 + 1);
+    for (const std::string &blob : layer_blobs) {
+        header.put_raw<uint64_t>(offset);
+        offset += blob.size();
+    }
+    header.put_raw<uint64_t>(offset);
+    for (const std::string &blob : support_layer_blobs) {
+        header.put_raw<uint64_t>(offset);
+        offset += blob.size();
+    }
+    header.put_raw<uint64_t>(offset);
+    header.put_raw<uint64_t>(offset);
+
+    FILE *file = boost::nowide::fopen(file_path.c_str(), "wb");
+    if (file == nullptr) {
+        BOOST_LOG_TRIVIAL(error) << __FUNCTION__ << boost::format(": can not open %1% for writing") % file_path;
+        return CLI_EXPORT_CACHE_WRITE_FAILED;
+    }
+    bool ok = fwrite(header.data.data(), 1, header.data.size(), file) == header.data.size();
+    for (const std::string &blob : layer_blobs)
+        ok = ok && fwrite(blob.data(), 1, blob.size(), file) == blob.size();
+    for (const std::string &blob : support_layer_blobs)
+        ok = ok && fwrite(blob.data(), 1, blob.size(), file) == blob.size();
+    ok = ok && fwrite(groups.data.data(), 1, groups.data.size(), file) == groups.data.size();
+    ok = (fclose(file) == 0) && ok;
+    if (! ok) {
+        BOOST_LOG_TRIVIAL(error) << __FUNCTION__ << boost::format(": failed to write %1%") % file_path;
+        return CLI_EXPORT_CACHE_WRITE_FAILED;
+    }
+
+    BOOST_LOG_TRIVIAL(info) << __FUNCTION__ << boost::format(": saved object %1% to %2%, layers %3%, support_layers %4%, size %5% bytes")
+        % name % file_path % layer_blobs.size() % support_layer_blobs.size() % (offset + groups.data.size());
+    return 0;
+}
+
+struct Reader::MappedFile
+{
+    boost::iostreams::mapped_file_source source;
+};
+
+Reader::Reader() = default;
+Reader::~Reader() { this->close(); }
+
+void Reader::close()
+{
+    if (m_file) {
+        m_file->source.close();
+        m_file.reset();
+    }
+    m_data = nullptr;
+    m_size = 0;
+    m_layer_offsets.clear();
+    m_support_layer_offsets.clear();
+}
+
+int Reader::open(const std::string &file_path)
+{
+    this->close();
+    try {
+        m_file = std::make_unique<MappedFile>();
+        m_file->source.open(file_path);
+        if (! m_file->source.is_open()) {
+            BOOST_LOG_TRIVIAL(error) << __FUNCTION__ << boost::format(": can not map %1%") % file_path;
+            this->close();
+            return CLI_IMPORT_CACHE_LOAD_FAILED;
+        }
+        m_data = m_file->source.data();
+        m_size = m_file->source.size();
+
+        Decoder decoder(m_data, m_data + m_size);
+        uint32_t magic   = decoder.get_raw<uint32_t>();
+        uint32_t version = decoder.get_raw<uint32_t>();
+        if (magic != MAGIC || version != VERSION) {
+            BOOST_LOG_TRIVIAL(warning) << __FUNCTION__ << boost::format(": %1% has an unsupported format, magic %2%, version %3%") % file_path % magic % version;
+            this->close();
+            return CLI_IMPORT_CACHE_DATA_CAN_NOT_USE;
+        }
+        m_checksum    = decoder.get_raw<uint64_t>();
+        m_identify_id = size_t(decoder.get_raw<uint64_t>());
+        uint32_t layer_count         = decoder.get_raw<uint32_t>();
+        uint32_t support_layer_count = decoder.get_raw<uint32_t>();
+        uint32_t name_length         = decoder.get_raw<uint32_t>();
+        m_name.clear();
+        m_name.reserve(name_length);
+        for (uint32_t i = 0; i < name_length; ++ i)
+            m_name.push_back(char(decoder.get_u8()));
+        m_layer_offsets.resize(size_t(layer_count) + 1);
+        for (uint64_t &offset : m_layer_offsets)
+            offset = decoder.get_raw<uint64_t>();
+        m_support_layer_offsets.resize(size_t(support_layer_count) + 1);
+        for (uint64_t &offset : m_support_layer_offsets)
+            offset = decoder.get_raw<uint64_t>();
+        m_groups_offset = decoder.get_raw<uint64_t>();
+
+        auto offsets_valid = [this](const std::vector<uint64_t> &offsets) {
+            for (size_t i = 1; i < offsets.size(); ++ i)
+                if (offsets[i] < offsets[i - 1])
+                    return false;
+            return offsets.back() <= m_size;
+        };
+        if (! offsets_valid(m_layer_offsets) || ! offsets_valid(m_support_layer_offsets) || m_groups_offset > m_size) {
+            BOOST_LOG_TRIVIAL(error) << __FUNCTION__ << boost::format(": %1% is truncated or corrupted") % file_path;
+            this->close();
+            return CLI_IMPORT_CACHE_LOAD_FAILED;
+        }
+    } catch (std::exception &err) {
+        BOOST_LOG_TRIVIAL(error) << __FUNCTION__ << ": load from " << file_path << " got a generic exception, reason = " << err.what();
+        this->close();
+        return CLI_IMPORT_CACHE_LOAD_FAILED;
+    }
+    return 0;
+}
+
+LayerInfo Reader::layer_info(size_t idx) const
+{
+    Decoder decoder(m_data + m_layer_offsets[idx], m_data + m_layer_offsets[idx + 1]);
+    return decoder.get_layer_header();
+}
+
+LayerInfo Reader::support_layer_info(size_t idx) const
+{
+    Decoder decoder(m_data + m_support_layer_offsets[idx], m_data + m_support_layer_offsets[idx + 1]);
+    return decoder.get_layer_header();
+}
+
+void Reader::load_layer(size_t idx, Layer &layer) const
+{
+    Decoder decoder(m_data + m_layer_offsets[idx], m_data + m_layer_offsets[idx + 1]);
+    decoder.get_layer_header();
+    decoder.get_layer_body(layer);
+}
+
+void Reader::load_support_layer(size_t idx, SupportLayer &support_layer) const
+{
+    Decoder decoder(m_data + m_support_layer_offsets[idx], m_data + m_support_layer_offsets[idx + 1]);
+    decoder.get_layer_header();
+    decoder.get_layer_body(support_layer);
+    support_layer.support_type = SupportInnerType(decoder.get_u8());
+    decoder.get_expolygons(support_layer.support_islands);
+    decoder.get_collection(support_layer.support_fills);
+}
+
+std::vector<groupedVolumeSlices> Reader::first_layer_groups() const
+{
+    Decoder decoder(m_data + m_groups_offset, m_data + m_size);
+    std::vector<groupedVolumeSlices> groups(decoder.get_count());
+    for (groupedVolumeSlices &group : groups) {
+        group.groupId = int(decoder.get_svarint());
+        group.volume_ids.resize(decoder.get_count());
+        for (ObjectID &volume_id : group.volume_ids)
+            volume_id.id = size_t(decoder.get_varint());
+        decoder.get_expolygons(group.slices);
+    }
+    return groups;
+}
+
+} // namespace SliceCache
+} // namespace Slic3r
@@ -0,0 +1,113 @@
+#ifndef slic3r_SliceCache_hpp_
+#define slic3r_SliceCache_hpp_
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "libslic3r.h"
+
+namespace Slic3r {
+
+class Layer;
+class SupportLayer;
+class PrintObject;
+struct groupedVolumeSlices;
+
+// BBS: binary cache of the sliced data of a PrintObject, written by Print::export_cached_data()
+// and read back by Print::load_cached_data() (CLI --export_slicedata / --load_slicedata).
+//
+// File layout (all fixed size fields little endian):
+//   Header           magic, version, checksum, identify_id, layer / support layer counts
+//   name             u32 length + bytes
+//   offset tables    u64 per layer and per support layer plus an end sentinel each,
+//                    u64 offset of the first layer groups section
+//   layer records    one per layer / support layer, each starts with a small header
+//                    (id, heights, region config hashes) followed by the geometry
+//   first layer groups
+//
+// Point arrays are stored contiguously as zigzag varint deltas to the previous point,
+// so a typical perimeter point costs 4-6 bytes instead of a JSON number pair.
+// The per layer offsets allow the file to be memory mapped and each layer to be decoded
+// independently and in parallel.
+namespace SliceCache {
+
+static constexpr uint32_t MAGIC   = 0x43534242; // "BBSC"
+static constexpr uint32_t VERSION = 1;
+
+static constexpr const char *FILE_EXTENSION = ".bin";
+
+// Hash of everything the cached geometry depends on: the object and region configs,
+// the meshes of all volumes with their transformations and painted facets and the layer height profile.
+// A cache written for a different checksum is rejected on load.
+uint64_t object_checksum(const PrintObject &object);
+
+// Key of the content addressed cache shared between CLI runs (--slice_cache): object_checksum() combined
+// with all print level options except for an explicit list of options influencing the G-code export only
+// (custom G-code, temperatures, cooling, retraction, acceleration, ...). Changing those reuses the cache.
+uint64_t content_key(const PrintObject &object);
+// Name of the cache entry of the object inside a content addressed cache directory.
+std::string content_file_name(const PrintObject &object);
+
+// Serialize all layers, support layers and first layer groups of the object into file_path.
+// Returns 0 on success or one of the CLI_EXPORT_CACHE_* error codes.
+int      export_object(const PrintObject &object, const std::string &name, size_t identify_id, const std::string &file_path);
+
+// Header of a single layer record, enough to create the Layer / SupportLayer and its regions
+// before the geometry itself is decoded.
+struct LayerInfo
+{
+    int                   id           { 0 };
+    coordf_t              height       { 0. };
+    coordf_t              print_z      { 0. };
+    coordf_t              slice_z      { 0. };
+    int                   interface_id { 0 };
+    std::vector<size_t>   region_config_hashes;
+};
+
+// Memory mapped reader of a file written by export_object().
+// All accessors are const and may be called concurrently for different layers.
+// Decoding errors throw Slic3r::FileIOError.
+class Reader
+{
+public:
+    Reader();
+    ~Reader();
+
+    // Returns 0 on success or one of the CLI_IMPORT_CACHE_* error codes.
+    int                 open(const std::string &file_path);
+    void                close();
+
+    const std::string&  name() const         { return m_name; }
+    size_t              identify_id() const  { return m_identify_id; }
+    uint64_t            checksum() const     { return m_checksum; }
+    size_t              layer_count() const  { return m_layer_offsets.empty() ? 0 : m_layer_offsets.size() - 1; }
+    size_t              support_layer_count() const { return m_support_layer_offsets.empty() ? 0 : m_support_layer_offsets.size() - 1; }
+
+    LayerInfo           layer_info(size_t idx) const;
+    LayerInfo           support_layer_info(size_t idx) const;
+    // Decode the geometry of a layer into an already created layer with its regions added.
+    void                load_layer(size_t idx, Layer &layer) const;
+    void                load_support_layer(size_t idx, SupportLayer &support_layer) const;
+    // Volume ids are returned as indices into ModelObject::volumes, as they were exported.
+    std::vector<groupedVolumeSlices> first_layer_groups() const;
+
+private:
+    struct MappedFile;
+    std::unique_ptr<MappedFile> m_file;
+    const char         *m_data { nullptr };
+    size_t              m_size { 0 };
+
+    std::string         m_name;
+    size_t              m_identify_id { 0 };
+    uint64_t            m_checksum { 0 };
+    std::vector<uint64_t> m_layer_offsets;
+    std::vector<uint64_t> m_support_layer_offsets;
+    uint64_t            m_groups_offset { 0 };
+};
+
+} // namespace SliceCache
+} // namespace Slic3r
+
+#endif // slic3r_SliceCache_hpp_
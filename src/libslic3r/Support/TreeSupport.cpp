@@ -1,5 +1,6 @@
 #include <math.h>
 #include <chrono>
+#include <numeric>
 
 #include "MinimumSpanningTree.hpp"
 #include "TreeSupport.hpp"
@@ -805,6 +806,7 @@ void TreeSupport::detect_overhangs(bool check_support_necessity/* = false*/)
     tbb::concurrent_vector<ExPolygons> overhangs_all_layers(m_object->layer_count());
     tbb::parallel_for(tbb::blocked_range<size_t>(0, m_object->layer_count()),
         [&](const tbb::blocked_range<size_t>& range) {
+            ClipperLib::ArenaScope clipper_arena;
             for (size_t layer_nr = range.begin(); layer_nr < range.end(); layer_nr++) {
                 if (m_object->print()->canceled())
                     break;
@@ -1456,6 +1458,7 @@ void TreeSupport::generate_toolpaths()
         tbb::blocked_range<size_t>(m_raft_layers, m_object->support_layer_count()),
         [&](const tbb::blocked_range<size_t>& range)
         {
+            ClipperLib::ArenaScope clipper_arena;
             for (size_t layer_id = range.begin(); layer_id < range.end(); layer_id++) {
                 if (m_object->print()->canceled())
                     break;
@@ -1971,6 +1974,7 @@ void TreeSupport::draw_circles(const std::vector<std::vector<SupportNode*>>& con
     tbb::parallel_for(tbb::blocked_range<size_t>(0, m_object->layer_count()),
         [&](const tbb::blocked_range<size_t>& range)
         {
+            ClipperLib::ArenaScope clipper_arena;
             for (size_t layer_nr = range.begin(); layer_nr < range.end(); layer_nr++)
             {
                 if (print->canceled())
@@ -2452,6 +2456,50 @@ void TreeSupport::drop_nodes(std::vector<std::vector<SupportNode*>>& contact_nod
         return move_dist;
     };
 
+    // Split the nodes of a part into clusters which can not merge with each other: two nodes may only be merged
+    // if they are neighbours in the MST and closer than the move distance, or if one of them is a polygon node.
+    // Returns the indices into nodes_vec per cluster, both in ascending order.
+    auto cluster_nodes_to_merge = [&get_max_move_dist](const std::vector<std::pair<const Point, SupportNode*>> &nodes_vec, const MinimumSpanningTree &mst,
+                                                       double max_move_distance2) {
+        std::unordered_map<Point, size_t, PointHash> node_idx;
+        for (size_t i = 0; i < nodes_vec.size(); ++ i)
+            node_idx.emplace(nodes_vec[i].first, i);
+        std::vector<size_t> root(nodes_vec.size());
+        std::iota(root.begin(), root.end(), 0);
+        auto find_root = [&root](size_t i) {
+            while (root[i] != i)
+                i = root[i] = root[root[i]];
+            return i;
+        };
+        for (size_t i = 0; i < nodes_vec.size(); ++ i) {
+            const SupportNode *node = nodes_vec[i].second;
+            for (const Point &neighbour : mst.adjacent_nodes(node->position)) {
+                auto it = node_idx.find(neighbour);
+                if (it == node_idx.end() || it->second < i)
+                    continue;
+                const SupportNode *neighbour_node = nodes_vec[it->second].second;
+                const double       dist2          = vsize2_with_unscale(neighbour - node->position);
+                if (node->type == ePolygon || neighbour_node->type == ePolygon ||
+                    dist2 < std::max({ max_move_distance2, get_max_move_dist(node, 2), get_max_move_dist(neighbour_node, 2) })) {
+                    size_t r1 = find_root(i), r2 = find_root(it->second);
+                    root[std::max(r1, r2)] = std::min(r1, r2);
+                }
+            }
+        }
+        std::vector<std::vector<size_t>> clusters;
+        std::vector<size_t> cluster_idx(nodes_vec.size());
+        for (size_t i = 0; i < nodes_vec.size(); ++ i) {
+            size_t r = find_root(i);
+            if (r == i) {
+                cluster_idx[i] = clusters.size();
+                clusters.emplace_back();
+            }
+            // The root is the smallest index of the cluster, thus it was visited already.
+            clusters[cluster_idx[r]].emplace_back(i);
+        }
+        return clusters;
+    };
+
     m_ts_data->layer_heights = plan_layer_heights(contact_nodes);
     std::vector<LayerHeightData> &layer_heights = m_ts_data->layer_heights;
     if (layer_heights.empty()) return;
@@ -2482,18 +2530,18 @@ void TreeSupport::drop_nodes(std::vector<std::vector<SupportNode*>>& contact_nod
                 layer_radius.emplace(calc_branch_radius(branch_radius, node_dist, diameter_angle_scale_factor));
             }
         }
-        // parallel pre-compute avoidance
+        // parallel pre-compute avoidance, bottom up per radius
+        m_ts_data->precalculate_avoidance(all_layer_radius);
         tbb::parallel_for(tbb::blocked_range<size_t>(0, contact_nodes.size() - 1), [&](const tbb::blocked_range<size_t> &range) {
-            for (size_t layer_nr = range.begin(); layer_nr < range.end(); layer_nr++) {
-            for (auto node_radius : all_layer_radius[layer_nr]) {
-                m_ts_data->get_avoidance(node_radius, layer_nr);
-                get_collision(m_ts_data->m_xy_distance, layer_nr);
-            }
-        }
+            for (size_t layer_nr = range.begin(); layer_nr < range.end(); layer_nr++)
+                if (! all_layer_radius[layer_nr].empty())
+                    get_collision(m_ts_data->m_xy_distance, layer_nr);
         });
 
         double duration{ std::chrono::duration_cast<second_>(clock_::now() - t0).count() };
-        BOOST_LOG_TRIVIAL(debug) << "finish pre calculate_avoidance. before m_avoidance_cache.size()=" << m_ts_data->m_avoidance_cache.size()
+        const TreeSupportData::CacheStats stats = m_ts_data->cache_stats();
+        BOOST_LOG_TRIVIAL(debug) << "finish pre calculate_avoidance. avoidance layers=" << stats.avoidance_layers << ", " << stats.avoidance_bytes / 1024 << " kB"
+            << ", evicted layers=" << stats.avoidance_evicted_layers << ", collision " << stats.collision_bytes / 1024 << " kB"
             << ", takes " << duration << " secs.";
     }
 
@@ -2505,6 +2553,11 @@ void TreeSupport::drop_nodes(std::vector<std::vector<SupportNode*>>& contact_nod
         if (m_object->print()->canceled())
             break;
 
+        // The nodes are dropped from the top down, the avoidance above this layer is not needed anymore.
+        m_ts_data->release_avoidance(layer_nr + 1);
+        // Nothing references the avoidance between the layers, the layers recalculated on demand are evicted here.
+        m_ts_data->trim_avoidance_cache();
+
         auto& layer_contact_nodes = contact_nodes[layer_nr];
         if (layer_contact_nodes.empty())
             continue;
@@ -2596,16 +2649,18 @@ void TreeSupport::drop_nodes(std::vector<std::vector<SupportNode*>>& contact_nod
         //Create a MST for every part.
         profiler.tic();
         //std::vector<MinimumSpanningTree>& spanning_trees = m_spanning_trees[layer_nr];
-        std::vector<MinimumSpanningTree> spanning_trees;
-        for (const std::unordered_map<Point, SupportNode*, PointHash>& group : nodes_per_part)
-        {
-            std::vector<Point> points_to_buildplate;
-            for (const std::pair<const Point, SupportNode*>& entry : group)
+        std::vector<MinimumSpanningTree> spanning_trees(nodes_per_part.size());
+        tbb::parallel_for(tbb::blocked_range<size_t>(0, nodes_per_part.size(), 1), [&](const tbb::blocked_range<size_t> &range) {
+            for (size_t group_index = range.begin(); group_index < range.end(); ++ group_index)
             {
-                points_to_buildplate.emplace_back(entry.first); //Just the position of the node.
+                std::vector<Point> points_to_buildplate;
+                for (const std::pair<const Point, SupportNode*>& entry : nodes_per_part[group_index])
+                {
+                    points_to_buildplate.emplace_back(entry.first); //Just the position of the node.
+                }
+                spanning_trees[group_index] = MinimumSpanningTree(points_to_buildplate);
             }
-            spanning_trees.emplace_back(points_to_buildplate);
-        }
+        });
         profiler.stage_add(STAGE_MinimumSpanningTree);
 
 #ifdef SUPPORT_TREE_DEBUG_TO_SVG
@@ -2620,12 +2675,22 @@ void TreeSupport::drop_nodes(std::vector<std::vector<SupportNode*>>& contact_nod
             //In the first pass, merge all nodes that are close together.
             tbb::concurrent_unordered_set<SupportNode*> to_delete;
             std::vector<std::pair<const Point, SupportNode*>> nodes_vec(nodes_this_part.begin(), nodes_this_part.end());
-            tbb::parallel_for_each(nodes_vec.begin(), nodes_vec.end(), [&](const std::pair<const Point, SupportNode*>& entry) {
-                SupportNode* p_node = entry.second;
+            // Nodes created for the next layer, stored per node of this layer and appended to contact_nodes in this order,
+            // so that the result does not depend on the order in which the threads finish.
+            std::vector<SupportNode*> merged_next_nodes(nodes_vec.size(), nullptr);
+            std::vector<SupportNode*> moved_next_nodes(nodes_vec.size(), nullptr);
+            std::vector<char>         unsupported(nodes_vec.size(), false);
+            const std::vector<std::vector<size_t>> clusters = cluster_nodes_to_merge(nodes_vec, mst, max_move_distance2);
+
+            // The nodes of a cluster are merged serially in the order of nodes_vec, the clusters in parallel.
+            tbb::parallel_for(tbb::blocked_range<size_t>(0, clusters.size(), 1), [&](const tbb::blocked_range<size_t> &range) {
+            for (size_t cluster_idx = range.begin(); cluster_idx < range.end(); ++ cluster_idx)
+            for (size_t node_idx : clusters[cluster_idx]) {
+                SupportNode* p_node = nodes_vec[node_idx].second;
                 SupportNode& node = *p_node;
                 if (to_delete.find(p_node) != to_delete.end())
                 {
-                    return; //Delete this node (don't create a new node for it on the next layer).
+                    continue; //Delete this node (don't create a new node for it on the next layer).
                 }
                 const std::vector<Point>& neighbours = mst.adjacent_nodes(node.position);
                 if (node.type == ePolygon) {
@@ -2673,11 +2738,9 @@ void TreeSupport::drop_nodes(std::vector<std::vector<SupportNode*>>& contact_nod
                     SupportNode* next_node = m_ts_data->create_node(next_position, node_parent->distance_to_top + 1, layer_nr_next, node_parent->support_roof_layers_below - 1, to_buildplate, node_parent,
                         print_z_next, height_next);
                     get_max_move_dist(next_node);
-                    m_ts_data->m_mutex.lock();
-                    contact_nodes[layer_nr_next].push_back(next_node);
+                    merged_next_nodes[node_idx] = next_node;
                     to_delete.insert(neighbour);
                     to_delete.insert(p_node);
-                    m_ts_data->m_mutex.unlock();
                 }
                 else if (neighbours.size() > 1) //Don't merge leaf nodes because we would then incur movement greater than the maximum move distance.
                 {
@@ -2691,29 +2754,63 @@ void TreeSupport::drop_nodes(std::vector<std::vector<SupportNode*>>& contact_nod
                             // only allow bigger node to merge smaller nodes. See STUDIO-6326
                             if(node.dist_mm_to_top < neighbour_node->dist_mm_to_top) continue;
 
-                            m_ts_data->m_mutex.lock();
-                            if (to_delete.find(p_node) == to_delete.end())
-                            {  // since we are processing all nodes in parallel, p_node may have been deleted by another thread. In this case, we should not delete neighbour_node.
-                                node.merged_neighbours.push_front(neighbour_node);
-                                node.merged_neighbours.insert(node.merged_neighbours.end(), neighbour_node->merged_neighbours.begin(), neighbour_node->merged_neighbours.end());
-                                to_delete.insert(neighbour_node);
-                                neighbour_node->valid = false;
-                            }
-                            m_ts_data->m_mutex.unlock();
+                            node.merged_neighbours.push_front(neighbour_node);
+                            node.merged_neighbours.insert(node.merged_neighbours.end(), neighbour_node->merged_neighbours.begin(), neighbour_node->merged_neighbours.end());
+                            to_delete.insert(neighbour_node);
+                            neighbour_node->valid = false;
+                        }
+                    }
+                }
+            }
+            });
+
+            // Nodes the second pass drops without moving them: the branches falling inside a collision area, and those cut
+            // off from their parent by the contours. They only depend on the node itself, thus they are found up front and
+            // the deleted ones are added to to_delete before the second pass, so that no node moves towards them,
+            // whatever the order in which the nodes are processed.
+            std::vector<char> dropped(nodes_vec.size(), false);
+            if (group_index > 0) {
+                tbb::parallel_for(tbb::blocked_range<size_t>(0, nodes_vec.size()), [&](const tbb::blocked_range<size_t> &range) {
+                for (size_t node_idx = range.begin(); node_idx < range.end(); ++ node_idx) {
+                    SupportNode* p_node = nodes_vec[node_idx].second;
+                    if (p_node->type == ePolygon || to_delete.find(p_node) != to_delete.end())
+                        continue;
+                    //If the branch falls completely inside a collision area (the entire branch would be removed by the X/Y offset), delete it.
+                    if (is_inside_ex(get_collision(m_ts_data->m_xy_distance, layer_nr), p_node->position))
+                    {
+                        const coordf_t branch_radius_node = get_radius(p_node, branch_radius);
+                        Point to_outside = projection_onto(get_collision(m_ts_data->m_xy_distance, layer_nr), p_node->position);
+                        double dist2_to_outside = vsize2_with_unscale(p_node->position - to_outside);
+                        if (dist2_to_outside >= branch_radius_node * branch_radius_node) //Too far inside.
+                        {
+                            dropped[node_idx] = true;
+                            if (support_on_buildplate_only)
+                                unsupported[node_idx] = true;
+                            else
+                                p_node->valid = false;
+                        }
+                        // if the link between parent and current is cut by contours, mark current as bottom contact node
+                        else if (p_node->parent && intersection_ln({p_node->position, p_node->parent->position}, layer_contours).empty()==false)
+                        {
+                            dropped[node_idx] = true;
+                            p_node->valid = false;
                         }
                     }
                 }
+                });
+                for (size_t node_idx = 0; node_idx < nodes_vec.size(); ++ node_idx)
+                    if (dropped[node_idx] && ! unsupported[node_idx])
+                        to_delete.insert(nodes_vec[node_idx].second);
             }
-            );
 
             //In the second pass, move all middle nodes.
-            tbb::parallel_for_each(nodes_vec.begin(), nodes_vec.end(), [&](const std::pair<const Point, SupportNode*>& entry) {
-            
-                SupportNode* p_node = entry.second;
+            tbb::parallel_for(tbb::blocked_range<size_t>(0, nodes_vec.size()), [&](const tbb::blocked_range<size_t> &range) {
+            for (size_t node_idx = range.begin(); node_idx < range.end(); ++ node_idx) {
+                SupportNode* p_node = nodes_vec[node_idx].second;
                 const SupportNode& node = *p_node;
                 if (to_delete.find(p_node) != to_delete.end())
                 {
-                    return;
+                    continue;
                 }
                 if (node.type == ePolygon) {
                     // polygon node do not merge or move
@@ -2735,41 +2832,13 @@ void TreeSupport::drop_nodes(std::vector<std::vector<SupportNode*>>& contact_nod
                             p_node, print_z_next, height_next);
                         next_node->max_move_dist = 0;
                         next_node->overhang = std::move(overhangs_next[index_biggest]);
-                        m_ts_data->m_mutex.lock();
-                        contact_nodes[layer_nr_next].emplace_back(next_node);
-                        m_ts_data->m_mutex.unlock();
-
+                        moved_next_nodes[node_idx] = next_node;
                     }
-                    return;
+                    continue;
                 }
 
-                //If the branch falls completely inside a collision area (the entire branch would be removed by the X/Y offset), delete it.
-                if (group_index > 0 && is_inside_ex(get_collision(m_ts_data->m_xy_distance, layer_nr), node.position))
-                {
-                    std::scoped_lock lock(m_ts_data->m_mutex);
-                    const coordf_t branch_radius_node = get_radius(p_node, branch_radius);
-                    Point to_outside = projection_onto(get_collision(m_ts_data->m_xy_distance, layer_nr), node.position);
-                    double dist2_to_outside = vsize2_with_unscale(node.position - to_outside);
-                    if (dist2_to_outside >= branch_radius_node * branch_radius_node) //Too far inside.
-                    {
-                        if (support_on_buildplate_only)
-                        {
-                            unsupported_branch_leaves.push_front({ layer_nr, p_node });
-                        }
-                        else {
-                            to_delete.insert(p_node);
-                            p_node->valid = false;
-                        }
-                        return;
-                    }
-                    // if the link between parent and current is cut by contours, mark current as bottom contact node
-                    if (p_node->parent && intersection_ln({p_node->position, p_node->parent->position}, layer_contours).empty()==false)
-                    {
-                        to_delete.insert(p_node);
-                        p_node->valid = false;
-                        return;
-                    }
-                }
+                if (dropped[node_idx])
+                    continue;
                 Point next_layer_vertex = node.position;
                 Point move_to_neighbor_center;
                 std::vector<Point>       moves;
@@ -2879,11 +2948,19 @@ void TreeSupport::drop_nodes(std::vector<std::vector<SupportNode*>>& contact_nod
                 SupportNode *     next_node     = m_ts_data->create_node(next_layer_vertex, node.distance_to_top + 1, layer_nr_next, node.support_roof_layers_below - 1, to_buildplate, p_node,
                     print_z_next, height_next);
                 get_max_move_dist(next_node);
-                m_ts_data->m_mutex.lock();
-                contact_nodes[layer_nr_next].push_back(next_node);
-                m_ts_data->m_mutex.unlock();
+                moved_next_nodes[node_idx] = next_node;
             }
-            );
+            });
+
+            for (SupportNode *next_node : merged_next_nodes)
+                if (next_node)
+                    contact_nodes[layer_nr_next].emplace_back(next_node);
+            for (SupportNode *next_node : moved_next_nodes)
+                if (next_node)
+                    contact_nodes[layer_nr_next].emplace_back(next_node);
+            for (size_t node_idx = 0; node_idx < nodes_vec.size(); ++ node_idx)
+                if (unsupported[node_idx])
+                    unsupported_branch_leaves.push_front({ layer_nr, nodes_vec[node_idx].second });
         }
 
 #ifdef SUPPORT_TREE_DEBUG_TO_SVG
@@ -2938,7 +3015,10 @@ void TreeSupport::drop_nodes(std::vector<std::vector<SupportNode*>>& contact_nod
         }
     }
 
-    BOOST_LOG_TRIVIAL(debug) << "after m_avoidance_cache.size()=" << m_ts_data->m_avoidance_cache.size();
+    const TreeSupportData::CacheStats stats = m_ts_data->cache_stats();
+    BOOST_LOG_TRIVIAL(debug) << "after drop_nodes avoidance peak " << stats.avoidance_peak_bytes / 1024 << " kB, evicted layers=" << stats.avoidance_evicted_layers;
+    // The avoidance is not used after dropping the nodes, unlike the collision needed by draw_circles().
+    m_ts_data->release_avoidance(0);
 
 }
 
@@ -3482,13 +3562,65 @@ TreeSupportData::TreeSupportData(const PrintObject &object, coordf_t xy_distance
     }
 }
 
+static size_t expolygons_memory(const ExPolygons &expolys)
+{
+    size_t bytes = expolys.capacity() * sizeof(ExPolygon);
+    for (const ExPolygon &expoly : expolys) {
+        bytes += expoly.contour.points.capacity() * sizeof(Point) + expoly.holes.capacity() * sizeof(Polygon);
+        for (const Polygon &hole : expoly.holes)
+            bytes += hole.points.capacity() * sizeof(Point);
+    }
+    return bytes;
+}
+
+TreeSupportData::RadiusAreas& TreeSupportData::radius_areas(AreasCache &cache, coordf_t radius) const
+{
+    const coord_t key = scale_(radius);
+    auto it = cache.radii.find(key);
+    if (it == cache.radii.end())
+        // Another thread may insert the same radius first, then ours is thrown away.
+        it = cache.radii.insert({ key, std::make_unique<RadiusAreas>(radius, m_layer_outlines.size()) }).first;
+    return *it->second;
+}
+
+template<typename CalculateFn>
+const ExPolygons& TreeSupportData::get_areas(AreasCache &cache, LayerAreas &layer, CalculateFn &&calculate)
+{
+    if (! layer.ready.load(std::memory_order_acquire)) {
+        // Threads requesting the same layer wait for the first one instead of calculating it again.
+        std::lock_guard<std::mutex> lock(layer.mutex);
+        if (! layer.ready.load(std::memory_order_relaxed)) {
+            layer.areas = calculate();
+            layer.areas.shrink_to_fit();
+            layer.bytes = expolygons_memory(layer.areas);
+            size_t bytes = (cache.bytes += layer.bytes);
+            for (size_t peak = cache.peak_bytes; peak < bytes && ! cache.peak_bytes.compare_exchange_weak(peak, bytes);) ;
+            ++ cache.layers;
+            layer.ready.store(true, std::memory_order_release);
+        }
+    }
+    return layer.areas;
+}
+
+void TreeSupportData::release_areas(AreasCache &cache, LayerAreas &layer)
+{
+    if (layer.ready.load(std::memory_order_relaxed)) {
+        layer.ready = false;
+        cache.bytes -= layer.bytes;
+        -- cache.layers;
+        ++ cache.evicted_layers;
+        layer.bytes = 0;
+        ExPolygons().swap(layer.areas);
+    }
+}
+
 const ExPolygons& TreeSupportData::get_collision(coordf_t radius, size_t layer_nr) const
 {
     profiler.tic();
     radius = ceil_radius(radius);
-    RadiusLayerPair key{radius, layer_nr};
-    const auto it = m_collision_cache.find(key);
-    const ExPolygons& collision = it != m_collision_cache.end() ? it->second : calculate_collision(key);
+    assert(layer_nr < m_layer_outlines.size());
+    const ExPolygons& collision = get_areas(m_collision_cache, radius_areas(m_collision_cache, radius).layers[layer_nr],
+        [this, radius, layer_nr]() { return calculate_collision(radius, layer_nr); });
     profiler.stage_add(STAGE_get_collision);
     return collision;
 }
@@ -3497,14 +3629,109 @@ const ExPolygons& TreeSupportData::get_avoidance(coordf_t radius, size_t layer_n
 {
     profiler.tic();
     radius = ceil_radius(radius);
-    RadiusLayerPair key{radius, layer_nr, recursions };
-    const auto it = m_avoidance_cache.find(key);
-    const ExPolygons& avoidance = it != m_avoidance_cache.end() ? it->second : calculate_avoidance(key);
+    assert(layer_nr < m_layer_outlines.size());
+    RadiusAreas &avoidance_areas = radius_areas(m_avoidance_cache, radius);
+    const ExPolygons& avoidance = get_areas(m_avoidance_cache, avoidance_areas.layers[layer_nr],
+        [this, &avoidance_areas, layer_nr, recursions]() { return calculate_avoidance(avoidance_areas, layer_nr, recursions); });
 
     profiler.stage_add(STAGE_GET_AVOIDANCE);
     return avoidance;
 }
 
+void TreeSupportData::precalculate_avoidance(const std::vector<std::set<coordf_t>> &layer_radii)
+{
+    m_avoidance_released_from = std::numeric_limits<size_t>::max();
+
+    // Layers requested per rounded radius.
+    std::map<coord_t, std::pair<coordf_t, std::vector<size_t>>> radii;
+    for (size_t layer_nr = 0; layer_nr < layer_radii.size() && layer_nr < m_layer_outlines.size(); ++ layer_nr)
+        for (coordf_t radius : layer_radii[layer_nr]) {
+            radius = ceil_radius(radius);
+            auto &requested = radii[scale_(radius)];
+            requested.first = radius;
+            requested.second.emplace_back(layer_nr);
+        }
+    std::vector<std::pair<coordf_t, std::vector<size_t>>> radii_layers;
+    radii_layers.reserve(radii.size());
+    for (auto &radius : radii)
+        radii_layers.emplace_back(std::move(radius.second));
+
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, radii_layers.size(), 1), [this, &radii_layers](const tbb::blocked_range<size_t> &range) {
+        for (size_t radius_idx = range.begin(); radius_idx < range.end(); ++ radius_idx) {
+            const coordf_t radius = radii_layers[radius_idx].first;
+            // The requested layers and all the layers below them they depend on.
+            std::vector<char> needed(m_layer_outlines.size(), false);
+            for (size_t layer_nr : radii_layers[radius_idx].second)
+                for (; ! needed[layer_nr]; layer_nr = layer_heights[layer_nr].next_layer_nr) {
+                    needed[layer_nr] = true;
+                    if (layer_nr == 0)
+                        break;
+                }
+            std::vector<size_t> layers;
+            for (size_t layer_nr = 0; layer_nr < needed.size(); ++ layer_nr)
+                if (needed[layer_nr])
+                    layers.emplace_back(layer_nr);
+
+            // The collision of the layers is independent of each other.
+            tbb::parallel_for(tbb::blocked_range<size_t>(0, layers.size()), [this, radius, &layers](const tbb::blocked_range<size_t> &range) {
+                for (size_t i = range.begin(); i < range.end(); ++ i)
+                    get_collision(radius, layers[i]);
+            });
+
+            RadiusAreas &avoidance_areas = radius_areas(m_avoidance_cache, radius);
+            for (size_t i = 0; i < layers.size(); ++ i) {
+                // Only offsets the layer below, which is cached already.
+                get_avoidance(radius, layers[i]);
+                if (i > 0 && (i - 1) % AVOIDANCE_CHECKPOINT_INTERVAL != 0 && m_avoidance_cache_budget > 0 &&
+                    m_avoidance_cache.bytes > m_avoidance_cache_budget)
+                    // No other thread accesses this radius.
+                    release_areas(m_avoidance_cache, avoidance_areas.layers[layers[i - 1]]);
+            }
+        }
+    });
+    // The checkpoint layers of all the radii together may still exceed the budget.
+    trim_avoidance_cache();
+}
+
+void TreeSupportData::trim_avoidance_cache()
+{
+    if (m_avoidance_cache_budget == 0 || m_avoidance_cache.bytes <= m_avoidance_cache_budget)
+        return;
+    // The nodes are dropped from the top down, thus the lowest layers are needed last and they are released first.
+    // The checkpoint layers go last, the layers between them are recalculated by a few offsets of a checkpoint.
+    for (bool checkpoints : { false, true })
+        for (size_t layer_nr = 0; layer_nr < m_layer_outlines.size(); ++ layer_nr) {
+            if ((layer_nr % AVOIDANCE_CHECKPOINT_INTERVAL == 0) != checkpoints)
+                continue;
+            for (auto &radius : m_avoidance_cache.radii) {
+                release_areas(m_avoidance_cache, radius.second->layers[layer_nr]);
+                if (m_avoidance_cache.bytes <= m_avoidance_cache_budget)
+                    return;
+            }
+        }
+}
+
+void TreeSupportData::release_avoidance(size_t layer_nr)
+{
+    // Layers above m_avoidance_released_from were released by the previous calls already.
+    for (auto &radius : m_avoidance_cache.radii)
+        for (size_t i = layer_nr; i < std::min(m_avoidance_released_from, radius.second->layers.size()); ++ i)
+            release_areas(m_avoidance_cache, radius.second->layers[i]);
+    m_avoidance_released_from = std::min(m_avoidance_released_from, layer_nr);
+}
+
+TreeSupportData::CacheStats TreeSupportData::cache_stats() const
+{
+    CacheStats stats;
+    stats.collision_bytes          = m_collision_cache.bytes;
+    stats.collision_layers         = m_collision_cache.layers;
+    stats.avoidance_bytes          = m_avoidance_cache.bytes;
+    stats.avoidance_peak_bytes     = m_avoidance_cache.peak_bytes;
+    stats.avoidance_layers         = m_avoidance_cache.layers;
+    stats.avoidance_evicted_layers = m_avoidance_cache.evicted_layers;
+    return stats;
+}
+
 Polygons TreeSupportData::get_contours(size_t layer_nr) const
 {
     Polygons contours;
@@ -3570,27 +3797,22 @@ coordf_t TreeSupportData::ceil_radius(coordf_t radius) const
     }
 }
 
-const ExPolygons& TreeSupportData::calculate_collision(const RadiusLayerPair& key) const
+ExPolygons TreeSupportData::calculate_collision(coordf_t radius, size_t layer_nr) const
 {
-    assert(key.layer_nr < m_layer_outlines.size());
+    assert(layer_nr < m_layer_outlines.size());
 
-    ExPolygons collision_areas = std::move(offset_ex(m_layer_outlines[key.layer_nr], scale_(key.radius)));
-    collision_areas = expolygons_simplify(collision_areas, scale_(m_radius_sample_resolution));
-    const auto ret = m_collision_cache.insert({ key, std::move(collision_areas) });
-    return ret.first->second;
+    ExPolygons collision_areas = std::move(offset_ex(m_layer_outlines[layer_nr], scale_(radius)));
+    return expolygons_simplify(collision_areas, scale_(m_radius_sample_resolution));
 }
 
-const ExPolygons& TreeSupportData::calculate_avoidance(const RadiusLayerPair& key) const
+ExPolygons TreeSupportData::calculate_avoidance(RadiusAreas& radius_areas, size_t layer_nr, int recursions) const
 {
-    const auto& radius = key.radius;
-    const auto& layer_nr = key.layer_nr;
-    BOOST_LOG_TRIVIAL(debug) << "calculate_avoidance on (radius,layer)= (" << radius << "," << layer_nr<<"), recursion="<<key.recursions;
+    const auto& radius = radius_areas.radius;
+    BOOST_LOG_TRIVIAL(debug) << "calculate_avoidance on (radius,layer)= (" << radius << "," << layer_nr<<"), recursion="<<recursions;
     constexpr auto max_recursion_depth = 100;
-    if (key.recursions <= max_recursion_depth*2) {
-        if (layer_nr == 0) {
-            m_avoidance_cache[key] = get_collision(radius, 0);
-            return m_avoidance_cache[key];
-        }
+    if (recursions <= max_recursion_depth*2) {
+        if (layer_nr == 0)
+            return get_collision(radius, 0);
 
         // Avoidance for a given layer depends on all layers beneath it so could have very deep recursion depths if
         // called at high layer heights. We can limit the reqursion depth to N by checking if the layer N
@@ -3601,25 +3823,19 @@ const ExPolygons& TreeSupportData::calculate_avoidance(const RadiusLayerPair& ke
         int            layers_below;
         for (layers_below = 0; layers_below < max_recursion_depth && layer_nr_next > 0; layers_below++) { layer_nr_next = layer_heights[layer_nr_next].next_layer_nr; }
         // Check if we would exceed the recursion limit by trying to process this layer
-        if (layers_below >= max_recursion_depth && m_avoidance_cache.find({radius, layer_nr_next}) == m_avoidance_cache.end()) {
+        if (layers_below >= max_recursion_depth && ! radius_areas.layers[layer_nr_next].ready) {
             // Force the calculation of the layer `max_recursion_depth` below our current one, ignoring the result.
-            get_avoidance(radius, layer_nr_next, key.recursions + 1);
+            get_avoidance(radius, layer_nr_next, recursions + 1);
         }
 
         layer_nr_next   = layer_heights[layer_nr].next_layer_nr;
-        ExPolygons        avoidance_areas = std::move(offset_ex(get_avoidance(radius, layer_nr_next, key.recursions+1), scale_(-m_max_move)));
+        ExPolygons        avoidance_areas = std::move(offset_ex(get_avoidance(radius, layer_nr_next, recursions+1), scale_(-m_max_move)));
         const ExPolygons &collision       = get_collision(radius, layer_nr);
         avoidance_areas.insert(avoidance_areas.end(), collision.begin(), collision.end());
-        avoidance_areas = std::move(union_ex(avoidance_areas));
-        auto ret  = m_avoidance_cache.insert({key, std::move(avoidance_areas)});
-        //assert(ret.second);
-        return ret.first->second;
+        return union_ex(avoidance_areas);
     } else {
-        BOOST_LOG_TRIVIAL(debug) << "calculate_avoidance exceeds max_recursion_depth*2 on radius=" << radius << ", layer=" << layer_nr << ", recursion=" << key.recursions;
-        ExPolygons avoidance_areas = get_collision(radius, layer_nr);// std::move(offset_ex(m_layer_outlines_below[layer_nr], scale_(m_xy_distance + radius)));
-        auto ret = m_avoidance_cache.insert({ key, std::move(avoidance_areas) });
-        assert(ret.second);
-        return ret.first->second;
+        BOOST_LOG_TRIVIAL(debug) << "calculate_avoidance exceeds max_recursion_depth*2 on radius=" << radius << ", layer=" << layer_nr << ", recursion=" << recursions;
+        return get_collision(radius, layer_nr);// std::move(offset_ex(m_layer_outlines_below[layer_nr], scale_(m_xy_distance + radius)));
     }
 }
 
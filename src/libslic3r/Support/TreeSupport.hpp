@@ -3,6 +3,10 @@
 
 #include <forward_list>
 #include <unordered_set>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <set>
 #include "tbb/concurrent_unordered_map.h"
 #include "../ExPolygon.hpp"
 #include "../Point.hpp"
@@ -186,7 +190,9 @@ struct SupportNode
 /*!
  * \brief Lazily generates tree guidance volumes.
  *
- * \warning This class is not currently thread-safe and should not be accessed in OpenMP blocks
+ * get_collision() and get_avoidance() may be called concurrently, each (radius, layer) area is
+ * calculated at most once. The avoidance is stored per radius and layer, so that the layers
+ * no longer needed may be released to keep the memory bounded, see set_avoidance_cache_budget().
  */
 class TreeSupportData
 {
@@ -241,6 +247,48 @@ public:
      */
     const ExPolygons& get_avoidance(coordf_t radius, size_t layer_idx, int recursions=0) const;
 
+    /*!
+     * \brief Calculate the avoidance of all the radii requested per layer by \p layer_radii.
+     *
+     * Each radius is calculated bottom up, so that every layer only offsets the layer below,
+     * and the radii are processed in parallel. Above the cache budget, only every
+     * AVOIDANCE_CHECKPOINT_INTERVAL-th layer is kept, the others are calculated again on demand
+     * from the closest kept layer below.
+     */
+    void precalculate_avoidance(const std::vector<std::set<coordf_t>> &layer_radii);
+
+    /*!
+     * \brief Release the cached avoidance of layer \p layer_nr and of all the layers above.
+     *
+     * Called by TreeSupport::drop_nodes() once the nodes were dropped below \p layer_nr.
+     * Not thread safe, no get_avoidance() may run concurrently.
+     */
+    void release_avoidance(size_t layer_nr);
+
+    /*!
+     * \brief Release cached avoidance layers until the cache fits the budget.
+     *
+     * The lowest layers are released first, the checkpoint layers only after all the others.
+     * The released layers are calculated again on demand. Called by TreeSupport::drop_nodes()
+     * for every layer, the cache may exceed the budget by the layers calculated in between.
+     * Not thread safe, no get_avoidance() may run concurrently.
+     */
+    void trim_avoidance_cache();
+
+    // Memory of the cached avoidance kept by precalculate_avoidance() and trim_avoidance_cache(), 0 for unlimited.
+    void set_avoidance_cache_budget(size_t bytes) { m_avoidance_cache_budget = bytes; }
+
+    struct CacheStats {
+        size_t collision_bytes          { 0 };
+        size_t collision_layers         { 0 };
+        size_t avoidance_bytes          { 0 };
+        size_t avoidance_peak_bytes     { 0 };
+        size_t avoidance_layers         { 0 };
+        // Avoidance layers released by the budget or by release_avoidance().
+        size_t avoidance_evicted_layers { 0 };
+    };
+    CacheStats cache_stats() const;
+
     Polygons get_contours(size_t layer_nr) const;
     Polygons get_contours_with_holes(size_t layer_nr) const;
 
@@ -254,25 +302,43 @@ public:
 
 private:
     /*!
-     * \brief Convenience typedef for the keys to the caches
+     * \brief Areas of a single radius and layer, calculated once by the first thread requesting them.
      */
-    struct RadiusLayerPair {
-        coordf_t radius;
-        size_t layer_nr;
-        int recursions;
-        
+    struct LayerAreas {
+        std::mutex          mutex;
+        std::atomic<bool>   ready { false };
+        ExPolygons          areas;
+        size_t              bytes { 0 };
     };
-    struct RadiusLayerPairEquality {
-        constexpr bool operator()(const RadiusLayerPair& _Left, const RadiusLayerPair& _Right) const {
-            return _Left.radius == _Right.radius && _Left.layer_nr == _Right.layer_nr;
-        }
+
+    /*!
+     * \brief Areas of a single radius indexed by layer.
+     */
+    struct RadiusAreas {
+        RadiusAreas(coordf_t radius, size_t num_layers) : radius(radius), layers(num_layers) {}
+        coordf_t                radius;
+        std::vector<LayerAreas> layers;
     };
-    struct RadiusLayerPairHash {
-        size_t operator()(const RadiusLayerPair& elem) const {
-            return std::hash<coord_t>()(elem.radius) ^ std::hash<coord_t>()(elem.layer_nr * 7919);
-        }
+
+    /*!
+     * \brief Cache of areas per radius and layer with its memory statistics.
+     *
+     * The radii are keyed by their scaled value, as the rounded up radii may differ in the last bits.
+     */
+    struct AreasCache {
+        tbb::concurrent_unordered_map<coord_t, std::unique_ptr<RadiusAreas>> radii;
+        std::atomic<size_t> bytes           { 0 };
+        std::atomic<size_t> peak_bytes      { 0 };
+        std::atomic<size_t> layers          { 0 };
+        std::atomic<size_t> evicted_layers  { 0 };
     };
 
+    RadiusAreas& radius_areas(AreasCache &cache, coordf_t radius) const;
+    // Return the areas of the layer, calculating them if not cached yet.
+    template<typename CalculateFn>
+    static const ExPolygons& get_areas(AreasCache &cache, LayerAreas &layer, CalculateFn &&calculate);
+    static void release_areas(AreasCache &cache, LayerAreas &layer);
+
     /*!
      * \brief Round \p radius upwards to a multiple of m_radius_sample_resolution
      *
@@ -281,20 +347,21 @@ private:
     coordf_t ceil_radius(coordf_t radius) const;
 
     /*!
-     * \brief Calculate the collision areas at the radius and layer indicated
-     * by \p key.
+     * \brief Calculate the collision areas at the radius and layer indicated.
      *
-     * \param key The radius and layer of the node of interest
+     * \param radius The radius of the node of interest
+     * \param layer_nr The layer of interest
      */
-    const ExPolygons& calculate_collision(const RadiusLayerPair& key) const;
+    ExPolygons calculate_collision(coordf_t radius, size_t layer_nr) const;
 
     /*!
-     * \brief Calculate the avoidance areas at the radius and layer indicated
-     * by \p key.
+     * \brief Calculate the avoidance areas at the radius and layer indicated.
      *
-     * \param key The radius and layer of the node of interest
+     * \param radius_areas The avoidance of the radius of interest
+     * \param layer_nr The layer of interest
+     * \param recursions Depth of the recursion to the layers below
      */
-    const ExPolygons& calculate_avoidance(const RadiusLayerPair& key) const;
+    ExPolygons calculate_avoidance(RadiusAreas& radius_areas, size_t layer_nr, int recursions) const;
 
     tbb::spin_mutex                         									m_mutex;
 
@@ -340,8 +407,14 @@ public:
      * coconut: previously stl::unordered_map is used which seems problematic with tbb::parallel_for.
      * So we change to tbb::concurrent_unordered_map
      */
-    mutable tbb::concurrent_unordered_map<RadiusLayerPair, ExPolygons, RadiusLayerPairHash, RadiusLayerPairEquality> m_collision_cache;
-    mutable tbb::concurrent_unordered_map<RadiusLayerPair, ExPolygons, RadiusLayerPairHash, RadiusLayerPairEquality> m_avoidance_cache;
+    mutable AreasCache m_collision_cache;
+    mutable AreasCache m_avoidance_cache;
+
+    // Every AVOIDANCE_CHECKPOINT_INTERVAL-th layer of a radius is kept by precalculate_avoidance() above the budget.
+    static constexpr size_t AVOIDANCE_CHECKPOINT_INTERVAL = 16;
+    size_t m_avoidance_cache_budget { size_t(2) << 30 };
+    // Lowest layer released by release_avoidance() since precalculate_avoidance().
+    size_t m_avoidance_released_from { std::numeric_limits<size_t>::max() };
 
     friend TreeSupport;
 };
@@ -15,7 +15,9 @@
 #include <libqhullcpp/QhullFacetList.h>
 #include <libqhullcpp/QhullVertexSet.h>
 
+#include <atomic>
 #include <cmath>
+#include <cstring>
 #include <deque>
 #include <queue>
 #include <vector>
@@ -27,6 +29,8 @@
 #include <boost/nowide/cstdio.hpp>
 #include <boost/predef/other/endian.h>
 
+#include <tbb/parallel_for.h>
+
 #include <Eigen/Core>
 #include <Eigen/Dense>
 
@@ -209,11 +213,111 @@ bool TriangleMesh::from_stl(stl_file& stl, bool repair)
     return true;
 }
 
+// BBS: Mirrors check_normal_vector() of admesh: Does the normal stored with the facet point against its orientation?
+static bool stl_stored_normal_reversed(stl_facet &facet)
+{
+    const float eps = 0.001f;
+    stl_normal  normal;
+    stl_calculate_normal(normal, &facet);
+    stl_normalize_vector(normal);
+    if (((normal - facet.normal).cwiseAbs().array() < eps).all())
+        return false;
+    stl_normal stored = facet.normal;
+    stl_normalize_vector(stored);
+    return ! ((normal - stored).cwiseAbs().array() < eps).all() && ((normal + stored).cwiseAbs().array() < eps).all();
+}
+
+// BBS: Would trianglemesh_repair_on_import() keep the mesh as it is, up to reversing all of its facets?
+// That is the case if no facet is degenerate, each edge is shared by exactly two facets of opposite orientation
+// and no stored normal points against the orientation of its facet, which would make stl_fix_normal_directions() reverse its part.
+static bool its_repair_on_import_is_noop(const indexed_triangle_set &its, const std::vector<stl_normal> &normals)
+{
+    assert(normals.size() == its.indices.size());
+    std::atomic<bool> noop { true };
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, its.indices.size()), [&its, &normals, &noop](const tbb::blocked_range<size_t> &range) {
+        for (size_t i = range.begin(); i < range.end() && noop; ++ i) {
+            const stl_triangle_vertex_indices &face = its.indices[i];
+            stl_facet facet;
+            facet.normal = normals[i];
+            for (int j = 0; j < 3; ++ j)
+                facet.vertex[j] = its.vertices[face(j)];
+            if (face(0) == face(1) || face(1) == face(2) || face(2) == face(0) || stl_stored_normal_reversed(facet))
+                noop = false;
+        }
+    });
+    if (! noop)
+        return false;
+    // Each edge a -> b has to be found once among the faces incident to a, its opposite edge b -> a once as well.
+    const VertexFaceIndex vertex_faces(its);
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, its.indices.size()), [&its, &noop, &vertex_faces](const tbb::blocked_range<size_t> &range) {
+        for (size_t i = range.begin(); i < range.end() && noop; ++ i) {
+            const stl_triangle_vertex_indices &face = its.indices[i];
+            for (int j = 0; j < 3; ++ j) {
+                const int a = face(j);
+                const int b = face(j == 2 ? 0 : j + 1);
+                int num_same = 0, num_opposite = 0;
+                for (size_t other_face : vertex_faces[a]) {
+                    const stl_triangle_vertex_indices &other = its.indices[other_face];
+                    const int k = its_triangle_vertex_index(other, a);
+                    num_same     += other(k == 2 ? 0 : k + 1) == b;
+                    num_opposite += other(k == 0 ? 2 : k - 1) == b;
+                }
+                if (num_same != 1 || num_opposite != 1) {
+                    noop = false;
+                    break;
+                }
+            }
+        }
+    });
+    return noop;
+}
+
+// BBS: Fill stl with the facets of its and their stored normals as stl_open() would have read them from the file.
+static void stl_from_its(const indexed_triangle_set &its, const std::vector<stl_normal> &normals, stl_file &stl)
+{
+    stl.clear();
+    stl.stats.type                = inmemory;
+    stl.stats.number_of_facets    = uint32_t(its.indices.size());
+    stl.stats.original_num_facets = stl.stats.number_of_facets;
+    stl_allocate(&stl);
+    bool first = true;
+    for (size_t i = 0; i < its.indices.size(); ++ i) {
+        stl_facet &facet = stl.facet_start[i];
+        for (int j = 0; j < 3; ++ j)
+            facet.vertex[j] = its.vertices[its.indices[i](j)];
+        facet.normal   = normals[i];
+        facet.extra[0] = 0;
+        facet.extra[1] = 0;
+        stl_facet_stats(&stl, facet, first);
+    }
+    stl.stats.size              = stl.stats.max - stl.stats.min;
+    stl.stats.bounding_diameter = stl.stats.size.norm();
+}
+
 bool TriangleMesh::ReadSTLFile(const char *input_file, bool repair, ImportstlProgressFn stlFn, int custom_header_length)
 {
+    // BBS: Read the STL directly into an indexed triangle set. The admesh repair only runs on the meshes it would change,
+    // the files its_read_stl() does not handle are read by admesh.
     stl_file stl;
-    if (!stl_open(&stl, input_file, stlFn, custom_header_length))
-        return false;
+    {
+        indexed_triangle_set    its;
+        std::vector<stl_normal> normals;
+        bool                    canceled = false;
+        if (its_read_stl(input_file, its, normals, canceled, stlFn, custom_header_length)) {
+            if (! repair || its_repair_on_import_is_noop(its, normals)) {
+                if (repair && its_volume(its) < 0)
+                    // stl_calculate_volume() reverses all the facets of a mesh with negative volume.
+                    its_flip_triangles(its);
+                this->its = std::move(its);
+                fill_initial_stats(this->its, m_stats);
+                return true;
+            }
+            stl_from_its(its, normals, stl);
+        } else if (canceled)
+            return false;
+        else if (! stl_open(&stl, input_file, stlFn, custom_header_length))
+            return false;
+    }
     return from_stl(stl, repair);
 }
 
@@ -733,6 +837,121 @@ int its_merge_vertices(indexed_triangle_set &its, bool shrink_to_fit)
     return num_erased;
 }
 
+indexed_triangle_set its_from_triangle_soup(const std::vector<stl_vertex> &soup)
+{
+    assert(soup.size() % 3 == 0);
+    assert(soup.size() < size_t(std::numeric_limits<int>::max()));
+    const size_t num_vertices = soup.size();
+    indexed_triangle_set out;
+    if (num_vertices == 0)
+        return out;
+
+    // 1) Hash the vertices. +0 and -0 compare equal, thus they are hashed the same.
+    auto coord_bits = [](float f) { uint32_t bits = 0; if (f != 0.f) memcpy(&bits, &f, sizeof(f)); return uint64_t(bits); };
+    std::vector<uint32_t> hashes(num_vertices);
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, num_vertices), [&soup, &hashes, &coord_bits](const tbb::blocked_range<size_t> &range) {
+        for (size_t i = range.begin(); i < range.end(); ++ i) {
+            const stl_vertex &v = soup[i];
+            uint64_t h = coord_bits(v.x()) * 0x9E3779B97F4A7C15ull;
+            h = (h ^ (h >> 29) ^ coord_bits(v.y())) * 0xBF58476D1CE4E5B9ull;
+            h = (h ^ (h >> 32) ^ coord_bits(v.z())) * 0x94D049BB133111EBull;
+            hashes[i] = uint32_t(h >> 32);
+        }
+    });
+
+    // 2) Distribute the vertex indices into shards by the top bits of their hashes, keeping their order inside a shard.
+    //    Matching vertices end up in the same shard, thus the shards are merged independently of each other.
+    const int    shard_bits = num_vertices < 65536 ? 0 : 8;
+    const size_t num_shards = size_t(1) << shard_bits;
+    auto         shard_of   = [shard_bits](uint32_t hash) { return shard_bits == 0 ? size_t(0) : size_t(hash >> (32 - shard_bits)); };
+    const size_t block_size = 65536;
+    const size_t num_blocks = (num_vertices + block_size - 1) / block_size;
+    std::vector<size_t> block_offsets(num_blocks * num_shards, 0);
+    tbb::parallel_for(size_t(0), num_blocks, [&](size_t block) {
+        size_t *counts = block_offsets.data() + block * num_shards;
+        for (size_t i = block * block_size; i < std::min(num_vertices, (block + 1) * block_size); ++ i)
+            ++ counts[shard_of(hashes[i])];
+    });
+    std::vector<size_t> shard_starts(num_shards + 1, 0);
+    for (size_t shard = 0, offset = 0; shard < num_shards; ++ shard) {
+        shard_starts[shard] = offset;
+        for (size_t block = 0; block < num_blocks; ++ block) {
+            size_t count = block_offsets[block * num_shards + shard];
+            block_offsets[block * num_shards + shard] = offset;
+            offset += count;
+        }
+        shard_starts[shard + 1] = offset;
+    }
+    std::vector<int> sorted(num_vertices);
+    tbb::parallel_for(size_t(0), num_blocks, [&](size_t block) {
+        size_t *offsets = block_offsets.data() + block * num_shards;
+        for (size_t i = block * block_size; i < std::min(num_vertices, (block + 1) * block_size); ++ i)
+            sorted[offsets[shard_of(hashes[i])] ++] = int(i);
+    });
+    block_offsets.clear();
+    block_offsets.shrink_to_fit();
+
+    // 3) Map each vertex to the first vertex with the same coordinates using an open addressing hash table per shard.
+    std::vector<int> first_occurrence(num_vertices);
+    tbb::parallel_for(size_t(0), num_shards, [&](size_t shard) {
+        const size_t begin = shard_starts[shard];
+        const size_t end   = shard_starts[shard + 1];
+        if (begin == end)
+            return;
+        size_t table_size = 16;
+        while (table_size < 2 * (end - begin))
+            table_size *= 2;
+        const size_t     mask = table_size - 1;
+        std::vector<int> table(table_size, -1);
+        for (size_t i = begin; i < end; ++ i) {
+            const int v = sorted[i];
+            for (size_t slot = hashes[v] & mask;; slot = (slot + 1) & mask) {
+                if (table[slot] == -1) {
+                    table[slot] = v;
+                    first_occurrence[v] = v;
+                    break;
+                }
+                if (soup[table[slot]] == soup[v]) {
+                    first_occurrence[v] = table[slot];
+                    break;
+                }
+            }
+        }
+    });
+    sorted.clear();
+    sorted.shrink_to_fit();
+    hashes.clear();
+    hashes.shrink_to_fit();
+
+    // 4) Number the first occurrences in the order of the soup, copy them to the output and index the triangles.
+    std::vector<int> block_starts(num_blocks + 1, 0);
+    tbb::parallel_for(size_t(0), num_blocks, [&](size_t block) {
+        int count = 0;
+        for (size_t i = block * block_size; i < std::min(num_vertices, (block + 1) * block_size); ++ i)
+            count += first_occurrence[i] == int(i);
+        block_starts[block + 1] = count;
+    });
+    for (size_t block = 0; block < num_blocks; ++ block)
+        block_starts[block + 1] += block_starts[block];
+    std::vector<int> new_index(num_vertices, -1);
+    out.vertices.resize(block_starts.back());
+    tbb::parallel_for(size_t(0), num_blocks, [&](size_t block) {
+        int idx = block_starts[block];
+        for (size_t i = block * block_size; i < std::min(num_vertices, (block + 1) * block_size); ++ i)
+            if (first_occurrence[i] == int(i)) {
+                new_index[i] = idx;
+                out.vertices[idx ++] = soup[i];
+            }
+    });
+    out.indices.resize(num_vertices / 3);
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, out.indices.size()), [&](const tbb::blocked_range<size_t> &range) {
+        for (size_t i = range.begin(); i < range.end(); ++ i)
+            for (int j = 0; j < 3; ++ j)
+                out.indices[i](j) = new_index[first_occurrence[3 * i + j]];
+    });
+    return out;
+}
+
 void its_flip_triangles(indexed_triangle_set &its)
 {
     for (stl_triangle_vertex_indices &face : its.indices)
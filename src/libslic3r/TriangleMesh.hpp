@@ -208,6 +208,10 @@ void its_flip_triangles(indexed_triangle_set &its);
 // or more than two faces share the same edge position!
 int its_merge_vertices(indexed_triangle_set &its, bool shrink_to_fit = true);
 
+// BBS: Create an indexed triangle set from a triangle soup of 3 vertices per triangle, merging the exactly matching
+// vertices in parallel. The vertices are stored in the order of their first occurrence, the order its_merge_vertices() keeps.
+indexed_triangle_set its_from_triangle_soup(const std::vector<stl_vertex> &soup);
+
 // Remove degenerate faces, return number of faces removed.
 int its_remove_degenerate_faces(indexed_triangle_set &its, bool shrink_to_fit = true);
 
@@ -12,6 +12,7 @@
 #include <deque>
 #include <queue>
 #include <mutex>
+#include <numeric>
 #include <utility>
 
 #include <boost/log/trivial.hpp>
@@ -1878,8 +1879,8 @@ std::vector<Polygons> slice_mesh(
         // Instead of edge identifiers, one shall use a sorted pair of edge vertex indices.
         // However facets_edges assigns a single edge ID to two triangles only, thus when factoring facets_edges out, one will have
         // to make sure that no code relies on it.
-        std::vector<Vec3i> face_edge_ids = its_face_edge_ids(mesh);
         if (zs.size() <= 1) {
+            std::vector<Vec3i> face_edge_ids = its_face_edge_ids(mesh);
             // It likely is not worthwile to copy the vertices. Apply the transformation in place.
             if (is_identity(params.trafo)) {
                 lines = slice_make_lines(
@@ -1891,10 +1892,8 @@ std::vector<Polygons> slice_mesh(
                 lines = slice_make_lines(mesh.vertices, [tf](const Vec3f &p) { return tf * p; }, mesh.indices, face_edge_ids, zs, throw_on_cancel);
             }
         } else {
-            // Copy and scale vertices in XY, don't scale in Z. Possibly apply the transformation.
-            lines = slice_make_lines(
-                transform_mesh_vertices_for_slicing(mesh, params.trafo), 
-                [](const Vec3f &p) { return p; },  mesh.indices, face_edge_ids, zs, throw_on_cancel);
+            // One-shot slicing through a temporary session: copy and scale vertices in XY, don't scale in Z. Possibly apply the transformation.
+            lines = MeshSlicingSession(mesh, params.trafo, false, throw_on_cancel).make_lines(zs, throw_on_cancel);
         }
     }
 
@@ -2001,22 +2000,20 @@ Polygons slice_mesh(
     return layers.front();
 }
 
-std::vector<ExPolygons> slice_mesh_ex(
-    const indexed_triangle_set       &mesh,
-    const std::vector<float>         &zs,
-    const MeshSlicingParamsEx        &params,
-    std::function<void()>             throw_on_cancel)
+// Slicing params for the slice_mesh() step of slice_mesh_ex().
+static MeshSlicingParams slicing_params_for_polygons(const MeshSlicingParamsEx &params)
+{
+    MeshSlicingParams slicing_params(params);
+    if (params.mode == MeshSlicingParams::SlicingMode::PositiveLargestContour)
+        slicing_params.mode = MeshSlicingParams::SlicingMode::Positive;
+    if (params.mode_below == MeshSlicingParams::SlicingMode::PositiveLargestContour)
+        slicing_params.mode_below = MeshSlicingParams::SlicingMode::Positive;
+    return slicing_params;
+}
+
+// Turn the layers produced by slice_mesh() into ExPolygons.
+static std::vector<ExPolygons> make_expolygons_layers(const std::vector<Polygons> &layers_p, const MeshSlicingParamsEx &params, const std::function<void()> &throw_on_cancel)
 {
-    std::vector<Polygons> layers_p;
-    {
-        MeshSlicingParams slicing_params(params);
-        if (params.mode == MeshSlicingParams::SlicingMode::PositiveLargestContour)
-            slicing_params.mode = MeshSlicingParams::SlicingMode::Positive;
-        if (params.mode_below == MeshSlicingParams::SlicingMode::PositiveLargestContour)
-            slicing_params.mode_below = MeshSlicingParams::SlicingMode::Positive;
-        layers_p = slice_mesh(mesh, zs, slicing_params, throw_on_cancel);
-    }
-    
 //    BOOST_LOG_TRIVIAL(debug) << "slice_mesh make_expolygons in parallel - start";
     std::vector<ExPolygons> layers(layers_p.size(), ExPolygons{});
     tbb::parallel_for(
@@ -2050,6 +2047,176 @@ std::vector<ExPolygons> slice_mesh_ex(
     return layers;
 }
 
+std::vector<ExPolygons> slice_mesh_ex(
+    const indexed_triangle_set       &mesh,
+    const std::vector<float>         &zs,
+    const MeshSlicingParamsEx        &params,
+    std::function<void()>             throw_on_cancel)
+{
+    std::vector<Polygons> layers_p = slice_mesh(mesh, zs, slicing_params_for_polygons(params), throw_on_cancel);
+
+    return make_expolygons_layers(layers_p, params, throw_on_cancel);
+}
+
+MeshSlicingSession::MeshSlicingSession(const indexed_triangle_set &mesh, const Transform3d &trafo, bool flip_triangles, std::function<void()> throw_on_cancel) :
+    m_trafo(trafo)
+{
+    if (mesh.indices.empty())
+        return;
+
+    indexed_triangle_set its;
+    its.vertices = transform_mesh_vertices_for_slicing(mesh, trafo);
+    its.indices  = mesh.indices;
+    if (flip_triangles)
+        its_flip_triangles(its);
+    //FIXME facets_edges is likely not needed and quite costly to calculate, see slice_mesh().
+    std::vector<Vec3i> face_edge_ids = its_face_edge_ids(its, throw_on_cancel);
+    throw_on_cancel();
+
+    // Order the faces by their lowest Z. A stable counting sort into thin Z buckets is cheaper than a full sort,
+    // the faces inside a bucket keep the order of the mesh.
+    std::vector<float> face_min_z(its.indices.size());
+    std::vector<float> face_max_z(its.indices.size());
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, its.indices.size()), [&its, &face_min_z, &face_max_z](const tbb::blocked_range<size_t> &range) {
+        for (size_t face_idx = range.begin(); face_idx < range.end(); ++ face_idx) {
+            const stl_triangle_vertex_indices &face = its.indices[face_idx];
+            const float z[3] { its.vertices[face(0)].z(), its.vertices[face(1)].z(), its.vertices[face(2)].z() };
+            face_min_z[face_idx] = std::min(z[0], std::min(z[1], z[2]));
+            face_max_z[face_idx] = std::max(z[0], std::max(z[1], z[2]));
+        }
+    });
+    const auto   [mesh_min_z, mesh_max_z] = std::minmax_element(face_min_z.begin(), face_min_z.end());
+    const float  bucket_min_z  = *mesh_min_z;
+    const size_t num_buckets   = std::clamp<size_t>(its.indices.size() / 64, 1, 65536);
+    const float  bucket_height = std::max(*mesh_max_z - bucket_min_z, float(EPSILON)) / float(num_buckets);
+    auto         bucket_idx    = [bucket_min_z, bucket_height, num_buckets](float z) { return std::min(size_t((z - bucket_min_z) / bucket_height), num_buckets - 1); };
+    std::vector<size_t> bucket_begin(num_buckets + 1, 0);
+    for (float z : face_min_z)
+        ++ bucket_begin[bucket_idx(z) + 1];
+    std::partial_sum(bucket_begin.begin(), bucket_begin.end(), bucket_begin.begin());
+    std::vector<int> order(its.indices.size());
+    {
+        std::vector<size_t> bucket_end(bucket_begin.begin(), bucket_begin.end() - 1);
+        for (size_t face_idx = 0; face_idx < its.indices.size(); ++ face_idx)
+            order[bucket_end[bucket_idx(face_min_z[face_idx])] ++] = int(face_idx);
+    }
+    throw_on_cancel();
+
+    m_indices.assign(its.indices.size(), stl_triangle_vertex_indices());
+    m_face_edge_ids.assign(its.indices.size(), Vec3i());
+    const size_t num_blocks = (its.indices.size() + FACE_BLOCK - 1) / FACE_BLOCK;
+    m_block_min_z.assign(num_blocks, 0.f);
+    m_block_max_z.assign(num_blocks, 0.f);
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, num_blocks, 1), [this, &its, &face_edge_ids, &face_min_z, &face_max_z, &order](const tbb::blocked_range<size_t> &range) {
+        for (size_t block_idx = range.begin(); block_idx < range.end(); ++ block_idx) {
+            const size_t begin = block_idx * FACE_BLOCK;
+            const size_t end   = std::min(begin + FACE_BLOCK, order.size());
+            float        min_z = std::numeric_limits<float>::max();
+            float        max_z = -std::numeric_limits<float>::max();
+            for (size_t i = begin; i < end; ++ i) {
+                m_indices[i]       = its.indices[order[i]];
+                m_face_edge_ids[i] = face_edge_ids[order[i]];
+                min_z = std::min(min_z, face_min_z[order[i]]);
+                max_z = std::max(max_z, face_max_z[order[i]]);
+            }
+            m_block_min_z[block_idx] = min_z;
+            m_block_max_z[block_idx] = max_z;
+        }
+    });
+    // The faces of a block are only roughly ordered, make the lowest Z of the blocks non decreasing for the binary search in make_lines().
+    for (size_t block_idx = num_blocks - 1; block_idx > 0; -- block_idx)
+        m_block_min_z[block_idx - 1] = std::min(m_block_min_z[block_idx - 1], m_block_min_z[block_idx]);
+    m_vertices = std::move(its.vertices);
+}
+
+size_t MeshSlicingSession::memsize() const
+{
+    return m_vertices.capacity() * sizeof(stl_vertex) + m_indices.capacity() * sizeof(stl_triangle_vertex_indices) +
+           m_face_edge_ids.capacity() * sizeof(Vec3i) + (m_block_min_z.capacity() + m_block_max_z.capacity()) * sizeof(float);
+}
+
+// Slice the faces block by block, each block into its own lines, which are then concatenated in the order of the blocks.
+// Contrary to slice_make_lines(), no locking is needed and the order of the lines does not depend on the scheduling of the threads.
+std::vector<IntersectionLines> MeshSlicingSession::make_lines(const std::vector<float> &zs, const std::function<void()> &throw_on_cancel) const
+{
+    std::vector<IntersectionLines> lines(zs.size(), IntersectionLines());
+    if (zs.empty() || m_indices.empty())
+        return lines;
+
+    struct BlockLines {
+        size_t                          first_slice { 0 };
+        std::vector<IntersectionLines>  lines;
+    };
+    // The blocks are ordered by their lowest Z, the blocks starting above the last Z are not sliced at all.
+    std::vector<BlockLines> blocks(std::upper_bound(m_block_min_z.begin(), m_block_min_z.end(), zs.back()) - m_block_min_z.begin());
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, blocks.size(), 1), [this, &zs, &blocks, &throw_on_cancel](const tbb::blocked_range<size_t> &range) {
+        for (size_t block_idx = range.begin(); block_idx < range.end(); ++ block_idx) {
+            throw_on_cancel();
+            if (m_block_max_z[block_idx] < zs.front())
+                continue;
+            BlockLines &out = blocks[block_idx];
+            auto zs_begin = std::lower_bound(zs.begin(), zs.end(), m_block_min_z[block_idx]);
+            auto zs_end   = std::upper_bound(zs_begin, zs.end(), m_block_max_z[block_idx]);
+            out.first_slice = zs_begin - zs.begin();
+            out.lines.assign(zs_end - zs_begin, IntersectionLines());
+            for (size_t face_idx = block_idx * FACE_BLOCK; face_idx < std::min((block_idx + 1) * FACE_BLOCK, m_indices.size()); ++ face_idx) {
+                const stl_triangle_vertex_indices &indices = m_indices[face_idx];
+                const stl_vertex vertices[3] { m_vertices[indices(0)], m_vertices[indices(1)], m_vertices[indices(2)] };
+                const float min_z = fminf(vertices[0].z(), fminf(vertices[1].z(), vertices[2].z()));
+                const float max_z = fmaxf(vertices[0].z(), fmaxf(vertices[1].z(), vertices[2].z()));
+                // Ignore horizontal triangles. Any valid horizontal triangle must have a vertical triangle connected, otherwise the part has zero volume.
+                if (min_z == max_z)
+                    continue;
+                auto min_layer = std::lower_bound(zs_begin, zs_end, min_z); // first layer whose slice_z is >= min_z
+                auto max_layer = std::upper_bound(min_layer, zs_end, max_z); // first layer whose slice_z is > max_z
+                int  idx_vertex_lowest = (vertices[1].z() == min_z) ? 1 : ((vertices[2].z() == min_z) ? 2 : 0);
+                for (auto it = min_layer; it != max_layer; ++ it) {
+                    IntersectionLine il;
+                    if (slice_facet(*it, vertices, indices, m_face_edge_ids[face_idx], idx_vertex_lowest, false, il) == FacetSliceType::Slicing) {
+                        assert(il.edge_type != IntersectionLine::FacetEdgeType::Horizontal);
+                        out.lines[it - zs_begin].emplace_back(il);
+                    }
+                }
+            }
+        }
+    });
+    throw_on_cancel();
+
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, zs.size()), [&blocks, &lines](const tbb::blocked_range<size_t> &range) {
+        for (size_t slice_id = range.begin(); slice_id < range.end(); ++ slice_id) {
+            size_t num_lines = 0;
+            for (const BlockLines &block : blocks)
+                if (slice_id >= block.first_slice && slice_id < block.first_slice + block.lines.size())
+                    num_lines += block.lines[slice_id - block.first_slice].size();
+            IntersectionLines &out = lines[slice_id];
+            out.reserve(num_lines);
+            for (const BlockLines &block : blocks)
+                if (slice_id >= block.first_slice && slice_id < block.first_slice + block.lines.size())
+                    append(out, block.lines[slice_id - block.first_slice]);
+        }
+    });
+    return lines;
+}
+
+std::vector<Polygons> MeshSlicingSession::slice(
+    const std::vector<float>         &zs,
+    const MeshSlicingParams          &params,
+    std::function<void()>             throw_on_cancel) const
+{
+    std::vector<IntersectionLines> lines = this->make_lines(zs, throw_on_cancel);
+    throw_on_cancel();
+    return make_loops(lines, params, throw_on_cancel);
+}
+
+std::vector<ExPolygons> MeshSlicingSession::slice_ex(
+    const std::vector<float>         &zs,
+    const MeshSlicingParamsEx        &params,
+    std::function<void()>             throw_on_cancel) const
+{
+    std::vector<Polygons> layers_p = this->slice(zs, slicing_params_for_polygons(params), throw_on_cancel);
+    return make_expolygons_layers(layers_p, params, throw_on_cancel);
+}
+
 // Slice a triangle set with a set of Z slabs (thick layers).
 // The effect is similar to producing the usual top / bottom layers from a sliced mesh by 
 // subtracting layer[i] from layer[i - 1] for the top surfaces resp.
@@ -8,6 +8,8 @@
 
 namespace Slic3r {
 
+class IntersectionLine;
+
 struct MeshSlicingParams
 {
     enum class SlicingMode : uint32_t {
@@ -94,6 +96,53 @@ inline std::vector<ExPolygons>  slice_mesh_ex(
     return slice_mesh_ex(mesh, zs, params, throw_on_cancel);
 }
 
+// Mesh prepared for slicing with many sets of Zs: the vertices transformed by trafo and scaled in XY,
+// the face edge ids and the faces ordered by their lowest Z. Built once per (mesh, trafo), a kept session
+// slices again without repeating the setup. PrintObject keeps the sessions of its support enforcers and
+// blockers, which are sliced again by each support generation, until posSlice is invalidated.
+// slice_mesh() / slice_mesh_ex() with multiple Zs and the model parts slice through a temporary session.
+class MeshSlicingSession
+{
+public:
+    MeshSlicingSession() = default;
+    // flip_triangles: reverse the orientation of the faces, as its_flip_triangles() does, for a left handed trafo.
+    MeshSlicingSession(const indexed_triangle_set &mesh, const Transform3d &trafo, bool flip_triangles = false,
+                       std::function<void()> throw_on_cancel = []{});
+
+    const Transform3d&              trafo() const { return m_trafo; }
+    bool                            empty() const { return m_indices.empty(); }
+    // Memory used by the session in bytes.
+    size_t                          memsize() const;
+
+    // params.trafo is ignored, the session trafo applies. Unscaled Zs.
+    std::vector<Polygons>           slice(
+        const std::vector<float>         &zs,
+        const MeshSlicingParams          &params,
+        std::function<void()>             throw_on_cancel = []{}) const;
+
+    std::vector<ExPolygons>         slice_ex(
+        const std::vector<float>         &zs,
+        const MeshSlicingParamsEx        &params,
+        std::function<void()>             throw_on_cancel = []{}) const;
+
+    // Number of consecutive faces (in the Z order) sliced by a single task.
+    static constexpr size_t         FACE_BLOCK = 16384;
+
+private:
+    friend std::vector<Polygons> slice_mesh(const indexed_triangle_set &, const std::vector<float> &, const MeshSlicingParams &, std::function<void()>);
+    std::vector<std::vector<IntersectionLine>> make_lines(const std::vector<float> &zs, const std::function<void()> &throw_on_cancel) const;
+
+    Transform3d                                 m_trafo { Transform3d::Identity() };
+    // Vertices transformed by m_trafo, scaled in XY, not in Z.
+    std::vector<stl_vertex>                     m_vertices;
+    // Faces and their edge ids, ordered by the lowest Z of the face.
+    std::vector<stl_triangle_vertex_indices>    m_indices;
+    std::vector<Vec3i>                          m_face_edge_ids;
+    // Lowest resp. highest Z of each block of FACE_BLOCK faces, to skip the blocks outside of the sliced Zs.
+    std::vector<float>                          m_block_min_z;
+    std::vector<float>                          m_block_max_z;
+};
+
 // Slice a triangle set with a set of Z slabs (thick layers).
 // The effect is similar to producing the usual top / bottom layers from a sliced mesh by 
 // subtracting layer[i] from layer[i - 1] for the top surfaces resp.
@@ -66,6 +66,7 @@
 
 
 namespace boost { namespace filesystem { class directory_entry; }}
+namespace boost { namespace iostreams { class mapped_file_source; }}
 
 namespace Slic3r {
 
@@ -194,6 +195,16 @@ extern CopyFileResult copy_file(const std::string &from, const std::string &to,
 // Compares two files if identical.
 extern CopyFileResult check_copy(const std::string& origin, const std::string& copy);
 
+//BBS: Memory map the whole file for reading. Returns false if the file could not be mapped
+// (empty file, special file, out of address space), the callers then fall back to buffered reading.
+extern bool map_file(const std::string &path, boost::iostreams::mapped_file_source &mapped);
+
+//BBS: size bound of the cache directories shared between runs (slice cache, OBJ cache). Removes the least recently used
+// files of dir with the given extension until they take at most max_size bytes. A cache hit refreshes the last write time
+// of its file by touch_cache_file(). Files may be removed while another process reads them, a missing file is a cache miss.
+extern void limit_cache_directory(const std::string &dir, const std::string &extension, uint64_t max_size);
+extern void touch_cache_file(const std::string &path);
+
 // Ignore system and hidden files, which may be created by the DropBox synchronisation process.
 // https://github.com/prusa3d/PrusaSlicer/issues/1298
 extern bool is_plain_file(const boost::filesystem::directory_entry &path);
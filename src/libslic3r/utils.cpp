@@ -57,6 +57,7 @@
 #include <boost/algorithm/string/predicate.hpp>
 #include <boost/filesystem.hpp>
 #include <boost/filesystem/path.hpp>
+#include <boost/iostreams/device/mapped_file.hpp>
 #include <boost/nowide/fstream.hpp>
 #include <boost/nowide/convert.hpp>
 #include <boost/nowide/cstdio.hpp>
@@ -980,6 +981,64 @@ CopyFileResult check_copy(const std::string &origin, const std::string &copy)
     return (f1.eof() && f2.eof() && fsize == 0) ? SUCCESS : FAIL_FILES_DIFFERENT;
 }
 
+bool map_file(const std::string &path, boost::iostreams::mapped_file_source &mapped)
+{
+    try {
+        boost::system::error_code ec;
+        boost::filesystem::path   file_path(path);
+        // Mapping of an empty file fails.
+        if (boost::filesystem::file_size(file_path, ec) == 0 || ec)
+            return false;
+        mapped.open(file_path);
+    } catch (const std::exception &ex) {
+        BOOST_LOG_TRIVIAL(info) << "map_file: failed to map " << path << ", falling back to buffered reading: " << ex.what();
+        return false;
+    }
+    return mapped.is_open();
+}
+
+void limit_cache_directory(const std::string &dir, const std::string &extension, uint64_t max_size)
+{
+    struct CacheFile {
+        std::time_t             last_used;
+        uint64_t                size;
+        boost::filesystem::path path;
+    };
+    std::vector<CacheFile> files;
+    uint64_t               total_size = 0;
+    boost::system::error_code ec;
+    for (boost::filesystem::directory_iterator it(dir, ec), end; ! ec && it != end; it.increment(ec)) {
+        const boost::filesystem::path &path = it->path();
+        if (path.extension() != extension || ! boost::filesystem::is_regular_file(it->status()))
+            continue;
+        boost::system::error_code file_ec;
+        uint64_t    size      = boost::filesystem::file_size(path, file_ec);
+        std::time_t last_used = file_ec ? 0 : boost::filesystem::last_write_time(path, file_ec);
+        if (! file_ec) {
+            files.push_back({ last_used, size, path });
+            total_size += size;
+        }
+    }
+    if (total_size <= max_size)
+        return;
+    std::sort(files.begin(), files.end(), [](const CacheFile &l, const CacheFile &r) { return l.last_used < r.last_used; });
+    for (const CacheFile &file : files) {
+        if (total_size <= max_size)
+            break;
+        // Fails on Windows for a file mapped by another process, it is then removed next time.
+        if (boost::filesystem::remove(file.path, ec) && ! ec) {
+            total_size -= file.size;
+            BOOST_LOG_TRIVIAL(info) << "limit_cache_directory: removed " << file.path.string();
+        }
+    }
+}
+
+void touch_cache_file(const std::string &path)
+{
+    boost::system::error_code ec;
+    boost::filesystem::last_write_time(path, std::time(nullptr), ec);
+}
+
 // Ignore system and hidden files, which may be created by the DropBox synchronisation process.
 bool is_plain_file(const boost::filesystem::directory_entry &dir_entry)
 {
@@ -591,6 +591,9 @@ DPIFrame(NULL, wxID_ANY, "", wxDefaultPosition, wxDefaultSize, BORDERLESS_FRAME_
         } else {
             Slic3r::set_backup_interval(0);
         }
+        std::string backup_compression_level = wxGetApp().app_config->get("backup_compression_level");
+        if (!backup_compression_level.empty())
+            Slic3r::set_backup_compression_level(std::atoi(backup_compression_level.c_str()));
         Slic3r::set_backup_callback([this](int action) {
             if (action == 0) {
                 wxPostEvent(this, wxCommandEvent(EVT_BACKUP_POST));
@@ -0,0 +1,196 @@
+#include <catch2/catch.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <set>
+
+#include "libslic3r/GCode/ConflictChecker.hpp"
+
+using namespace Slic3r;
+
+// Perimeter square and a zig-zag infill of a 20mm x 20mm object, the infill of the layers listed in extended_layers
+// reaches 10mm beyond the perimeter in the X direction.
+static ExtrusionLayers make_object_layers(size_t layer_count, const std::set<size_t> &extended_layers = {})
+{
+    static constexpr double size    = 20.;
+    static constexpr double spacing = 0.45;
+    static constexpr float  height  = 0.2f;
+
+    ExtrusionLayers layers;
+    layers.type = ExtrusionLayersType::PERIMETERS;
+    for (size_t layer_id = 0; layer_id < layer_count; ++ layer_id) {
+        ExtrusionLayer layer;
+        layer.layer    = nullptr;
+        layer.bottom_z = height * float(layer_id);
+        layer.height   = height;
+
+        ExtrusionPaths paths;
+        ExtrusionPath perimeter(erExternalPerimeter, 0.05, 0.45f, height);
+        perimeter.polyline.points = { Point::new_scale(0., 0.), Point::new_scale(size, 0.), Point::new_scale(size, size), Point::new_scale(0., size), Point::new_scale(0., 0.) };
+        paths.emplace_back(std::move(perimeter));
+
+        double x_max = extended_layers.count(layer_id) ? size * 1.5 : size - spacing;
+        ExtrusionPath infill(erInternalInfill, 0.05, 0.45f, height);
+        for (double y = spacing; y < size - spacing; y += 2. * spacing) {
+            infill.polyline.points.emplace_back(Point::new_scale(spacing, y));
+            infill.polyline.points.emplace_back(Point::new_scale(x_max, y));
+            infill.polyline.points.emplace_back(Point::new_scale(x_max, y + spacing));
+            infill.polyline.points.emplace_back(Point::new_scale(spacing, y + spacing));
+        }
+        paths.emplace_back(std::move(infill));
+        layer.own_toolpaths = FlatToolpaths(paths);
+        layers.push_back(std::move(layer));
+    }
+    return layers;
+}
+
+static void fill_queue(LinesBucketQueue &queue, const std::vector<ExtrusionLayers> &objects, const std::vector<Point> &offsets)
+{
+    for (size_t i = 0; i < objects.size(); ++ i) {
+        ExtrusionLayers layers = objects[i];
+        queue.emplace_back_bucket(std::move(layers), &objects[i], offsets[i]);
+    }
+}
+
+// The former conflict check: all lines of a layer rasterized into a map of grid cells, layer by layer from the bottom.
+static std::optional<std::pair<ConflictComputeResult, float>> find_conflict_reference(LinesBucketQueue &queue)
+{
+    while (queue.valid()) {
+        LineWithIDs lines;
+        for (const LinesBucketRange &range : queue.getCurRanges())
+            for (int i = range.begin; i < range.end; ++ i)
+                range.bucket->_piles[i].get_toolpaths().for_each_path([&](const FlatToolpaths::Path &path, const Point *begin, const Point *end) {
+                    if (path.no_extrusion)
+                        return;
+                    Polyline polyline(Points(begin, end));
+                    polyline.translate(range.bucket->_offset);
+                    for (const Line &line : polyline.lines())
+                        lines.emplace_back(line, range.bucket->_id, path.role);
+                });
+        float bottom_z = queue.getCurrBottomZ();
+        if (auto res = ConflictChecker::find_inter_of_lines(lines); res.has_value())
+            return std::make_pair(*res, bottom_z);
+    }
+    return {};
+}
+
+using Conflict = std::optional<std::pair<ConflictComputeResult, float>>;
+
+static void require_same_conflict(const Conflict &reference, const Conflict &conflict)
+{
+    REQUIRE(reference.has_value() == conflict.has_value());
+    if (reference.has_value()) {
+        REQUIRE(reference->second == conflict->second);
+        REQUIRE(std::minmax(reference->first._obj1, reference->first._obj2) == std::minmax(conflict->first._obj1, conflict->first._obj2));
+    }
+}
+
+static std::pair<Conflict, Conflict> find_conflicts(const std::vector<ExtrusionLayers> &objects, const std::vector<Point> &offsets)
+{
+    LinesBucketQueue queue_reference, queue;
+    fill_queue(queue_reference, objects, offsets);
+    fill_queue(queue, objects, offsets);
+    return { find_conflict_reference(queue_reference), ConflictChecker::find_inter_of_buckets(queue) };
+}
+
+SCENARIO("ConflictChecker: the bounding box culled check matches the map of grid cells", "[ConflictChecker]") {
+    GIVEN("a 4x4 grid of objects with 2mm gaps") {
+        std::vector<Point> offsets;
+        for (size_t i = 0; i < 16; ++ i)
+            offsets.emplace_back(Point::new_scale(22. * double(i % 4), 22. * double(i / 4)));
+        WHEN("no object reaches its neighbour") {
+            std::vector<ExtrusionLayers> objects(16, make_object_layers(20));
+            auto [reference, conflict] = find_conflicts(objects, offsets);
+            THEN("no conflict is reported") {
+                REQUIRE(! reference.has_value());
+                require_same_conflict(reference, conflict);
+            }
+        }
+        WHEN("the infill of an object crosses into its neighbour on a few layers") {
+            std::vector<ExtrusionLayers> objects(16, make_object_layers(20));
+            objects[5] = make_object_layers(20, { 7, 12, 19 });
+            auto [reference, conflict] = find_conflicts(objects, offsets);
+            THEN("the same objects conflict on the same lowest layer") {
+                REQUIRE(reference.has_value());
+                REQUIRE(reference->second == Approx(0.2f * 7));
+                require_same_conflict(reference, conflict);
+            }
+        }
+    }
+    GIVEN("two objects overlapping each other") {
+        std::vector<ExtrusionLayers> objects { make_object_layers(10), make_object_layers(10) };
+        for (double shift : { 5., 12.3, 19.9, 20.5 }) {
+            WHEN("the second object is shifted by " + std::to_string(shift) + "mm in X and Y") {
+                auto [reference, conflict] = find_conflicts(objects, { Point(0, 0), Point::new_scale(shift, shift) });
+                THEN("the conflicts match") {
+                    require_same_conflict(reference, conflict);
+                    REQUIRE(reference.has_value() == (shift < 20.));
+                }
+            }
+        }
+    }
+}
+
+SCENARIO("ConflictChecker: single layer checks match the map of grid cells", "[ConflictChecker]") {
+    GIVEN("layers of three objects at pseudo random positions") {
+        std::vector<ExtrusionLayers> objects { make_object_layers(1), make_object_layers(1, { 0 }), make_object_layers(1) };
+        uint32_t seed = 12345;
+        auto random_mm = [&seed]() { seed = seed * 1664525u + 1013904223u; return double(seed >> 8) / double(1 << 24) * 60.; };
+        for (int run = 0; run < 50; ++ run) {
+            std::vector<Point> offsets;
+            for (size_t i = 0; i < objects.size(); ++ i)
+                offsets.emplace_back(Point::new_scale(random_mm(), random_mm()));
+            LinesBucketQueue queue;
+            fill_queue(queue, objects, offsets);
+            LinesBucketRanges ranges = queue.getCurRanges();
+            LineWithIDs       lines;
+            for (const LinesBucketRange &range : ranges)
+                range.bucket->_piles[range.begin].get_toolpaths().for_each_path([&](const FlatToolpaths::Path &path, const Point *begin, const Point *end) {
+                    Polyline polyline(Points(begin, end));
+                    polyline.translate(range.bucket->_offset);
+                    for (const Line &line : polyline.lines())
+                        lines.emplace_back(line, range.bucket->_id, path.role);
+                });
+            // Which pair conflicts first depends on the order of the tests when all three objects overlap, only the presence is compared.
+            REQUIRE(ConflictChecker::find_inter_of_lines(lines).has_value() == ConflictChecker::find_inter_of_layer(ranges).has_value());
+        }
+    }
+}
+
+SCENARIO("ConflictChecker: the layer extrusions are read in place", "[ConflictChecker]") {
+    GIVEN("the flat toolpaths of a collection of a loop, a multi path and a nested collection") {
+        ExtrusionPath path(erPerimeter, 0.05, 0.45f, 0.2f);
+        path.polyline.points = { Point(0, 0), Point(1000, 0), Point(1000, 1000) };
+        ExtrusionEntityCollection nested;
+        nested.append(path);
+        ExtrusionEntityCollection collection;
+        collection.append(ExtrusionLoop(ExtrusionPaths{ path, path }));
+        collection.append(ExtrusionMultiPath(ExtrusionPaths{ path, path, path }));
+        collection.append(nested);
+        FlatToolpaths toolpaths({ &collection });
+        WHEN("a layer references them") {
+            ExtrusionLayers layers;
+            ExtrusionLayer  layer;
+            layer.toolpaths = &toolpaths;
+            layer.layer     = nullptr;
+            layer.bottom_z  = 0.f;
+            layer.height    = 0.2f;
+            layers.push_back(std::move(layer));
+            LinesBucketQueue queue;
+            queue.emplace_back_bucket(std::move(layers), &toolpaths, Point(0, 0));
+            THEN("the paths are read from the flat toolpaths without a copy, all the paths in the extrusion order") {
+                LinesBucketRanges ranges = queue.getCurRanges();
+                REQUIRE(ranges.size() == 1);
+                const FlatToolpaths &read = ranges.front().bucket->_piles[ranges.front().begin].get_toolpaths();
+                REQUIRE(&read == &toolpaths);
+                REQUIRE(read.paths().size() == 6);
+                LayerLines lines;
+                ranges.front().append_lines(lines, 0, BoundingBox(Point(-10, -10), Point(2000, 2000)));
+                REQUIRE(lines.size() == 12);
+                BoundingBox bbox = ranges.front().bounding_box();
+                REQUIRE(bbox.min == Point(0, 0));
+                REQUIRE(bbox.max == Point(1000, 1000));
+            }
+        }
+    }
+}
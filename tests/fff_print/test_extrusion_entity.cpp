@@ -4,6 +4,7 @@
 
 #include "libslic3r/ExtrusionEntityCollection.hpp"
 #include "libslic3r/ExtrusionEntity.hpp"
+#include "libslic3r/FlatToolpaths.hpp"
 #include "libslic3r/Point.hpp"
 #include "libslic3r/libslic3r.h"
 
@@ -83,3 +84,128 @@ SCENARIO("ExtrusionEntityCollection: Polygon flattening", "[ExtrusionEntity]") {
         }
     }
 }
+
+// All the paths of an extrusion entity tree in extrusion order.
+static void collect_paths(const ExtrusionEntity &entity, ExtrusionPaths &out)
+{
+    if (auto *collection = dynamic_cast<const ExtrusionEntityCollection*>(&entity))
+        for (const ExtrusionEntity *child : collection->entities)
+            collect_paths(*child, out);
+    else if (auto *loop = dynamic_cast<const ExtrusionLoop*>(&entity))
+        append(out, loop->paths);
+    else if (auto *multipath = dynamic_cast<const ExtrusionMultiPath*>(&entity))
+        append(out, multipath->paths);
+    else
+        out.push_back(*dynamic_cast<const ExtrusionPath*>(&entity));
+}
+
+SCENARIO("FlatToolpaths: round trip of an extrusion entity tree", "[ExtrusionEntity]") {
+    srand(0xDEADBEEF); // consistent seed for test reproducibility.
+
+    GIVEN("A collection with paths, a multi path, a loop and a nested no-sort collection") {
+        Slic3r::ExtrusionEntityCollection sample;
+        sample.append(random_path());
+        sample.append(ExtrusionPathOriented(erSupportMaterial, 0.5, 0.4f, 0.2f));
+        ExtrusionMultiPath multipath(random_paths(3));
+        multipath.paths[1].set_force_no_extrusion(true);
+        sample.append(multipath);
+        ExtrusionLoop loop(random_paths(2), elrContourInternalPerimeter);
+        loop.paths.back().mm3_per_mm = 0.25;
+        sample.append(loop);
+        Slic3r::ExtrusionEntityCollection sub_nosort;
+        sub_nosort.no_sort = true;
+        sub_nosort.append(random_paths(4));
+        Slic3r::ExtrusionEntityCollection sub_sub;
+        sub_sub.append(random_path());
+        sub_nosort.append(sub_sub);
+        sample.append(sub_nosort);
+        sample.append(random_path());
+
+        WHEN("The collection is flattened") {
+            FlatToolpaths flat(sample);
+            THEN("All the paths are stored in extrusion order") {
+                ExtrusionPaths expected;
+                collect_paths(sample, expected);
+                REQUIRE(flat.paths().size() == expected.size());
+                for (size_t i = 0; i < expected.size(); ++ i) {
+                    const FlatToolpaths::Path &path = flat.paths()[i];
+                    CHECK(Points(flat.path_begin(path), flat.path_end(path)) == expected[i].polyline.points);
+                    CHECK(path.role == expected[i].role());
+                    CHECK(path.mm3_per_mm == expected[i].mm3_per_mm);
+                    CHECK(path.width == expected[i].width);
+                    CHECK(path.height == expected[i].height);
+                    CHECK(path.no_extrusion == expected[i].is_force_no_extrusion());
+                }
+                CHECK(flat.total_volume() == Approx(sample.total_volume()));
+                CHECK(flat.paths()[3].no_extrusion);
+            }
+            THEN("The points and the paths of each entity are contiguous") {
+                size_t idx = 0;
+                for (const ExtrusionEntity *entity : sample.entities) {
+                    REQUIRE(idx < flat.entities().size());
+                    Points expected;
+                    entity->collect_points(expected);
+                    FlatToolpaths::Span<Point> points = flat.entity_points(idx);
+                    CHECK(Points(points.begin(), points.end()) == expected);
+                    CHECK(flat.entities()[idx].role == entity->role());
+                    idx = flat.next_sibling(idx);
+                }
+                CHECK(idx == flat.entities().size());
+                // The nested no-sort collection: 4 paths and a collection of a single path.
+                const FlatToolpaths::Entity &nosort = flat.entities()[4];
+                CHECK(nosort.type == FlatToolpaths::EntityType::Collection);
+                CHECK(nosort.num_descendants == 6);
+                CHECK(flat.entity_paths(4).size() == 5);
+            }
+            AND_WHEN("It is copied") {
+                FlatToolpaths copy(flat);
+                THEN("The copy owns its own memory block with the same content") {
+                    REQUIRE(copy.points().size() == flat.points().size());
+                    CHECK(copy.points().begin() != flat.points().begin());
+                    CHECK(Points(copy.points().begin(), copy.points().end()) == Points(flat.points().begin(), flat.points().end()));
+                    CHECK(copy.entities().size() == flat.entities().size());
+                    CHECK(copy.total_volume() == flat.total_volume());
+                    CHECK(copy.memsize() == flat.memsize());
+                }
+            }
+            AND_WHEN("It is converted back to a collection") {
+                Slic3r::ExtrusionEntityCollection output;
+                flat.to_collection(output);
+                THEN("The tree has the same shape and the paths have the same properties") {
+                    REQUIRE(output.entities.size() == sample.entities.size());
+                    CHECK(dynamic_cast<const ExtrusionPathOriented*>(output.entities[1]) != nullptr);
+                    CHECK(! output.entities[1]->can_reverse());
+                    const auto *out_loop = dynamic_cast<const ExtrusionLoop*>(output.entities[3]);
+                    REQUIRE(out_loop != nullptr);
+                    CHECK(out_loop->loop_role() == elrContourInternalPerimeter);
+                    CHECK(out_loop->paths.back().mm3_per_mm == 0.25);
+                    const auto *out_nosort = dynamic_cast<const ExtrusionEntityCollection*>(output.entities[4]);
+                    REQUIRE(out_nosort != nullptr);
+                    CHECK(out_nosort->no_sort);
+                    REQUIRE(out_nosort->entities.size() == 5);
+                    CHECK(out_nosort->entities.back()->is_collection());
+                    ExtrusionPaths expected, out;
+                    collect_paths(sample, expected);
+                    collect_paths(output, out);
+                    REQUIRE(out.size() == expected.size());
+                    for (size_t i = 0; i < expected.size(); ++ i) {
+                        CHECK(out[i].polyline.points == expected[i].polyline.points);
+                        CHECK(out[i].role() == expected[i].role());
+                        CHECK(out[i].mm3_per_mm == expected[i].mm3_per_mm);
+                        CHECK(out[i].width == expected[i].width);
+                        CHECK(out[i].is_force_no_extrusion() == expected[i].is_force_no_extrusion());
+                    }
+                    CHECK(output.entities.back()->min_mm3_per_mm() == sample.entities.back()->min_mm3_per_mm());
+                }
+            }
+        }
+    }
+    GIVEN("An empty collection") {
+        FlatToolpaths flat(Slic3r::ExtrusionEntityCollection{});
+        THEN("Nothing is allocated") {
+            CHECK(flat.empty());
+            CHECK(flat.entities().empty());
+            CHECK(flat.memsize() == sizeof(FlatToolpaths));
+        }
+    }
+}
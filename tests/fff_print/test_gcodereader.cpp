@@ -0,0 +1,191 @@
+#include <catch2/catch.hpp>
+
+#include <boost/filesystem.hpp>
+#include <boost/nowide/fstream.hpp>
+
+#include "libslic3r/GCodeReader.hpp"
+
+using namespace Slic3r;
+
+namespace {
+
+struct ParsedLines
+{
+    std::vector<std::string> raw;
+    std::vector<std::string> cmds;
+    std::vector<float>       positions;
+    std::vector<size_t>      lines_ends;
+};
+
+// Enough lines to span several chunks of GCodeReader::parse_file_parallel().
+static std::string make_test_gcode_file()
+{
+    std::string path = (boost::filesystem::temp_directory_path() / boost::filesystem::unique_path("gcodereader_%%%%-%%%%.gcode")).string();
+    boost::nowide::ofstream out(path, std::ios::binary);
+    out << "; generated by test\n";
+    for (int i = 0; i < 200000; ++ i) {
+        if (i % 1000 == 0)
+            out << ";LAYER_CHANGE\r\nG1 Z" << 0.2 * (i / 1000 + 1) << "\n";
+        out << "N" << i << " G1 X" << (i % 200) * 0.5 << " Y" << (i % 150) * 0.25 << " E" << 0.01 * i << " ; move " << i << "\n";
+        if (i % 7 == 0)
+            out << "   \n";
+        if (i % 11 == 0)
+            out << "G92 E0\nM204 S5000\n";
+    }
+    // Last line without a trailing newline.
+    out << "G1 X1 Y2 F3000";
+    return path;
+}
+
+template<typename ParseFn>
+static ParsedLines parse(ParseFn parse_fn)
+{
+    ParsedLines result;
+    GCodeReader reader;
+    parse_fn(reader, [&result](GCodeReader &reader, const GCodeReader::GCodeLine &line) {
+        result.raw.emplace_back(line.raw());
+        result.cmds.emplace_back(line.cmd());
+        result.positions.emplace_back(reader.x());
+        result.positions.emplace_back(reader.y());
+        result.positions.emplace_back(reader.e());
+    }, result.lines_ends);
+    return result;
+}
+
+} // anonymous namespace
+
+SCENARIO("GCodeReader: parallel parsing matches serial parsing", "[GCodeReader]") {
+    GIVEN("a G-code file spanning several parse chunks") {
+        std::string path = make_test_gcode_file();
+        ParsedLines serial = parse([&path](GCodeReader &reader, GCodeReader::callback_t callback, std::vector<size_t> &lines_ends) {
+            REQUIRE(reader.parse_file(path, callback, lines_ends));
+        });
+        ParsedLines parallel = parse([&path](GCodeReader &reader, GCodeReader::callback_t callback, std::vector<size_t> &lines_ends) {
+            REQUIRE(reader.parse_file_parallel(path, callback, lines_ends));
+        });
+        THEN("the same lines are reported in the same order with the same reader state") {
+            REQUIRE(parallel.raw.size() == serial.raw.size());
+            REQUIRE(parallel.raw == serial.raw);
+            REQUIRE(parallel.positions == serial.positions);
+            REQUIRE(parallel.lines_ends == serial.lines_ends);
+        }
+        boost::filesystem::remove(path);
+    }
+}
+
+SCENARIO("GCodeReader: parallel parsing emits move records without their raw text", "[GCodeReader]") {
+    GIVEN("a G-code file spanning several parse chunks") {
+        std::string path = make_test_gcode_file();
+        ParsedLines serial = parse([&path](GCodeReader &reader, GCodeReader::callback_t callback, std::vector<size_t> &lines_ends) {
+            REQUIRE(reader.parse_file(path, callback, lines_ends));
+        });
+        ParsedLines records = parse([&path](GCodeReader &reader, GCodeReader::callback_t callback, std::vector<size_t> &lines_ends) {
+            REQUIRE(reader.parse_file_parallel(path, callback, lines_ends, false));
+        });
+        THEN("the commands and the reader state match, only the moves without a comment miss their raw text") {
+            REQUIRE(records.raw.size() == serial.raw.size());
+            REQUIRE(records.cmds == serial.cmds);
+            REQUIRE(records.positions == serial.positions);
+            REQUIRE(records.lines_ends == serial.lines_ends);
+            size_t num_moves_without_raw = 0;
+            for (size_t i = 0; i < serial.raw.size(); ++ i)
+                if (records.raw[i].empty() && ! serial.raw[i].empty()) {
+                    REQUIRE(serial.cmds[i] == "G1");
+                    REQUIRE(serial.raw[i].find(';') == std::string::npos);
+                    ++ num_moves_without_raw;
+                } else
+                    REQUIRE(records.raw[i] == serial.raw[i]);
+            // The layer changes and the last line.
+            REQUIRE(num_moves_without_raw == 201);
+        }
+        boost::filesystem::remove(path);
+    }
+}
+
+SCENARIO("GCodeReader: vectorized tokenizer matches the scalar tokenizer", "[GCodeReader]") {
+    GIVEN("lines with tabs, comments, invalid values and unknown axes") {
+        const std::vector<std::string> lines {
+            "G1 X1.5 Y-2 E.0125 F1800",
+            "  G1\tX10\t\tY20 ;comment X5",
+            "G1 X1;comment directly after a value",
+            "G1 X1.5e Y2 Zabc E3",
+            "G1 X Y2",
+            "M204 S5000 T12 Q1",
+            "g1 x1 y2",
+            ";LAYER_CHANGE",
+            "",
+            "   ",
+            "G92 E0",
+            "G2 X10 Y10 I5 J0 P1 E0.5",
+            "G1 X12.345678901234 Y98.765432109876 Z0.123456789 E0.987654321 F12000 ; a line over sixty four characters",
+            "N100 G1 X1 Y1*77"
+        };
+        auto parse_line = [](GCodeReader &reader, const std::string &line) {
+            std::vector<float> result;
+            reader.parse_line(line, [&result](GCodeReader &, const GCodeReader::GCodeLine &gline) {
+                result.emplace_back(float(gline.cmd_type()));
+                for (int axis = 0; axis <= int(UNKNOWN_AXIS); ++ axis)
+                    result.emplace_back(gline.has(Axis(axis)) ? (axis < int(NUM_AXES) ? gline.value(Axis(axis)) : 1.f) : -1.f);
+            });
+            return result;
+        };
+        WHEN("the lines are parsed one by one and as a single buffer") {
+            // Short lines are tokenized by the scalar loop, the lines of a buffer with the separator masks.
+            GCodeReader        reader;
+            std::vector<float> expected;
+            std::string        buffer;
+            for (const std::string &line : lines) {
+                std::vector<float> parsed = parse_line(reader, line);
+                expected.insert(expected.end(), parsed.begin(), parsed.end());
+                buffer += line + "\n";
+            }
+            std::vector<float> parsed;
+            GCodeReader        reader2;
+            reader2.parse_buffer(buffer, [&parsed](GCodeReader &, const GCodeReader::GCodeLine &gline) {
+                parsed.emplace_back(float(gline.cmd_type()));
+                for (int axis = 0; axis <= int(UNKNOWN_AXIS); ++ axis)
+                    parsed.emplace_back(gline.has(Axis(axis)) ? (axis < int(NUM_AXES) ? gline.value(Axis(axis)) : 1.f) : -1.f);
+            });
+            THEN("the axes and the commands are the same") {
+                REQUIRE(parsed == expected);
+            }
+        }
+    }
+}
+
+SCENARIO("GCodeReader: short lines inside a large buffer are tokenized with the separator masks", "[GCodeReader]") {
+    GIVEN("a short line followed by further lines of a large buffer") {
+        const std::string line = "G1 X1.5 Y-2 E.0125";
+        std::string       buffer = line + "\nG1 Z5 F1800 ; the next line\n";
+        buffer += std::string(1024, ' ');
+        const char *ptr        = buffer.data();
+        const char *end        = ptr + line.size();
+        const char *buffer_end = ptr + buffer.size();
+        float                               axis[NUM_AXES] = { 0 };
+        uint32_t                            mask = 0;
+        std::pair<const char*, const char*> command;
+        WHEN("the line is tokenized up to its end inside the buffer") {
+            const char *line_end = GCodeReader::tokenize_line_vectorized(ptr, end, buffer_end, axis, mask, command);
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+            THEN("the vectorized tokenizer handles it and stops at the end of the line") {
+                REQUIRE(line_end == end);
+                REQUIRE(std::string(command.first, command.second) == "G1");
+                REQUIRE(mask == ((1u << X) | (1u << Y) | (1u << E)));
+                REQUIRE(axis[X] == Approx(1.5f));
+                REQUIRE(axis[Y] == Approx(-2.f));
+                REQUIRE(axis[E] == Approx(0.0125f));
+                REQUIRE(axis[Z] == 0.f);
+            }
+#else
+            THEN("the scalar tokenizer is used") {
+                REQUIRE(line_end == nullptr);
+            }
+#endif
+        }
+        WHEN("the buffer ends with the line") {
+            THEN("the vectorized tokenizer does not read beyond the buffer") {
+                REQUIRE(GCodeReader::tokenize_line_vectorized(ptr, end, end, axis, mask, command) == nullptr);
+            }
+        }
+    }
+}
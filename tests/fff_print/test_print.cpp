@@ -3,6 +3,15 @@
 #include "libslic3r/libslic3r.h"
 #include "libslic3r/Print.hpp"
 #include "libslic3r/Layer.hpp"
+#include "libslic3r/PerfReport.hpp"
+#include "libslic3r/SliceCache.hpp"
+#include "libslic3r/Utils.hpp"
+
+#include <sstream>
+
+#include <boost/filesystem.hpp>
+#include <boost/nowide/fstream.hpp>
+#include "nlohmann/json.hpp"
 
 #include "test_data.hpp"
 
@@ -126,3 +135,213 @@ SCENARIO("Print: Brim generation", "[Print]") {
         }
     }
 }
+
+SCENARIO("Print: Cached slice data round trip", "[Print]") {
+    GIVEN("sliced 20mm cube") {
+        Slic3r::Print print;
+        Slic3r::Test::init_and_process_print({TestMesh::cube_20x20x20}, print, { { "fill_density", 0.2 } });
+        const PrintObject &object = *print.objects().front();
+        std::vector<size_t> perimeter_counts, fill_counts;
+        std::vector<double> print_zs;
+        for (const Layer *layer : object.layers()) {
+            perimeter_counts.push_back(layer->regions().front()->perimeters.items_count());
+            fill_counts.push_back(layer->regions().front()->fills.items_count());
+            print_zs.push_back(layer->print_z);
+        }
+        std::string dir = (boost::filesystem::temp_directory_path() / boost::filesystem::unique_path("slice_cache_%%%%-%%%%")).string();
+        WHEN("the sliced data is exported in the binary format and loaded back") {
+            REQUIRE(print.export_cached_data(dir, false) == 0);
+            REQUIRE(print.load_cached_data(dir) == 0);
+            THEN("the layers and their extrusions are restored") {
+                REQUIRE(object.layers().size() == perimeter_counts.size());
+                for (size_t i = 0; i < object.layers().size(); ++ i) {
+                    const Layer *layer = object.layers()[i];
+                    REQUIRE(layer->print_z == print_zs[i]);
+                    REQUIRE(layer->regions().front()->perimeters.items_count() == perimeter_counts[i]);
+                    REQUIRE(layer->regions().front()->fills.items_count() == fill_counts[i]);
+                }
+            }
+            boost::filesystem::remove_all(dir);
+        }
+        WHEN("support enforcers are painted after the export") {
+            REQUIRE(print.export_cached_data(dir, false) == 0);
+            uint64_t checksum = SliceCache::object_checksum(object);
+            const_cast<ModelObject*>(object.model_object())->volumes.front()->supported_facets.set_triangle_from_string(0, "4");
+            THEN("the cached data is rejected") {
+                REQUIRE(SliceCache::object_checksum(object) != checksum);
+                REQUIRE(print.load_cached_data(dir) != 0);
+            }
+            boost::filesystem::remove_all(dir);
+        }
+    }
+}
+
+SCENARIO("Print: Content key of the slice cache", "[Print]") {
+    GIVEN("20mm cube") {
+        Slic3r::DynamicPrintConfig config = Slic3r::DynamicPrintConfig::full_print_config();
+        Slic3r::Print print;
+        Slic3r::Model model;
+        Slic3r::Test::init_print({TestMesh::cube_20x20x20}, print, model, config);
+        auto key_with = [&print, &model, &config](const std::string &opt_key, const std::string &value) {
+            Slic3r::DynamicPrintConfig new_config = config;
+            if (! opt_key.empty())
+                new_config.set_deserialize_strict(opt_key, value);
+            print.apply(model, new_config);
+            return SliceCache::content_key(*print.objects().front());
+        };
+        uint64_t key = key_with({}, {});
+        THEN("changing a print option the layers depend on misses the cache") {
+            REQUIRE(key_with("filament_diameter", "2.85") != key);
+            REQUIRE(key_with("skirt_height", "3") != key);
+            REQUIRE(key_with("nozzle_diameter", "0.6") != key);
+        }
+        THEN("changing a G-code only option reuses the cache") {
+            REQUIRE(key_with("nozzle_temperature", "235") == key);
+            REQUIRE(key_with("machine_start_gcode", "G28 ; home") == key);
+            REQUIRE(key_with("retraction_length", "2") == key);
+        }
+        THEN("painting the object misses the cache") {
+            const_cast<ModelObject*>(print.objects().front()->model_object())->volumes.front()->seam_facets.set_triangle_from_string(0, "4");
+            REQUIRE(SliceCache::content_key(*print.objects().front()) != key);
+        }
+    }
+}
+
+SCENARIO("Print: Size limit of the slice cache", "[Print]") {
+    GIVEN("a cache directory with four entries of 1000 bytes used at different times and a file of another type") {
+        boost::filesystem::path dir = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path("slice_cache_%%%%-%%%%");
+        boost::filesystem::create_directories(dir);
+        auto entry = [&dir](int i) { return (dir / (std::to_string(i) + SliceCache::FILE_EXTENSION)).string(); };
+        std::time_t now = std::time(nullptr);
+        for (int i = 0; i < 4; ++ i) {
+            boost::nowide::ofstream(entry(i), std::ios::binary) << std::string(1000, 'x');
+            boost::filesystem::last_write_time(entry(i), now - 1000 + i * 100);
+        }
+        boost::nowide::ofstream((dir / "other.json").string()) << std::string(5000, 'x');
+        WHEN("the oldest entry is used again and the cache is limited to 2500 bytes") {
+            touch_cache_file(entry(0));
+            limit_cache_directory(dir.string(), SliceCache::FILE_EXTENSION, 2500);
+            THEN("the least recently used entries are removed, the other files are kept") {
+                REQUIRE(boost::filesystem::exists(entry(0)));
+                REQUIRE(! boost::filesystem::exists(entry(1)));
+                REQUIRE(! boost::filesystem::exists(entry(2)));
+                REQUIRE(boost::filesystem::exists(entry(3)));
+                REQUIRE(boost::filesystem::exists(dir / "other.json"));
+            }
+        }
+        boost::filesystem::remove_all(dir);
+    }
+}
+
+SCENARIO("Print: Performance report", "[Print]") {
+    GIVEN("20mm cube sliced with the performance report enabled") {
+        PerfReport::enable(true);
+        // Disabled also if a REQUIRE below fails.
+        ScopeGuard disable_report([]() { PerfReport::enable(false); });
+        Slic3r::Print print;
+        Slic3r::Test::init_and_process_print({TestMesh::cube_20x20x20}, print, { { "fill_density", 0.2 } });
+        std::string path = (boost::filesystem::temp_directory_path() / boost::filesystem::unique_path("perf_report_%%%%-%%%%.json")).string();
+        REQUIRE(PerfReport::write(path));
+        THEN("the report contains the object steps with their layer counts") {
+            nlohmann::json report;
+            boost::nowide::ifstream ifs(path);
+            ifs >> report;
+            REQUIRE(report["traceEvents"].is_array());
+            bool found_perimeters = false;
+            for (const nlohmann::json &item : report["summary"])
+                if (item["category"] == "object" && item["name"] == "perimeters") {
+                    found_perimeters = true;
+                    REQUIRE(item["count"] == 1);
+                    REQUIRE(item["tasks"] == print.objects().front()->layer_count());
+                    REQUIRE(item["process_peak_rss_kb"].get<int64_t>() > 0);
+                }
+            REQUIRE(found_perimeters);
+        }
+        boost::filesystem::remove(path);
+    }
+}
+
+// G-code without the comment lines, which differ by the time stamps.
+static std::string non_comment_lines(const std::string &gcode)
+{
+    std::string out;
+    std::istringstream is(gcode);
+    for (std::string line; std::getline(is, line);)
+        if (! line.empty() && line.front() != ';')
+            out += line + "\n";
+    return out;
+}
+
+SCENARIO("Print: Low memory mode", "[Print]") {
+    GIVEN("two 20mm cubes sliced with and without the low memory mode") {
+        Slic3r::Print print, print_low_memory;
+        Slic3r::Model model, model_low_memory;
+        Slic3r::Test::init_print({ TestMesh::cube_20x20x20, TestMesh::cube_20x20x20 }, print, model, { { "fill_density", 0.2 } });
+        Slic3r::Test::init_print({ TestMesh::cube_20x20x20, TestMesh::cube_20x20x20 }, print_low_memory, model_low_memory, { { "fill_density", 0.2 } });
+        print_low_memory.set_low_memory_mode(true);
+        std::string gcode            = Slic3r::Test::gcode(print);
+        std::string gcode_low_memory = Slic3r::Test::gcode(print_low_memory);
+        THEN("the G-code is the same") {
+            REQUIRE(! gcode.empty());
+            REQUIRE(non_comment_lines(gcode) == non_comment_lines(gcode_low_memory));
+        }
+        THEN("the toolpaths of the exported layers are released, their outlines are kept") {
+            for (const PrintObject *object : print_low_memory.objects())
+                for (const Layer *layer : object->layers()) {
+                    REQUIRE(! layer->has_extrusions());
+                    REQUIRE(! layer->lslices.empty());
+                }
+            for (const PrintObject *object : print.objects())
+                REQUIRE(object->layers().front()->has_extrusions());
+        }
+    }
+    GIVEN("a 20mm cube processed in the low memory mode") {
+        Slic3r::Print print;
+        Slic3r::Model model;
+        Slic3r::Test::init_print({ TestMesh::cube_20x20x20 }, print, model, { { "fill_density", 0.2 } });
+        print.set_low_memory_mode(true);
+        print.process();
+        THEN("the fill areas are released once the infill was generated, the toolpaths and the surfaces are kept") {
+            const PrintObject *object = print.objects().front();
+            REQUIRE(object->is_step_done(posInfill));
+            for (const Layer *layer : object->layers()) {
+                REQUIRE(layer->regions().front()->fill_expolygons.empty());
+                REQUIRE(layer->regions().front()->fill_no_overlap_expolygons.empty());
+                REQUIRE(! layer->regions().front()->slices.empty());
+            }
+            REQUIRE(object->layers().front()->has_extrusions());
+            REQUIRE(! object->layers().front()->regions().front()->fill_surfaces.empty());
+        }
+    }
+    GIVEN("two 20mm cubes printed by object with two filaments, with and without the low memory mode") {
+        // The walls are printed with the second filament, the infill with the first one.
+        Slic3r::DynamicPrintConfig config = Slic3r::DynamicPrintConfig::full_print_config();
+        config.set_deserialize_strict({
+            { "print_sequence",     "by object" },
+            { "filament_diameter",  "1.75,1.75" },
+            { "wall_filament",      2 },
+            { "enable_prime_tower", 0 },
+            { "fill_density",       0.2 }
+        });
+        Slic3r::Print print, print_low_memory;
+        Slic3r::Model model, model_low_memory;
+        Slic3r::Test::init_print({ TestMesh::cube_20x20x20, TestMesh::cube_20x20x20 }, print, model, config);
+        Slic3r::Test::init_print({ TestMesh::cube_20x20x20, TestMesh::cube_20x20x20 }, print_low_memory, model_low_memory, config);
+        print_low_memory.set_low_memory_mode(true);
+        std::string gcode            = Slic3r::Test::gcode(print);
+        std::string gcode_low_memory = Slic3r::Test::gcode(print_low_memory);
+        THEN("the G-code is the same") {
+            REQUIRE(! gcode.empty());
+            REQUIRE(non_comment_lines(gcode) == non_comment_lines(gcode_low_memory));
+        }
+        THEN("the slices read by the G-code of the objects printed later are kept") {
+            for (const PrintObject *object : print_low_memory.objects()) {
+                REQUIRE(! object->layers().front()->regions().front()->raw_slices.empty());
+                for (const Layer *layer : object->layers()) {
+                    REQUIRE(! layer->has_extrusions());
+                    REQUIRE(! layer->regions().front()->slices.empty());
+                }
+            }
+        }
+    }
+}
@@ -1,7 +1,13 @@
 #include <catch2/catch.hpp>
 
+#include <tbb/global_control.h>
+#include <tbb/info.h>
+#include <tbb/parallel_for.h>
+
 #include "libslic3r/GCodeReader.hpp"
 #include "libslic3r/Layer.hpp"
+#include "libslic3r/Print.hpp"
+#include "libslic3r/Support/TreeSupport.hpp"
 
 #include "test_data.hpp" // get access to init_print, etc
 
@@ -119,6 +125,92 @@ SCENARIO("SupportMaterial: support_layers_z and contact_distance", "[SupportMate
     }
 }
 
+TEST_CASE("SupportMaterial: tree support nodes do not depend on the thread count", "[SupportMaterial]")
+{
+    // Layer and position of all the valid nodes of the tree support, sorted.
+    auto tree_support_nodes = [](int num_threads) {
+        tbb::global_control parallelism(tbb::global_control::max_allowed_parallelism, num_threads);
+        Slic3r::Print print;
+        Slic3r::Test::init_and_process_print({ TestMesh::overhang, TestMesh::bridge }, print, {
+            { "enable_support",   1 },
+            { "support_type",     "tree(auto)" },
+            { "support_style",    "tree_hybrid" }
+            });
+        std::vector<std::tuple<int, coord_t, coord_t>> nodes;
+        for (const PrintObject *object : print.objects())
+            if (std::shared_ptr<TreeSupportData> ts_data = const_cast<PrintObject*>(object)->alloc_tree_support_preview_cache(); ts_data)
+                for (const SupportNode *node : ts_data->contact_nodes)
+                    if (node->valid)
+                        nodes.emplace_back(node->obj_layer_nr, node->position.x(), node->position.y());
+        std::sort(nodes.begin(), nodes.end());
+        return nodes;
+    };
+
+    std::vector<std::tuple<int, coord_t, coord_t>> serial   = tree_support_nodes(1);
+    std::vector<std::tuple<int, coord_t, coord_t>> parallel = tree_support_nodes(std::max(4, tbb::info::default_concurrency()));
+    REQUIRE(! serial.empty());
+    REQUIRE(serial.size() == parallel.size());
+    REQUIRE(serial == parallel);
+}
+
+TEST_CASE("SupportMaterial: tree support avoidance does not depend on its cache", "[SupportMaterial]")
+{
+    Slic3r::Print print;
+    Slic3r::Test::init_and_process_print({ TestMesh::overhang }, print, { { "layer_height", 0.1 }, { "initial_layer_print_height", 0.1 } });
+    const PrintObject &object = *print.objects().front();
+    const std::vector<coordf_t> radii { 0.5, 1.2, 3. };
+    auto make_data = [&object]() {
+        auto data = std::make_unique<TreeSupportData>(object, 0.35, 0.1, 0.05);
+        for (size_t layer_nr = 0; layer_nr < object.layer_count(); ++ layer_nr)
+            data->layer_heights.emplace_back(object.get_layer(int(layer_nr))->print_z, object.get_layer(int(layer_nr))->height, layer_nr > 0 ? layer_nr - 1 : 0);
+        return data;
+    };
+    REQUIRE(object.layer_count() > 150);
+
+    // Serial recursion from the top layer down, the reference.
+    std::vector<std::vector<ExPolygons>> serial(radii.size());
+    {
+        std::unique_ptr<TreeSupportData> data = make_data();
+        for (size_t radius_idx = 0; radius_idx < radii.size(); ++ radius_idx)
+            for (size_t layer_nr = object.layer_count(); layer_nr > 0; -- layer_nr)
+                serial[radius_idx].emplace(serial[radius_idx].begin(), data->get_avoidance(radii[radius_idx], layer_nr - 1));
+    }
+
+    SECTION("all the layers requested concurrently are calculated once with the same result") {
+        std::unique_ptr<TreeSupportData> data = make_data();
+        std::vector<std::vector<ExPolygons>> concurrent(radii.size(), std::vector<ExPolygons>(object.layer_count()));
+        // Several threads request the same layers, from the top down as drop_nodes() does without the precalculation.
+        tbb::parallel_for(tbb::blocked_range<size_t>(0, 4 * radii.size() * object.layer_count()), [&](const tbb::blocked_range<size_t> &range) {
+            for (size_t i = range.begin(); i < range.end(); ++ i) {
+                size_t radius_idx = i % radii.size();
+                size_t layer_nr   = object.layer_count() - 1 - (i / radii.size()) % object.layer_count();
+                const ExPolygons &avoidance = data->get_avoidance(radii[radius_idx], layer_nr);
+                if (i < radii.size() * object.layer_count())
+                    concurrent[radius_idx][layer_nr] = avoidance;
+            }
+        });
+        REQUIRE(data->cache_stats().avoidance_layers == radii.size() * object.layer_count());
+        REQUIRE(concurrent == serial);
+    }
+
+    SECTION("the avoidance precalculated bottom up and trimmed to a small budget is the same") {
+        std::unique_ptr<TreeSupportData> data = make_data();
+        data->set_avoidance_cache_budget(64 * 1024);
+        data->precalculate_avoidance(std::vector<std::set<coordf_t>>(object.layer_count(), std::set<coordf_t>(radii.begin(), radii.end())));
+        REQUIRE(data->cache_stats().avoidance_bytes <= 64 * 1024);
+        REQUIRE(data->cache_stats().avoidance_evicted_layers > 0);
+        // Dropping the nodes from the top down, the layers are trimmed after each layer.
+        for (size_t layer_nr = object.layer_count(); layer_nr > 0; -- layer_nr) {
+            data->release_avoidance(layer_nr);
+            data->trim_avoidance_cache();
+            REQUIRE(data->cache_stats().avoidance_bytes <= 64 * 1024);
+            for (size_t radius_idx = 0; radius_idx < radii.size(); ++ radius_idx)
+                REQUIRE(data->get_avoidance(radii[radius_idx], layer_nr - 1) == serial[radius_idx][layer_nr - 1]);
+        }
+        REQUIRE(data->cache_stats().avoidance_peak_bytes > 64 * 1024);
+    }
+}
+
 #if 0
 // Test 8.
 TEST_CASE("SupportMaterial: forced support is generated", "[SupportMaterial]")
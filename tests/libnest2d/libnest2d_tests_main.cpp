@@ -1225,3 +1225,83 @@ TEST_CASE("Test for biggest bounding box area", "[Nesting], [NestKernels]")
     REQUIRE(pile.size() == N);
     REQUIRE(bb.area() == double(N) * N * W * W);
 }
+
+TEST_CASE("Copies of a part share the cached NFPs", "[Nesting], [NestKernels]")
+{
+    static const constexpr Slic3r::ClipperLib::cInt W = 10000000;
+    static const constexpr size_t N = 20;
+
+    auto bin = Box(250000000, 210000000);
+
+    auto arrange = [&bin](NfpPlacer::Config pconfig) {
+        std::vector<RectangleItem> input(N, {W, 2 * W});
+        // BIN_ID_UNSET equals BIN_ID_UNFIT, which the selection skips.
+        for (auto &itm : input) itm.binId(0);
+        nest(input, bin, 0, NestConfig{pconfig});
+        for (auto &itm : input) REQUIRE(itm.binId() == 0);
+
+        // The copies must not overlap.
+        MultiPolygon pile = merged_pile(input.begin(), input.end(), 0);
+        REQUIRE(sl::area(pile) == Approx(2. * N * W * W));
+        return input;
+    };
+
+    NfpPlacer::Config pconfig;
+    pconfig.object_function = [&bin](const Item &item, const _ItemGroup<PolygonImpl> &) -> double {
+        return pl::distance(item.boundingBox().center(), bin.center()) / double(W);
+    };
+    std::vector<RectangleItem> cached = arrange(pconfig);
+
+    // One NFP for each pair of the rotations of the stationary and the orbiting copy.
+    REQUIRE(pconfig.nfp_cache->size() > 0);
+    REQUIRE(pconfig.nfp_cache->size() <= pconfig.rotations.size() * pconfig.rotations.size());
+
+    pconfig.nfp_cache = nullptr;
+    pconfig.parallel = false;
+    std::vector<RectangleItem> uncached = arrange(pconfig);
+
+    // Neither the cache nor the parallel evaluation of the rotations changes the result.
+    for (size_t i = 0; i < N; ++i) {
+        REQUIRE(getX(cached[i].translation()) == getX(uncached[i].translation()));
+        REQUIRE(getY(cached[i].translation()) == getY(uncached[i].translation()));
+        REQUIRE(double(cached[i].rotation()) == Approx(double(uncached[i].rotation())));
+    }
+}
+
+TEST_CASE("The NFP cache checks the shapes on a hit", "[Nesting], [NestKernels]")
+{
+    using Cache = placers::NfpCache<PolygonImpl>;
+    static const constexpr Slic3r::ClipperLib::cInt W = 10000000;
+
+    RectangleItem stationary(W, 2 * W), orbiter(W, W), other(2 * W, W);
+    RectangleItem nfp(2 * W, 3 * W);
+
+    Cache cache;
+    Cache::Key key{stationary.shapeHash(), orbiter.shapeHash()};
+    cache.insert(key, stationary.transformedShape(), stationary.leftmostBottomVertex(),
+                 orbiter.transformedShape(), orbiter.leftmostBottomVertex(), nfp.transformedShape());
+    REQUIRE(cache.size() == 1);
+
+    // A translated copy of the stationary item gets the NFP moved along.
+    stationary.translation({3 * W, W});
+    PolygonImpl out;
+    REQUIRE(cache.find(key, stationary.transformedShape(), stationary.leftmostBottomVertex(),
+                       orbiter.transformedShape(), orbiter.leftmostBottomVertex(), out));
+    REQUIRE(sl::boundingBox(out).minCorner() == stationary.leftmostBottomVertex());
+    REQUIRE(sl::area(out) == Approx(sl::area(nfp.transformedShape())));
+
+    // Other shapes under the same key (a hash collision) do not get the NFP.
+    REQUIRE(!cache.find(key, other.transformedShape(), other.leftmostBottomVertex(),
+                        orbiter.transformedShape(), orbiter.leftmostBottomVertex(), out));
+    REQUIRE(!cache.find(key, stationary.transformedShape(), stationary.leftmostBottomVertex(),
+                        other.transformedShape(), other.leftmostBottomVertex(), out));
+
+    // And replace the entry when inserted.
+    cache.insert(key, other.transformedShape(), other.leftmostBottomVertex(),
+                 orbiter.transformedShape(), orbiter.leftmostBottomVertex(), nfp.transformedShape());
+    REQUIRE(cache.size() == 1);
+    REQUIRE(cache.find(key, other.transformedShape(), other.leftmostBottomVertex(),
+                       orbiter.transformedShape(), orbiter.leftmostBottomVertex(), out));
+    REQUIRE(!cache.find(key, stationary.transformedShape(), stationary.leftmostBottomVertex(),
+                        orbiter.transformedShape(), orbiter.leftmostBottomVertex(), out));
+}
@@ -2,9 +2,17 @@
 
 #include "libslic3r/Model.hpp"
 #include "libslic3r/Format/3mf.hpp"
+#include "libslic3r/Format/bbs_3mf.hpp"
+#include "libslic3r/Format/bbs_3mf_mesh.hpp"
 #include "libslic3r/Format/STL.hpp"
+#include "libslic3r/GCode/ThumbnailData.hpp"
+#include "libslic3r/miniz_extension.hpp"
 
 #include <boost/filesystem/operations.hpp>
+#include <boost/filesystem/path.hpp>
+
+#include <fstream>
+#include <sstream>
 
 using namespace Slic3r;
 
@@ -131,3 +139,408 @@ SCENARIO("2D convex hull of sinking object", "[3mf]") {
     }
 }
 
+
+// A mesh of a model file as written by the 3MF exporter, with vertex i at (i, i / 2, -i / 4) and triangle i
+// referencing the vertices i, i + 1, i + 2. Every third triangle is painted.
+static std::string mesh_xml(int num_vertices, int num_triangles)
+{
+    std::ostringstream out;
+    out.precision(10);
+    out << "  <mesh>\n   <vertices>\n";
+    for (int i = 0; i < num_vertices; ++ i)
+        out << "    <vertex x=\"" << i << "\" y=\"" << i * 0.5 << "\" z=\"" << i * -0.25 << "\"/>\n";
+    out << "   </vertices>\n   <triangles>\n";
+    for (int i = 0; i < num_triangles; ++ i) {
+        out << "    <triangle v1=\"" << i << "\" v2=\"" << i + 1 << "\" v3=\"" << i + 2 << "\"";
+        if (i % 3 == 0)
+            out << " paint_color=\"" << i % 16 << "C\"";
+        out << "/>\n";
+    }
+    out << "   </triangles>\n  </mesh>\n";
+    return out.str();
+}
+
+static std::string model_xml(const std::vector<std::string> &meshes)
+{
+    std::string out = "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n<model unit=\"millimeter\" xml:lang=\"en-US\">\n <resources>\n";
+    for (size_t i = 0; i < meshes.size(); ++ i)
+        out += " <object id=\"" + std::to_string(i + 1) + "\" type=\"model\">\n" + meshes[i] + " </object>\n";
+    return out + " </resources>\n</model>\n";
+}
+
+static void check_mesh(MeshXmlSections &sections, int num_vertices, int num_triangles)
+{
+    std::vector<Vec3f>         vertices;
+    MeshXmlSections::Triangles triangles;
+    REQUIRE(sections.take_vertices(vertices));
+    REQUIRE(sections.take_triangles(triangles));
+    REQUIRE(vertices.size() == size_t(num_vertices));
+    REQUIRE(triangles.indices.size() == size_t(num_triangles));
+    REQUIRE(triangles.mmu_segmentation.size() == size_t(num_triangles));
+    REQUIRE(triangles.custom_supports.size() == size_t(num_triangles));
+    bool all_equal = true;
+    for (int i = 0; i < num_vertices; ++ i)
+        all_equal &= vertices[i] == Vec3f(float(i), float(i * 0.5), float(i * -0.25));
+    for (int i = 0; i < num_triangles; ++ i)
+        all_equal &= triangles.indices[i] == Vec3i(i, i + 1, i + 2) && triangles.custom_supports[i].empty() &&
+            triangles.mmu_segmentation[i] == (i % 3 == 0 ? std::to_string(i % 16) + "C" : std::string());
+    REQUIRE(all_equal);
+}
+
+SCENARIO("Decoding the mesh sections of 3mf model files", "[3mf]") {
+    GIVEN("a model file with a small and a large mesh") {
+        // The large mesh is split into several chunks.
+        std::string xml = model_xml({ mesh_xml(4, 2), mesh_xml(100000, 150000) });
+        MeshXmlSections sections;
+        WHEN("decoded") {
+            bool ret = decode_mesh_xml_sections(xml.data(), xml.data() + xml.size(), sections);
+            THEN("all the vertices and triangles are decoded in the order of the document") {
+                REQUIRE(ret);
+                REQUIRE(sections.vertices.size() == 2);
+                REQUIRE(sections.triangles.size() == 2);
+                check_mesh(sections, 4, 2);
+                check_mesh(sections, 100000, 150000);
+                std::vector<Vec3f> vertices;
+                REQUIRE(! sections.take_vertices(vertices));
+            }
+            THEN("the skeleton keeps the rest of the document") {
+                REQUIRE(ret);
+                std::string empty_mesh = "  <mesh>\n   <vertices></vertices>\n   <triangles></triangles>\n  </mesh>\n";
+                REQUIRE(sections.skeleton == model_xml({ empty_mesh, empty_mesh }));
+            }
+        }
+    }
+    GIVEN("mesh sections with single quotes, white space, end tags and an empty section") {
+        std::string xml = "<model><object><mesh><vertices/><triangles >\r\n\t<triangle v3 = '3' v1='+1'\n v2=\"-2\" ></triangle ><triangle/></triangles></mesh></object></model>";
+        MeshXmlSections sections;
+        REQUIRE(decode_mesh_xml_sections(xml.data(), xml.data() + xml.size(), sections));
+        THEN("they are decoded as Expat would") {
+            std::vector<Vec3f>         vertices;
+            MeshXmlSections::Triangles triangles;
+            REQUIRE(sections.take_vertices(vertices));
+            REQUIRE(sections.take_triangles(triangles));
+            REQUIRE(vertices.empty());
+            REQUIRE(triangles.indices == std::vector<Vec3i>{ Vec3i(1, -2, 3), Vec3i::Zero() });
+            REQUIRE(sections.skeleton == "<model><object><mesh><vertices/><triangles ></triangles></mesh></object></model>");
+        }
+    }
+    GIVEN("vertices with explicit signs, as written by other 3mf producers") {
+        std::string xml = "<model><object><mesh><vertices><vertex x=\"+1.5\" y='-2' z=\"+1e1\"/><vertex x=\"+0\" y=\"3\"/></vertices></mesh></object></model>";
+        MeshXmlSections sections;
+        REQUIRE(decode_mesh_xml_sections(xml.data(), xml.data() + xml.size(), sections));
+        THEN("the coordinates are parsed including the plus signs") {
+            std::vector<Vec3f> vertices;
+            REQUIRE(sections.take_vertices(vertices));
+            REQUIRE(vertices == std::vector<Vec3f>{ Vec3f(1.5f, -2.f, 10.f), Vec3f(0.f, 3.f, 0.f) });
+        }
+    }
+    GIVEN("model files the fast path does not handle") {
+        auto decode = [](const std::string &xml) {
+            MeshXmlSections sections;
+            return decode_mesh_xml_sections(xml.data(), xml.data() + xml.size(), sections);
+        };
+        THEN("they are left to Expat") {
+            REQUIRE(! decode("<model><!-- <vertices> --><mesh><vertices></vertices></mesh></model>"));
+            REQUIRE(! decode("<model><mesh><triangles><triangle v1=\"&#49;\"/></triangles></mesh></model>"));
+            REQUIRE(! decode("<model><mesh><vertices><metadata/></vertices></mesh></model>"));
+            REQUIRE(! decode("<model><mesh><vertices><vertex x=\"1\"></vertices></mesh></model>"));
+            REQUIRE(! decode("<model><mesh><vertices><vertex x=\"1\"/>"));
+        }
+    }
+}
+
+// A project of two plates, the Prusa model on the first plate and two copies of a cube on the second one.
+static void make_project(Model &model, PlateDataPtrs &plates)
+{
+    std::string src_file = std::string(TEST_DATA_DIR) + "/test_3mf/Prusa.stl";
+    load_stl(src_file.c_str(), &model);
+    model.objects.front()->add_instance()->set_offset({ 100.0, 100.0, 0.0 });
+    ModelObject *cube = model.add_object("cube", "", TriangleMesh(its_make_cube(10.0, 20.0, 30.0)));
+    cube->add_instance()->set_offset({ 300.0, 100.0, 0.0 });
+    ModelInstance *rotated = cube->add_instance();
+    rotated->set_offset({ 350.0, 120.0, 0.0 });
+    rotated->set_rotation({ 0.0, 0.0, Geometry::deg2rad(30.0) });
+
+    for (int i = 0; i < 2; ++ i) {
+        plates.push_back(new PlateData());
+        plates.back()->plate_index = i;
+    }
+    plates[0]->objects_and_instances = { { 0, 0 } };
+    plates[1]->objects_and_instances = { { 1, 0 }, { 1, 1 } };
+}
+
+static void require_same_object(const ModelObject &src, const ModelObject &dst)
+{
+    REQUIRE(dst.name == src.name);
+    REQUIRE(dst.instances.size() == src.instances.size());
+    REQUIRE(dst.volumes.size() == src.volumes.size());
+    REQUIRE(dst.volumes.front()->mesh().its.indices.size() == src.volumes.front()->mesh().its.indices.size());
+    for (size_t i = 0; i < src.instances.size(); ++ i) {
+        BoundingBoxf3 src_bbox = src.instance_bounding_box(i);
+        BoundingBoxf3 dst_bbox = dst.instance_bounding_box(i);
+        REQUIRE(dst_bbox.min.isApprox(src_bbox.min, 1e-5));
+        REQUIRE(dst_bbox.max.isApprox(src_bbox.max, 1e-5));
+    }
+}
+
+static std::string read_archive_file(mz_zip_archive &archive, const std::string &name)
+{
+    size_t size = 0;
+    void  *data = mz_zip_reader_extract_file_to_heap(&archive, name.c_str(), &size, 0);
+    std::string out;
+    if (data != nullptr) {
+        out.assign((const char *) data, size);
+        mz_free(data);
+    }
+    return out;
+}
+
+SCENARIO("Export+Import of a project with thumbnails to/from bbs 3mf file", "[3mf]") {
+    GIVEN("a project of two plates with their thumbnails and the G-code of the second plate") {
+        Model         src_model;
+        PlateDataPtrs src_plates;
+        make_project(src_model, src_plates);
+        DynamicPrintConfig config = DynamicPrintConfig::full_print_config();
+
+        // Distinct pixels for every plate and kind of thumbnail, so that a thumbnail stored under a wrong name is detected.
+        std::vector<ThumbnailData> thumbnails(6);
+        for (size_t i = 0; i < thumbnails.size(); ++ i) {
+            thumbnails[i].set(256, 256);
+            for (size_t j = 0; j < thumbnails[i].pixels.size(); ++ j)
+                thumbnails[i].pixels[j] = (unsigned char) ((j * (i + 3)) / 7);
+        }
+
+        std::string tmp_dir   = boost::filesystem::temp_directory_path().string();
+        std::string gcode     = "; G-code of the second plate\nG1 X10 Y10 E1\n";
+        std::string gcode_src = (boost::filesystem::path(tmp_dir) / boost::filesystem::unique_path("%%%%-%%%%.gcode")).string();
+        std::ofstream(gcode_src, std::ios::binary) << gcode;
+        src_plates[1]->gcode_file      = gcode_src;
+        src_plates[1]->is_sliced_valid = true;
+
+        WHEN("the project is saved with one model file per object and loaded back") {
+            std::string test_file = (boost::filesystem::path(tmp_dir) / boost::filesystem::unique_path("%%%%-%%%%.3mf")).string();
+            std::vector<Preset*> project_presets;
+            StoreParams store_params;
+            store_params.path                = test_file.c_str();
+            store_params.model               = &src_model;
+            store_params.plate_data_list     = src_plates;
+            store_params.project_presets     = project_presets;
+            store_params.config              = &config;
+            store_params.thumbnail_data      = { &thumbnails[0], &thumbnails[1] };
+            store_params.top_thumbnail_data  = { &thumbnails[2], &thumbnails[3] };
+            store_params.pick_thumbnail_data = { &thumbnails[4], &thumbnails[5] };
+            store_params.strategy            = SaveStrategy::SplitModel | SaveStrategy::WithGcode | SaveStrategy::Silence | SaveStrategy::Zip64;
+            bool stored = store_bbs_3mf(store_params);
+            boost::filesystem::remove(gcode_src);
+
+            Model              dst_model;
+            PlateDataPtrs      dst_plates;
+            DynamicPrintConfig dst_config;
+            ConfigSubstitutionContext ctxt{ ForwardCompatibilitySubstitutionRule::Enable };
+            bool   is_bbl_3mf = false;
+            Semver file_version;
+            bool loaded = stored && load_bbs_3mf(test_file.c_str(), &dst_config, &ctxt, &dst_model, &dst_plates, &project_presets, &is_bbl_3mf,
+                &file_version, nullptr, LoadStrategy::LoadModel | LoadStrategy::LoadConfig);
+
+            mz_zip_archive archive;
+            mz_zip_zero_struct(&archive);
+            bool opened = stored && open_zip_reader(&archive, test_file);
+            THEN("the objects load back at their places") {
+                REQUIRE(stored);
+                REQUIRE(loaded);
+                REQUIRE(is_bbl_3mf);
+                REQUIRE(dst_model.objects.size() == src_model.objects.size());
+                for (size_t i = 0; i < src_model.objects.size(); ++ i)
+                    require_same_object(*src_model.objects[i], *dst_model.objects[i]);
+            }
+            THEN("every thumbnail is stored under the name of its plate") {
+                REQUIRE(opened);
+                const char *names[] = { "plate", "top", "pick" };
+                for (size_t i = 0; i < thumbnails.size(); ++ i) {
+                    size_t png_size = 0;
+                    void  *png = tdefl_write_image_to_png_file_in_memory_ex((const void *) thumbnails[i].pixels.data(), thumbnails[i].width, thumbnails[i].height, 4,
+                                                                            &png_size, MZ_DEFAULT_COMPRESSION, 1);
+                    REQUIRE(png != nullptr);
+                    std::string expected((const char *) png, png_size);
+                    mz_free(png);
+                    std::string name = "Metadata/" + std::string(names[i / 2]) + "_" + std::to_string(i % 2 + 1);
+                    REQUIRE(read_archive_file(archive, name + ".png") == expected);
+                    if (i < 2)
+                        REQUIRE(read_archive_file(archive, name + "_small.png").substr(1, 3) == "PNG");
+                }
+            }
+            THEN("the object model files and the G-code compressed on the worker threads are stored completely") {
+                REQUIRE(opened);
+                REQUIRE(read_archive_file(archive, "Metadata/plate_2.gcode") == gcode);
+                REQUIRE(mz_zip_reader_locate_file(&archive, "Metadata/plate_1.gcode", nullptr, 0) < 0);
+                for (const ModelObject *object : src_model.objects) {
+                    std::string object_model = read_archive_file(archive, "3D/Objects/object_" + std::to_string(src_model.get_object_backup_id(*object)) + ".model");
+                    REQUIRE(object_model.find("</model>") != std::string::npos);
+                }
+                REQUIRE(mz_zip_validate_archive(&archive, 0));
+            }
+            if (opened)
+                close_zip_reader(&archive);
+            release_PlateData_list(dst_plates);
+            boost::filesystem::remove(test_file);
+        }
+        release_PlateData_list(src_plates);
+    }
+}
+
+SCENARIO("Backup compression level of bbs 3mf files", "[3mf]") {
+    GIVEN("a project of two plates") {
+        Model         model;
+        PlateDataPtrs plates;
+        make_project(model, plates);
+        DynamicPrintConfig config = DynamicPrintConfig::full_print_config();
+        std::string tmp_dir = boost::filesystem::temp_directory_path().string();
+
+        // Save a backup at the compression level, return the compressed size and the content of every entry.
+        struct Entry { size_t compressed_size; std::string content; };
+        auto store_backup = [&](int level) {
+            set_backup_compression_level(level);
+            std::string test_file = (boost::filesystem::path(tmp_dir) / boost::filesystem::unique_path("%%%%-%%%%.3mf")).string();
+            std::vector<Preset*> project_presets;
+            StoreParams store_params;
+            store_params.path            = test_file.c_str();
+            store_params.model           = &model;
+            store_params.plate_data_list = plates;
+            store_params.project_presets = project_presets;
+            store_params.config          = &config;
+            store_params.strategy        = SaveStrategy::Backup | SaveStrategy::Zip64;
+            std::map<std::string, Entry> entries;
+            REQUIRE(store_bbs_3mf(store_params));
+            mz_zip_archive archive;
+            mz_zip_zero_struct(&archive);
+            REQUIRE(open_zip_reader(&archive, test_file));
+            for (mz_uint i = 0; i < mz_zip_reader_get_num_files(&archive); ++ i) {
+                mz_zip_archive_file_stat stat;
+                REQUIRE(mz_zip_reader_file_stat(&archive, i, &stat));
+                entries[stat.m_filename] = { size_t(stat.m_comp_size), read_archive_file(archive, stat.m_filename) };
+            }
+            close_zip_reader(&archive);
+            boost::filesystem::remove(test_file);
+            return entries;
+        };
+
+        WHEN("the backups are saved at the fastest and at the best compression") {
+            auto fastest = store_backup(MZ_BEST_SPEED);
+            auto best    = store_backup(MZ_BEST_COMPRESSION);
+            THEN("the level changes the size of the entries, not their content") {
+                REQUIRE(fastest.count("3D/3dmodel.model") == 1);
+                REQUIRE(fastest.size() == best.size());
+                size_t fastest_size = 0, best_size = 0;
+                for (const auto &[name, entry] : fastest) {
+                    REQUIRE(best.count(name) == 1);
+                    REQUIRE(entry.content == best[name].content);
+                    fastest_size += entry.compressed_size;
+                    best_size    += best[name].compressed_size;
+                }
+                REQUIRE(best_size < fastest_size);
+            }
+        }
+        WHEN("the backup is saved at a level out of range") {
+            auto stored    = store_backup(MZ_NO_COMPRESSION);
+            auto reference = store_backup(MZ_BEST_SPEED);
+            THEN("the level is clamped") {
+                REQUIRE(stored.size() == reference.size());
+                for (const auto &[name, entry] : stored)
+                    REQUIRE(entry.compressed_size == reference[name].compressed_size);
+            }
+        }
+        // Restore the default level of the backups for the other tests.
+        set_backup_compression_level(MZ_BEST_SPEED);
+        release_PlateData_list(plates);
+    }
+}
+
+// Copy the archive with the content of one file replaced.
+static bool copy_archive(const std::string &src, const std::string &dst, const std::string &name, const std::string &content)
+{
+    mz_zip_archive in, out;
+    mz_zip_zero_struct(&in);
+    mz_zip_zero_struct(&out);
+    if (! open_zip_reader(&in, src))
+        return false;
+    bool res = open_zip_writer(&out, dst);
+    for (mz_uint i = 0; res && i < mz_zip_reader_get_num_files(&in); ++ i) {
+        mz_zip_archive_file_stat stat;
+        res = mz_zip_reader_file_stat(&in, i, &stat) &&
+            (name == stat.m_filename ? mz_zip_writer_add_mem(&out, name.c_str(), content.data(), content.size(), MZ_DEFAULT_LEVEL) :
+                                       mz_zip_writer_add_from_zip_reader(&out, &in, i));
+    }
+    res = res && mz_zip_writer_finalize_archive(&out);
+    close_zip_writer(&out);
+    close_zip_reader(&in);
+    return res;
+}
+
+SCENARIO("Loading a single plate of a bbs 3mf file", "[3mf]") {
+    GIVEN("a project of two plates saved with one model file per object") {
+        Model         src_model;
+        PlateDataPtrs src_plates;
+        make_project(src_model, src_plates);
+        DynamicPrintConfig config = DynamicPrintConfig::full_print_config();
+        std::string tmp_dir   = boost::filesystem::temp_directory_path().string();
+        std::string test_file = (boost::filesystem::path(tmp_dir) / boost::filesystem::unique_path("%%%%-%%%%.3mf")).string();
+        std::vector<Preset*> project_presets;
+        StoreParams store_params;
+        store_params.path            = test_file.c_str();
+        store_params.model           = &src_model;
+        store_params.plate_data_list = src_plates;
+        store_params.project_presets = project_presets;
+        store_params.config          = &config;
+        store_params.strategy        = SaveStrategy::SplitModel | SaveStrategy::Silence | SaveStrategy::Zip64;
+        REQUIRE(store_bbs_3mf(store_params));
+
+        auto load_plate = [](const std::string &path, int plate_id, Model &model) {
+            PlateDataPtrs        plates;
+            std::vector<Preset*> presets;
+            DynamicPrintConfig   config;
+            ConfigSubstitutionContext ctxt{ ForwardCompatibilitySubstitutionRule::Enable };
+            bool   is_bbl_3mf = false;
+            Semver file_version;
+            bool res = load_bbs_3mf(path.c_str(), &config, &ctxt, &model, &plates, &presets, &is_bbl_3mf, &file_version, nullptr,
+                                    LoadStrategy::LoadModel | LoadStrategy::LoadConfig, nullptr, plate_id);
+            release_PlateData_list(plates);
+            return res;
+        };
+
+        WHEN("each plate is loaded") {
+            Model plate_1, plate_2;
+            bool  loaded_1 = load_plate(test_file, 1, plate_1);
+            bool  loaded_2 = load_plate(test_file, 2, plate_2);
+            THEN("only the objects of the plate load, with all their instances in place") {
+                REQUIRE(loaded_1);
+                REQUIRE(loaded_2);
+                REQUIRE(plate_1.objects.size() == 1);
+                require_same_object(*src_model.objects[0], *plate_1.objects.front());
+                REQUIRE(plate_2.objects.size() == 1);
+                require_same_object(*src_model.objects[1], *plate_2.objects.front());
+                REQUIRE(plate_2.objects.front()->instances.back()->get_rotation().isApprox(src_model.objects[1]->instances.back()->get_rotation()));
+            }
+        }
+        WHEN("the model file of the object on the first plate is broken") {
+            std::string broken_file = (boost::filesystem::path(tmp_dir) / boost::filesystem::unique_path("%%%%-%%%%.3mf")).string();
+            std::string object_file = "3D/Objects/object_" + std::to_string(src_model.get_object_backup_id(*src_model.objects[0])) + ".model";
+            REQUIRE(copy_archive(test_file, broken_file, object_file, "<model"));
+            Model plate_1, plate_2, all;
+            bool  loaded_1   = load_plate(broken_file, 1, plate_1);
+            bool  loaded_2   = load_plate(broken_file, 2, plate_2);
+            bool  loaded_all = load_plate(broken_file, 0, all);
+            boost::filesystem::remove(broken_file);
+            THEN("the second plate does not read it") {
+                REQUIRE(loaded_2);
+                REQUIRE(plate_2.objects.size() == 1);
+                require_same_object(*src_model.objects[1], *plate_2.objects.front());
+            }
+            THEN("the first plate and the whole project fail to load") {
+                REQUIRE(! loaded_1);
+                REQUIRE(! loaded_all);
+            }
+        }
+        boost::filesystem::remove(test_file);
+        release_PlateData_list(src_plates);
+    }
+}
@@ -0,0 +1,209 @@
+#include <catch2/catch.hpp>
+
+#include <functional>
+#include <string>
+
+#include "libslic3r/ClipperUtils.hpp"
+#include "libslic3r/TriangleMesh.hpp"
+#include "libslic3r/TriangleMeshSlicer.hpp"
+#include "libslic3r/Format/OBJ.hpp"
+
+using namespace Slic3r;
+
+// Switch the ClipperUtils backend for the lifetime of the object.
+class BackendScope
+{
+public:
+    BackendScope(ClipperUtils::Backend backend) : m_old(ClipperUtils::backend()) { ClipperUtils::set_backend(backend); }
+    ~BackendScope() { ClipperUtils::set_backend(m_old); }
+private:
+    ClipperUtils::Backend m_old;
+};
+
+static std::vector<ExPolygons> slice_model(const std::string &obj_filename, size_t max_layers)
+{
+    TriangleMesh mesh;
+    ObjInfo      obj_info;
+    std::string  message;
+    std::string  path = std::string(TEST_DATA_DIR) + "/" + obj_filename;
+    REQUIRE(load_obj(path.c_str(), &mesh, obj_info, message));
+    BoundingBoxf3      bbox = mesh.bounding_box();
+    std::vector<float> zs;
+    for (size_t i = 0; i < max_layers; ++ i)
+        zs.emplace_back(float(bbox.min.z() + (bbox.max.z() - bbox.min.z()) * (double(i) + 0.5) / double(max_layers)));
+    BackendScope scope(ClipperUtils::Backend::ClipperLib);
+    return slice_mesh_ex(mesh.its, zs);
+}
+
+static double perimeter(const ExPolygons &expolygons)
+{
+    double out = 0.;
+    for (const ExPolygon &expoly : expolygons) {
+        out += expoly.contour.length();
+        for (const Polygon &hole : expoly.holes)
+            out += hole.length();
+    }
+    return out;
+}
+
+// Number of contours and holes of the ExPolygons, which are not just specks left by rounding.
+static std::pair<size_t, size_t> count_significant(const ExPolygons &expolygons)
+{
+    const double min_area = sqr(scaled<double>(0.01));
+    std::pair<size_t, size_t> out { 0, 0 };
+    for (const ExPolygon &expoly : expolygons)
+        if (expoly.area() > min_area) {
+            ++ out.first;
+            for (const Polygon &hole : expoly.holes)
+                if (std::abs(hole.area()) > min_area)
+                    ++ out.second;
+        }
+    return out;
+}
+
+// Area of the symmetric difference of the two results, evaluated with ClipperLib.
+static double difference_area(const ExPolygons &a, const ExPolygons &b)
+{
+    BackendScope scope(ClipperUtils::Backend::ClipperLib);
+    return area(xor_ex(a, b));
+}
+
+struct DifferentialOp
+{
+    std::string                                                    name;
+    // Allowed deviation of the boundaries of the results of the two backends, scaled.
+    double                                                         tolerance;
+    // The number of ExPolygons and holes have to match, not counting the specks.
+    bool                                                           same_topology;
+    std::function<ExPolygons(const ExPolygons &, const ExPolygons &)> fn;
+};
+
+static std::vector<DifferentialOp> differential_ops()
+{
+    // Booleans only differ by rounding of the intersection points, offsets by the approximation of the arcs and
+    // by ClipperLib dropping the short edges before offsetting.
+    const double boolean_tolerance = scaled<double>(0.0005);
+    const double offset_tolerance  = scaled<double>(0.01);
+    const float  delta             = scaled<float>(0.4);
+    return {
+        { "union_ex",           boolean_tolerance, true,  [](const ExPolygons &a, const ExPolygons &b) { return union_ex(a, b); } },
+        { "diff_ex",            boolean_tolerance, true,  [](const ExPolygons &a, const ExPolygons &b) { return diff_ex(a, b); } },
+        { "intersection_ex",    boolean_tolerance, true,  [](const ExPolygons &a, const ExPolygons &b) { return intersection_ex(a, b); } },
+        // Slivers of the symmetric difference touching at a vertex are split differently by ClipperLib and Clipper2.
+        { "xor_ex",             boolean_tolerance, false, [](const ExPolygons &a, const ExPolygons &b) { return xor_ex(a, b); } },
+        { "diff safety offset", boolean_tolerance, false, [](const ExPolygons &a, const ExPolygons &b) { return diff_ex(a, b, ApplySafetyOffset::Yes); } },
+        { "union_ polygons",    boolean_tolerance, false, [](const ExPolygons &a, const ExPolygons &b) { return union_ex(union_(to_polygons(a), to_polygons(b))); } },
+        { "expand expolygons",  offset_tolerance,  false, [delta](const ExPolygons &a, const ExPolygons &) { return offset_ex(a, delta); } },
+        { "shrink expolygons",  offset_tolerance,  false, [delta](const ExPolygons &a, const ExPolygons &) { return offset_ex(a, - delta); } },
+        { "expand polygons",    offset_tolerance,  false, [delta](const ExPolygons &a, const ExPolygons &) { return offset_ex(to_polygons(a), delta); } },
+        { "shrink polygons",    offset_tolerance,  false, [delta](const ExPolygons &a, const ExPolygons &) { return offset_ex(to_polygons(a), - delta); } },
+        { "round offset",       offset_tolerance,  false, [delta](const ExPolygons &a, const ExPolygons &) { return offset_ex(a, delta, jtRound, scaled<double>(0.005)); } },
+        { "square offset",      offset_tolerance,  false, [delta](const ExPolygons &a, const ExPolygons &) { return offset_ex(a, delta, jtSquare); } },
+        { "opening",            offset_tolerance,  false, [delta](const ExPolygons &a, const ExPolygons &) { return offset2_ex(a, - delta, delta); } },
+        { "closing",            offset_tolerance,  false, [delta](const ExPolygons &a, const ExPolygons &) { return closing_ex(to_polygons(a), delta, delta); } },
+        { "offset polylines",   offset_tolerance,  false, [delta](const ExPolygons &a, const ExPolygons &) {
+            Polylines polylines;
+            for (const ExPolygon &expoly : a)
+                polylines.emplace_back(expoly.contour.split_at_first_point());
+            return union_ex(offset(polylines, delta));
+        } },
+    };
+}
+
+TEST_CASE("Clipper2 backend matches ClipperLib on sliced models", "[ClipperUtils][Clipper2]") {
+    auto model = GENERATE(as<std::string>{},
+        "20mm_cube.obj", "cube_with_hole.obj", "cube_with_concave_hole.obj", "two_hollow_squares.obj", "bridge.obj",
+        "overhang.obj", "pyramid.obj", "sloping_hole.obj", "ipadstand.obj", "extruder_idler.obj", "frog_legs.obj");
+    std::vector<ExPolygons> layers = slice_model(model, 20);
+    REQUIRE(! layers.empty());
+    for (const DifferentialOp &op : differential_ops()) {
+        for (size_t i = 0; i < layers.size(); ++ i) {
+            const ExPolygons &layer = layers[i];
+            const ExPolygons &next  = layers[std::min(i + 1, layers.size() - 1)];
+            ExPolygons out_clipperlib, out_clipper2;
+            {
+                BackendScope scope(ClipperUtils::Backend::ClipperLib);
+                out_clipperlib = op.fn(layer, next);
+            }
+            {
+                BackendScope scope(ClipperUtils::Backend::Clipper2);
+                out_clipper2 = op.fn(layer, next);
+            }
+            INFO(model << ", layer " << i << ", " << op.name);
+            CHECK(difference_area(out_clipperlib, out_clipper2) <= op.tolerance * std::max(perimeter(out_clipperlib), perimeter(out_clipper2)));
+            CHECK(area(out_clipper2) == Approx(area(out_clipperlib)).epsilon(0.01).margin(op.tolerance * op.tolerance));
+            if (op.same_topology) {
+                CHECK(count_significant(out_clipper2) == count_significant(out_clipperlib));
+            }
+        }
+    }
+}
+
+SCENARIO("Clipper2 backend PolyTree conversion", "[ClipperUtils][Clipper2]") {
+    BackendScope scope(ClipperUtils::Backend::Clipper2);
+    GIVEN("A square with a square hole and an island inside the hole") {
+        Polygon outer  = Polygon::new_scale({ { 0, 0 }, { 30, 0 }, { 30, 30 }, { 0, 30 } });
+        Polygon hole   = Polygon::new_scale({ { 5, 5 }, { 25, 5 }, { 25, 25 }, { 5, 25 } });
+        Polygon island = Polygon::new_scale({ { 10, 10 }, { 20, 10 }, { 20, 20 }, { 10, 20 } });
+        hole.reverse();
+        WHEN("united") {
+            ExPolygons out = union_ex(Polygons{ outer, hole, island });
+            THEN("the island is a separate ExPolygon") {
+                REQUIRE(out.size() == 2);
+                REQUIRE(out.front().holes.size() + out.back().holes.size() == 1);
+            }
+            THEN("contours are CCW, holes CW") {
+                for (const ExPolygon &expoly : out) {
+                    REQUIRE(expoly.contour.is_counter_clockwise());
+                    for (const Polygon &h : expoly.holes)
+                        REQUIRE(h.is_clockwise());
+                }
+            }
+            THEN("the area is preserved") {
+                REQUIRE(area(out) == Approx(outer.area() + hole.area() + island.area()));
+            }
+        }
+        WHEN("shrunk") {
+            ExPolygons out = offset_ex(Polygons{ outer, hole, island }, - scaled<float>(1.));
+            THEN("the hole grows and the island shrinks") {
+                REQUIRE(out.size() == 2);
+                REQUIRE(area(out) == Approx(sqr(scaled<double>(28.)) - sqr(scaled<double>(22.)) + sqr(scaled<double>(8.))));
+            }
+        }
+    }
+}
+
+SCENARIO("Clipper2 backend offsets by less than a unit", "[ClipperUtils][Clipper2]") {
+    GIVEN("A square with a square hole") {
+        Polygon outer = Polygon::new_scale({ { 0, 0 }, { 30, 0 }, { 30, 30 }, { 0, 30 } });
+        Polygon hole  = Polygon::new_scale({ { 5, 5 }, { 25, 5 }, { 25, 25 }, { 5, 25 } });
+        hole.reverse();
+        ExPolygon expoly(outer, hole);
+        for (float delta : { 0.f, 0.1f, -0.1f }) {
+            WHEN("offsetted by " + std::to_string(delta)) {
+                Polygons   polygons_clipperlib, polygons_clipper2;
+                ExPolygons expolygons_clipperlib, expolygons_clipper2;
+                {
+                    BackendScope scope(ClipperUtils::Backend::ClipperLib);
+                    polygons_clipperlib   = offset(Polygons{ outer, hole }, delta);
+                    expolygons_clipperlib = offset_ex(expoly, delta);
+                }
+                {
+                    BackendScope scope(ClipperUtils::Backend::Clipper2);
+                    polygons_clipper2   = offset(Polygons{ outer, hole }, delta);
+                    expolygons_clipper2 = offset_ex(expoly, delta);
+                }
+                THEN("the hole stays a CW hole as with ClipperLib") {
+                    REQUIRE(polygons_clipper2.size() == 2);
+                    REQUIRE(polygons_clipper2.size() == polygons_clipperlib.size());
+                    for (size_t i = 0; i < polygons_clipper2.size(); ++ i)
+                        REQUIRE(polygons_clipper2[i].is_counter_clockwise() == polygons_clipperlib[i].is_counter_clockwise());
+                    REQUIRE(area(polygons_clipper2) == Approx(outer.area() + hole.area()));
+                    REQUIRE(expolygons_clipper2.size() == 1);
+                    REQUIRE(expolygons_clipper2.front().holes.size() == 1);
+                    REQUIRE(area(expolygons_clipper2) == Approx(area(expolygons_clipperlib)));
+                }
+            }
+        }
+    }
+}
@@ -299,3 +299,38 @@ TEST_CASE("Traversing Clipper PolyTree", "[ClipperUtils]") {
         REQUIRE(count_polys(output) == reference.size());
     }
 }
+
+TEST_CASE("Clipper temporaries allocated from the thread local arena", "[ClipperUtils]") {
+    Polygon square { { 0, 0 }, { 1000, 0 }, { 1000, 1000 }, { 0, 1000 } };
+    Polygons holes;
+    for (coord_t i = 0; i < 4; ++ i)
+        for (coord_t j = 0; j < 4; ++ j) {
+            Polygon hole { { 100 + 200 * i, 100 + 200 * j }, { 100 + 200 * i, 200 + 200 * j }, { 200 + 200 * i, 200 + 200 * j }, { 200 + 200 * i, 100 + 200 * j } };
+            holes.emplace_back(std::move(hole));
+        }
+    ExPolygons shape = diff_ex(Polygons{ square }, holes);
+
+    auto process = [&shape, &holes]() {
+        ExPolygons out = offset_ex(shape, -20.f);
+        append(out, intersection_ex(offset(holes, 30.f), shape));
+        return union_ex(out);
+    };
+    ExPolygons expected = process();
+
+    ClipperArena::Arena &arena = ClipperArena::thread_arena();
+    {
+        ClipperLib::ArenaScope clipper_arena;
+        REQUIRE(ClipperArena::current() == &arena);
+        {
+            ClipperLib::ArenaScope nested;
+            REQUIRE(ClipperArena::current() == &arena);
+        }
+        REQUIRE(ClipperArena::current() == &arena);
+        ExPolygons result = process();
+        CHECK(result == expected);
+        // All the temporaries were released, the arena was rewound.
+        CHECK(arena.live() == 0);
+        CHECK(arena.capacity() > 0);
+    }
+    CHECK(ClipperArena::current() == nullptr);
+}
@@ -3,6 +3,8 @@
 #include <catch2/catch.hpp>
 
 #include "libslic3r/TriangleMesh.hpp"
+#include "libslic3r/TriangleMeshSlicer.hpp"
+#include "libslic3r/Geometry.hpp"
 
 using namespace Slic3r;
 
@@ -309,3 +311,50 @@ TEST_CASE("Simplified cube should not be empty.", "[its]")
     its_quadric_edge_collapse(its, wanted_count, &max_error);
     CHECK(!its.indices.empty());
 }
+
+TEST_CASE("Mesh slicing session matches slicing plane by plane", "[its][slice]")
+{
+    indexed_triangle_set its = its_make_sphere(10., 2. * PI / 64.);
+    its_merge(its, its_make_cylinder(3., 25.));
+    // Mirroring and rotation, the session has to flip the triangles back.
+    Transform3d trafo = Geometry::assemble_transform(Vec3d(1., 2., 0.), Vec3d(0.3, 0.2, 0.1), Vec3d(1., -1., 1.2));
+    indexed_triangle_set its_flipped = its;
+    its_flip_triangles(its_flipped);
+
+    std::vector<float> zs;
+    for (float z = -12.f; z < 32.f; z += 0.37f)
+        zs.emplace_back(z);
+
+    MeshSlicingParamsEx params;
+    params.trafo = trafo;
+    MeshSlicingSession session(its, trafo, true);
+    std::vector<ExPolygons> layers         = session.slice_ex(zs, params);
+    std::vector<ExPolygons> layers_batched = slice_mesh_ex(its_flipped, zs, params);
+    REQUIRE(layers.size() == zs.size());
+    REQUIRE(layers_batched.size() == zs.size());
+
+    auto area = [](const ExPolygons &expolys) {
+        double a = 0.;
+        for (const ExPolygon &expoly : expolys)
+            a += expoly.area();
+        return a;
+    };
+    size_t num_non_empty = 0;
+    for (size_t i = 0; i < zs.size(); ++ i) {
+        ExPolygons single = slice_mesh_ex(its_flipped, { zs[i] }, params).front();
+        REQUIRE(layers[i].size() == single.size());
+        REQUIRE(layers_batched[i].size() == single.size());
+        REQUIRE(area(layers[i]) == Approx(area(single)));
+        REQUIRE(area(layers_batched[i]) == Approx(area(single)));
+        if (! single.empty())
+            ++ num_non_empty;
+    }
+    REQUIRE(num_non_empty > 0);
+
+    // Slicing a subset of the heights with the same session.
+    std::vector<float> zs_subset { zs[10], zs[11], zs[50] };
+    std::vector<ExPolygons> subset = session.slice_ex(zs_subset, params);
+    REQUIRE(subset.size() == 3);
+    REQUIRE(subset[0].size() == layers[10].size());
+    REQUIRE(area(subset[2]) == Approx(area(layers[50])));
+}
@@ -0,0 +1,96 @@
+#include <catch2/catch.hpp>
+
+#include "libslic3r/Format/objparser.hpp"
+
+#include <fstream>
+#include <sstream>
+
+#include <boost/filesystem.hpp>
+
+using namespace ObjParser;
+
+// Large enough to be parsed in several chunks, using relative indices, materials and both line endings.
+static std::string make_obj(size_t num_quads)
+{
+	std::ostringstream out;
+	out << "mtllib test.mtl\n";
+	for (size_t i = 0; i < num_quads; ++ i) {
+		const char *eol = i % 3 == 0 ? "\r\n" : "\n";
+		if (i % 97 == 0)
+			out << "usemtl material_" << i % 5 << eol;
+		if (i % 1001 == 0)
+			out << "g group_" << i << eol << "s " << i % 2 << eol;
+		for (int j = 0; j < 4; ++ j)
+			out << "v " << double(i) * 0.125 << ' ' << double(j) - 0.5 << ' ' << double(i % 7) / 3. << " 0.5 0.25 1" << eol;
+		out << "vt " << double(i % 10) / 10. << " 0.5" << eol << "vn 0 0 1" << eol;
+		if (i % 2 == 0)
+			out << "f -4/-1/-1 -3/-1/-1 -2/-1/-1 -1/-1/-1" << eol;
+		else
+			out << "f " << 4 * i + 1 << "//" << i + 1 << ' ' << 4 * i + 2 << "//" << i + 1 << ' ' << 4 * i + 3 << "//" << i + 1 << eol;
+	}
+	// The last line is not terminated.
+	out << "f 1 2 3";
+	return out.str();
+}
+
+static void require_equal(const ObjData &data1, const ObjData &data2)
+{
+	REQUIRE(objequal(data1, data2));
+	REQUIRE(data1.has_vertex_color == data2.has_vertex_color);
+	REQUIRE(data1.smoothingGroups.size() == data2.smoothingGroups.size());
+	REQUIRE(data1.usemtls.size() == data2.usemtls.size());
+	for (size_t i = 0; i < data1.usemtls.size(); ++ i) {
+		REQUIRE(data1.usemtls[i].vertexIdxEnd == data2.usemtls[i].vertexIdxEnd);
+		REQUIRE(data1.usemtls[i].face_start == data2.usemtls[i].face_start);
+		REQUIRE(data1.usemtls[i].face_end == data2.usemtls[i].face_end);
+	}
+}
+
+SCENARIO("Parsing an OBJ file", "[obj]") {
+	GIVEN("an OBJ file of a few megabytes") {
+		std::string text = make_obj(20000);
+		std::string path = (boost::filesystem::temp_directory_path() / boost::filesystem::unique_path("%%%%-%%%%.obj")).string();
+		std::ofstream(path, std::ios::binary) << text;
+		ObjData reference;
+		std::istringstream stream(text);
+		REQUIRE(objparse(stream, reference));
+		REQUIRE(reference.vertices.size() == 10000 * 5 + 10000 * 4 + 4);
+		REQUIRE(reference.has_vertex_color);
+		WHEN("the file is parsed in parallel chunks") {
+			ObjData data;
+			bool    ok = objparse(path.c_str(), data);
+			boost::filesystem::remove(path);
+			THEN("the data match the data parsed from a stream") {
+				REQUIRE(ok);
+				require_equal(data, reference);
+			}
+		}
+		WHEN("the data are stored in the binary format") {
+			std::string bin_path = path + ".bin";
+			REQUIRE(objbinsave(bin_path.c_str(), reference, path.c_str()));
+			ObjData loaded;
+			bool    ok = objbinload(bin_path.c_str(), loaded, path.c_str());
+			THEN("they load back unchanged") {
+				REQUIRE(ok);
+				require_equal(loaded, reference);
+			}
+			THEN("they are not loaded for a modified OBJ file") {
+				std::ofstream(path, std::ios::binary | std::ios::app) << "\n";
+				ObjData stale;
+				REQUIRE(! objbinload(bin_path.c_str(), stale, path.c_str()));
+				ObjData cached;
+				REQUIRE(objparse_cached(path.c_str(), bin_path.c_str(), cached));
+				require_equal(cached, reference);
+				REQUIRE(objbinload(bin_path.c_str(), stale, path.c_str()));
+			}
+			THEN("they are not loaded for an OBJ file modified in place") {
+				// Same size, possibly the same modification time.
+				std::fstream(path, std::ios::binary | std::ios::in | std::ios::out).seekp(text.size() / 2) << (text[text.size() / 2] == '0' ? '1' : '0');
+				ObjData stale;
+				REQUIRE(! objbinload(bin_path.c_str(), stale, path.c_str()));
+			}
+			boost::filesystem::remove(bin_path);
+			boost::filesystem::remove(path);
+		}
+	}
+}
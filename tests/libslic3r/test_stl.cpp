@@ -1,8 +1,11 @@
 #include <catch2/catch.hpp>
 
 #include "libslic3r/Model.hpp"
+#include "libslic3r/TriangleMesh.hpp"
 #include "libslic3r/Format/STL.hpp"
 
+#include <boost/filesystem.hpp>
+
 using namespace Slic3r;
 
 static inline std::string stl_path(const char* path)
@@ -35,8 +38,7 @@ SCENARIO("Reading an STL file", "[stl]") {
 				REQUIRE(is_approx(model.objects.front()->volumes.front()->mesh().size(), Vec3d(20, 20, 20)));
 			}
 		}
-#if 0
-		// ASCII STLs ending with just carriage returns are not supported. These were used by the old Macs, while the Unix based MacOS uses LFs as any other Unix.
+		// ASCII STLs ending with just carriage returns were used by the old Macs. They are only read by its_read_stl(), not by admesh.
 		WHEN("line endings CR") {
 			Slic3r::Model model;
 			THEN("load should succeed") {
@@ -44,8 +46,6 @@ SCENARIO("Reading an STL file", "[stl]") {
 				REQUIRE(is_approx(model.objects.front()->volumes.front()->mesh().size(), Vec3d(20, 20, 20)));
 			}
 		}
-
-#endif
 		WHEN("nonstandard STL file (text after ending tags, invalid normals, for example infinities)") {
 			Slic3r::Model model;
 			THEN("load should succeed") {
@@ -55,3 +55,56 @@ SCENARIO("Reading an STL file", "[stl]") {
 		}
 	}
 }
+
+SCENARIO("Reading an STL file directly into an indexed triangle set", "[stl]") {
+	GIVEN("the 20mm box in binary and ASCII formats") {
+		auto path = GENERATE(as<std::string>{}, "Geräte/20mmbox-čřšřěá.stl", "ASCII/20mmbox-LF.stl", "ASCII/20mmbox-CRLF.stl", "ASCII/20mmbox-CR.stl", "ASCII/20mmbox-nonstandard.stl");
+		WHEN("read by its_read_stl()") {
+			indexed_triangle_set    its;
+			std::vector<stl_normal> normals;
+			bool                    canceled = true;
+			bool                    ok       = its_read_stl(stl_path(path.c_str()).c_str(), its, normals, canceled);
+			THEN("the box is read with its vertices merged") {
+				INFO(path);
+				REQUIRE(ok);
+				REQUIRE(! canceled);
+				REQUIRE(its.indices.size() == 12);
+				REQUIRE(normals.size() == 12);
+				REQUIRE(its.vertices.size() == 8);
+				REQUIRE(its_volume(its) == Approx(8000.));
+			}
+		}
+	}
+	GIVEN("a sphere stored as a binary STL") {
+		indexed_triangle_set sphere = its_make_sphere(10., PI / 90.);
+		std::string          path   = (boost::filesystem::temp_directory_path() / boost::filesystem::unique_path("%%%%-%%%%.stl")).string();
+		REQUIRE(its_write_stl_binary(path.c_str(), "sphere", sphere));
+		WHEN("loaded as a mesh") {
+			TriangleMesh mesh;
+			bool         ok = mesh.ReadSTLFile(path.c_str());
+			boost::filesystem::remove(path);
+			THEN("the mesh matches the sphere") {
+				REQUIRE(ok);
+				REQUIRE(mesh.its.indices.size() == sphere.indices.size());
+				REQUIRE(mesh.its.vertices.size() == sphere.vertices.size());
+				REQUIRE(mesh.stats().open_edges == 0);
+				REQUIRE(mesh.volume() == Approx(its_volume(sphere)));
+			}
+		}
+	}
+}
+
+TEST_CASE("Merging the vertices of a triangle soup", "[stl]") {
+	indexed_triangle_set    sphere = its_make_sphere(10., PI / 90.);
+	std::vector<stl_vertex> soup;
+	for (const stl_triangle_vertex_indices &face : sphere.indices)
+		for (int i = 0; i < 3; ++ i)
+			soup.emplace_back(sphere.vertices[face(i)]);
+	indexed_triangle_set merged = its_from_triangle_soup(soup);
+	indexed_triangle_set reference { {}, soup };
+	for (int i = 0; i < int(soup.size()); i += 3)
+		reference.indices.emplace_back(i, i + 1, i + 2);
+	its_merge_vertices(reference);
+	REQUIRE(merged.vertices == reference.vertices);
+	REQUIRE(merged.indices == reference.indices);
+}